@@ -1,108 +1,250 @@
 #include <ais/ais_decode.h>
 #include <ais/ais_demod.h>
+#include <ais/ais_demod_priv.h>
 #include <ais/ais_msg_format.h>
+#include <ais/ais_nmea.h>
+#include <ais/ais_vessel_table.h>
 
 #include <tsl/safe_alloc.h>
 #include <tsl/errors.h>
 #include <tsl/diag.h>
 #include <tsl/assert.h>
 
+#include <pthread.h>
+#include <stdatomic.h>
 #include <string.h>
 
-struct ais_decode {
+/**
+ * How long a packet is remembered for, in samples. A transmission that is heard on more than one
+ * channel arrives within a few milliseconds on each, while a station only repeats an identical
+ * packet after several seconds, if at all.
+ */
+#define AIS_DECODE_DEDUP_WINDOW         (AIS_INPUT_SAMPLE_RATE)
+
+/**
+ * Number of recent packets remembered. Two channels carry at most 75 slots a second between them.
+ */
+#define AIS_DECODE_DEDUP_ENTRIES        128
+
+/**
+ * The two AIS channels, 87B and 88B, known as A and B in NMEA sentences
+ */
+#define AIS_DECODE_CHANNEL_A_FREQ       161975000ul
+#define AIS_DECODE_CHANNEL_B_FREQ       162025000ul
+
+/**
+ * A recently delivered packet
+ */
+struct ais_decode_dedup_entry {
+    /**
+     * Hash of the packet contents and length, or 0 if the entry is unused
+     */
+    uint64_t hash;
+
+    /**
+     * Channel sample count when the packet was received
+     */
+    uint64_t when;
+};
+
+/**
+ * A single channel: its demodulator, and how far into its stream we are.
+ */
+struct ais_decode_channel {
+    struct ais_decode *decode;
     struct ais_demod *demod;
     uint32_t freq;
+
+    /**
+     * The channel, as named in NMEA sentences
+     */
+    char nmea_channel;
+
+    /**
+     * Samples consumed so far, including those skipped. All the channels come from the same
+     * wideband capture, so this is a common clock for comparing packets across channels.
+     */
+    uint64_t nr_samples;
+};
+
+struct ais_decode {
+    struct ais_decode_channel channels[AIS_DECODE_MAX_CHANNELS];
+    size_t nr_channels;
+
+    /**
+     * The dedup window: a ring of the most recently delivered packets. The channels can be fed
+     * from different threads, so this is protected by the lock.
+     */
+    pthread_mutex_t dedup_lock;
+    struct ais_decode_dedup_entry dedup[AIS_DECODE_DEDUP_ENTRIES];
+    size_t dedup_next;
+    uint64_t nr_duplicates;
+
     ais_decode_on_position_report_func_t on_position_report;
     ais_decode_on_base_station_report_func_t on_base_station_report;
     ais_decode_on_static_voyage_data_func_t on_static_voyage_data;
+
+    /**
+     * Callback for every message, of any type, and the fields it wants extracted
+     */
+    ais_decode_on_message_func_t on_message;
+    void *on_message_state;
+    struct ais_field_set message_fields;
+
+    /**
+     * The fields to extract from each message type, for all the callbacks
+     */
+    struct ais_field_set wanted[AIS_MESSAGE_TYPE_MAX + 1];
+
+    /**
+     * Whether any callback needs the message fields, or the raw message armored for it. If not,
+     * the only output is NMEA sentences, straight from the packet.
+     */
+    bool need_fields;
+
+    /**
+     * Callback for every message, formatted as NMEA sentences
+     */
+    ais_decode_on_nmea_func_t on_nmea;
+    void *on_nmea_state;
+
+    /**
+     * Next sequential message ID for multi-sentence messages. The channels can be fed from
+     * different threads.
+     */
+    atomic_uint nmea_seq_id;
+
+    /**
+     * The latest state of every vessel heard from, for rate limiting the position report and
+     * static and voyage data callbacks. NULL if every report is passed on.
+     */
+    struct ais_vessel_table *vessels;
 };
 
 #define DUMP(...)
 
-static
-uint32_t _ais_decode_get_bitfield(const uint8_t *packet, size_t packet_len,
-        size_t offset, size_t len)
-{
-    uint64_t acc = 0;
-    size_t nr_bytes = 0,
-           start_byte = offset/8,
-           end_byte = (offset + len + 7)/8,
-           end_rem_bits = 0;
-
-    nr_bytes = end_byte - start_byte;
-
-    TSL_BUG_ON(nr_bytes + start_byte > packet_len);
-
-    for (size_t i = 0; i < nr_bytes; i++) {
-        acc <<= 8;
-        acc |= packet[i + start_byte];
-    }
-
-    end_rem_bits = (end_byte * 8) - (offset + len);
+/**
+ * The fields the position report callback needs
+ */
+static const
+enum ais_field _ais_decode_position_report_fields[] = {
+    AIS_FIELD_NAV_STATUS,
+    AIS_FIELD_RATE_OF_TURN,
+    AIS_FIELD_SPEED_OVER_GROUND,
+    AIS_FIELD_POSITION_ACCURACY,
+    AIS_FIELD_LONGITUDE,
+    AIS_FIELD_LATITUDE,
+    AIS_FIELD_COURSE_OVER_GROUND,
+    AIS_FIELD_HEADING,
+    AIS_FIELD_SECOND,
+};
 
-    acc >>= end_rem_bits;
-    acc &= ((1ull << len) - 1);
+/**
+ * The fields the base station report callback needs
+ */
+static const
+enum ais_field _ais_decode_base_station_report_fields[] = {
+    AIS_FIELD_YEAR,
+    AIS_FIELD_MONTH,
+    AIS_FIELD_DAY,
+    AIS_FIELD_HOUR,
+    AIS_FIELD_MINUTE,
+    AIS_FIELD_SECOND,
+    AIS_FIELD_LONGITUDE,
+    AIS_FIELD_LATITUDE,
+    AIS_FIELD_EPFD_TYPE,
+};
 
-    return (uint32_t)acc;
-}
+/**
+ * The integer fields the static and voyage data callback needs. The text fields are extracted
+ * separately.
+ */
+static const
+enum ais_field _ais_decode_static_voyage_data_fields[] = {
+    AIS_FIELD_AIS_VERSION,
+    AIS_FIELD_IMO_NUMBER,
+    AIS_FIELD_SHIP_TYPE,
+    AIS_FIELD_DIM_TO_BOW,
+    AIS_FIELD_DIM_TO_STERN,
+    AIS_FIELD_DIM_TO_PORT,
+    AIS_FIELD_DIM_TO_STARBOARD,
+    AIS_FIELD_EPFD_TYPE,
+    AIS_FIELD_ETA_MONTH,
+    AIS_FIELD_ETA_DAY,
+    AIS_FIELD_ETA_HOUR,
+    AIS_FIELD_ETA_MINUTE,
+    AIS_FIELD_DRAUGHT,
+};
 
+/**
+ * Check that every one of the given fields was extracted, i.e. the message wasn't cut short.
+ */
 static
-int32_t _ais_decode_get_bitfield_signed(const uint8_t *packet, size_t packet_len,
-        size_t offset, size_t len)
+bool _ais_decode_has_fields(const struct ais_message *msg, const enum ais_field *fields, size_t nr_fields)
 {
-    uint32_t t = _ais_decode_get_bitfield(packet, packet_len, offset, len);
-    int32_t v = t << (32 - len);
-    return v >> (32 - len);
+    for (size_t i = 0; i < nr_fields; i++) {
+        if (false == ais_field_set_has(&msg->present, fields[i])) {
+            return false;
+        }
+    }
+
+    return true;
 }
 
 static
-void _ais_decode_get_string(const uint8_t *packet, size_t packet_len,
-        size_t offset, size_t nr_chars, char *dest)
+void _ais_decode_add_fields(struct ais_field_set *set, const enum ais_field *fields, size_t nr_fields)
 {
-    size_t base = offset;
-    memset(dest, 0, nr_chars);
-
-    for (size_t i = 0; i < nr_chars; i++) {
-        char v = _ais_decode_get_bitfield(packet, packet_len, base, 6);
-        /* Convert out of the 6-bit ASCII format */
-        dest[i] = v > 0x1f ? v : v + 0x40;
-        base += 6;
+    for (size_t i = 0; i < nr_fields; i++) {
+        ais_field_set_add(set, fields[i]);
     }
 }
 
+#define AIS_DECODE_NR_FIELDS(f)         (sizeof(f)/sizeof((f)[0]))
+
 static
-aresult_t _ais_decode_position_report(struct ais_decode *decode, const uint8_t *packet, size_t packet_len,
-        unsigned msg_id, unsigned repeat, uint32_t mmsi, const char *raw_msg)
+aresult_t _ais_decode_position_report(struct ais_decode *decode, uint64_t now_ms, const struct ais_message *msg,
+        const char *raw_msg)
 {
     aresult_t ret = A_OK;
 
     struct ais_position_report rpt;
+    bool emit = true;
 
     TSL_ASSERT_ARG(NULL != decode);
-    TSL_ASSERT_ARG(NULL != packet);
-    TSL_ASSERT_ARG(0 != packet_len);
+    TSL_ASSERT_ARG(NULL != msg);
+
+    if (false == _ais_decode_has_fields(msg, _ais_decode_position_report_fields,
+                AIS_DECODE_NR_FIELDS(_ais_decode_position_report_fields)))
+    {
+        goto done;
+    }
 
     memset(&rpt, 0, sizeof(rpt));
 
-    rpt.mmsi = mmsi;
-    rpt.nav_stat = _ais_decode_get_bitfield(packet, packet_len, 38, 4);
-    rpt.rate_of_turn = _ais_decode_get_bitfield_signed(packet, packet_len, 42, 8);
-    rpt.speed_over_ground = (float)_ais_decode_get_bitfield(packet, packet_len, 50, 10)/10.0;
-    rpt.position_acc = _ais_decode_get_bitfield(packet, packet_len, 60, 1);
-    rpt.longitude = (float)_ais_decode_get_bitfield_signed(packet, packet_len, 61, 28)/600000.0;
-    rpt.latitude = (float)_ais_decode_get_bitfield_signed(packet, packet_len, 89, 27)/600000.0;
-    rpt.course = _ais_decode_get_bitfield(packet, packet_len, 116, 12);
-    rpt.heading = _ais_decode_get_bitfield(packet, packet_len, 128, 9);
-    rpt.timestamp = _ais_decode_get_bitfield(packet, packet_len, 137, 6);
+    rpt.mmsi = msg->mmsi;
+    rpt.nav_stat = msg->values[AIS_FIELD_NAV_STATUS];
+    rpt.rate_of_turn = msg->values[AIS_FIELD_RATE_OF_TURN];
+    rpt.speed_over_ground = (float)msg->values[AIS_FIELD_SPEED_OVER_GROUND]/10.0;
+    rpt.position_acc = msg->values[AIS_FIELD_POSITION_ACCURACY];
+    rpt.longitude = (float)msg->values[AIS_FIELD_LONGITUDE]/600000.0;
+    rpt.latitude = (float)msg->values[AIS_FIELD_LATITUDE]/600000.0;
+    rpt.course = msg->values[AIS_FIELD_COURSE_OVER_GROUND];
+    rpt.heading = msg->values[AIS_FIELD_HEADING];
+    rpt.timestamp = msg->values[AIS_FIELD_SECOND];
 
     DUMP("  Nav Stat = %1u RoT = %3f SoG = %4.2f (%9.6f, %9.6f), CoG = %u Heading = %u Timestamp = %u\n",
             rpt.nav_stat, (double)rpt.rate_of_turn, (double)rpt.speed_over_ground, (double)rpt.latitude,
             (double)rpt.longitude, rpt.course, rpt.heading, rpt.timestamp);
 
-    if (NULL != decode->on_position_report) {
+    if (NULL != decode->vessels) {
+        TSL_BUG_IF_FAILED(ais_vessel_table_on_position_report(decode->vessels, now_ms, &rpt, raw_msg, &emit));
+    }
+
+    if (true == emit) {
         decode->on_position_report(decode, NULL, &rpt, raw_msg);
     }
 
+done:
     return ret;
 }
 
@@ -126,94 +268,160 @@ const char *_ais_decode_epfd_type[] = {
     [15] = "Unknown 15",
 };
 
+const char *ais_decode_epfd_name(uint32_t epfd_type)
+{
+    return _ais_decode_epfd_type[epfd_type & 0xf];
+}
+
 static
-aresult_t _ais_decode_base_station_report(struct ais_decode *decode, const uint8_t *packet, size_t packet_len,
-        unsigned msg_id, unsigned repeat, uint32_t mmsi, const char *raw_msg)
+aresult_t _ais_decode_base_station_report(struct ais_decode *decode, const struct ais_message *msg,
+        const char *raw_msg)
 {
     aresult_t ret = A_OK;
 
     struct ais_base_station_report bsr;
 
+    TSL_ASSERT_ARG(NULL != decode);
+    TSL_ASSERT_ARG(NULL != msg);
+
+    if (false == _ais_decode_has_fields(msg, _ais_decode_base_station_report_fields,
+                AIS_DECODE_NR_FIELDS(_ais_decode_base_station_report_fields)))
+    {
+        goto done;
+    }
+
     memset(&bsr, 0, sizeof(bsr));
 
-    bsr.mmsi = mmsi;
+    bsr.mmsi = msg->mmsi;
 
-    bsr.year = _ais_decode_get_bitfield(packet, packet_len, 38, 14);
-    bsr.month = _ais_decode_get_bitfield(packet, packet_len, 52, 4);
-    bsr.day = _ais_decode_get_bitfield(packet, packet_len, 56, 5);
-    bsr.hour = _ais_decode_get_bitfield(packet, packet_len, 61, 5);
-    bsr.minute = _ais_decode_get_bitfield(packet, packet_len, 66, 6);
-    bsr.second = _ais_decode_get_bitfield(packet, packet_len, 72, 6);
+    bsr.year = msg->values[AIS_FIELD_YEAR];
+    bsr.month = msg->values[AIS_FIELD_MONTH];
+    bsr.day = msg->values[AIS_FIELD_DAY];
+    bsr.hour = msg->values[AIS_FIELD_HOUR];
+    bsr.minute = msg->values[AIS_FIELD_MINUTE];
+    bsr.second = msg->values[AIS_FIELD_SECOND];
 
-    bsr.longitude = (float)_ais_decode_get_bitfield_signed(packet, packet_len, 79, 28)/600000.0;
-    bsr.latitude = (float)_ais_decode_get_bitfield_signed(packet, packet_len,  107, 27)/600000.0;
+    bsr.longitude = (float)msg->values[AIS_FIELD_LONGITUDE]/600000.0;
+    bsr.latitude = (float)msg->values[AIS_FIELD_LATITUDE]/600000.0;
 
-    bsr.epfd_type = _ais_decode_get_bitfield(packet, packet_len, 134, 4);
+    bsr.epfd_type = msg->values[AIS_FIELD_EPFD_TYPE];
     bsr.epfd_name = _ais_decode_epfd_type[bsr.epfd_type & 0xf];
 
     DUMP("  %04u-%02u-%02u-%02u:%02u:%02u - (%9.6f, %9.6f) - EPFD: %s (%u)\n",
             bsr.year, bsr.month, bsr.day, bsr.hour, bsr.minute, bsr.second, bsr.latitude,
             bsr.longitude, bsr.epfd_name, bsr.epfd_type);
 
-    if (NULL != decode->on_base_station_report) {
-        decode->on_base_station_report(decode, NULL, &bsr, raw_msg);
-    }
+    decode->on_base_station_report(decode, NULL, &bsr, raw_msg);
 
+done:
     return ret;
 }
 
 static
-aresult_t _ais_decode_static_voyage_data(struct ais_decode *decode, const uint8_t *packet, size_t packet_len,
-        unsigned msg_id, unsigned repeat, uint32_t mmsi, const char *raw_msg)
+aresult_t _ais_decode_static_voyage_data(struct ais_decode *decode, uint64_t now_ms, const struct ais_message *msg,
+        const char *raw_msg)
 {
     aresult_t ret = A_OK;
 
     struct ais_static_voyage_data asd;
+    bool emit = true;
 
     TSL_ASSERT_ARG(NULL != decode);
-    TSL_ASSERT_ARG(NULL != packet);
-    TSL_ASSERT_ARG(0 != packet_len);
+    TSL_ASSERT_ARG(NULL != msg);
+
+    if (false == _ais_decode_has_fields(msg, _ais_decode_static_voyage_data_fields,
+                AIS_DECODE_NR_FIELDS(_ais_decode_static_voyage_data_fields)))
+    {
+        goto done;
+    }
 
-    asd.mmsi = mmsi;
+    memset(&asd, 0, sizeof(asd));
 
-    asd.version = _ais_decode_get_bitfield(packet, packet_len, 38, 2);
-    asd.imo_number = _ais_decode_get_bitfield(packet, packet_len, 40, 30);
+    asd.mmsi = msg->mmsi;
 
-    _ais_decode_get_string(packet, packet_len, 70, 7, asd.callsign);
-    asd.callsign[7] = '\0';
-    _ais_decode_get_string(packet, packet_len, 112, 20, asd.ship_name);
-    asd.ship_name[20] = '\0';
+    asd.version = msg->values[AIS_FIELD_AIS_VERSION];
+    asd.imo_number = msg->values[AIS_FIELD_IMO_NUMBER];
 
-    asd.ship_type = _ais_decode_get_bitfield(packet, packet_len, 232, 8);
-    asd.dim_to_bow = _ais_decode_get_bitfield(packet, packet_len, 240, 9);
-    asd.dim_to_stern = _ais_decode_get_bitfield(packet, packet_len, 249, 9);
-    asd.dim_to_port = _ais_decode_get_bitfield(packet, packet_len, 258, 6);
-    asd.dim_to_starboard = _ais_decode_get_bitfield(packet, packet_len, 264, 6);
-    asd.fix_type = _ais_decode_get_bitfield(packet, packet_len, 270, 4);
+    ais_message_get_text(msg, AIS_FIELD_CALLSIGN, asd.callsign, sizeof(asd.callsign));
+    ais_message_get_text(msg, AIS_FIELD_SHIP_NAME, asd.ship_name, sizeof(asd.ship_name));
+
+    asd.ship_type = msg->values[AIS_FIELD_SHIP_TYPE];
+    asd.dim_to_bow = msg->values[AIS_FIELD_DIM_TO_BOW];
+    asd.dim_to_stern = msg->values[AIS_FIELD_DIM_TO_STERN];
+    asd.dim_to_port = msg->values[AIS_FIELD_DIM_TO_PORT];
+    asd.dim_to_starboard = msg->values[AIS_FIELD_DIM_TO_STARBOARD];
+    asd.fix_type = msg->values[AIS_FIELD_EPFD_TYPE];
     asd.epfd_name = _ais_decode_epfd_type[asd.fix_type & 0xf];
 
-    asd.eta_month = _ais_decode_get_bitfield(packet, packet_len, 274, 4);
-    asd.eta_day = _ais_decode_get_bitfield(packet, packet_len, 278, 5);
-    asd.eta_hour = _ais_decode_get_bitfield(packet, packet_len, 283, 5);
-    asd.eta_minute = _ais_decode_get_bitfield(packet, packet_len, 288, 6);
+    asd.eta_month = msg->values[AIS_FIELD_ETA_MONTH];
+    asd.eta_day = msg->values[AIS_FIELD_ETA_DAY];
+    asd.eta_hour = msg->values[AIS_FIELD_ETA_HOUR];
+    asd.eta_minute = msg->values[AIS_FIELD_ETA_MINUTE];
 
-    asd.draught = (float)_ais_decode_get_bitfield(packet, packet_len, 294, 8)/10.0;
+    asd.draught = (float)msg->values[AIS_FIELD_DRAUGHT]/10.0;
 
-    _ais_decode_get_string(packet, packet_len, 302, 20, asd.destination);
-    asd.destination[20] = '\0';
+    ais_message_get_text(msg, AIS_FIELD_DESTINATION, asd.destination, sizeof(asd.destination));
 
     DUMP("  V=%u Imo=%9u Callsign=[%s] Vessel=[%s] ShipType=%3u (%u, %u, %u, %u) Fix=%s ETA=%u-%u %u:%u Draught=%4.1f Destination=[%s]\n",
             asd.version, asd.imo_number, asd.callsign, asd.ship_name, asd.ship_type, asd.dim_to_bow,
             asd.dim_to_stern, asd.dim_to_port, asd.dim_to_starboard, asd.epfd_name,
             asd.eta_month, asd.eta_day, asd.eta_hour, asd.eta_minute, asd.draught, asd.destination);
 
-    if (NULL != decode->on_static_voyage_data) {
+    if (NULL != decode->vessels) {
+        TSL_BUG_IF_FAILED(ais_vessel_table_on_static_voyage_data(decode->vessels, now_ms, &asd, raw_msg, &emit));
+    }
+
+    if (true == emit) {
         decode->on_static_voyage_data(decode, NULL, &asd, raw_msg);
     }
 
+done:
     return ret;
 }
 
+/**
+ * Work out which fields to extract from each message type, for the callbacks that are set.
+ */
+static
+void _ais_decode_update_wanted(struct ais_decode *decode)
+{
+    memset(decode->wanted, 0, sizeof(decode->wanted));
+
+    for (size_t i = 0; i <= AIS_MESSAGE_TYPE_MAX; i++) {
+        struct ais_field_set *set = &decode->wanted[i];
+
+        if (NULL != decode->on_message) {
+            *set = decode->message_fields;
+        }
+
+        switch (i) {
+        case AIS_MESSAGE_POSITION_REPORT_SOTDMA:
+        case AIS_MESSAGE_POSITION_REPORT_SOTDMA2:
+        case AIS_MESSAGE_POSITION_REPORT_ITDMA:
+            if (NULL != decode->on_position_report) {
+                _ais_decode_add_fields(set, _ais_decode_position_report_fields,
+                        AIS_DECODE_NR_FIELDS(_ais_decode_position_report_fields));
+            }
+            break;
+        case AIS_MESSAGE_BASE_STATION_REPORT:
+            if (NULL != decode->on_base_station_report) {
+                _ais_decode_add_fields(set, _ais_decode_base_station_report_fields,
+                        AIS_DECODE_NR_FIELDS(_ais_decode_base_station_report_fields));
+            }
+            break;
+        case AIS_MESSAGE_SHIP_STATIC_INFO:
+            if (NULL != decode->on_static_voyage_data) {
+                _ais_decode_add_fields(set, _ais_decode_static_voyage_data_fields,
+                        AIS_DECODE_NR_FIELDS(_ais_decode_static_voyage_data_fields));
+            }
+            break;
+        }
+    }
+
+    decode->need_fields = NULL != decode->on_position_report || NULL != decode->on_base_station_report ||
+        NULL != decode->on_static_voyage_data || NULL != decode->on_message;
+}
+
 static
 char _ais_decode_to_ascii_armor(uint8_t in)
 {
@@ -224,6 +432,95 @@ char _ais_decode_to_ascii_armor(uint8_t in)
     }
 }
 
+/**
+ * Check if a packet was already delivered within the dedup window, on any channel, and remember
+ * it if not.
+ *
+ * \return true if the packet is a duplicate, and should be dropped.
+ */
+static
+bool _ais_decode_dedup(struct ais_decode *decode, uint64_t when, const uint8_t *packet, size_t packet_len)
+{
+    /* FNV-1a, seeded with the length. Never 0, since that marks an unused entry. */
+    uint64_t hash = 0xcbf29ce484222325ull ^ packet_len;
+    bool duplicate = false;
+
+    for (size_t i = 0; i < packet_len; i++) {
+        hash = (hash ^ packet[i]) * 0x100000001b3ull;
+    }
+
+    hash |= 1;
+
+    pthread_mutex_lock(&decode->dedup_lock);
+
+    for (size_t i = 0; i < AIS_DECODE_DEDUP_ENTRIES; i++) {
+        struct ais_decode_dedup_entry *ent = &decode->dedup[i];
+        /* The channels may be a little out of step, so the other copy can be from either side */
+        uint64_t age = when > ent->when ? when - ent->when : ent->when - when;
+
+        if (hash == ent->hash && AIS_DECODE_DEDUP_WINDOW >= age) {
+            duplicate = true;
+            break;
+        }
+    }
+
+    if (false == duplicate) {
+        decode->dedup[decode->dedup_next].hash = hash;
+        decode->dedup[decode->dedup_next].when = when;
+        decode->dedup_next = (decode->dedup_next + 1) % AIS_DECODE_DEDUP_ENTRIES;
+    } else {
+        decode->nr_duplicates++;
+    }
+
+    pthread_mutex_unlock(&decode->dedup_lock);
+
+    return duplicate;
+}
+
+/**
+ * Format a packet as NMEA sentences, and hand them to the callback. None of the fields are looked
+ * at, so this works for every message type.
+ */
+static
+void _ais_decode_emit_nmea(struct ais_decode *decode, struct ais_decode_channel *chan, const uint8_t *packet,
+        size_t packet_len)
+{
+    char sentences[AIS_NMEA_BUF_LEN(AIS_PACKET_BYTES)];
+    size_t len = 0;
+    unsigned seq_id = 0;
+
+    if (AIS_NMEA_FRAGMENT_BYTES < packet_len) {
+        seq_id = atomic_fetch_add(&decode->nmea_seq_id, 1) % 10;
+    }
+
+    if (FAILED(ais_nmea_format(sentences, sizeof(sentences), &len, packet, packet_len, chan->nmea_channel, seq_id))) {
+        DUMP("Failed to format packet as NMEA (Len: %zu bytes)\n", packet_len);
+        return;
+    }
+
+    decode->on_nmea(decode, decode->on_nmea_state, sentences, len);
+}
+
+/**
+ * Emit the latest reports for a vessel, as part of a snapshot of the vessel table.
+ */
+static
+aresult_t _ais_decode_on_vessel(struct ais_vessel_table *table, void *state, const struct ais_vessel *vessel)
+{
+    struct ais_decode *decode = state;
+
+    if (true == vessel->has_position && NULL != decode->on_position_report) {
+        struct ais_position_report rpt = vessel->position;
+        decode->on_position_report(decode, NULL, &rpt, vessel->position_raw_msg);
+    }
+
+    if (true == vessel->has_static_voyage_data && NULL != decode->on_static_voyage_data) {
+        struct ais_static_voyage_data svd = vessel->static_voyage_data;
+        decode->on_static_voyage_data(decode, NULL, &svd, vessel->static_voyage_raw_msg);
+    }
+
+    return A_OK;
+}
 
 static
 aresult_t _ais_decode_demod_on_msg(struct ais_demod *demod, void *state, const uint8_t *packet,
@@ -231,17 +528,36 @@ aresult_t _ais_decode_demod_on_msg(struct ais_demod *demod, void *state, const u
 {
     aresult_t ret = A_OK;
 
-    uint8_t msg_id = 0,
-            repeat = 0;
-    uint32_t mmsi = 0;
+    unsigned msg_id = 0;
     size_t offs = 0;
-    struct ais_decode *decode = state;
+    uint64_t now_ms = 0;
+    struct ais_decode_channel *chan = state;
+    struct ais_decode *decode = NULL;
+    struct ais_message msg;
+    uint8_t padded[AIS_PACKET_BYTES + AIS_MESSAGE_PACKET_PAD];
     char msg_ascii_6[(168+(4*256)+5)/6];
 
     TSL_ASSERT_ARG(NULL != demod);
     TSL_ASSERT_ARG(NULL != state);
     TSL_ASSERT_ARG(NULL != packet);
     TSL_ASSERT_ARG(0 != packet_len);
+    TSL_ASSERT_ARG(AIS_PACKET_BYTES >= packet_len);
+
+    decode = chan->decode;
+    now_ms = chan->nr_samples * 1000 / AIS_INPUT_SAMPLE_RATE;
+
+    if (true == _ais_decode_dedup(decode, chan->nr_samples, packet, packet_len)) {
+        DUMP("Dropping duplicate packet on %u Hz (Len: %zu bytes)\n", chan->freq, packet_len);
+        goto done;
+    }
+
+    if (NULL != decode->on_nmea) {
+        _ais_decode_emit_nmea(decode, chan, packet, packet_len);
+    }
+
+    if (false == decode->need_fields) {
+        goto done;
+    }
 
     memset(msg_ascii_6, 0, sizeof(msg_ascii_6));
 
@@ -258,34 +574,51 @@ aresult_t _ais_decode_demod_on_msg(struct ais_demod *demod, void *state, const u
         }
     }
 
-    /* Extract the message type */
-    msg_id = (packet[0] >> 2) & 0x3f;
+    /* Pad the packet out, so the fields can be extracted a 64-bit window at a time */
+    memcpy(padded, packet, packet_len);
+    memset(padded + packet_len, 0, AIS_MESSAGE_PACKET_PAD);
 
-    /* Extract repeat indicator */
-    repeat = packet[0] & 0x3;
+    /* Peek at the message type, to find out which fields are wanted from it */
+    msg_id = padded[0] >> 2;
 
-    /* Extract the MMSI from the packet */
-    mmsi  = (uint32_t)packet[1] << 22;
-    mmsi |= (uint32_t)packet[2] << 14;
-    mmsi |= (uint32_t)packet[3] << 6;
-    mmsi |= ((uint32_t)packet[4] >> 2) & 0x3f;
+    if (FAILED(ais_message_extract(&msg, padded, packet_len,
+                    AIS_MESSAGE_TYPE_MAX >= msg_id ? &decode->wanted[msg_id] : &decode->message_fields)))
+    {
+        DUMP("Packet too short to be an AIS message (Len: %zu bytes)\n", packet_len);
+        goto done;
+    }
 
-    DUMP("MsgId: %02u Rpt: %1u MMSI: %9u (Len: %zu bytes)\n", msg_id, repeat, mmsi, packet_len);
+    DUMP("MsgId: %02u Rpt: %1u MMSI: %9u (Len: %zu bytes)\n", msg.msg_id, msg.repeat, msg.mmsi, packet_len);
 
-    switch (msg_id) {
+    switch (msg.msg_id) {
     case AIS_MESSAGE_POSITION_REPORT_SOTDMA:
     case AIS_MESSAGE_POSITION_REPORT_SOTDMA2:
     case AIS_MESSAGE_POSITION_REPORT_ITDMA:
-        _ais_decode_position_report(decode, packet, packet_len, msg_id, repeat, mmsi, msg_ascii_6);
+        if (NULL != decode->on_position_report) {
+            _ais_decode_position_report(decode, now_ms, &msg, msg_ascii_6);
+        }
         break;
     case AIS_MESSAGE_BASE_STATION_REPORT:
-        _ais_decode_base_station_report(decode, packet, packet_len, msg_id, repeat, mmsi, msg_ascii_6);
+        if (NULL != decode->on_base_station_report) {
+            _ais_decode_base_station_report(decode, &msg, msg_ascii_6);
+        }
         break;
     case AIS_MESSAGE_SHIP_STATIC_INFO:
-        _ais_decode_static_voyage_data(decode, packet, packet_len, msg_id, repeat, mmsi, msg_ascii_6);
+        if (NULL != decode->on_static_voyage_data) {
+            _ais_decode_static_voyage_data(decode, now_ms, &msg, msg_ascii_6);
+        }
         break;
     }
 
+    if (NULL != decode->on_message) {
+        decode->on_message(decode, decode->on_message_state, &msg, msg_ascii_6);
+    }
+
+    if (NULL != decode->vessels && true == ais_vessel_table_snapshot_due(decode->vessels, now_ms)) {
+        TSL_BUG_IF_FAILED(ais_vessel_table_snapshot(decode->vessels, now_ms, _ais_decode_on_vessel, decode));
+    }
+
+done:
     return ret;
 }
 
@@ -301,30 +634,76 @@ aresult_t ais_decode_new(struct ais_decode **pdecode, uint32_t freq, ais_decode_
         goto done;
     }
 
-    if (FAILED(ret = ais_demod_new(&decode->demod, decode, _ais_decode_demod_on_msg, freq))) {
-        goto done;
-    }
-
-    decode->freq = freq;
+    pthread_mutex_init(&decode->dedup_lock, NULL);
 
     decode->on_position_report = on_position_report;
     decode->on_base_station_report = on_base_station_report;
     decode->on_static_voyage_data = on_static_voyage_data;
 
+    _ais_decode_update_wanted(decode);
+
+    if (FAILED(ret = ais_decode_add_channel(decode, freq, NULL))) {
+        goto done;
+    }
+
     *pdecode = decode;
 
 done:
     if (FAILED(ret)) {
         if (NULL != decode) {
-            if (NULL != decode->demod) {
-                TSL_BUG_IF_FAILED(ais_demod_delete(&decode->demod));
-            }
-            TFREE(decode);
+            TSL_BUG_IF_FAILED(ais_decode_delete(&decode));
         }
     }
     return ret;
 }
 
+aresult_t ais_decode_add_channel(struct ais_decode *decode, uint32_t freq, unsigned *pchannel)
+{
+    aresult_t ret = A_OK;
+
+    struct ais_decode_channel *chan = NULL;
+
+    TSL_ASSERT_ARG(NULL != decode);
+
+    if (AIS_DECODE_MAX_CHANNELS == decode->nr_channels) {
+        AIS_MSG(SEV_ERROR, "TOO-MANY-CHANNELS", "Can decode at most %d AIS channels at once.",
+                AIS_DECODE_MAX_CHANNELS);
+        ret = A_E_INVAL;
+        goto done;
+    }
+
+    chan = &decode->channels[decode->nr_channels];
+
+    chan->decode = decode;
+    chan->freq = freq;
+    chan->nr_samples = 0;
+
+    switch (freq) {
+    case AIS_DECODE_CHANNEL_A_FREQ:
+        chan->nmea_channel = 'A';
+        break;
+    case AIS_DECODE_CHANNEL_B_FREQ:
+        chan->nmea_channel = 'B';
+        break;
+    default:
+        /* Not a standard AIS channel, so just name them in the order they were added */
+        chan->nmea_channel = 'A' + decode->nr_channels;
+    }
+
+    if (FAILED(ret = ais_demod_new(&chan->demod, chan, _ais_decode_demod_on_msg, freq))) {
+        goto done;
+    }
+
+    if (NULL != pchannel) {
+        *pchannel = decode->nr_channels;
+    }
+
+    decode->nr_channels++;
+
+done:
+    return ret;
+}
+
 aresult_t ais_decode_delete(struct ais_decode **pdecode)
 {
     aresult_t ret = A_OK;
@@ -336,10 +715,16 @@ aresult_t ais_decode_delete(struct ais_decode **pdecode)
 
     decode = *pdecode;
 
-    if (NULL != decode->demod) {
-        TSL_BUG_IF_FAILED(ais_demod_delete(&decode->demod));
+    for (size_t i = 0; i < decode->nr_channels; i++) {
+        TSL_BUG_IF_FAILED(ais_demod_delete(&decode->channels[i].demod));
     }
 
+    if (NULL != decode->vessels) {
+        TSL_BUG_IF_FAILED(ais_vessel_table_delete(&decode->vessels));
+    }
+
+    pthread_mutex_destroy(&decode->dedup_lock);
+
     TFREE(decode);
 
     *pdecode = NULL;
@@ -347,11 +732,110 @@ aresult_t ais_decode_delete(struct ais_decode **pdecode)
     return ret;
 }
 
-aresult_t ais_decode_on_pcm(struct ais_decode *decode, const int16_t *samples, size_t nr_samples)
+aresult_t ais_decode_on_pcm(struct ais_decode *decode, unsigned channel, const int16_t *samples, size_t nr_samples)
 {
+    aresult_t ret = A_OK;
+
+    struct ais_decode_channel *chan = NULL;
+
     TSL_ASSERT_ARG(NULL != decode);
+    TSL_ASSERT_ARG(channel < decode->nr_channels);
     TSL_ASSERT_ARG(NULL != samples);
     TSL_ASSERT_ARG(0 != nr_samples);
-    return ais_demod_on_pcm(decode->demod, samples, nr_samples);
+
+    chan = &decode->channels[channel];
+
+    ret = ais_demod_on_pcm(chan->demod, samples, nr_samples);
+    chan->nr_samples += nr_samples;
+
+    return ret;
+}
+
+aresult_t ais_decode_sample_demand(struct ais_decode *decode, unsigned channel, bool *psparse, size_t *pnr_skip)
+{
+    TSL_ASSERT_ARG(NULL != decode);
+    TSL_ASSERT_ARG(channel < decode->nr_channels);
+    return ais_demod_sample_demand(decode->channels[channel].demod, psparse, pnr_skip);
+}
+
+aresult_t ais_decode_skip(struct ais_decode *decode, unsigned channel, size_t nr_samples)
+{
+    aresult_t ret = A_OK;
+
+    struct ais_decode_channel *chan = NULL;
+
+    TSL_ASSERT_ARG(NULL != decode);
+    TSL_ASSERT_ARG(channel < decode->nr_channels);
+
+    chan = &decode->channels[channel];
+
+    ret = ais_demod_skip(chan->demod, nr_samples);
+    chan->nr_samples += nr_samples;
+
+    return ret;
+}
+
+aresult_t ais_decode_set_on_message(struct ais_decode *decode, ais_decode_on_message_func_t on_message, void *state,
+        const struct ais_field_set *fields)
+{
+    TSL_ASSERT_ARG(NULL != decode);
+
+    decode->on_message = on_message;
+    decode->on_message_state = state;
+
+    if (NULL != fields) {
+        decode->message_fields = *fields;
+    } else {
+        memset(&decode->message_fields, 0xff, sizeof(decode->message_fields));
+    }
+
+    _ais_decode_update_wanted(decode);
+
+    return A_OK;
+}
+
+aresult_t ais_decode_set_on_nmea(struct ais_decode *decode, ais_decode_on_nmea_func_t on_nmea, void *state)
+{
+    TSL_ASSERT_ARG(NULL != decode);
+
+    decode->on_nmea = on_nmea;
+    decode->on_nmea_state = state;
+
+    return A_OK;
 }
 
+aresult_t ais_decode_set_vessel_table(struct ais_decode *decode, const struct ais_vessel_table_config *config)
+{
+    aresult_t ret = A_OK;
+
+    TSL_ASSERT_ARG(NULL != decode);
+
+    if (NULL != decode->vessels) {
+        TSL_BUG_IF_FAILED(ais_vessel_table_delete(&decode->vessels));
+    }
+
+    if (NULL != config) {
+        ret = ais_vessel_table_new(&decode->vessels, config);
+    }
+
+    return ret;
+}
+
+struct ais_vessel_table *ais_decode_vessel_table(struct ais_decode *decode)
+{
+    TSL_BUG_ON(NULL == decode);
+    return decode->vessels;
+}
+
+uint64_t ais_decode_nr_duplicates(struct ais_decode *decode)
+{
+    uint64_t nr_duplicates = 0;
+
+    TSL_BUG_ON(NULL == decode);
+
+    pthread_mutex_lock(&decode->dedup_lock);
+    nr_duplicates = decode->nr_duplicates;
+    pthread_mutex_unlock(&decode->dedup_lock);
+
+    return nr_duplicates;
+}
@@ -1,8 +1,19 @@
 #pragma once
 
+#include <ais/ais_msg_format.h>
+
 #include <tsl/result.h>
 
+#include <stdbool.h>
+
+/**
+ * Most channels a single decoder can listen to. AIS uses two, 87B and 88B.
+ */
+#define AIS_DECODE_MAX_CHANNELS         4
+
 struct ais_decode;
+struct ais_vessel_table;
+struct ais_vessel_table_config;
 
 struct ais_position_report {
     uint32_t mmsi;
@@ -60,7 +71,95 @@ typedef aresult_t (*ais_decode_on_position_report_func_t)(struct ais_decode *dec
 typedef aresult_t (*ais_decode_on_base_station_report_func_t)(struct ais_decode *decode, void *state, struct ais_base_station_report *bsr, const char *raw_msg);
 typedef aresult_t (*ais_decode_on_static_voyage_data_func_t)(struct ais_decode *decode, void *state, struct ais_static_voyage_data *svd, const char *raw_msg);
 
+/**
+ * Callback for every message received, of any type. Only the fields asked for in
+ * ais_decode_set_on_message are extracted; the message is only valid for the duration of the
+ * call.
+ */
+typedef aresult_t (*ais_decode_on_message_func_t)(struct ais_decode *decode, void *state, const struct ais_message *msg, const char *raw_msg);
+
+/**
+ * Callback for every message received, formatted as one or more !AIVDM sentences, each terminated
+ * with CR LF. The sentences are only valid for the duration of the call.
+ */
+typedef aresult_t (*ais_decode_on_nmea_func_t)(struct ais_decode *decode, void *state, const char *sentences, size_t len);
+
+/**
+ * Create a new AIS decoder, listening on a single channel (channel 0). More channels can be added
+ * with ais_decode_add_channel.
+ */
 aresult_t ais_decode_new(struct ais_decode **pdecode, uint32_t freq, ais_decode_on_position_report_func_t on_position_report, ais_decode_on_base_station_report_func_t on_base_station_report, ais_decode_on_static_voyage_data_func_t on_static_voyage_data);
 aresult_t ais_decode_delete(struct ais_decode **pdecode);
-aresult_t ais_decode_on_pcm(struct ais_decode *decode, const int16_t *samples, size_t nr_samples);
+
+/**
+ * Add another channel to the decoder. Each channel has its own demodulator, but the channels share
+ * the message callbacks, and a packet heard on more than one channel within a short window is only
+ * delivered once.
+ *
+ * The channels are expected to be demodulated from the same wideband capture, so that their
+ * sample streams line up. Each channel can be fed from a different thread, but any one channel
+ * must only be fed from one thread at a time. The callbacks can be called from any of them.
+ *
+ * \param decode The decoder
+ * \param freq The frequency of the channel, in Hz
+ * \param pchannel The index of the new channel, returned by reference. Can be NULL.
+ */
+aresult_t ais_decode_add_channel(struct ais_decode *decode, uint32_t freq, unsigned *pchannel);
+
+aresult_t ais_decode_on_pcm(struct ais_decode *decode, unsigned channel, const int16_t *samples, size_t nr_samples);
+aresult_t ais_decode_sample_demand(struct ais_decode *decode, unsigned channel, bool *psparse, size_t *pnr_skip);
+aresult_t ais_decode_skip(struct ais_decode *decode, unsigned channel, size_t nr_samples);
+
+/**
+ * Set a callback to be called for every message received, of any type, after the type-specific
+ * callbacks.
+ *
+ * \param decode The decoder
+ * \param on_message The callback, or NULL to remove it
+ * \param state State passed to the callback
+ * \param fields The integer fields the callback needs extracted, or NULL for all of them. Text
+ *               and data fields can be extracted in the callback as needed.
+ */
+aresult_t ais_decode_set_on_message(struct ais_decode *decode, ais_decode_on_message_func_t on_message, void *state,
+        const struct ais_field_set *fields);
+
+/**
+ * Set a callback to be called for every message received, of any type, formatted as NMEA
+ * sentences. The sentences are armored straight from the packet, so if no other callbacks are
+ * set, no fields are extracted at all. Packets heard on more than one channel are only delivered
+ * once, tagged with the channel they were heard on first.
+ *
+ * \param decode The decoder
+ * \param on_nmea The callback, or NULL to remove it
+ * \param state State passed to the callback
+ */
+aresult_t ais_decode_set_on_nmea(struct ais_decode *decode, ais_decode_on_nmea_func_t on_nmea, void *state);
+
+/**
+ * Keep the latest state of every vessel heard from, and only call the position report and static
+ * and voyage data callbacks when a vessel's state changes enough, or hasn't been reported for a
+ * while. Periodically, the latest reports for every vessel are passed to the callbacks again, as
+ * a snapshot. Time is measured by the samples consumed, so snapshots are only taken as messages
+ * arrive. Must be set before any samples are processed.
+ *
+ * \param decode The decoder
+ * \param config The thresholds for rate limiting and the snapshot interval, or NULL to pass
+ *               every report on (the default)
+ */
+aresult_t ais_decode_set_vessel_table(struct ais_decode *decode, const struct ais_vessel_table_config *config);
+
+/**
+ * Get the vessel table, or NULL if there is none.
+ */
+struct ais_vessel_table *ais_decode_vessel_table(struct ais_decode *decode);
+
+/**
+ * Get the number of packets dropped as duplicates of one already delivered.
+ */
+uint64_t ais_decode_nr_duplicates(struct ais_decode *decode);
+
+/**
+ * Get the human readable name of an electronic position fixing device type.
+ */
+const char *ais_decode_epfd_name(uint32_t epfd_type);
 
@@ -8,6 +8,7 @@
 #include <tsl/hexdump.h>
 
 #include <string.h>
+#include <pthread.h>
 
 #ifdef AIS_DEBUG_STATE
 #define STATE_TRANSITION(x, ...)    DIAG(x, ##__VA_ARGS__)
@@ -15,38 +16,127 @@
 #define STATE_TRANSITION(...)
 #endif /* defined(AIS_DEBUG_STATE) */
 
+/**
+ * The CRC-16 polynomial used for the HDLC frame check sequence, bit reversed
+ */
+#define AIS_CRC16_POLY              0x8408u
+
+/**
+ * CRC-16 lookup tables, for slicing by 4. Table k gives the CRC update for a byte followed by k
+ * zero bytes.
+ */
 static
-uint16_t _ais_crc16(const uint8_t *data, size_t len)
+uint16_t _ais_crc16_table[4][256];
+
+/**
+ * Bit destuffing lookup table, indexed by the destuffing state, then a byte of NRZI decoded bits.
+ */
+static
+struct ais_demod_destuff _ais_destuff_table[AIS_DESTUFF_STATES][256];
+
+static
+pthread_once_t _ais_demod_tables_once = PTHREAD_ONCE_INIT;
+
+/**
+ * Run the first nr_bits NRZI decoded bits of decoded, starting from the highest bit, through the
+ * destuffer. A bit that follows five 1's in a row is a stuffed bit (or part of a flag), so it is
+ * dropped.
+ *
+ * \param pnr_ones The number of 1's in a row so far, updated by reference
+ * \param decoded The decoded bits
+ * \param nr_bits The number of bits to process
+ * \param pout The bits that were kept, first bit in the LSB
+ *
+ * \return The number of bits kept
+ */
+static
+uint8_t _ais_demod_destuff_bits(uint8_t *pnr_ones, uint8_t decoded, size_t nr_bits, uint8_t *pout)
 {
-    uint16_t crc = 0xffffu;
-    const uint16_t poly = 0x8408u;
+    uint8_t nr_ones = *pnr_ones,
+            out = 0,
+            nr_out = 0;
+
+    for (size_t i = 0; i < nr_bits; i++) {
+        uint8_t bit = (decoded >> (7 - i)) & 1;
+
+        if (nr_ones < 5) {
+            out |= bit << nr_out;
+            nr_out++;
+        }
+
+        if (0 == bit) {
+            nr_ones = 0;
+        } else if (nr_ones < 5) {
+            nr_ones++;
+        }
+    }
+
+    *pnr_ones = nr_ones;
+    *pout = out;
+
+    return nr_out;
+}
+
+static
+void _ais_demod_tables_init(void)
+{
+    for (size_t i = 0; i < 256; i++) {
+        uint16_t crc = i;
 
-    for (size_t i = 0; i < len; i++) {
-        crc ^= (uint16_t)data[i];
         for (size_t j = 0; j < 8; j++) {
             if (crc & 1) {
-                crc = (crc >> 1) ^ poly;
+                crc = (crc >> 1) ^ AIS_CRC16_POLY;
             } else {
                 crc >>= 1;
             }
         }
+
+        _ais_crc16_table[0][i] = crc;
     }
 
-    return ~crc;
+    for (size_t k = 1; k < 4; k++) {
+        for (size_t i = 0; i < 256; i++) {
+            uint16_t prior = _ais_crc16_table[k - 1][i];
+            _ais_crc16_table[k][i] = (prior >> 8) ^ _ais_crc16_table[0][prior & 0xff];
+        }
+    }
+
+    for (size_t s = 0; s < AIS_DESTUFF_STATES; s++) {
+        for (size_t i = 0; i < 256; i++) {
+            struct ais_demod_destuff *destuff = &_ais_destuff_table[s][i];
+
+            destuff->nr_ones = s;
+            destuff->nr_bits = _ais_demod_destuff_bits(&destuff->nr_ones, i, 8, &destuff->bits);
+        }
+    }
 }
 
 static
-bool _ais_demod_compare(uint32_t x, uint32_t y, unsigned diff)
+uint16_t _ais_crc16(const uint8_t *data, size_t len)
 {
-    return __builtin_popcountll(x ^ y) <= diff;
+    uint16_t crc = 0xffffu;
+    size_t i = 0;
+
+    /* Four bytes at a time: the CRC so far is folded into the first two */
+    for (; i + 4 <= len; i += 4) {
+        crc ^= (uint16_t)data[i] | (uint16_t)data[i + 1] << 8;
+        crc = _ais_crc16_table[3][crc & 0xff] ^ _ais_crc16_table[2][crc >> 8] ^
+              _ais_crc16_table[1][data[i + 2]] ^ _ais_crc16_table[0][data[i + 3]];
+    }
+
+    for (; i < len; i++) {
+        crc = (crc >> 8) ^ _ais_crc16_table[0][(crc ^ data[i]) & 0xff];
+    }
+
+    return ~crc;
 }
 
 static
 void _ais_demod_detect_reset(struct ais_demod_detect *detect)
 {
-    memset(detect->preambles, 0, sizeof(detect->preambles));
-    memset(detect->prior_sample, 0, sizeof(detect->prior_sample));
-    detect->next_field = 0;
+    memset(detect->history, 0, sizeof(detect->history));
+    detect->prior_slices = 0;
+    detect->prior_hits = 0;
 }
 
 static
@@ -54,8 +144,19 @@ void _ais_demod_rx_reset(struct ais_demod_rx *rx)
 {
     memset(rx->packet, 0, sizeof(rx->packet));
     rx->raw_shr = 0;
+    rx->raw_bits = 0;
+    rx->nr_raw_bits = 0;
     rx->current_bit = 0;
     rx->nr_ones = 0;
+    rx->active = false;
+}
+
+static
+void _ais_demod_rx_reset_all(struct ais_demod *demod)
+{
+    for (size_t i = 0; i < AIS_DECIMATION_RATE; i++) {
+        _ais_demod_rx_reset(&demod->packet_rx[i]);
+    }
 }
 
 aresult_t ais_demod_new(struct ais_demod **pdemod, void *state, ais_demod_on_message_callback_func_t cb, uint32_t freq)
@@ -69,11 +170,13 @@ aresult_t ais_demod_new(struct ais_demod **pdemod, void *state, ais_demod_on_mes
 
     *pdemod = NULL;
 
+    pthread_once(&_ais_demod_tables_once, _ais_demod_tables_init);
+
     if (FAILED(ret = TZAALLOC(demod, SYS_CACHE_LINE_LENGTH))) {
         goto done;
     }
 
-    _ais_demod_rx_reset(&demod->packet_rx);
+    _ais_demod_rx_reset_all(demod);
     _ais_demod_detect_reset(&demod->detector);
 
     demod->on_msg_cb = cb;
@@ -110,108 +213,374 @@ aresult_t ais_demod_delete(struct ais_demod **pdemod)
     return ret;
 }
 
+/**
+ * Read the 64 bits starting at bit offset off of a packed bit buffer.
+ */
 static inline
-void _ais_demod_detect_handle_sample(struct ais_demod *demod, int16_t sample)
+uint64_t __ais_demod_bits_at(const uint64_t *bits, size_t off)
 {
-    struct ais_demod_detect *detector = NULL;
+    size_t word = off / 64,
+           shift = off % 64;
 
-    uint8_t sample_slice = 0,
-            nr_match = 0,
-            last_bit = 0;
+    if (0 == shift) {
+        return bits[word];
+    }
 
-    TSL_BUG_ON(NULL == demod);
+    return (bits[word] >> shift) | (bits[word + 1] << (64 - shift));
+}
 
-    detector = &demod->detector;
+/**
+ * Slice samples into a packed bit buffer, a positive sample becoming a 1.
+ */
+static
+void _ais_demod_detect_slice(uint64_t *bits, const int16_t *samples, size_t nr_samples)
+{
+    for (size_t i = 0; i < nr_samples; i += 64) {
+        size_t nr = BL_MIN2(nr_samples - i, 64);
+        uint64_t slice = 0;
 
-    /* Slice our new sample */
-    sample_slice = sample > 0;
+        /* The compiler can turn this into compares and a movemask */
+        for (size_t j = 0; j < nr; j++) {
+            slice |= (uint64_t)(samples[i + j] > 0) << j;
+        }
 
-    /* Grab our prior sample */
-    last_bit = detector->prior_sample[detector->next_field];
+        bits[i / 64] = slice;
+    }
+}
 
-    /* Record this sample */
-    detector->prior_sample[detector->next_field] = sample_slice;
+/**
+ * Check the preamble against each of 64 consecutive samples, starting at bit offset pos of the
+ * packed NRZI decoded bitstream.
+ *
+ * Bit m of the preamble is expected m * AIS_DECIMATION_RATE samples before the sample being
+ * checked. A 64-bit window of the bitstream checks bit m for all 64 samples, and the mismatches
+ * are added up in a 2-bit counter per sample, held as one 64-bit word per counter bit.
+ * Overflowing the counter counts as too many errors.
+ *
+ * \return A mask of the samples within AIS_PREAMBLE_MAX_ERRORS of the preamble
+ */
+static
+uint64_t _ais_demod_detect_matches(const uint64_t *bits, size_t pos)
+{
+    uint64_t count_0 = 0,
+             count_1 = 0,
+             over = 0;
 
-    detector->preambles[detector->next_field] <<= 1;
-    detector->preambles[detector->next_field] |= !(last_bit ^ sample_slice);
+    for (size_t m = 0; m < 32; m++) {
+        uint64_t expect = ((AIS_PREAMBLE >> m) & 1) ? ~0ull : 0,
+                 carry = __ais_demod_bits_at(bits, pos - m * AIS_DECIMATION_RATE) ^ expect,
+                 next = 0;
 
-    for (size_t i = 0; i < AIS_DECIMATION_RATE; i++) {
-        if (_ais_demod_compare(detector->preambles[i], 0x5555557eul, 2)) {
-#ifdef AIS_PACKET_DEBUG
-            DIAG("   Preamble [%zu]: 0x%08x", i, detector->preambles[i]);
-#endif /* define(AIS_PACKET_DEBUG) */
-            nr_match++;
+        next = count_0 & carry;
+        count_0 ^= carry;
+        carry = next;
+
+        over |= count_1 & carry;
+        count_1 ^= carry;
+
+        if (~0ull == over) {
+            /* Every sample has had at least 4 errors */
+            break;
         }
     }
 
-    if (nr_match >= 3) {
-        STATE_TRANSITION("SEARCH_SYNC -> RECEIVING (%d matches)", (int)nr_match);
+#if AIS_PREAMBLE_MAX_ERRORS != 2
+#error The preamble match count only handles up to 2 errors
+#endif
+
+    return ~(over | (count_1 & count_0));
+}
+
+/**
+ * Count, for each of 64 consecutive samples, how many of it and the AIS_DECIMATION_RATE - 1
+ * samples before it saw the preamble. Each of those is in a different decimation phase.
+ *
+ * \return A mask of the samples where at least AIS_PREAMBLE_MIN_PHASES phases saw the preamble
+ */
+static
+uint64_t _ais_demod_detect_phases(uint64_t hits, uint64_t prior_hits)
+{
+    uint64_t count_0 = 0,
+             count_1 = 0,
+             count_2 = 0;
+
+    for (size_t p = 0; p < AIS_DECIMATION_RATE; p++) {
+        uint64_t carry = 0 == p ? hits : (hits << p) | (prior_hits >> (64 - p)),
+                 next = 0;
+
+        next = count_0 & carry;
+        count_0 ^= carry;
+        carry = next;
+
+        next = count_1 & carry;
+        count_1 ^= carry;
+        carry = next;
 
-        demod->state = AIS_DEMOD_STATE_RECEIVING;
-        demod->sample_skip = 2;
-        _ais_demod_rx_reset(&demod->packet_rx);
-        demod->packet_rx.last_sample = detector->prior_sample[detector->next_field];
+        count_2 |= carry;
     }
 
-    detector->next_field = (detector->next_field + 1) % AIS_DECIMATION_RATE;
+#if AIS_PREAMBLE_MIN_PHASES != 3 || AIS_DECIMATION_RATE > 7
+#error The decimation phase count only handles a threshold of 3, up to 7 phases
+#endif
+
+    return count_2 | (count_1 & count_0);
 }
 
-static inline
-void _ais_demod_packet_rx_sample(struct ais_demod *demod, int16_t sample)
+/**
+ * Start receiving a packet in every decimation phase.
+ *
+ * \param demod The demodulator
+ * \param slices The last 64 sliced samples, up to the one the preamble was found at in the MSB
+ */
+static
+void _ais_demod_rx_start(struct ais_demod *demod, uint64_t slices)
 {
-    struct ais_demod_rx *rx = NULL;
+    STATE_TRANSITION("SEARCH_SYNC -> RECEIVING");
 
-    uint8_t bit = 0,
-            raw = 0,
-            last = 0;
+    demod->state = AIS_DEMOD_STATE_RECEIVING;
+    demod->sample_skip = 0;
+    demod->rx_deadline = 0;
 
-    TSL_BUG_ON(NULL == demod);
+    for (size_t i = 0; i < AIS_DECIMATION_RATE; i++) {
+        struct ais_demod_rx *rx = &demod->packet_rx[i];
 
-    rx = &demod->packet_rx;
+        /* NRZI decoding starts from the last sample of the start flag in the same phase */
+        size_t back = (AIS_DECIMATION_RATE - i) % AIS_DECIMATION_RATE;
 
-    raw = sample > 0;
-    last = rx->last_sample;
+        _ais_demod_rx_reset(rx);
+        rx->last_sample = (slices >> (63 - back)) & 1;
+        rx->active = true;
+    }
+}
 
-    bit = !(last ^ raw);
-    rx->raw_shr <<= 1;
-    rx->raw_shr |= bit;
-    rx->last_sample = raw;
+/**
+ * Search a block of samples for the preamble and start flag.
+ *
+ * The samples are sliced into a packed bitstream, NRZI decoded in each decimation phase with a
+ * shift and an XOR, and every phase is checked against the preamble 64 samples at a time.
+ *
+ * \return The number of samples consumed. If the preamble was found, the sample it was found at
+ *         is the last one consumed, and the demodulator is now receiving the packet.
+ */
+static
+size_t _ais_demod_detect(struct ais_demod *demod, const int16_t *samples, size_t nr_samples)
+{
+    struct ais_demod_detect *detector = &demod->detector;
+    uint64_t slices[AIS_DETECT_CHUNK / 64 + 2],
+             bits[(AIS_DETECT_HISTORY + AIS_DETECT_CHUNK) / 64 + 1];
+    size_t consumed = 0;
 
-    if (rx->nr_ones < 5) {
-        rx->packet[rx->current_bit / 8] |= bit << (rx->current_bit % 8);
-        rx->current_bit++;
-    }
+    memset(slices, 0, sizeof(slices));
+    memset(bits, 0, sizeof(bits));
 
-    if (0 == bit) {
-        rx->nr_ones = 0;
-    } else {
-        rx->nr_ones++;
+    while (consumed < nr_samples && AIS_DEMOD_STATE_SEARCH_SYNC == demod->state) {
+        size_t nr = BL_MIN2(nr_samples - consumed, AIS_DETECT_CHUNK),
+               end = nr;
+
+        /* The slices run one word behind the samples, so every sample can see a phase back */
+        slices[0] = detector->prior_slices;
+        _ais_demod_detect_slice(&slices[1], &samples[consumed], nr);
+
+        memcpy(bits, detector->history, sizeof(detector->history));
+
+        /* A 1 for no change in level since the prior sample in the same decimation phase */
+        for (size_t i = 0; i < nr; i += 64) {
+            bits[(AIS_DETECT_HISTORY + i) / 64] = ~(__ais_demod_bits_at(slices, 64 + i) ^
+                    __ais_demod_bits_at(slices, 64 + i - AIS_DECIMATION_RATE));
+        }
+
+        for (size_t base = 0; base < end; base += 64) {
+            size_t nr_lanes = BL_MIN2(end - base, 64);
+            uint64_t hits = _ais_demod_detect_matches(bits, AIS_DETECT_HISTORY + base),
+                     found = _ais_demod_detect_phases(hits, detector->prior_hits);
+
+            if (64 > nr_lanes) {
+                found &= (1ull << nr_lanes) - 1;
+            }
+
+            if (0 != found) {
+                nr_lanes = __builtin_ctzll(found) + 1;
+                end = base + nr_lanes;
+
+                _ais_demod_rx_start(demod, __ais_demod_bits_at(slices, end));
+            }
+
+            detector->prior_hits = 64 == nr_lanes ? hits :
+                (hits << (64 - nr_lanes)) | (detector->prior_hits >> nr_lanes);
+        }
+
+        /* Keep the bits leading up to the last sample consumed, for the next chunk */
+        for (size_t w = 0; w < AIS_DETECT_HISTORY / 64; w++) {
+            detector->history[w] = __ais_demod_bits_at(bits, end + w * 64);
+        }
+        detector->prior_slices = __ais_demod_bits_at(slices, end);
+
+        consumed += end;
     }
 
-    if (rx->raw_shr == AIS_PACKET_END_FLAG || rx->current_bit == (5 * 256)) {
-        /* We have a packet or some horrible corruption */
-        size_t packet_bytes = rx->current_bit / 8;
-        if (4 <= packet_bytes) {
-            uint16_t crc = _ais_crc16(rx->packet, packet_bytes - 2),
-                     rx_crc = (uint16_t)rx->packet[packet_bytes - 2] | (uint16_t)rx->packet[packet_bytes - 1] << 8;
+    return consumed;
+}
+
+/**
+ * Stop receiving, and go back to searching for a preamble.
+ */
+static
+void _ais_demod_rx_finish(struct ais_demod *demod)
+{
+    STATE_TRANSITION("RECEIVING -> SEARCH_SYNC");
+    demod->state = AIS_DEMOD_STATE_SEARCH_SYNC;
+    demod->sample_skip = 0;
+    demod->rx_deadline = 0;
+    _ais_demod_rx_reset_all(demod);
+    _ais_demod_detect_reset(&demod->detector);
+}
+
+/**
+ * A decimation phase has reached the end of the packet: check the FCS, and hand the packet off
+ * if it's good. The first good packet ends the reception, so the other phases can't deliver the
+ * same packet again. If every phase has a bad FCS, the packet is counted as rejected.
+ */
+static
+void _ais_demod_packet_rx_end(struct ais_demod *demod, struct ais_demod_rx *rx)
+{
+    /* We have a packet or some horrible corruption */
+    size_t packet_bytes = rx->current_bit / 8;
+
+    rx->active = false;
+
+    if (4 <= packet_bytes) {
+        uint16_t crc = _ais_crc16(rx->packet, packet_bytes - 2),
+                 rx_crc = (uint16_t)rx->packet[packet_bytes - 2] | (uint16_t)rx->packet[packet_bytes - 1] << 8;
+
+        if (rx_crc == crc) {
+            TSL_BUG_IF_FAILED(demod->on_msg_cb(demod, demod->caller_state, rx->packet, packet_bytes - 2, true));
+            _ais_demod_rx_finish(demod);
+            return;
+        }
 
-            if (rx_crc == crc) {
-                TSL_BUG_IF_FAILED(demod->on_msg_cb(demod, demod->caller_state, rx->packet, packet_bytes - 2, true));
-            } else {
-                demod->crc_rejects++;
 #ifdef AIS_PACKET_DEBUG
-                DIAG("Failed CRC match, raw packet (calculated %04x, received %04x):", crc, rx_crc);
-                hexdump_dump_hex(rx->packet, packet_bytes);
+        DIAG("Failed CRC match, raw packet (calculated %04x, received %04x):", crc, rx_crc);
+        hexdump_dump_hex(rx->packet, packet_bytes);
 #endif /* defined(_TSL_DEBUG) */
+    }
+
+    for (size_t i = 0; i < AIS_DECIMATION_RATE; i++) {
+        if (true == demod->packet_rx[i].active) {
+            /* The other phases should find the end flag about now, if they're going to */
+            if (0 == demod->rx_deadline) {
+                demod->rx_deadline = demod->sample_skip + AIS_RX_LINGER_BITS * AIS_DECIMATION_RATE;
             }
+            return;
         }
-        STATE_TRANSITION("RECEIVING -> SEARCH_SYNC");
-        demod->state = AIS_DEMOD_STATE_SEARCH_SYNC;
-        demod->sample_skip = 0;
-        _ais_demod_detect_reset(&demod->detector);
+    }
+
+    demod->crc_rejects++;
+    _ais_demod_rx_finish(demod);
+}
+
+/**
+ * Append destuffed bits to the packet. The packet starts out zeroed, so they're just ORed in.
+ */
+static inline
+void _ais_demod_packet_append(struct ais_demod_rx *rx, uint8_t bits, size_t nr_bits)
+{
+    size_t offs = rx->current_bit / 8,
+           shift = rx->current_bit % 8;
+
+    rx->packet[offs] |= bits << shift;
+    rx->packet[offs + 1] |= bits >> (8 - shift);
+    rx->current_bit += nr_bits;
+}
+
+/**
+ * Decode a byte's worth of sliced samples: NRZI decode them, look for the end flag, then destuff
+ * what's left into the packet.
+ *
+ * \return true if the packet is complete, false otherwise
+ */
+static inline
+bool _ais_demod_packet_rx_byte(struct ais_demod_rx *rx, uint8_t raw)
+{
+    uint8_t decoded = ~(raw ^ (raw >> 1 | rx->last_sample << 7));
+    unsigned window = (unsigned)rx->raw_shr << 8 | decoded;
+    size_t nr_bits = 8;
+    bool end = false;
+
+    rx->last_sample = raw & 1;
+
+    /* Stuffing means six 1's in a row only ever show up in a flag, so only look closer then */
+    if (0 != (window & window >> 1 & window >> 2 & window >> 3 & window >> 4 & window >> 5)) {
+        for (size_t i = 0; i < 8; i++) {
+            if (AIS_PACKET_END_FLAG == ((window >> (7 - i)) & 0xff)) {
+                /* Only the bits up to the end of the flag are part of this packet */
+                nr_bits = i + 1;
+                end = true;
+                break;
+            }
+        }
+    }
+
+    rx->raw_shr = decoded;
+
+    if (8 == nr_bits) {
+        const struct ais_demod_destuff *destuff = &_ais_destuff_table[rx->nr_ones][decoded];
+        _ais_demod_packet_append(rx, destuff->bits, destuff->nr_bits);
+        rx->nr_ones = destuff->nr_ones;
+    } else {
+        uint8_t bits = 0,
+                nr_out = _ais_demod_destuff_bits(&rx->nr_ones, decoded, nr_bits, &bits);
+        _ais_demod_packet_append(rx, bits, nr_out);
+    }
+
+    if (rx->current_bit >= 5 * 256) {
+        /* Stop at the longest packet we'd accept; anything past it is garbage */
+        rx->current_bit = 5 * 256;
+        end = true;
+    }
+
+    return end;
+}
+
+static inline
+void _ais_demod_packet_rx_sample(struct ais_demod *demod, struct ais_demod_rx *rx, int16_t sample)
+{
+    TSL_BUG_ON(NULL == demod);
+    TSL_BUG_ON(NULL == rx);
+
+    /* Gather a byte's worth of sliced samples, then decode them all at once */
+    rx->raw_bits = rx->raw_bits << 1 | (sample > 0);
+
+    if (8 > ++rx->nr_raw_bits) {
+        return;
+    }
+
+    rx->nr_raw_bits = 0;
+
+    if (true == _ais_demod_packet_rx_byte(rx, rx->raw_bits)) {
+        _ais_demod_packet_rx_end(demod, rx);
     }
 }
 
+/**
+ * Find the next sample any decimation phase that's still receiving wants.
+ *
+ * \return The number of samples before that sample
+ */
+static
+size_t _ais_demod_rx_next(struct ais_demod *demod)
+{
+    size_t nr_skip = 0;
+
+    /* While receiving, at least one phase is always active */
+    while (nr_skip < AIS_DECIMATION_RATE - 1 &&
+            false == demod->packet_rx[(demod->sample_skip + nr_skip + 1) % AIS_DECIMATION_RATE].active)
+    {
+        nr_skip++;
+    }
+
+    return nr_skip;
+}
+
 aresult_t ais_demod_on_pcm(struct ais_demod *demod, const int16_t *samples, size_t nr_samples)
 {
     aresult_t ret = A_OK;
@@ -223,29 +592,29 @@ aresult_t ais_demod_on_pcm(struct ais_demod *demod, const int16_t *samples, size
 
     while (nr_samples > cur_sample) {
         if (demod->state == AIS_DEMOD_STATE_SEARCH_SYNC) {
-            for (size_t i = cur_sample; i < nr_samples; i++, cur_sample++) {
-                /* Process this sample */
-                _ais_demod_detect_handle_sample(demod, samples[i]);
-                if (demod->state == AIS_DEMOD_STATE_RECEIVING) {
-                    /* Preamble was found, break. */
-#ifdef  AIS_PACKET_DEBUG
-                    fprintf(stderr, "   %zu, %d       %% last preamble bit\n", i, samples[i]);
-#endif
-                    cur_sample = i + 1;
-                    break;
-                }
-            }
+            cur_sample += _ais_demod_detect(demod, &samples[cur_sample], nr_samples - cur_sample);
         } else if (demod->state == AIS_DEMOD_STATE_RECEIVING) {
             for (size_t i = cur_sample; i < nr_samples; i++, cur_sample++) {
-                if ((demod->sample_skip++ % AIS_DECIMATION_RATE) == 0) {
+                struct ais_demod_rx *rx = &demod->packet_rx[++demod->sample_skip % AIS_DECIMATION_RATE];
+
+                if (true == rx->active) {
 #ifdef  AIS_PACKET_DEBUG
-                    fprintf(stderr, "  %zu, %d %% skip = %zu\n", i, samples[i], demod->sample_skip - 1);
+                    fprintf(stderr, "  %zu, %d %% skip = %zu\n", i, samples[i], demod->sample_skip);
 #endif /* defined(AIS_PACKET_DEBUG) */
-                    _ais_demod_packet_rx_sample(demod, samples[i]);
-                    if (demod->state == AIS_DEMOD_STATE_SEARCH_SYNC) {
-                        cur_sample = i + 1;
-                        break;
-                    }
+                    _ais_demod_packet_rx_sample(demod, rx, samples[i]);
+                }
+
+                if (demod->state == AIS_DEMOD_STATE_RECEIVING &&
+                        0 != demod->rx_deadline && demod->sample_skip >= demod->rx_deadline)
+                {
+                    /* None of the remaining phases found the end of the packet in time */
+                    demod->crc_rejects++;
+                    _ais_demod_rx_finish(demod);
+                }
+
+                if (demod->state == AIS_DEMOD_STATE_SEARCH_SYNC) {
+                    cur_sample = i + 1;
+                    break;
                 }
             }
         } else {
@@ -256,3 +625,44 @@ aresult_t ais_demod_on_pcm(struct ais_demod *demod, const int16_t *samples, size
     return ret;
 }
 
+aresult_t ais_demod_sample_demand(struct ais_demod *demod, bool *psparse, size_t *pnr_skip)
+{
+    aresult_t ret = A_OK;
+
+    TSL_ASSERT_ARG(NULL != demod);
+    TSL_ASSERT_ARG(NULL != psparse);
+    TSL_ASSERT_ARG(NULL != pnr_skip);
+
+    /* While searching for the preamble, every sample is examined */
+    *psparse = AIS_DEMOD_STATE_RECEIVING == demod->state;
+    *pnr_skip = true == *psparse ? _ais_demod_rx_next(demod) : 0;
+
+    return ret;
+}
+
+aresult_t ais_demod_skip(struct ais_demod *demod, size_t nr_samples)
+{
+    aresult_t ret = A_OK;
+
+    bool sparse = false;
+    size_t nr_skip = 0;
+
+    TSL_ASSERT_ARG(NULL != demod);
+
+    if (0 == nr_samples) {
+        goto done;
+    }
+
+    TSL_BUG_IF_FAILED(ais_demod_sample_demand(demod, &sparse, &nr_skip));
+
+    if (false == sparse || nr_samples > nr_skip) {
+        /* The demodulator needs one of these samples */
+        ret = A_E_INVAL;
+        goto done;
+    }
+
+    demod->sample_skip += nr_samples;
+
+done:
+    return ret;
+}
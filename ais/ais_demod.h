@@ -47,3 +47,23 @@ aresult_t ais_demod_delete(struct ais_demod **pdemod);
  */
 aresult_t ais_demod_on_pcm(struct ais_demod *demod, const int16_t *samples, size_t nr_samples);
 
+/**
+ * Find out which upcoming samples the demodulator will actually look at. While receiving a
+ * packet, the demodulator only looks at one sample per bit, and the rest can be skipped with
+ * ais_demod_skip, so they never need to be computed.
+ *
+ * \param demod The demodulator state
+ * \param psparse Set to true if only some samples are looked at, false if every sample is needed
+ * \param pnr_skip If sparse, the number of samples that will be ignored before the next one that
+ *                 is looked at
+ */
+aresult_t ais_demod_sample_demand(struct ais_demod *demod, bool *psparse, size_t *pnr_skip);
+
+/**
+ * Advance the demodulator past samples it would ignore, without providing them. nr_samples must
+ * not be more than the skip count from ais_demod_sample_demand.
+ *
+ * \param demod The demodulator state
+ * \param nr_samples The number of samples to skip
+ */
+aresult_t ais_demod_skip(struct ais_demod *demod, size_t nr_samples);
@@ -17,25 +17,53 @@
  */
 #define AIS_DECIMATION_RATE         (AIS_INPUT_SAMPLE_RATE/AIS_BIT_RATE)
 
+/**
+ * The preamble and start flag, as NRZI decoded bits, most recent bit in the LSB
+ */
+#define AIS_PREAMBLE                0x5555557eul
+
+/**
+ * The most bit errors allowed in the preamble and start flag
+ */
+#define AIS_PREAMBLE_MAX_ERRORS     2
+
+/**
+ * The number of the last AIS_DECIMATION_RATE samples (i.e. decimation phases) that have to see
+ * the preamble before we start receiving the packet
+ */
+#define AIS_PREAMBLE_MIN_PHASES     3
+
+/**
+ * Number of NRZI decoded bits kept from one block to the next: enough to see the whole preamble
+ * at every decimation phase, rounded up to a whole number of 64-bit words.
+ */
+#define AIS_DETECT_HISTORY          ((31 * AIS_DECIMATION_RATE + 64) / 64 * 64)
+
+/**
+ * Number of samples the preamble detector slices and searches at a time
+ */
+#define AIS_DETECT_CHUNK            1024
+
 /**
  * Structure to track detecting the preamble for AIS
  */
 struct ais_demod_detect {
     /**
-     * Preamble detection shift registers
+     * The NRZI decoded bit at each of the last AIS_DETECT_HISTORY samples, oldest first. Each
+     * sample is decoded against the sample AIS_DECIMATION_RATE before it, i.e. in its own
+     * decimation phase.
      */
-    uint32_t preambles[AIS_DECIMATION_RATE];
+    uint64_t history[AIS_DETECT_HISTORY / 64];
 
     /**
-     * The last sample we saw (for NRZI decoding)
+     * The last 64 sliced samples, 1 for a positive sample, with the most recent in the MSB
      */
-    uint8_t prior_sample[AIS_DECIMATION_RATE];
+    uint64_t prior_slices;
 
     /**
-     * Next preamble decimation field to update
+     * Whether the preamble was seen at each of the last 64 samples, most recent in the MSB
      */
-    size_t next_field;
-
+    uint64_t prior_hits;
 };
 
 #define AIS_PACKET_BITS                 256
@@ -53,6 +81,33 @@ struct ais_demod_detect {
 #define AIS_PACKET_END_FLAG             0x7e
 
 
+/**
+ * The number of states the bit destuffing state machine can be in: the number of 1's in a row
+ * seen so far, where 5 or more all behave the same way.
+ */
+#define AIS_DESTUFF_STATES              6
+
+/**
+ * An entry in the bit destuffing table: the result of running 8 NRZI decoded bits through the
+ * destuffer, starting in a given state.
+ */
+struct ais_demod_destuff {
+    /**
+     * The bits to append to the packet, first bit in the LSB
+     */
+    uint8_t bits;
+
+    /**
+     * The number of bits to append
+     */
+    uint8_t nr_bits;
+
+    /**
+     * The state after these 8 bits
+     */
+    uint8_t nr_ones;
+};
+
 /**
  * Structure to track receiving the AIS message bits. This is before bit unstuffing
  * is performed, but it does detect the packet start/end flags
@@ -73,17 +128,39 @@ struct ais_demod_rx {
      */
     uint8_t last_sample;
 
+    /**
+     * Sliced samples not yet decoded, earliest in the highest bit. These are decoded a byte at
+     * a time.
+     */
+    uint8_t raw_bits;
+
+    /**
+     * Number of sliced samples in raw_bits
+     */
+    uint8_t nr_raw_bits;
+
     /**
      * The current bit we're populating
      */
     size_t current_bit;
 
     /**
-     * Number of 1's in a row (to deal with bit stuffing)
+     * Number of 1's in a row (to deal with bit stuffing), up to 5
+     */
+    uint8_t nr_ones;
+
+    /**
+     * Whether this decimation phase is still receiving the packet
      */
-    size_t nr_ones;
+    bool active;
 };
 
+/**
+ * Once one decimation phase has reached the end of a packet with a bad FCS, how many more bits
+ * the other phases have to find the end of theirs before they are given up on
+ */
+#define AIS_RX_LINGER_BITS              16
+
 /**
  * State of the demodulator
  */
@@ -97,12 +174,34 @@ enum ais_demod_state {
  */
 struct ais_demod {
     struct ais_demod_detect detector;
-    struct ais_demod_rx packet_rx;
+
+    /**
+     * A packet receiver for each decimation phase. The sample n samples after the preamble was
+     * found goes to packet_rx[n % AIS_DECIMATION_RATE], so whatever the timing of the preamble
+     * detection, one of them samples each bit close to its middle.
+     */
+    struct ais_demod_rx packet_rx[AIS_DECIMATION_RATE];
+
     enum ais_demod_state state;
     ais_demod_on_message_callback_func_t on_msg_cb;
     uint32_t freq;
+
+    /**
+     * Number of samples since the preamble was found
+     */
     size_t sample_skip;
+
+    /**
+     * Once a phase has given up on the packet, the sample (counted like sample_skip) after which
+     * the others are given up on too. 0 if no phase has given up yet.
+     */
+    size_t rx_deadline;
+
+    /**
+     * Number of packets that were found, but no decimation phase had a good FCS
+     */
     size_t crc_rejects;
+
     void *caller_state;
 };
 
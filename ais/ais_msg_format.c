@@ -0,0 +1,770 @@
+#include <ais/ais_msg_format.h>
+
+#include <tsl/errors.h>
+#include <tsl/assert.h>
+#include <tsl/diag.h>
+
+#include <string.h>
+
+/**
+ * Describe a field. co, cl and cv are the condition for the field to be present, if any.
+ */
+#define AIS_FIELD_DESC(f, t, o, l, div, co, cl, cv) \
+    { .field = AIS_FIELD_##f, .type = AIS_FIELD_TYPE_##t, .offset = (o), .len = (l), .cond_offset = (co), \
+      .cond_len = (cl), .cond_value = (cv), .divisor = (div) }
+
+/* Shorthand for the common cases */
+#define AIS_U(f, o, l)                  AIS_FIELD_DESC(f, UNSIGNED, o, l, 0, 0, 0, 0)
+#define AIS_UD(f, o, l, div)            AIS_FIELD_DESC(f, UNSIGNED, o, l, div, 0, 0, 0)
+#define AIS_I(f, o, l)                  AIS_FIELD_DESC(f, SIGNED, o, l, 0, 0, 0, 0)
+#define AIS_ID(f, o, l, div)            AIS_FIELD_DESC(f, SIGNED, o, l, div, 0, 0, 0)
+#define AIS_T(f, o, l)                  AIS_FIELD_DESC(f, TEXT, o, l, 0, 0, 0, 0)
+#define AIS_D(f, o, l)                  AIS_FIELD_DESC(f, DATA, o, l, 0, 0, 0, 0)
+
+/**
+ * Resolution of a high resolution position, in 1/10000 minute
+ */
+#define AIS_POS_DIV                     600000
+
+/**
+ * Resolution of a low resolution position, in 1/10 minute
+ */
+#define AIS_POS_LOW_DIV                 600
+
+/**
+ * Message types 1, 2 and 3: Class A position report
+ */
+static const
+struct ais_field_desc _ais_position_report_fields[] = {
+    AIS_U(NAV_STATUS, 38, 4),
+    AIS_I(RATE_OF_TURN, 42, 8),
+    AIS_UD(SPEED_OVER_GROUND, 50, 10, 10),
+    AIS_U(POSITION_ACCURACY, 60, 1),
+    AIS_ID(LONGITUDE, 61, 28, AIS_POS_DIV),
+    AIS_ID(LATITUDE, 89, 27, AIS_POS_DIV),
+    AIS_UD(COURSE_OVER_GROUND, 116, 12, 10),
+    AIS_U(HEADING, 128, 9),
+    AIS_U(SECOND, 137, 6),
+    AIS_U(MANEUVER, 143, 2),
+    AIS_U(RAIM, 148, 1),
+    AIS_U(RADIO_STATUS, 149, 19),
+};
+
+/**
+ * Message types 4 and 11: base station report, and UTC/date response
+ */
+static const
+struct ais_field_desc _ais_base_station_report_fields[] = {
+    AIS_U(YEAR, 38, 14),
+    AIS_U(MONTH, 52, 4),
+    AIS_U(DAY, 56, 5),
+    AIS_U(HOUR, 61, 5),
+    AIS_U(MINUTE, 66, 6),
+    AIS_U(SECOND, 72, 6),
+    AIS_U(POSITION_ACCURACY, 78, 1),
+    AIS_ID(LONGITUDE, 79, 28, AIS_POS_DIV),
+    AIS_ID(LATITUDE, 107, 27, AIS_POS_DIV),
+    AIS_U(EPFD_TYPE, 134, 4),
+    AIS_U(RAIM, 148, 1),
+    AIS_U(RADIO_STATUS, 149, 19),
+};
+
+/**
+ * Message type 5: static and voyage related data
+ */
+static const
+struct ais_field_desc _ais_static_voyage_data_fields[] = {
+    AIS_U(AIS_VERSION, 38, 2),
+    AIS_U(IMO_NUMBER, 40, 30),
+    AIS_T(CALLSIGN, 70, 42),
+    AIS_T(SHIP_NAME, 112, 120),
+    AIS_U(SHIP_TYPE, 232, 8),
+    AIS_U(DIM_TO_BOW, 240, 9),
+    AIS_U(DIM_TO_STERN, 249, 9),
+    AIS_U(DIM_TO_PORT, 258, 6),
+    AIS_U(DIM_TO_STARBOARD, 264, 6),
+    AIS_U(EPFD_TYPE, 270, 4),
+    AIS_U(ETA_MONTH, 274, 4),
+    AIS_U(ETA_DAY, 278, 5),
+    AIS_U(ETA_HOUR, 283, 5),
+    AIS_U(ETA_MINUTE, 288, 6),
+    AIS_UD(DRAUGHT, 294, 8, 10),
+    AIS_T(DESTINATION, 302, 120),
+    AIS_U(DTE, 422, 1),
+};
+
+/**
+ * Message type 6: addressed binary message
+ */
+static const
+struct ais_field_desc _ais_binary_addressed_fields[] = {
+    AIS_U(SEQUENCE_NUMBER, 38, 2),
+    AIS_U(DEST_MMSI, 40, 30),
+    AIS_U(RETRANSMIT, 70, 1),
+    AIS_U(DAC, 72, 10),
+    AIS_U(FID, 82, 6),
+    AIS_D(DATA, 88, 920),
+};
+
+/**
+ * Message types 7 and 13: binary and safety related acknowledgements. Between one and four
+ * stations are acknowledged, so the later ones may not be present.
+ */
+static const
+struct ais_field_desc _ais_ack_fields[] = {
+    AIS_U(ACK_MMSI_1, 40, 30),
+    AIS_U(ACK_SEQUENCE_1, 70, 2),
+    AIS_U(ACK_MMSI_2, 72, 30),
+    AIS_U(ACK_SEQUENCE_2, 102, 2),
+    AIS_U(ACK_MMSI_3, 104, 30),
+    AIS_U(ACK_SEQUENCE_3, 134, 2),
+    AIS_U(ACK_MMSI_4, 136, 30),
+    AIS_U(ACK_SEQUENCE_4, 166, 2),
+};
+
+/**
+ * Message type 8: binary broadcast message
+ */
+static const
+struct ais_field_desc _ais_binary_broadcast_fields[] = {
+    AIS_U(DAC, 40, 10),
+    AIS_U(FID, 50, 6),
+    AIS_D(DATA, 56, 952),
+};
+
+/**
+ * Message type 9: standard SAR aircraft position report
+ */
+static const
+struct ais_field_desc _ais_sar_aircraft_position_fields[] = {
+    AIS_U(ALTITUDE, 38, 12),
+    AIS_U(SPEED_OVER_GROUND, 50, 10),
+    AIS_U(POSITION_ACCURACY, 60, 1),
+    AIS_ID(LONGITUDE, 61, 28, AIS_POS_DIV),
+    AIS_ID(LATITUDE, 89, 27, AIS_POS_DIV),
+    AIS_UD(COURSE_OVER_GROUND, 116, 12, 10),
+    AIS_U(SECOND, 128, 6),
+    AIS_U(REGIONAL, 134, 8),
+    AIS_U(DTE, 142, 1),
+    AIS_U(ASSIGNED, 146, 1),
+    AIS_U(RAIM, 147, 1),
+    AIS_U(RADIO_STATUS, 148, 20),
+};
+
+/**
+ * Message type 10: UTC/date inquiry
+ */
+static const
+struct ais_field_desc _ais_utc_date_inquiry_fields[] = {
+    AIS_U(DEST_MMSI, 40, 30),
+};
+
+/**
+ * Message type 12: addressed safety related message
+ */
+static const
+struct ais_field_desc _ais_safety_addressed_fields[] = {
+    AIS_U(SEQUENCE_NUMBER, 38, 2),
+    AIS_U(DEST_MMSI, 40, 30),
+    AIS_U(RETRANSMIT, 70, 1),
+    AIS_T(TEXT, 72, 936),
+};
+
+/**
+ * Message type 14: safety related broadcast message
+ */
+static const
+struct ais_field_desc _ais_safety_broadcast_fields[] = {
+    AIS_T(TEXT, 40, 968),
+};
+
+/**
+ * Message type 15: interrogation. One or two stations, for one or two message types.
+ */
+static const
+struct ais_field_desc _ais_interrogation_fields[] = {
+    AIS_U(INTERROGATED_MMSI_1, 40, 30),
+    AIS_U(REQUESTED_TYPE_1_1, 70, 6),
+    AIS_U(SLOT_OFFSET_1_1, 76, 12),
+    AIS_U(REQUESTED_TYPE_1_2, 90, 6),
+    AIS_U(SLOT_OFFSET_1_2, 96, 12),
+    AIS_U(INTERROGATED_MMSI_2, 110, 30),
+    AIS_U(REQUESTED_TYPE_2_1, 140, 6),
+    AIS_U(SLOT_OFFSET_2_1, 146, 12),
+};
+
+/**
+ * Message type 16: assignment mode command, for one or two stations
+ */
+static const
+struct ais_field_desc _ais_assignment_mode_fields[] = {
+    AIS_U(ASSIGNED_MMSI_1, 40, 30),
+    AIS_U(ASSIGNED_OFFSET_1, 70, 12),
+    AIS_U(ASSIGNED_INCREMENT_1, 82, 10),
+    AIS_U(ASSIGNED_MMSI_2, 92, 30),
+    AIS_U(ASSIGNED_OFFSET_2, 122, 12),
+    AIS_U(ASSIGNED_INCREMENT_2, 134, 10),
+};
+
+/**
+ * Message type 17: DGNSS broadcast binary message
+ */
+static const
+struct ais_field_desc _ais_dgnss_broadcast_fields[] = {
+    AIS_ID(LONGITUDE, 40, 18, AIS_POS_LOW_DIV),
+    AIS_ID(LATITUDE, 58, 17, AIS_POS_LOW_DIV),
+    AIS_D(DATA, 80, 736),
+};
+
+/**
+ * Message type 18: standard Class B position report
+ */
+static const
+struct ais_field_desc _ais_class_b_position_report_fields[] = {
+    AIS_UD(SPEED_OVER_GROUND, 46, 10, 10),
+    AIS_U(POSITION_ACCURACY, 56, 1),
+    AIS_ID(LONGITUDE, 57, 28, AIS_POS_DIV),
+    AIS_ID(LATITUDE, 85, 27, AIS_POS_DIV),
+    AIS_UD(COURSE_OVER_GROUND, 112, 12, 10),
+    AIS_U(HEADING, 124, 9),
+    AIS_U(SECOND, 133, 6),
+    AIS_U(REGIONAL, 139, 2),
+    AIS_U(CS_UNIT, 141, 1),
+    AIS_U(DISPLAY, 142, 1),
+    AIS_U(DSC, 143, 1),
+    AIS_U(BAND, 144, 1),
+    AIS_U(MSG22, 145, 1),
+    AIS_U(ASSIGNED, 146, 1),
+    AIS_U(RAIM, 147, 1),
+    AIS_U(RADIO_STATUS, 148, 20),
+};
+
+/**
+ * Message type 19: extended Class B position report
+ */
+static const
+struct ais_field_desc _ais_class_b_extended_report_fields[] = {
+    AIS_UD(SPEED_OVER_GROUND, 46, 10, 10),
+    AIS_U(POSITION_ACCURACY, 56, 1),
+    AIS_ID(LONGITUDE, 57, 28, AIS_POS_DIV),
+    AIS_ID(LATITUDE, 85, 27, AIS_POS_DIV),
+    AIS_UD(COURSE_OVER_GROUND, 112, 12, 10),
+    AIS_U(HEADING, 124, 9),
+    AIS_U(SECOND, 133, 6),
+    AIS_U(REGIONAL, 139, 4),
+    AIS_T(SHIP_NAME, 143, 120),
+    AIS_U(SHIP_TYPE, 263, 8),
+    AIS_U(DIM_TO_BOW, 271, 9),
+    AIS_U(DIM_TO_STERN, 280, 9),
+    AIS_U(DIM_TO_PORT, 289, 6),
+    AIS_U(DIM_TO_STARBOARD, 295, 6),
+    AIS_U(EPFD_TYPE, 301, 4),
+    AIS_U(RAIM, 305, 1),
+    AIS_U(DTE, 306, 1),
+    AIS_U(ASSIGNED, 307, 1),
+};
+
+/**
+ * Message type 20: data link management. One to four slot reservations.
+ */
+static const
+struct ais_field_desc _ais_data_link_management_fields[] = {
+    AIS_U(RESERVED_OFFSET_1, 40, 12),
+    AIS_U(RESERVED_NUMBER_1, 52, 4),
+    AIS_U(RESERVED_TIMEOUT_1, 56, 3),
+    AIS_U(RESERVED_INCREMENT_1, 59, 11),
+    AIS_U(RESERVED_OFFSET_2, 70, 12),
+    AIS_U(RESERVED_NUMBER_2, 82, 4),
+    AIS_U(RESERVED_TIMEOUT_2, 86, 3),
+    AIS_U(RESERVED_INCREMENT_2, 89, 11),
+    AIS_U(RESERVED_OFFSET_3, 100, 12),
+    AIS_U(RESERVED_NUMBER_3, 112, 4),
+    AIS_U(RESERVED_TIMEOUT_3, 116, 3),
+    AIS_U(RESERVED_INCREMENT_3, 119, 11),
+    AIS_U(RESERVED_OFFSET_4, 130, 12),
+    AIS_U(RESERVED_NUMBER_4, 142, 4),
+    AIS_U(RESERVED_TIMEOUT_4, 146, 3),
+    AIS_U(RESERVED_INCREMENT_4, 149, 11),
+};
+
+/**
+ * Message type 21: aid-to-navigation report
+ */
+static const
+struct ais_field_desc _ais_aid_to_navigation_report_fields[] = {
+    AIS_U(AID_TYPE, 38, 5),
+    AIS_T(SHIP_NAME, 43, 120),
+    AIS_U(POSITION_ACCURACY, 163, 1),
+    AIS_ID(LONGITUDE, 164, 28, AIS_POS_DIV),
+    AIS_ID(LATITUDE, 192, 27, AIS_POS_DIV),
+    AIS_U(DIM_TO_BOW, 219, 9),
+    AIS_U(DIM_TO_STERN, 228, 9),
+    AIS_U(DIM_TO_PORT, 237, 6),
+    AIS_U(DIM_TO_STARBOARD, 243, 6),
+    AIS_U(EPFD_TYPE, 249, 4),
+    AIS_U(SECOND, 253, 6),
+    AIS_U(OFF_POSITION, 259, 1),
+    AIS_U(REGIONAL, 260, 8),
+    AIS_U(RAIM, 268, 1),
+    AIS_U(VIRTUAL_AID, 269, 1),
+    AIS_U(ASSIGNED, 270, 1),
+    AIS_T(NAME_EXTENSION, 272, 88),
+};
+
+/**
+ * Message type 22: channel management. Either a broadcast to a region, or addressed to two
+ * stations, per the addressed flag at bit 139.
+ */
+static const
+struct ais_field_desc _ais_channel_management_fields[] = {
+    AIS_U(CHANNEL_A, 40, 12),
+    AIS_U(CHANNEL_B, 52, 12),
+    AIS_U(TXRX_MODE, 64, 4),
+    AIS_U(POWER, 68, 1),
+    AIS_FIELD_DESC(NE_LONGITUDE, SIGNED, 69, 18, AIS_POS_LOW_DIV, 139, 1, 0),
+    AIS_FIELD_DESC(NE_LATITUDE, SIGNED, 87, 17, AIS_POS_LOW_DIV, 139, 1, 0),
+    AIS_FIELD_DESC(SW_LONGITUDE, SIGNED, 104, 18, AIS_POS_LOW_DIV, 139, 1, 0),
+    AIS_FIELD_DESC(SW_LATITUDE, SIGNED, 122, 17, AIS_POS_LOW_DIV, 139, 1, 0),
+    AIS_FIELD_DESC(DEST_MMSI_1, UNSIGNED, 69, 30, 0, 139, 1, 1),
+    AIS_FIELD_DESC(DEST_MMSI_2, UNSIGNED, 104, 30, 0, 139, 1, 1),
+    AIS_U(ADDRESSED, 139, 1),
+    AIS_U(BAND_A, 140, 1),
+    AIS_U(BAND_B, 141, 1),
+    AIS_U(ZONE_SIZE, 142, 3),
+};
+
+/**
+ * Message type 23: group assignment command
+ */
+static const
+struct ais_field_desc _ais_group_assignment_fields[] = {
+    AIS_ID(NE_LONGITUDE, 40, 18, AIS_POS_LOW_DIV),
+    AIS_ID(NE_LATITUDE, 58, 17, AIS_POS_LOW_DIV),
+    AIS_ID(SW_LONGITUDE, 75, 18, AIS_POS_LOW_DIV),
+    AIS_ID(SW_LATITUDE, 93, 17, AIS_POS_LOW_DIV),
+    AIS_U(STATION_TYPE, 110, 4),
+    AIS_U(SHIP_TYPE, 114, 8),
+    AIS_U(TXRX_MODE, 144, 2),
+    AIS_U(REPORT_INTERVAL, 146, 4),
+    AIS_U(QUIET_TIME, 150, 4),
+};
+
+/**
+ * Message type 24: static data report. Part A carries the name, part B the rest.
+ */
+static const
+struct ais_field_desc _ais_static_data_report_fields[] = {
+    AIS_U(PART_NUMBER, 38, 2),
+    AIS_FIELD_DESC(SHIP_NAME, TEXT, 40, 120, 0, 38, 2, 0),
+    AIS_FIELD_DESC(SHIP_TYPE, UNSIGNED, 40, 8, 0, 38, 2, 1),
+    AIS_FIELD_DESC(VENDOR_ID, TEXT, 48, 18, 0, 38, 2, 1),
+    AIS_FIELD_DESC(MODEL, UNSIGNED, 66, 4, 0, 38, 2, 1),
+    AIS_FIELD_DESC(SERIAL, UNSIGNED, 70, 20, 0, 38, 2, 1),
+    AIS_FIELD_DESC(CALLSIGN, TEXT, 90, 42, 0, 38, 2, 1),
+    AIS_FIELD_DESC(DIM_TO_BOW, UNSIGNED, 132, 9, 0, 38, 2, 1),
+    AIS_FIELD_DESC(DIM_TO_STERN, UNSIGNED, 141, 9, 0, 38, 2, 1),
+    AIS_FIELD_DESC(DIM_TO_PORT, UNSIGNED, 150, 6, 0, 38, 2, 1),
+    AIS_FIELD_DESC(DIM_TO_STARBOARD, UNSIGNED, 156, 6, 0, 38, 2, 1),
+};
+
+/**
+ * Message types 25 and 26: single and multiple slot binary messages. The addressed and
+ * structured flags decide whether there is a destination and an application ID, and so where
+ * the data starts. For type 26, the data runs on into the radio status at the end.
+ */
+static const
+struct ais_field_desc _ais_slot_binary_fields[] = {
+    AIS_U(ADDRESSED, 38, 1),
+    AIS_U(STRUCTURED, 39, 1),
+    AIS_FIELD_DESC(DEST_MMSI, UNSIGNED, 40, 30, 0, 38, 1, 1),
+    AIS_FIELD_DESC(APP_ID, UNSIGNED, 70, 16, 0, 38, 2, 3),
+    AIS_FIELD_DESC(APP_ID, UNSIGNED, 40, 16, 0, 38, 2, 1),
+    AIS_FIELD_DESC(DATA, DATA, 40, 1024, 0, 38, 2, 0),
+    AIS_FIELD_DESC(DATA, DATA, 56, 1008, 0, 38, 2, 1),
+    AIS_FIELD_DESC(DATA, DATA, 70, 994, 0, 38, 2, 2),
+    AIS_FIELD_DESC(DATA, DATA, 86, 978, 0, 38, 2, 3),
+};
+
+/**
+ * Message type 27: long range AIS broadcast
+ */
+static const
+struct ais_field_desc _ais_long_range_broadcast_fields[] = {
+    AIS_U(POSITION_ACCURACY, 38, 1),
+    AIS_U(RAIM, 39, 1),
+    AIS_U(NAV_STATUS, 40, 4),
+    AIS_ID(LONGITUDE, 44, 18, AIS_POS_LOW_DIV),
+    AIS_ID(LATITUDE, 62, 17, AIS_POS_LOW_DIV),
+    AIS_U(SPEED_OVER_GROUND, 79, 6),
+    AIS_U(COURSE_OVER_GROUND, 85, 9),
+    AIS_U(GNSS_STATUS, 94, 1),
+};
+
+#define AIS_MSG_DESC(n, f)              { .name = (n), .fields = (f), .nr_fields = sizeof(f)/sizeof((f)[0]) }
+
+const struct ais_msg_desc ais_msg_descs[AIS_MESSAGE_TYPE_MAX + 1] = {
+    [AIS_MESSAGE_POSITION_REPORT_SOTDMA] = AIS_MSG_DESC("positionReport", _ais_position_report_fields),
+    [AIS_MESSAGE_POSITION_REPORT_SOTDMA2] = AIS_MSG_DESC("positionReport", _ais_position_report_fields),
+    [AIS_MESSAGE_POSITION_REPORT_ITDMA] = AIS_MSG_DESC("positionReport", _ais_position_report_fields),
+    [AIS_MESSAGE_BASE_STATION_REPORT] = AIS_MSG_DESC("baseStationReport", _ais_base_station_report_fields),
+    [AIS_MESSAGE_SHIP_STATIC_INFO] = AIS_MSG_DESC("staticAndVoyageData", _ais_static_voyage_data_fields),
+    [AIS_MESSAGE_BINARY_ADDRESSED] = AIS_MSG_DESC("binaryAddressed", _ais_binary_addressed_fields),
+    [AIS_MESSAGE_BINARY_ACK] = AIS_MSG_DESC("binaryAck", _ais_ack_fields),
+    [AIS_MESSAGE_BINARY_BROADCAST] = AIS_MSG_DESC("binaryBroadcast", _ais_binary_broadcast_fields),
+    [AIS_MESSAGE_SAR_AIRCRAFT_POSITION] = AIS_MSG_DESC("sarAircraftPositionReport", _ais_sar_aircraft_position_fields),
+    [AIS_MESSAGE_UTC_DATE_INQUIRY] = AIS_MSG_DESC("utcDateInquiry", _ais_utc_date_inquiry_fields),
+    [AIS_MESSAGE_UTC_DATE_RESPONSE] = AIS_MSG_DESC("utcDateResponse", _ais_base_station_report_fields),
+    [AIS_MESSAGE_SAFETY_ADDRESSED] = AIS_MSG_DESC("safetyAddressed", _ais_safety_addressed_fields),
+    [AIS_MESSAGE_SAFETY_ACK] = AIS_MSG_DESC("safetyAck", _ais_ack_fields),
+    [AIS_MESSAGE_SAFETY_BROADCAST] = AIS_MSG_DESC("safetyBroadcast", _ais_safety_broadcast_fields),
+    [AIS_MESSAGE_INTERROGATION] = AIS_MSG_DESC("interrogation", _ais_interrogation_fields),
+    [AIS_MESSAGE_ASSIGNMENT_MODE] = AIS_MSG_DESC("assignmentModeCommand", _ais_assignment_mode_fields),
+    [AIS_MESSAGE_DGNSS_BROADCAST] = AIS_MSG_DESC("dgnssBroadcast", _ais_dgnss_broadcast_fields),
+    [AIS_MESSAGE_CLASS_B_POSITION_REPORT] = AIS_MSG_DESC("classBPositionReport", _ais_class_b_position_report_fields),
+    [AIS_MESSAGE_CLASS_B_EXTENDED_REPORT] = AIS_MSG_DESC("classBExtendedPositionReport", _ais_class_b_extended_report_fields),
+    [AIS_MESSAGE_DATA_LINK_MANAGEMENT] = AIS_MSG_DESC("dataLinkManagement", _ais_data_link_management_fields),
+    [AIS_MESSAGE_AID_TO_NAVIGATION_REPORT] = AIS_MSG_DESC("aidToNavigationReport", _ais_aid_to_navigation_report_fields),
+    [AIS_MESSAGE_CHANNEL_MANAGEMENT] = AIS_MSG_DESC("channelManagement", _ais_channel_management_fields),
+    [AIS_MESSAGE_GROUP_ASSIGNMENT] = AIS_MSG_DESC("groupAssignmentCommand", _ais_group_assignment_fields),
+    [AIS_MESSAGE_STATIC_DATA_REPORT] = AIS_MSG_DESC("staticDataReport", _ais_static_data_report_fields),
+    [AIS_MESSAGE_SINGLE_SLOT_BINARY] = AIS_MSG_DESC("singleSlotBinary", _ais_slot_binary_fields),
+    [AIS_MESSAGE_MULTI_SLOT_BINARY] = AIS_MSG_DESC("multipleSlotBinary", _ais_slot_binary_fields),
+    [AIS_MESSAGE_LONG_RANGE_BROADCAST] = AIS_MSG_DESC("longRangeBroadcast", _ais_long_range_broadcast_fields),
+};
+
+static const
+char *_ais_field_names[AIS_FIELD_MAX] = {
+    [AIS_FIELD_NAV_STATUS] = "navStat",
+    [AIS_FIELD_RATE_OF_TURN] = "rateOfTurn",
+    [AIS_FIELD_SPEED_OVER_GROUND] = "speedOverGround",
+    [AIS_FIELD_POSITION_ACCURACY] = "positionAcc",
+    [AIS_FIELD_LONGITUDE] = "lon",
+    [AIS_FIELD_LATITUDE] = "lat",
+    [AIS_FIELD_COURSE_OVER_GROUND] = "course",
+    [AIS_FIELD_HEADING] = "heading",
+    [AIS_FIELD_SECOND] = "second",
+    [AIS_FIELD_MANEUVER] = "maneuver",
+    [AIS_FIELD_RAIM] = "raim",
+    [AIS_FIELD_RADIO_STATUS] = "radioStatus",
+    [AIS_FIELD_YEAR] = "year",
+    [AIS_FIELD_MONTH] = "month",
+    [AIS_FIELD_DAY] = "day",
+    [AIS_FIELD_HOUR] = "hour",
+    [AIS_FIELD_MINUTE] = "minute",
+    [AIS_FIELD_EPFD_TYPE] = "epfdType",
+    [AIS_FIELD_AIS_VERSION] = "version",
+    [AIS_FIELD_IMO_NUMBER] = "imoNumber",
+    [AIS_FIELD_CALLSIGN] = "callsign",
+    [AIS_FIELD_SHIP_NAME] = "shipName",
+    [AIS_FIELD_SHIP_TYPE] = "shipType",
+    [AIS_FIELD_DIM_TO_BOW] = "dimToBow",
+    [AIS_FIELD_DIM_TO_STERN] = "dimToStern",
+    [AIS_FIELD_DIM_TO_PORT] = "dimToPort",
+    [AIS_FIELD_DIM_TO_STARBOARD] = "dimToStarboard",
+    [AIS_FIELD_ETA_MONTH] = "etaMonth",
+    [AIS_FIELD_ETA_DAY] = "etaDay",
+    [AIS_FIELD_ETA_HOUR] = "etaHour",
+    [AIS_FIELD_ETA_MINUTE] = "etaMinute",
+    [AIS_FIELD_DRAUGHT] = "draught",
+    [AIS_FIELD_DESTINATION] = "destination",
+    [AIS_FIELD_DTE] = "dte",
+    [AIS_FIELD_SEQUENCE_NUMBER] = "sequenceNumber",
+    [AIS_FIELD_DEST_MMSI] = "destMmsi",
+    [AIS_FIELD_RETRANSMIT] = "retransmit",
+    [AIS_FIELD_DAC] = "dac",
+    [AIS_FIELD_FID] = "fid",
+    [AIS_FIELD_DATA] = "data",
+    [AIS_FIELD_ACK_MMSI_1] = "ackMmsi1",
+    [AIS_FIELD_ACK_SEQUENCE_1] = "ackSequence1",
+    [AIS_FIELD_ACK_MMSI_2] = "ackMmsi2",
+    [AIS_FIELD_ACK_SEQUENCE_2] = "ackSequence2",
+    [AIS_FIELD_ACK_MMSI_3] = "ackMmsi3",
+    [AIS_FIELD_ACK_SEQUENCE_3] = "ackSequence3",
+    [AIS_FIELD_ACK_MMSI_4] = "ackMmsi4",
+    [AIS_FIELD_ACK_SEQUENCE_4] = "ackSequence4",
+    [AIS_FIELD_ALTITUDE] = "altitude",
+    [AIS_FIELD_REGIONAL] = "regional",
+    [AIS_FIELD_ASSIGNED] = "assigned",
+    [AIS_FIELD_TEXT] = "text",
+    [AIS_FIELD_INTERROGATED_MMSI_1] = "interrogatedMmsi1",
+    [AIS_FIELD_REQUESTED_TYPE_1_1] = "requestedType1_1",
+    [AIS_FIELD_SLOT_OFFSET_1_1] = "slotOffset1_1",
+    [AIS_FIELD_REQUESTED_TYPE_1_2] = "requestedType1_2",
+    [AIS_FIELD_SLOT_OFFSET_1_2] = "slotOffset1_2",
+    [AIS_FIELD_INTERROGATED_MMSI_2] = "interrogatedMmsi2",
+    [AIS_FIELD_REQUESTED_TYPE_2_1] = "requestedType2_1",
+    [AIS_FIELD_SLOT_OFFSET_2_1] = "slotOffset2_1",
+    [AIS_FIELD_ASSIGNED_MMSI_1] = "assignedMmsi1",
+    [AIS_FIELD_ASSIGNED_OFFSET_1] = "assignedOffset1",
+    [AIS_FIELD_ASSIGNED_INCREMENT_1] = "assignedIncrement1",
+    [AIS_FIELD_ASSIGNED_MMSI_2] = "assignedMmsi2",
+    [AIS_FIELD_ASSIGNED_OFFSET_2] = "assignedOffset2",
+    [AIS_FIELD_ASSIGNED_INCREMENT_2] = "assignedIncrement2",
+    [AIS_FIELD_CS_UNIT] = "csUnit",
+    [AIS_FIELD_DISPLAY] = "display",
+    [AIS_FIELD_DSC] = "dsc",
+    [AIS_FIELD_BAND] = "band",
+    [AIS_FIELD_MSG22] = "msg22",
+    [AIS_FIELD_RESERVED_OFFSET_1] = "reservedOffset1",
+    [AIS_FIELD_RESERVED_NUMBER_1] = "reservedNumber1",
+    [AIS_FIELD_RESERVED_TIMEOUT_1] = "reservedTimeout1",
+    [AIS_FIELD_RESERVED_INCREMENT_1] = "reservedIncrement1",
+    [AIS_FIELD_RESERVED_OFFSET_2] = "reservedOffset2",
+    [AIS_FIELD_RESERVED_NUMBER_2] = "reservedNumber2",
+    [AIS_FIELD_RESERVED_TIMEOUT_2] = "reservedTimeout2",
+    [AIS_FIELD_RESERVED_INCREMENT_2] = "reservedIncrement2",
+    [AIS_FIELD_RESERVED_OFFSET_3] = "reservedOffset3",
+    [AIS_FIELD_RESERVED_NUMBER_3] = "reservedNumber3",
+    [AIS_FIELD_RESERVED_TIMEOUT_3] = "reservedTimeout3",
+    [AIS_FIELD_RESERVED_INCREMENT_3] = "reservedIncrement3",
+    [AIS_FIELD_RESERVED_OFFSET_4] = "reservedOffset4",
+    [AIS_FIELD_RESERVED_NUMBER_4] = "reservedNumber4",
+    [AIS_FIELD_RESERVED_TIMEOUT_4] = "reservedTimeout4",
+    [AIS_FIELD_RESERVED_INCREMENT_4] = "reservedIncrement4",
+    [AIS_FIELD_AID_TYPE] = "aidType",
+    [AIS_FIELD_OFF_POSITION] = "offPosition",
+    [AIS_FIELD_VIRTUAL_AID] = "virtualAid",
+    [AIS_FIELD_NAME_EXTENSION] = "nameExtension",
+    [AIS_FIELD_CHANNEL_A] = "channelA",
+    [AIS_FIELD_CHANNEL_B] = "channelB",
+    [AIS_FIELD_TXRX_MODE] = "txrxMode",
+    [AIS_FIELD_POWER] = "power",
+    [AIS_FIELD_NE_LONGITUDE] = "neLon",
+    [AIS_FIELD_NE_LATITUDE] = "neLat",
+    [AIS_FIELD_SW_LONGITUDE] = "swLon",
+    [AIS_FIELD_SW_LATITUDE] = "swLat",
+    [AIS_FIELD_DEST_MMSI_1] = "destMmsi1",
+    [AIS_FIELD_DEST_MMSI_2] = "destMmsi2",
+    [AIS_FIELD_ADDRESSED] = "addressed",
+    [AIS_FIELD_BAND_A] = "bandA",
+    [AIS_FIELD_BAND_B] = "bandB",
+    [AIS_FIELD_ZONE_SIZE] = "zoneSize",
+    [AIS_FIELD_STATION_TYPE] = "stationType",
+    [AIS_FIELD_REPORT_INTERVAL] = "reportInterval",
+    [AIS_FIELD_QUIET_TIME] = "quietTime",
+    [AIS_FIELD_PART_NUMBER] = "partNumber",
+    [AIS_FIELD_VENDOR_ID] = "vendorId",
+    [AIS_FIELD_MODEL] = "model",
+    [AIS_FIELD_SERIAL] = "serial",
+    [AIS_FIELD_STRUCTURED] = "structured",
+    [AIS_FIELD_APP_ID] = "appId",
+    [AIS_FIELD_GNSS_STATUS] = "gnssStatus",
+};
+
+const char *ais_field_name(enum ais_field field)
+{
+    return AIS_FIELD_MAX > field ? _ais_field_names[field] : "unknown";
+}
+
+/**
+ * Load the 64 bits of the packet starting at the given bit offset, first bit in the MSB. The
+ * packet must be padded, so this can read past the end.
+ */
+static inline
+uint64_t _ais_msg_window(const uint8_t *packet, size_t offset)
+{
+    const uint8_t *p = packet + offset / 8;
+    uint64_t w = (uint64_t)p[0] << 56 | (uint64_t)p[1] << 48 | (uint64_t)p[2] << 40 | (uint64_t)p[3] << 32 |
+                 (uint64_t)p[4] << 24 | (uint64_t)p[5] << 16 | (uint64_t)p[6] << 8 | (uint64_t)p[7];
+
+    return w << (offset % 8);
+}
+
+/**
+ * Check if a field is in the message: its variant was selected, and it fits in the packet. Text
+ * and data fields only need to start in the packet.
+ */
+static inline
+bool _ais_msg_field_present(const struct ais_message *msg, const struct ais_field_desc *fd)
+{
+    if (0 != fd->cond_len) {
+        if (fd->cond_offset + fd->cond_len > msg->nr_bits ||
+                fd->cond_value != _ais_msg_window(msg->packet, fd->cond_offset) >> (64 - fd->cond_len))
+        {
+            return false;
+        }
+    }
+
+    if (AIS_FIELD_TYPE_TEXT == fd->type || AIS_FIELD_TYPE_DATA == fd->type) {
+        return fd->offset < msg->nr_bits;
+    }
+
+    return fd->offset + fd->len <= msg->nr_bits;
+}
+
+/**
+ * Find the description of a field, in the variant of the message we have.
+ */
+static
+const struct ais_field_desc *_ais_msg_find_field(const struct ais_message *msg, enum ais_field field)
+{
+    if (NULL == msg->desc) {
+        return NULL;
+    }
+
+    for (size_t i = 0; i < msg->desc->nr_fields; i++) {
+        const struct ais_field_desc *fd = &msg->desc->fields[i];
+
+        if (field == fd->field && true == _ais_msg_field_present(msg, fd)) {
+            return fd;
+        }
+    }
+
+    return NULL;
+}
+
+aresult_t ais_message_extract(struct ais_message *msg, const uint8_t *packet, size_t packet_len,
+        const struct ais_field_set *wanted)
+{
+    aresult_t ret = A_OK;
+
+    uint64_t w = 0;
+
+    TSL_ASSERT_ARG(NULL != msg);
+    TSL_ASSERT_ARG(NULL != packet);
+
+    if (AIS_MESSAGE_HEADER_BITS > packet_len * 8) {
+        ret = A_E_INVAL;
+        goto done;
+    }
+
+    msg->packet = packet;
+    msg->nr_bits = packet_len * 8;
+    memset(&msg->present, 0, sizeof(msg->present));
+
+    /* The common header is all in the first window */
+    w = _ais_msg_window(packet, 0);
+    msg->msg_id = w >> 58;
+    msg->repeat = (w >> 56) & 0x3;
+    msg->mmsi = (w >> 26) & 0x3fffffff;
+
+    msg->desc = 0 != msg->msg_id && AIS_MESSAGE_TYPE_MAX >= msg->msg_id ? &ais_msg_descs[msg->msg_id] : NULL;
+
+    if (NULL == msg->desc) {
+        goto done;
+    }
+
+    for (size_t i = 0; i < msg->desc->nr_fields; i++) {
+        const struct ais_field_desc *fd = &msg->desc->fields[i];
+
+        if (AIS_FIELD_TYPE_TEXT == fd->type || AIS_FIELD_TYPE_DATA == fd->type) {
+            continue;
+        }
+
+        if ((NULL != wanted && false == ais_field_set_has(wanted, fd->field)) ||
+                false == _ais_msg_field_present(msg, fd))
+        {
+            continue;
+        }
+
+        w = _ais_msg_window(packet, fd->offset);
+
+        if (AIS_FIELD_TYPE_SIGNED == fd->type) {
+            msg->values[fd->field] = (int64_t)w >> (64 - fd->len);
+        } else {
+            msg->values[fd->field] = w >> (64 - fd->len);
+        }
+
+        ais_field_set_add(&msg->present, fd->field);
+    }
+
+done:
+    return ret;
+}
+
+bool ais_message_get(const struct ais_message *msg, enum ais_field field, int64_t *pvalue)
+{
+    TSL_BUG_ON(NULL == msg);
+    TSL_BUG_ON(NULL == pvalue);
+
+    if (AIS_FIELD_MAX <= field || false == ais_field_set_has(&msg->present, field)) {
+        return false;
+    }
+
+    *pvalue = msg->values[field];
+
+    return true;
+}
+
+bool ais_message_get_scaled(const struct ais_message *msg, enum ais_field field, double *pvalue)
+{
+    const struct ais_field_desc *fd = NULL;
+    int64_t value = 0;
+
+    TSL_BUG_ON(NULL == pvalue);
+
+    if (false == ais_message_get(msg, field, &value)) {
+        return false;
+    }
+
+    *pvalue = (double)value;
+
+    if (NULL != (fd = _ais_msg_find_field(msg, field)) && 0 != fd->divisor) {
+        *pvalue /= (double)fd->divisor;
+    }
+
+    return true;
+}
+
+size_t ais_message_get_text(const struct ais_message *msg, enum ais_field field, char *dest, size_t dest_len)
+{
+    const struct ais_field_desc *fd = NULL;
+    size_t nr_chars = 0,
+           nr_bits = 0;
+
+    TSL_BUG_ON(NULL == msg);
+    TSL_BUG_ON(NULL == dest);
+    TSL_BUG_ON(0 == dest_len);
+
+    dest[0] = '\0';
+
+    if (NULL == (fd = _ais_msg_find_field(msg, field)) || AIS_FIELD_TYPE_TEXT != fd->type) {
+        return 0;
+    }
+
+    nr_bits = msg->nr_bits - fd->offset;
+    if (nr_bits > fd->len) {
+        nr_bits = fd->len;
+    }
+
+    nr_chars = nr_bits / 6;
+    if (nr_chars > dest_len - 1) {
+        nr_chars = dest_len - 1;
+    }
+
+    /* Nine characters fit in each window */
+    for (size_t i = 0; i < nr_chars; i += 9) {
+        uint64_t w = _ais_msg_window(msg->packet, fd->offset + i * 6);
+
+        for (size_t j = 0; j < 9 && i + j < nr_chars; j++) {
+            char v = (w >> (58 - j * 6)) & 0x3f;
+            /* Convert out of the 6-bit ASCII format */
+            dest[i + j] = v > 0x1f ? v : v + 0x40;
+        }
+    }
+
+    dest[nr_chars] = '\0';
+
+    return nr_chars;
+}
+
+bool ais_message_get_data(const struct ais_message *msg, enum ais_field field, size_t *poffset, size_t *pnr_bits)
+{
+    const struct ais_field_desc *fd = NULL;
+    size_t nr_bits = 0;
+
+    TSL_BUG_ON(NULL == msg);
+    TSL_BUG_ON(NULL == poffset);
+    TSL_BUG_ON(NULL == pnr_bits);
+
+    if (NULL == (fd = _ais_msg_find_field(msg, field)) || AIS_FIELD_TYPE_DATA != fd->type) {
+        return false;
+    }
+
+    nr_bits = msg->nr_bits - fd->offset;
+
+    *poffset = fd->offset;
+    *pnr_bits = nr_bits > fd->len ? fd->len : nr_bits;
+
+    return true;
+}
@@ -1,8 +1,362 @@
 #pragma once
 
+#include <tsl/result.h>
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
 #define AIS_MESSAGE_POSITION_REPORT_SOTDMA      1
 #define AIS_MESSAGE_POSITION_REPORT_SOTDMA2     2
 #define AIS_MESSAGE_POSITION_REPORT_ITDMA       3
 #define AIS_MESSAGE_BASE_STATION_REPORT         4
 #define AIS_MESSAGE_SHIP_STATIC_INFO            5
+#define AIS_MESSAGE_BINARY_ADDRESSED            6
+#define AIS_MESSAGE_BINARY_ACK                  7
+#define AIS_MESSAGE_BINARY_BROADCAST            8
+#define AIS_MESSAGE_SAR_AIRCRAFT_POSITION       9
+#define AIS_MESSAGE_UTC_DATE_INQUIRY            10
+#define AIS_MESSAGE_UTC_DATE_RESPONSE           11
+#define AIS_MESSAGE_SAFETY_ADDRESSED            12
+#define AIS_MESSAGE_SAFETY_ACK                  13
+#define AIS_MESSAGE_SAFETY_BROADCAST            14
+#define AIS_MESSAGE_INTERROGATION               15
+#define AIS_MESSAGE_ASSIGNMENT_MODE             16
+#define AIS_MESSAGE_DGNSS_BROADCAST             17
+#define AIS_MESSAGE_CLASS_B_POSITION_REPORT     18
+#define AIS_MESSAGE_CLASS_B_EXTENDED_REPORT     19
+#define AIS_MESSAGE_DATA_LINK_MANAGEMENT        20
+#define AIS_MESSAGE_AID_TO_NAVIGATION_REPORT    21
+#define AIS_MESSAGE_CHANNEL_MANAGEMENT          22
+#define AIS_MESSAGE_GROUP_ASSIGNMENT            23
+#define AIS_MESSAGE_STATIC_DATA_REPORT          24
+#define AIS_MESSAGE_SINGLE_SLOT_BINARY          25
+#define AIS_MESSAGE_MULTI_SLOT_BINARY           26
+#define AIS_MESSAGE_LONG_RANGE_BROADCAST        27
+
+/**
+ * The highest message type defined
+ */
+#define AIS_MESSAGE_TYPE_MAX                    27
+
+/**
+ * Length of the common header of every message (type, repeat indicator and MMSI), in bits
+ */
+#define AIS_MESSAGE_HEADER_BITS                 38
+
+/**
+ * Packets handed to ais_message_extract must be readable, and zeroed, for this many bytes past
+ * their end, so that a 64-bit window can be loaded at any bit offset in the packet.
+ */
+#define AIS_MESSAGE_PACKET_PAD                  8
+
+/**
+ * Every field that can appear in an AIS message, past the common header. Fields that mean the
+ * same thing in different message types share an identifier, even if their resolution differs
+ * (see ais_field_desc.divisor).
+ */
+enum ais_field {
+    AIS_FIELD_NAV_STATUS,
+    AIS_FIELD_RATE_OF_TURN,
+    AIS_FIELD_SPEED_OVER_GROUND,
+    AIS_FIELD_POSITION_ACCURACY,
+    AIS_FIELD_LONGITUDE,
+    AIS_FIELD_LATITUDE,
+    AIS_FIELD_COURSE_OVER_GROUND,
+    AIS_FIELD_HEADING,
+    AIS_FIELD_SECOND,
+    AIS_FIELD_MANEUVER,
+    AIS_FIELD_RAIM,
+    AIS_FIELD_RADIO_STATUS,
+    AIS_FIELD_YEAR,
+    AIS_FIELD_MONTH,
+    AIS_FIELD_DAY,
+    AIS_FIELD_HOUR,
+    AIS_FIELD_MINUTE,
+    AIS_FIELD_EPFD_TYPE,
+    AIS_FIELD_AIS_VERSION,
+    AIS_FIELD_IMO_NUMBER,
+    AIS_FIELD_CALLSIGN,
+    AIS_FIELD_SHIP_NAME,
+    AIS_FIELD_SHIP_TYPE,
+    AIS_FIELD_DIM_TO_BOW,
+    AIS_FIELD_DIM_TO_STERN,
+    AIS_FIELD_DIM_TO_PORT,
+    AIS_FIELD_DIM_TO_STARBOARD,
+    AIS_FIELD_ETA_MONTH,
+    AIS_FIELD_ETA_DAY,
+    AIS_FIELD_ETA_HOUR,
+    AIS_FIELD_ETA_MINUTE,
+    AIS_FIELD_DRAUGHT,
+    AIS_FIELD_DESTINATION,
+    AIS_FIELD_DTE,
+    AIS_FIELD_SEQUENCE_NUMBER,
+    AIS_FIELD_DEST_MMSI,
+    AIS_FIELD_RETRANSMIT,
+    AIS_FIELD_DAC,
+    AIS_FIELD_FID,
+    AIS_FIELD_DATA,
+    AIS_FIELD_ACK_MMSI_1,
+    AIS_FIELD_ACK_SEQUENCE_1,
+    AIS_FIELD_ACK_MMSI_2,
+    AIS_FIELD_ACK_SEQUENCE_2,
+    AIS_FIELD_ACK_MMSI_3,
+    AIS_FIELD_ACK_SEQUENCE_3,
+    AIS_FIELD_ACK_MMSI_4,
+    AIS_FIELD_ACK_SEQUENCE_4,
+    AIS_FIELD_ALTITUDE,
+    AIS_FIELD_REGIONAL,
+    AIS_FIELD_ASSIGNED,
+    AIS_FIELD_TEXT,
+    AIS_FIELD_INTERROGATED_MMSI_1,
+    AIS_FIELD_REQUESTED_TYPE_1_1,
+    AIS_FIELD_SLOT_OFFSET_1_1,
+    AIS_FIELD_REQUESTED_TYPE_1_2,
+    AIS_FIELD_SLOT_OFFSET_1_2,
+    AIS_FIELD_INTERROGATED_MMSI_2,
+    AIS_FIELD_REQUESTED_TYPE_2_1,
+    AIS_FIELD_SLOT_OFFSET_2_1,
+    AIS_FIELD_ASSIGNED_MMSI_1,
+    AIS_FIELD_ASSIGNED_OFFSET_1,
+    AIS_FIELD_ASSIGNED_INCREMENT_1,
+    AIS_FIELD_ASSIGNED_MMSI_2,
+    AIS_FIELD_ASSIGNED_OFFSET_2,
+    AIS_FIELD_ASSIGNED_INCREMENT_2,
+    AIS_FIELD_CS_UNIT,
+    AIS_FIELD_DISPLAY,
+    AIS_FIELD_DSC,
+    AIS_FIELD_BAND,
+    AIS_FIELD_MSG22,
+    AIS_FIELD_RESERVED_OFFSET_1,
+    AIS_FIELD_RESERVED_NUMBER_1,
+    AIS_FIELD_RESERVED_TIMEOUT_1,
+    AIS_FIELD_RESERVED_INCREMENT_1,
+    AIS_FIELD_RESERVED_OFFSET_2,
+    AIS_FIELD_RESERVED_NUMBER_2,
+    AIS_FIELD_RESERVED_TIMEOUT_2,
+    AIS_FIELD_RESERVED_INCREMENT_2,
+    AIS_FIELD_RESERVED_OFFSET_3,
+    AIS_FIELD_RESERVED_NUMBER_3,
+    AIS_FIELD_RESERVED_TIMEOUT_3,
+    AIS_FIELD_RESERVED_INCREMENT_3,
+    AIS_FIELD_RESERVED_OFFSET_4,
+    AIS_FIELD_RESERVED_NUMBER_4,
+    AIS_FIELD_RESERVED_TIMEOUT_4,
+    AIS_FIELD_RESERVED_INCREMENT_4,
+    AIS_FIELD_AID_TYPE,
+    AIS_FIELD_OFF_POSITION,
+    AIS_FIELD_VIRTUAL_AID,
+    AIS_FIELD_NAME_EXTENSION,
+    AIS_FIELD_CHANNEL_A,
+    AIS_FIELD_CHANNEL_B,
+    AIS_FIELD_TXRX_MODE,
+    AIS_FIELD_POWER,
+    AIS_FIELD_NE_LONGITUDE,
+    AIS_FIELD_NE_LATITUDE,
+    AIS_FIELD_SW_LONGITUDE,
+    AIS_FIELD_SW_LATITUDE,
+    AIS_FIELD_DEST_MMSI_1,
+    AIS_FIELD_DEST_MMSI_2,
+    AIS_FIELD_ADDRESSED,
+    AIS_FIELD_BAND_A,
+    AIS_FIELD_BAND_B,
+    AIS_FIELD_ZONE_SIZE,
+    AIS_FIELD_STATION_TYPE,
+    AIS_FIELD_REPORT_INTERVAL,
+    AIS_FIELD_QUIET_TIME,
+    AIS_FIELD_PART_NUMBER,
+    AIS_FIELD_VENDOR_ID,
+    AIS_FIELD_MODEL,
+    AIS_FIELD_SERIAL,
+    AIS_FIELD_STRUCTURED,
+    AIS_FIELD_APP_ID,
+    AIS_FIELD_GNSS_STATUS,
+    AIS_FIELD_MAX,
+};
+
+/**
+ * How a field's bits are to be interpreted
+ */
+enum ais_field_type {
+    /**
+     * An unsigned integer (including flags)
+     */
+    AIS_FIELD_TYPE_UNSIGNED,
+
+    /**
+     * A two's complement signed integer
+     */
+    AIS_FIELD_TYPE_SIGNED,
+
+    /**
+     * 6-bit ASCII text. May run short of the described length, at the end of the packet.
+     */
+    AIS_FIELD_TYPE_TEXT,
+
+    /**
+     * Opaque binary data. May run short of the described length, at the end of the packet.
+     */
+    AIS_FIELD_TYPE_DATA,
+};
+
+/**
+ * Where a field lives in a message, and how to interpret it.
+ */
+struct ais_field_desc {
+    /**
+     * The field identifier, an enum ais_field
+     */
+    uint8_t field;
+
+    /**
+     * The field type, an enum ais_field_type
+     */
+    uint8_t type;
+
+    /**
+     * Offset of the field from the start of the message, and its length, in bits. Integer fields
+     * are at most 32 bits long.
+     */
+    uint16_t offset;
+    uint16_t len;
+
+    /**
+     * Some messages have variants, with different fields, chosen by a few bits of the message
+     * (i.e. the part number of a type 24 message). If cond_len is not 0, the field is only present
+     * if the cond_len bits at cond_offset are equal to cond_value.
+     */
+    uint8_t cond_offset;
+    uint8_t cond_len;
+    uint8_t cond_value;
+
+    /**
+     * Divide the raw value by this to get it in its natural unit (i.e. degrees, knots or metres).
+     * 0 if the raw value is what's wanted.
+     */
+    uint32_t divisor;
+};
+
+/**
+ * The layout of one AIS message type
+ */
+struct ais_msg_desc {
+    /**
+     * Human readable name of the message type
+     */
+    const char *name;
+
+    /**
+     * The fields of the message, in the order they appear
+     */
+    const struct ais_field_desc *fields;
+    size_t nr_fields;
+};
+
+/**
+ * Field layouts for each message type, indexed by message type. Unused types have no fields.
+ */
+extern const struct ais_msg_desc ais_msg_descs[AIS_MESSAGE_TYPE_MAX + 1];
+
+#define AIS_FIELD_SET_WORDS                     ((AIS_FIELD_MAX + 63)/64)
+
+/**
+ * A set of fields, i.e. those a caller wants extracted, or those present in a message.
+ */
+struct ais_field_set {
+    uint64_t mask[AIS_FIELD_SET_WORDS];
+};
+
+static inline
+void ais_field_set_add(struct ais_field_set *set, enum ais_field field)
+{
+    set->mask[field / 64] |= 1ull << (field % 64);
+}
+
+static inline
+bool ais_field_set_has(const struct ais_field_set *set, enum ais_field field)
+{
+    return !!(set->mask[field / 64] & (1ull << (field % 64)));
+}
+
+/**
+ * An AIS message, with the fields asked for extracted.
+ */
+struct ais_message {
+    /**
+     * The common header
+     */
+    unsigned msg_id;
+    unsigned repeat;
+    uint32_t mmsi;
+
+    /**
+     * The layout of the message. NULL if the message type is not defined.
+     */
+    const struct ais_msg_desc *desc;
+
+    /**
+     * The raw packet, padded per AIS_MESSAGE_PACKET_PAD, and its length in bits. Only valid as
+     * long as the packet is.
+     */
+    const uint8_t *packet;
+    size_t nr_bits;
+
+    /**
+     * The integer fields that were asked for and are present in the message
+     */
+    struct ais_field_set present;
+
+    /**
+     * Raw values of the integer fields, indexed by field. Only those in present are valid.
+     */
+    int64_t values[AIS_FIELD_MAX];
+};
+
+/**
+ * Unpack the header of a message, and the integer fields of it the caller is interested in. Text
+ * and data fields are only extracted on request, with ais_message_get_text and
+ * ais_message_get_data.
+ *
+ * \param msg The message to fill in
+ * \param packet The raw packet, which must be padded per AIS_MESSAGE_PACKET_PAD
+ * \param packet_len The length of the packet, in bytes
+ * \param wanted The fields to extract. NULL to extract every integer field.
+ *
+ * \return A_OK on success, A_E_INVAL if the packet is too short to be an AIS message.
+ */
+aresult_t ais_message_extract(struct ais_message *msg, const uint8_t *packet, size_t packet_len,
+        const struct ais_field_set *wanted);
+
+/**
+ * Get the raw value of an integer field.
+ *
+ * \return true if the field was extracted, false if it was not asked for, or is not present
+ */
+bool ais_message_get(const struct ais_message *msg, enum ais_field field, int64_t *pvalue);
+
+/**
+ * Get the value of an integer field, scaled to its natural unit.
+ *
+ * \return true if the field was extracted, false if it was not asked for, or is not present
+ */
+bool ais_message_get_scaled(const struct ais_message *msg, enum ais_field field, double *pvalue);
+
+/**
+ * Get a text field, converted from 6-bit ASCII. At most dest_len - 1 characters are written,
+ * and the result is always terminated. The padding ('@') is kept.
+ *
+ * \return The number of characters written, or 0 if the field is not present
+ */
+size_t ais_message_get_text(const struct ais_message *msg, enum ais_field field, char *dest, size_t dest_len);
+
+/**
+ * Find a data field in the packet.
+ *
+ * \return true if the field is present, with its offset and length in bits returned by reference
+ */
+bool ais_message_get_data(const struct ais_message *msg, enum ais_field field, size_t *poffset, size_t *pnr_bits);
 
+/**
+ * Get the name of a field, for diagnostics
+ */
+const char *ais_field_name(enum ais_field field);
@@ -0,0 +1,129 @@
+#include <ais/ais_nmea.h>
+
+#include <tsl/errors.h>
+#include <tsl/assert.h>
+#include <tsl/diag.h>
+
+#include <string.h>
+
+/**
+ * The 6-bit ASCII armor: values 0 to 39 map to '0' to 'W', and 40 to 63 to '`' to 'w'.
+ */
+static const
+char _ais_nmea_armor[64] = "0123456789:;<=>?@ABCDEFGHIJKLMNOPQRSTUVW`abcdefghijklmnopqrstuvw";
+
+static const
+char _ais_nmea_hex[16] = "0123456789ABCDEF";
+
+size_t ais_nmea_armor(char *out, const uint8_t *packet, size_t packet_len, unsigned *pfill_bits)
+{
+    size_t nr_chars = 0,
+           i = 0;
+    uint32_t accum = 0;
+
+#ifdef _TSL_DEBUG
+    TSL_BUG_ON(NULL == out);
+    TSL_BUG_ON(NULL == packet);
+    TSL_BUG_ON(NULL == pfill_bits);
+#endif
+
+    /* Every 3 bytes are exactly 4 characters */
+    for (i = 0; i + 3 <= packet_len; i += 3) {
+        accum = ((uint32_t)packet[i] << 16) | ((uint32_t)packet[i + 1] << 8) | packet[i + 2];
+        out[nr_chars + 0] = _ais_nmea_armor[(accum >> 18) & 0x3f];
+        out[nr_chars + 1] = _ais_nmea_armor[(accum >> 12) & 0x3f];
+        out[nr_chars + 2] = _ais_nmea_armor[(accum >> 6) & 0x3f];
+        out[nr_chars + 3] = _ais_nmea_armor[accum & 0x3f];
+        nr_chars += 4;
+    }
+
+    /* The leftover byte or two are padded out with fill bits to a whole character */
+    switch (packet_len - i) {
+    case 1:
+        accum = (uint32_t)packet[i] << 16;
+        out[nr_chars + 0] = _ais_nmea_armor[(accum >> 18) & 0x3f];
+        out[nr_chars + 1] = _ais_nmea_armor[(accum >> 12) & 0x3f];
+        nr_chars += 2;
+        *pfill_bits = 4;
+        break;
+    case 2:
+        accum = ((uint32_t)packet[i] << 16) | ((uint32_t)packet[i + 1] << 8);
+        out[nr_chars + 0] = _ais_nmea_armor[(accum >> 18) & 0x3f];
+        out[nr_chars + 1] = _ais_nmea_armor[(accum >> 12) & 0x3f];
+        out[nr_chars + 2] = _ais_nmea_armor[(accum >> 6) & 0x3f];
+        nr_chars += 3;
+        *pfill_bits = 2;
+        break;
+    default:
+        *pfill_bits = 0;
+    }
+
+    return nr_chars;
+}
+
+aresult_t ais_nmea_format(char *out, size_t out_len, size_t *pout_used, const uint8_t *packet, size_t packet_len,
+        char channel, unsigned seq_id)
+{
+    aresult_t ret = A_OK;
+
+    size_t nr_fragments = 0,
+           used = 0;
+
+    TSL_ASSERT_ARG(NULL != out);
+    TSL_ASSERT_ARG(NULL != pout_used);
+    TSL_ASSERT_ARG(NULL != packet);
+    TSL_ASSERT_ARG(0 != packet_len);
+
+    *pout_used = 0;
+
+    nr_fragments = (packet_len + AIS_NMEA_FRAGMENT_BYTES - 1) / AIS_NMEA_FRAGMENT_BYTES;
+
+    if (AIS_NMEA_MAX_FRAGMENTS < nr_fragments || nr_fragments * AIS_NMEA_SENTENCE_MAX > out_len) {
+        ret = A_E_INVAL;
+        goto done;
+    }
+
+    for (size_t frag = 0; frag < nr_fragments; frag++) {
+        size_t offs = frag * AIS_NMEA_FRAGMENT_BYTES;
+        char *sentence = out + used,
+             *cur = sentence;
+        unsigned fill_bits = 0;
+        uint8_t csum = 0;
+
+        memcpy(cur, "!AIVDM,", 7);
+        cur += 7;
+        *cur++ = '0' + nr_fragments;
+        *cur++ = ',';
+        *cur++ = '1' + frag;
+        *cur++ = ',';
+        if (1 < nr_fragments) {
+            *cur++ = '0' + seq_id % 10;
+        }
+        *cur++ = ',';
+        *cur++ = channel;
+        *cur++ = ',';
+
+        cur += ais_nmea_armor(cur, packet + offs, BL_MIN2(packet_len - offs, AIS_NMEA_FRAGMENT_BYTES), &fill_bits);
+
+        *cur++ = ',';
+        *cur++ = '0' + fill_bits;
+
+        /* The checksum covers everything between the '!' and the '*' */
+        for (const char *c = sentence + 1; c < cur; c++) {
+            csum ^= (uint8_t)*c;
+        }
+
+        *cur++ = '*';
+        *cur++ = _ais_nmea_hex[csum >> 4];
+        *cur++ = _ais_nmea_hex[csum & 0xf];
+        *cur++ = '\r';
+        *cur++ = '\n';
+
+        used += cur - sentence;
+    }
+
+    *pout_used = used;
+
+done:
+    return ret;
+}
@@ -0,0 +1,64 @@
+#pragma once
+
+#include <tsl/result.h>
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * Most armored payload characters carried by one sentence. 60 characters is 360 bits, or 45
+ * bytes, so every fragment but the last starts and ends on a byte boundary.
+ */
+#define AIS_NMEA_FRAGMENT_CHARS         60
+
+/**
+ * Packet bytes carried by a full fragment
+ */
+#define AIS_NMEA_FRAGMENT_BYTES         ((AIS_NMEA_FRAGMENT_CHARS * 6) / 8)
+
+/**
+ * Longest sentence, including the trailing CR LF, per NMEA 0183.
+ */
+#define AIS_NMEA_SENTENCE_MAX           82
+
+/**
+ * The fragment count is a single digit
+ */
+#define AIS_NMEA_MAX_FRAGMENTS          9
+
+/**
+ * Bytes needed to hold all the sentences for a packet of the given length, in bytes.
+ */
+#define AIS_NMEA_BUF_LEN(packet_len) \
+    ((((packet_len) + AIS_NMEA_FRAGMENT_BYTES - 1) / AIS_NMEA_FRAGMENT_BYTES) * AIS_NMEA_SENTENCE_MAX)
+
+/**
+ * Armor a packet as 6-bit ASCII, as carried in the payload of an AIVDM sentence.
+ *
+ * \param out Where to write the armored payload. Must hold at least (packet_len * 8 + 5) / 6
+ *            characters. Not NUL terminated.
+ * \param packet The raw packet
+ * \param packet_len The length of the packet, in bytes
+ * \param pfill_bits The number of fill bits padding out the last character, returned by reference
+ *
+ * \return The number of characters written
+ */
+size_t ais_nmea_armor(char *out, const uint8_t *packet, size_t packet_len, unsigned *pfill_bits);
+
+/**
+ * Format a packet as one or more !AIVDM sentences, each terminated with CR LF, split into
+ * fragments of at most AIS_NMEA_FRAGMENT_CHARS characters.
+ *
+ * \param out Where to write the sentences
+ * \param out_len Size of out, at least AIS_NMEA_BUF_LEN(packet_len)
+ * \param pout_used The number of bytes written, returned by reference. Not NUL terminated.
+ * \param packet The raw packet
+ * \param packet_len The length of the packet, in bytes
+ * \param channel The radio channel the packet was heard on, 'A' or 'B'
+ * \param seq_id The sequential message ID tying the fragments of a packet together, 0 to 9. Only
+ *               used if the packet needs more than one fragment.
+ *
+ * \return A_OK on success, A_E_INVAL if the packet needs too many fragments or out is too small.
+ */
+aresult_t ais_nmea_format(char *out, size_t out_len, size_t *pout_used, const uint8_t *packet, size_t packet_len,
+        char channel, unsigned seq_id);
@@ -0,0 +1,435 @@
+#include <ais/ais_vessel_table.h>
+
+#include <tsl/safe_alloc.h>
+#include <tsl/errors.h>
+#include <tsl/diag.h>
+#include <tsl/assert.h>
+
+#include <pthread.h>
+#include <string.h>
+#include <math.h>
+
+/**
+ * Mean radius of the earth, in metres. Vessels move little enough between reports that a flat
+ * earth approximation is plenty.
+ */
+#define AIS_VESSEL_EARTH_RADIUS         6371000.0
+
+/**
+ * Course over ground, in tenths of a degree, when it's not available
+ */
+#define AIS_VESSEL_COURSE_UNAVAILABLE   3600
+
+/**
+ * A slot in the table: the vessel state, and what was last emitted for it
+ */
+struct ais_vessel_slot {
+    /**
+     * The vessel, or an empty slot if the MMSI is 0
+     */
+    struct ais_vessel vessel;
+
+    /**
+     * The position report last emitted, and when
+     */
+    float emitted_latitude;
+    float emitted_longitude;
+    uint32_t emitted_course;
+    uint32_t emitted_nav_stat;
+    uint64_t position_emitted_ms;
+
+    /**
+     * When the static and voyage data was last emitted
+     */
+    uint64_t static_voyage_emitted_ms;
+};
+
+/**
+ * An open addressing hash table, with linear probing, keyed on MMSI. The table is never more than
+ * half full, so probe sequences stay short and there's always an empty slot to end them.
+ */
+struct ais_vessel_table {
+    struct ais_vessel_table_config config;
+
+    pthread_mutex_t lock;
+
+    struct ais_vessel_slot *slots;
+    size_t nr_slots;
+    unsigned slot_bits;
+
+    size_t nr_vessels;
+    uint64_t nr_suppressed;
+
+    /**
+     * When the next snapshot is due, in milliseconds
+     */
+    uint64_t next_snapshot_ms;
+};
+
+static inline
+size_t _ais_vessel_table_hash(const struct ais_vessel_table *table, uint32_t mmsi)
+{
+    /* Fibonacci hashing: MMSIs are far from uniformly distributed in their low bits */
+    return (size_t)((mmsi * 2654435769u) >> (32 - table->slot_bits));
+}
+
+/**
+ * Time since then, in milliseconds. The channels' clocks can be a little out of step with each
+ * other, so a time slightly in the future counts as now.
+ */
+static inline
+uint64_t _ais_vessel_table_since(uint64_t now_ms, uint64_t then_ms)
+{
+    return now_ms > then_ms ? now_ms - then_ms : 0;
+}
+
+/**
+ * Find the slot for a vessel. If the vessel isn't in the table and insert is set, an empty slot is
+ * claimed for it, unless the table is full.
+ *
+ * \return The slot, or NULL if the vessel isn't in the table and wasn't added.
+ */
+static
+struct ais_vessel_slot *_ais_vessel_table_find(struct ais_vessel_table *table, uint32_t mmsi, bool insert)
+{
+    size_t mask = table->nr_slots - 1;
+
+    for (size_t i = _ais_vessel_table_hash(table, mmsi); ; i = (i + 1) & mask) {
+        struct ais_vessel_slot *slot = &table->slots[i];
+
+        if (mmsi == slot->vessel.mmsi) {
+            return slot;
+        }
+
+        if (0 == slot->vessel.mmsi) {
+            if (false == insert || table->config.max_vessels == table->nr_vessels) {
+                return NULL;
+            }
+
+            memset(slot, 0, sizeof(*slot));
+            slot->vessel.mmsi = mmsi;
+            table->nr_vessels++;
+
+            return slot;
+        }
+    }
+}
+
+/**
+ * Remove the vessel in the given slot. Rather than leaving a tombstone, the rest of the probe
+ * sequence is shifted back to fill the hole.
+ */
+static
+void _ais_vessel_table_remove(struct ais_vessel_table *table, size_t hole)
+{
+    size_t mask = table->nr_slots - 1;
+
+    for (size_t i = (hole + 1) & mask; 0 != table->slots[i].vessel.mmsi; i = (i + 1) & mask) {
+        size_t home = _ais_vessel_table_hash(table, table->slots[i].vessel.mmsi);
+
+        /* The vessel can move to the hole if its home slot isn't between the hole and here */
+        if (((i - home) & mask) >= ((i - hole) & mask)) {
+            table->slots[hole] = table->slots[i];
+            hole = i;
+        }
+    }
+
+    table->slots[hole].vessel.mmsi = 0;
+    table->nr_vessels--;
+}
+
+static
+void _ais_vessel_table_copy_raw_msg(char *dst, const char *raw_msg)
+{
+    size_t len = 0;
+
+    if (NULL != raw_msg) {
+        len = strnlen(raw_msg, AIS_VESSEL_RAW_MSG_LEN);
+        memcpy(dst, raw_msg, len);
+    }
+
+    dst[len] = '\0';
+}
+
+/**
+ * Check if a position report differs enough from the last one emitted to be worth emitting.
+ */
+static
+bool _ais_vessel_table_position_changed(const struct ais_vessel_table *table, const struct ais_vessel_slot *slot,
+        const struct ais_position_report *rpt)
+{
+    double dlat = (rpt->latitude - slot->emitted_latitude) * (M_PI / 180.0),
+           dlon = (rpt->longitude - slot->emitted_longitude) * (M_PI / 180.0) *
+                cos((rpt->latitude + slot->emitted_latitude) * (M_PI / 360.0));
+    uint32_t course_diff = 0;
+
+    if (rpt->nav_stat != slot->emitted_nav_stat) {
+        return true;
+    }
+
+    if (AIS_VESSEL_EARTH_RADIUS * sqrt(dlat * dlat + dlon * dlon) >= table->config.min_distance) {
+        return true;
+    }
+
+    if (rpt->course != slot->emitted_course &&
+            (AIS_VESSEL_COURSE_UNAVAILABLE <= rpt->course || AIS_VESSEL_COURSE_UNAVAILABLE <= slot->emitted_course))
+    {
+        /* The course came or went */
+        return true;
+    }
+
+    course_diff = rpt->course > slot->emitted_course ? rpt->course - slot->emitted_course :
+        slot->emitted_course - rpt->course;
+    course_diff = BL_MIN2(course_diff, 3600 - course_diff);
+
+    return (float)course_diff / 10.0f >= table->config.min_course_change;
+}
+
+static
+void _ais_vessel_table_position_emitted(struct ais_vessel_slot *slot, uint64_t now_ms)
+{
+    slot->emitted_latitude = slot->vessel.position.latitude;
+    slot->emitted_longitude = slot->vessel.position.longitude;
+    slot->emitted_course = slot->vessel.position.course;
+    slot->emitted_nav_stat = slot->vessel.position.nav_stat;
+    slot->position_emitted_ms = now_ms;
+}
+
+aresult_t ais_vessel_table_new(struct ais_vessel_table **ptable, const struct ais_vessel_table_config *config)
+{
+    aresult_t ret = A_OK;
+
+    struct ais_vessel_table *table = NULL;
+
+    TSL_ASSERT_ARG(NULL != ptable);
+    TSL_ASSERT_ARG(NULL != config);
+    TSL_ASSERT_ARG(0 != config->max_vessels);
+
+    *ptable = NULL;
+
+    if (FAILED(ret = TZAALLOC(table, SYS_CACHE_LINE_LENGTH))) {
+        goto done;
+    }
+
+    table->config = *config;
+    table->next_snapshot_ms = config->snapshot_interval_ms;
+
+    /* At least twice as many slots as vessels, rounded up to a power of 2 */
+    table->slot_bits = 1;
+    while (((size_t)1 << table->slot_bits) < 2 * config->max_vessels) {
+        table->slot_bits++;
+    }
+    table->nr_slots = (size_t)1 << table->slot_bits;
+
+    if (FAILED(ret = TCALLOC((void **)&table->slots, sizeof(struct ais_vessel_slot), table->nr_slots))) {
+        goto done;
+    }
+
+    pthread_mutex_init(&table->lock, NULL);
+
+    *ptable = table;
+
+done:
+    if (FAILED(ret)) {
+        if (NULL != table) {
+            TFREE(table);
+        }
+    }
+    return ret;
+}
+
+aresult_t ais_vessel_table_delete(struct ais_vessel_table **ptable)
+{
+    struct ais_vessel_table *table = NULL;
+
+    TSL_ASSERT_ARG(NULL != ptable);
+    TSL_ASSERT_ARG(NULL != *ptable);
+
+    table = *ptable;
+
+    pthread_mutex_destroy(&table->lock);
+    TFREE(table->slots);
+    TFREE(table);
+
+    *ptable = NULL;
+
+    return A_OK;
+}
+
+aresult_t ais_vessel_table_on_position_report(struct ais_vessel_table *table, uint64_t now_ms,
+        const struct ais_position_report *rpt, const char *raw_msg, bool *pemit)
+{
+    struct ais_vessel_slot *slot = NULL;
+    bool emit = true;
+
+    TSL_ASSERT_ARG(NULL != table);
+    TSL_ASSERT_ARG(NULL != rpt);
+    TSL_ASSERT_ARG(NULL != pemit);
+
+    if (0 == rpt->mmsi) {
+        /* Not a valid MMSI, and 0 marks an empty slot, so don't track it */
+        goto done;
+    }
+
+    pthread_mutex_lock(&table->lock);
+
+    if (NULL == (slot = _ais_vessel_table_find(table, rpt->mmsi, true))) {
+        /* The table is full, so there's nothing to compare against */
+        pthread_mutex_unlock(&table->lock);
+        goto done;
+    }
+
+    if (true == slot->vessel.has_position &&
+            _ais_vessel_table_since(now_ms, slot->position_emitted_ms) < table->config.max_interval_ms &&
+            false == _ais_vessel_table_position_changed(table, slot, rpt))
+    {
+        emit = false;
+        table->nr_suppressed++;
+    }
+
+    slot->vessel.last_heard_ms = now_ms;
+    slot->vessel.has_position = true;
+    slot->vessel.position = *rpt;
+    _ais_vessel_table_copy_raw_msg(slot->vessel.position_raw_msg, raw_msg);
+
+    if (true == emit) {
+        _ais_vessel_table_position_emitted(slot, now_ms);
+    }
+
+    pthread_mutex_unlock(&table->lock);
+
+done:
+    *pemit = emit;
+    return A_OK;
+}
+
+aresult_t ais_vessel_table_on_static_voyage_data(struct ais_vessel_table *table, uint64_t now_ms,
+        const struct ais_static_voyage_data *svd, const char *raw_msg, bool *pemit)
+{
+    struct ais_vessel_slot *slot = NULL;
+    bool emit = true;
+
+    TSL_ASSERT_ARG(NULL != table);
+    TSL_ASSERT_ARG(NULL != svd);
+    TSL_ASSERT_ARG(NULL != pemit);
+
+    if (0 == svd->mmsi) {
+        goto done;
+    }
+
+    pthread_mutex_lock(&table->lock);
+
+    if (NULL == (slot = _ais_vessel_table_find(table, svd->mmsi, true))) {
+        pthread_mutex_unlock(&table->lock);
+        goto done;
+    }
+
+    /* The decoder clears the whole struct before filling it in, so it can be compared as is */
+    if (true == slot->vessel.has_static_voyage_data &&
+            _ais_vessel_table_since(now_ms, slot->static_voyage_emitted_ms) < table->config.max_interval_ms &&
+            0 == memcmp(&slot->vessel.static_voyage_data, svd, sizeof(*svd)))
+    {
+        emit = false;
+        table->nr_suppressed++;
+    }
+
+    slot->vessel.last_heard_ms = now_ms;
+    slot->vessel.has_static_voyage_data = true;
+    slot->vessel.static_voyage_data = *svd;
+    _ais_vessel_table_copy_raw_msg(slot->vessel.static_voyage_raw_msg, raw_msg);
+
+    if (true == emit) {
+        slot->static_voyage_emitted_ms = now_ms;
+    }
+
+    pthread_mutex_unlock(&table->lock);
+
+done:
+    *pemit = emit;
+    return A_OK;
+}
+
+bool ais_vessel_table_snapshot_due(struct ais_vessel_table *table, uint64_t now_ms)
+{
+    bool due = false;
+
+    TSL_BUG_ON(NULL == table);
+
+    if (0 == table->config.snapshot_interval_ms) {
+        return false;
+    }
+
+    pthread_mutex_lock(&table->lock);
+
+    if (now_ms >= table->next_snapshot_ms) {
+        due = true;
+        table->next_snapshot_ms = now_ms + table->config.snapshot_interval_ms;
+    }
+
+    pthread_mutex_unlock(&table->lock);
+
+    return due;
+}
+
+aresult_t ais_vessel_table_snapshot(struct ais_vessel_table *table, uint64_t now_ms,
+        ais_vessel_table_on_vessel_func_t on_vessel, void *state)
+{
+    aresult_t ret = A_OK;
+
+    TSL_ASSERT_ARG(NULL != table);
+
+    pthread_mutex_lock(&table->lock);
+
+    for (size_t i = 0; i < table->nr_slots; i++) {
+        struct ais_vessel_slot *slot = &table->slots[i];
+
+        if (0 == slot->vessel.mmsi || _ais_vessel_table_since(now_ms, slot->vessel.last_heard_ms) >= table->config.expire_ms) {
+            continue;
+        }
+
+        if (NULL != on_vessel && FAILED(ret = on_vessel(table, state, &slot->vessel))) {
+            goto done;
+        }
+
+        if (true == slot->vessel.has_position) {
+            _ais_vessel_table_position_emitted(slot, now_ms);
+        }
+
+        if (true == slot->vessel.has_static_voyage_data) {
+            slot->static_voyage_emitted_ms = now_ms;
+        }
+    }
+
+    /*
+     * Forget the vessels that have expired. Removing a vessel can shift the next one in its probe
+     * sequence back into the same slot, so check it again before moving on.
+     */
+    for (size_t i = 0; i < table->nr_slots; i++) {
+        while (0 != table->slots[i].vessel.mmsi &&
+                _ais_vessel_table_since(now_ms, table->slots[i].vessel.last_heard_ms) >= table->config.expire_ms)
+        {
+            _ais_vessel_table_remove(table, i);
+        }
+    }
+
+done:
+    pthread_mutex_unlock(&table->lock);
+    return ret;
+}
+
+void ais_vessel_table_stats(struct ais_vessel_table *table, size_t *pnr_vessels, uint64_t *pnr_suppressed)
+{
+    TSL_BUG_ON(NULL == table);
+
+    pthread_mutex_lock(&table->lock);
+
+    if (NULL != pnr_vessels) {
+        *pnr_vessels = table->nr_vessels;
+    }
+
+    if (NULL != pnr_suppressed) {
+        *pnr_suppressed = table->nr_suppressed;
+    }
+
+    pthread_mutex_unlock(&table->lock);
+}
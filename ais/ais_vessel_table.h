@@ -0,0 +1,124 @@
+#pragma once
+
+#include <ais/ais_decode.h>
+
+#include <tsl/result.h>
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/**
+ * Longest raw (armored) message kept for a vessel. Longer messages are truncated.
+ */
+#define AIS_VESSEL_RAW_MSG_LEN          80
+
+struct ais_vessel_table;
+
+/**
+ * When to emit an update for a vessel that's already been heard from. A report is emitted if any
+ * one of the thresholds is crossed, relative to the last report emitted for the vessel.
+ */
+struct ais_vessel_table_config {
+    /**
+     * Most vessels tracked at once. Once full, reports for new vessels are always emitted.
+     */
+    size_t max_vessels;
+
+    /**
+     * Distance moved, in metres
+     */
+    float min_distance;
+
+    /**
+     * Change in course over ground, in degrees
+     */
+    float min_course_change;
+
+    /**
+     * Longest time between updates for a vessel, in milliseconds
+     */
+    uint64_t max_interval_ms;
+
+    /**
+     * Time between snapshots of every vessel in the table, in milliseconds, or 0 for none
+     */
+    uint64_t snapshot_interval_ms;
+
+    /**
+     * Vessels not heard from for this long are forgotten at the next snapshot, in milliseconds
+     */
+    uint64_t expire_ms;
+};
+
+/**
+ * The latest state known for a vessel
+ */
+struct ais_vessel {
+    uint32_t mmsi;
+
+    /**
+     * When the vessel was last heard from, in milliseconds
+     */
+    uint64_t last_heard_ms;
+
+    bool has_position;
+    struct ais_position_report position;
+    char position_raw_msg[AIS_VESSEL_RAW_MSG_LEN + 1];
+
+    bool has_static_voyage_data;
+    struct ais_static_voyage_data static_voyage_data;
+    char static_voyage_raw_msg[AIS_VESSEL_RAW_MSG_LEN + 1];
+};
+
+/**
+ * Called for every vessel in the table when taking a snapshot
+ */
+typedef aresult_t (*ais_vessel_table_on_vessel_func_t)(struct ais_vessel_table *table, void *state,
+        const struct ais_vessel *vessel);
+
+/**
+ * Create a new vessel table.
+ *
+ * \param ptable The new table, returned by reference
+ * \param config The thresholds for emitting updates. Copied.
+ */
+aresult_t ais_vessel_table_new(struct ais_vessel_table **ptable, const struct ais_vessel_table_config *config);
+aresult_t ais_vessel_table_delete(struct ais_vessel_table **ptable);
+
+/**
+ * Record a position report, and check if it should be emitted. The table can be updated from
+ * several threads at once.
+ *
+ * \param table The vessel table
+ * \param now_ms The current time, in milliseconds
+ * \param rpt The position report
+ * \param raw_msg The armored message the report was decoded from
+ * \param pemit Set to true if the report should be emitted, false if it should be suppressed
+ */
+aresult_t ais_vessel_table_on_position_report(struct ais_vessel_table *table, uint64_t now_ms,
+        const struct ais_position_report *rpt, const char *raw_msg, bool *pemit);
+
+/**
+ * Record static and voyage data, and check if it should be emitted, i.e. if it changed or hasn't
+ * been emitted for the longest interval.
+ */
+aresult_t ais_vessel_table_on_static_voyage_data(struct ais_vessel_table *table, uint64_t now_ms,
+        const struct ais_static_voyage_data *svd, const char *raw_msg, bool *pemit);
+
+/**
+ * Check if a snapshot is due, per the snapshot interval. Only returns true once per interval, so
+ * the caller that sees true should take the snapshot.
+ */
+bool ais_vessel_table_snapshot_due(struct ais_vessel_table *table, uint64_t now_ms);
+
+/**
+ * Call the callback for every vessel in the table, and forget the vessels that have expired. Every
+ * vessel is treated as having been emitted now. The table is locked while this runs.
+ */
+aresult_t ais_vessel_table_snapshot(struct ais_vessel_table *table, uint64_t now_ms,
+        ais_vessel_table_on_vessel_func_t on_vessel, void *state);
+
+/**
+ * Get the number of vessels in the table, and the number of reports suppressed so far.
+ */
+void ais_vessel_table_stats(struct ais_vessel_table *table, size_t *pnr_vessels, uint64_t *pnr_suppressed);
@@ -1,5 +1,7 @@
 #include <ais/ais_demod.h>
 #include <ais/ais_decode.h>
+#include <ais/ais_demod_priv.h>
+#include <ais/ais_msg_format.h>
 
 #include <test/assert.h>
 #include <test/framework.h>
@@ -11,6 +13,7 @@
 
 #include <stdlib.h>
 #include <stdio.h>
+#include <string.h>
 
 static
 const int16_t *samples = NULL;
@@ -186,7 +189,7 @@ TEST_DECLARE_UNIT(test_one_shot_decoder, ais_demod)
 
     TEST_ASSERT_OK(ais_decode_new(&decoder, 162025000ul, NULL, NULL, NULL));
     TEST_ASSERT_NOT_NULL(decoder);
-    TEST_ASSERT_OK(ais_decode_on_pcm(decoder, samples, nr_samples));
+    TEST_ASSERT_OK(ais_decode_on_pcm(decoder, 0, samples, nr_samples));
     TEST_ASSERT_OK(ais_decode_delete(&decoder));
 
     return A_OK;
@@ -206,6 +209,419 @@ TEST_DECLARE_UNIT(test_one_shot, ais_demod)
     return A_OK;
 }
 
+#define TEST_SAMPLES_PER_BIT        5
+#define TEST_MAX_PACKET_BYTES       64
+#define TEST_MAX_SAMPLES            (TEST_SAMPLES_PER_BIT * 16 * (TEST_MAX_PACKET_BYTES + 16))
+
+/**
+ * Reference bit-at-a-time CRC-16, as the HDLC FCS is specified.
+ */
+static
+uint16_t _test_crc16(const uint8_t *data, size_t len)
+{
+    uint16_t crc = 0xffffu;
+
+    for (size_t i = 0; i < len; i++) {
+        crc ^= data[i];
+        for (size_t j = 0; j < 8; j++) {
+            crc = crc & 1 ? (crc >> 1) ^ 0x8408u : crc >> 1;
+        }
+    }
+
+    return ~crc;
+}
+
+struct test_packet_capture {
+    uint8_t packet[TEST_MAX_PACKET_BYTES];
+    size_t packet_len;
+    size_t nr_packets;
+};
+
+static
+aresult_t _test_capture_cb(struct ais_demod *demod, void *state, const uint8_t *packet, size_t packet_len, bool fcs_valid)
+{
+    struct test_packet_capture *cap = state;
+
+    if (true == fcs_valid && packet_len <= TEST_MAX_PACKET_BYTES) {
+        memcpy(cap->packet, packet, packet_len);
+        cap->packet_len = packet_len;
+        cap->nr_packets++;
+    }
+
+    return A_OK;
+}
+
+/**
+ * Mask of the samples in each bit that are stuck at 0, as if they were lost in the noise. Only
+ * the rest of the samples in each bit can be relied on.
+ */
+static
+unsigned test_blurred = 0;
+
+/**
+ * NRZI encode a bit (a 0 is a change in level), writing out the samples for it.
+ */
+static
+size_t _test_nrzi_bit(int16_t *out, size_t nr_out, int *plevel, unsigned bit)
+{
+    if (0 == bit) {
+        *plevel = -*plevel;
+    }
+
+    for (size_t i = 0; i < TEST_SAMPLES_PER_BIT; i++) {
+        out[nr_out++] = (test_blurred >> i) & 1 ? 0 : *plevel * 8000;
+    }
+
+    return nr_out;
+}
+
+/**
+ * Build the samples for an HDLC framed packet: preamble, start flag, the bit stuffed packet and
+ * FCS, then the end flag.
+ */
+static
+size_t _test_frame_packet(int16_t *out, const uint8_t *packet, size_t packet_len)
+{
+    uint8_t framed[TEST_MAX_PACKET_BYTES + 2];
+    uint16_t crc = _test_crc16(packet, packet_len);
+    size_t nr_out = 0,
+           nr_ones = 0;
+    int level = 1;
+
+    memcpy(framed, packet, packet_len);
+    framed[packet_len] = crc & 0xff;
+    framed[packet_len + 1] = crc >> 8;
+
+    /* Some idle time, then the preamble and the start flag */
+    for (size_t i = 0; i < 16; i++) {
+        nr_out = _test_nrzi_bit(out, nr_out, &level, 1);
+    }
+
+    for (size_t i = 0; i < 24; i++) {
+        nr_out = _test_nrzi_bit(out, nr_out, &level, i & 1);
+    }
+
+    for (size_t i = 0; i < 8; i++) {
+        nr_out = _test_nrzi_bit(out, nr_out, &level, (0x7e >> (7 - i)) & 1);
+    }
+
+    /* Each byte goes out LSB first, with a 0 stuffed after every five 1's in a row */
+    for (size_t i = 0; i < (packet_len + 2) * 8; i++) {
+        unsigned bit = (framed[i / 8] >> (i % 8)) & 1;
+
+        nr_out = _test_nrzi_bit(out, nr_out, &level, bit);
+
+        nr_ones = bit ? nr_ones + 1 : 0;
+        if (5 == nr_ones) {
+            nr_out = _test_nrzi_bit(out, nr_out, &level, 0);
+            nr_ones = 0;
+        }
+    }
+
+    for (size_t i = 0; i < 8; i++) {
+        nr_out = _test_nrzi_bit(out, nr_out, &level, (0x7e >> (7 - i)) & 1);
+    }
+
+    /* And some trailing idle */
+    for (size_t i = 0; i < 16; i++) {
+        nr_out = _test_nrzi_bit(out, nr_out, &level, 1);
+    }
+
+    return nr_out;
+}
+
+TEST_DECLARE_UNIT(test_framed_packets, ais_demod)
+{
+    static int16_t framed[TEST_MAX_SAMPLES];
+    struct ais_demod *demod = NULL;
+    struct test_packet_capture cap;
+
+    memset(&cap, 0, sizeof(cap));
+
+    srandom(68);
+
+    test_blurred = 0;
+
+    TEST_ASSERT_OK(ais_demod_new(&demod, &cap, _test_capture_cb, 162025000ul));
+
+    for (size_t n = 0; n < 256; n++) {
+        uint8_t packet[TEST_MAX_PACKET_BYTES];
+        /* Lengths that are and aren't a multiple of 4, to cover the CRC tail */
+        size_t packet_len = 21 + n % 11,
+               nr_framed = 0,
+               nr_packets = cap.nr_packets;
+
+        for (size_t i = 0; i < packet_len; i++) {
+            /* Plenty of 1's, so there's lots of stuffing */
+            packet[i] = 0 == n % 4 ? 0xff : random();
+        }
+
+        nr_framed = _test_frame_packet(framed, packet, packet_len);
+
+        /* Odd sized chunks, so bytes get split across calls */
+        for (size_t off = 0, chunk = n % 13 + 1; off < nr_framed; off += chunk) {
+            size_t nr = chunk > nr_framed - off ? nr_framed - off : chunk;
+            TEST_ASSERT_OK(ais_demod_on_pcm(demod, framed + off, nr));
+        }
+
+        TEST_ASSERT_EQUALS(cap.nr_packets, nr_packets + 1);
+        TEST_ASSERT_EQUALS(cap.packet_len, packet_len);
+        TEST_ASSERT_EQUALS(memcmp(cap.packet, packet, packet_len), 0);
+    }
+
+    TEST_ASSERT_OK(ais_demod_delete(&demod));
+
+    return A_OK;
+}
+
+TEST_DECLARE_UNIT(test_framed_packets_phase, ais_demod)
+{
+    static int16_t framed[TEST_MAX_SAMPLES];
+    struct ais_demod *demod = NULL;
+    struct test_packet_capture cap;
+
+    memset(&cap, 0, sizeof(cap));
+
+    srandom(70);
+
+    TEST_ASSERT_OK(ais_demod_new(&demod, &cap, _test_capture_cb, 162025000ul));
+
+    static const unsigned blurred[] = { 0x14, 0x0a, 0x12, 0x03 };
+
+    /*
+     * With some samples of every bit unreliable, only some of the decimation phases see the
+     * packet properly, and the demodulator has to find one of them. Each packet should still be
+     * delivered exactly once.
+     */
+    for (size_t n = 0; n < 64; n++) {
+        uint8_t packet[TEST_MAX_PACKET_BYTES];
+        size_t packet_len = 21,
+               nr_framed = 0,
+               nr_packets = cap.nr_packets;
+
+        test_blurred = blurred[n % 4];
+
+        for (size_t i = 0; i < packet_len; i++) {
+            packet[i] = random();
+        }
+
+        nr_framed = _test_frame_packet(framed, packet, packet_len);
+
+        /* Start at each sample offset in turn, so the preamble is found at every phase */
+        TEST_ASSERT_OK(ais_demod_on_pcm(demod, framed + n % TEST_SAMPLES_PER_BIT,
+                    nr_framed - n % TEST_SAMPLES_PER_BIT));
+
+        TEST_ASSERT_EQUALS(cap.nr_packets, nr_packets + 1);
+        TEST_ASSERT_EQUALS(cap.packet_len, packet_len);
+        TEST_ASSERT_EQUALS(memcmp(cap.packet, packet, packet_len), 0);
+    }
+
+    test_blurred = 0;
+
+    TEST_ASSERT_OK(ais_demod_delete(&demod));
+
+    return A_OK;
+}
+
+static
+size_t test_nr_reports = 0;
+
+static
+aresult_t _test_count_position_report(struct ais_decode *decode, void *state, struct ais_position_report *rpt,
+        const char *raw_msg)
+{
+    test_nr_reports++;
+
+    return A_OK;
+}
+
+TEST_DECLARE_UNIT(test_dual_channel_dedup, ais_demod)
+{
+    static int16_t framed[TEST_MAX_SAMPLES],
+                   other[TEST_MAX_SAMPLES],
+                   idle[AIS_INPUT_SAMPLE_RATE / 4];
+    struct ais_decode *decode = NULL;
+    unsigned channel = 0;
+    size_t nr_framed = 0,
+           nr_other = 0;
+
+    srandom(71);
+
+    test_blurred = 0;
+    test_nr_reports = 0;
+
+    memset(idle, 0, sizeof(idle));
+
+    TEST_ASSERT_OK(ais_decode_new(&decode, 161975000ul, _test_count_position_report, NULL, NULL));
+    TEST_ASSERT_OK(ais_decode_add_channel(decode, 162025000ul, &channel));
+    TEST_ASSERT_EQUALS(channel, 1);
+
+    for (size_t n = 0; n < 16; n++) {
+        uint8_t packet[TEST_MAX_PACKET_BYTES];
+        size_t packet_len = 21,
+               nr_reports = test_nr_reports;
+
+        /* A position report, with the rest of the bits random */
+        for (size_t i = 0; i < packet_len; i++) {
+            packet[i] = random();
+        }
+        packet[0] = (AIS_MESSAGE_POSITION_REPORT_SOTDMA << 2) | (packet[0] & 0x3);
+
+        nr_framed = _test_frame_packet(framed, packet, packet_len);
+
+        /* The same packet, heard on both channels, is only delivered once */
+        TEST_ASSERT_OK(ais_decode_on_pcm(decode, 0, framed, nr_framed));
+        TEST_ASSERT_OK(ais_decode_on_pcm(decode, 1, framed, nr_framed));
+        TEST_ASSERT_EQUALS(test_nr_reports, nr_reports + 1);
+
+        /* A different packet on each channel at the same time is delivered from both */
+        packet[5] ^= 0x10;
+        nr_other = _test_frame_packet(other, packet, packet_len);
+        packet[5] ^= 0x10;
+        packet[7] ^= 0x01;
+        nr_framed = _test_frame_packet(framed, packet, packet_len);
+
+        TEST_ASSERT_OK(ais_decode_on_pcm(decode, 0, framed, nr_framed));
+        TEST_ASSERT_OK(ais_decode_on_pcm(decode, 1, other, nr_other));
+        TEST_ASSERT_EQUALS(test_nr_reports, nr_reports + 3);
+
+        /* Keep the channels in step, so they share a clock */
+        if (nr_framed != nr_other) {
+            size_t lag = nr_framed > nr_other ? nr_framed - nr_other : nr_other - nr_framed;
+            TEST_ASSERT_OK(ais_decode_on_pcm(decode, nr_framed > nr_other ? 1 : 0, idle, lag));
+        }
+
+        /* Once the window has passed, the same packet again is a new transmission */
+        for (size_t i = 0; i < 5; i++) {
+            TEST_ASSERT_OK(ais_decode_on_pcm(decode, 0, idle, sizeof(idle)/sizeof(idle[0])));
+            TEST_ASSERT_OK(ais_decode_on_pcm(decode, 1, idle, sizeof(idle)/sizeof(idle[0])));
+        }
+
+        TEST_ASSERT_OK(ais_decode_on_pcm(decode, 1, other, nr_other));
+        TEST_ASSERT_OK(ais_decode_on_pcm(decode, 0, other, nr_other));
+        TEST_ASSERT_EQUALS(test_nr_reports, nr_reports + 4);
+
+        for (size_t i = 0; i < 5; i++) {
+            TEST_ASSERT_OK(ais_decode_on_pcm(decode, 0, idle, sizeof(idle)/sizeof(idle[0])));
+            TEST_ASSERT_OK(ais_decode_on_pcm(decode, 1, idle, sizeof(idle)/sizeof(idle[0])));
+        }
+    }
+
+    TEST_ASSERT_EQUALS(ais_decode_nr_duplicates(decode), 32);
+
+    TEST_ASSERT_OK(ais_decode_delete(&decode));
+
+    return A_OK;
+}
+
+/**
+ * The sample of a framed packet at which the preamble should be found: in the last bit of the
+ * start flag, once AIS_PREAMBLE_MIN_PHASES decimation phases have seen it.
+ */
+#define TEST_PREAMBLE_FOUND_SAMPLE  ((16 + 24 + 8 - 1) * TEST_SAMPLES_PER_BIT + AIS_PREAMBLE_MIN_PHASES - 1)
+
+TEST_DECLARE_UNIT(test_preamble_phases, ais_demod)
+{
+    static int16_t framed[TEST_MAX_SAMPLES + AIS_DECIMATION_RATE];
+    uint8_t packet[TEST_MAX_PACKET_BYTES];
+    size_t packet_len = 21;
+
+    srandom(72);
+
+    test_blurred = 0;
+
+    for (size_t i = 0; i < packet_len; i++) {
+        packet[i] = random();
+    }
+
+    /*
+     * Delay the packet by each number of samples up to a bit, so the preamble is found in each
+     * decimation phase, and check it's found at exactly the right sample: fed a sample at a
+     * time, and in one block that ends on that sample or just before it.
+     */
+    for (size_t delay = 0; delay < AIS_DECIMATION_RATE; delay++) {
+        size_t found = TEST_PREAMBLE_FOUND_SAMPLE + delay,
+               nr_framed = 0;
+        struct ais_demod *demod = NULL;
+        struct test_packet_capture cap;
+
+        memset(framed, 0, sizeof(int16_t) * delay);
+        nr_framed = delay + _test_frame_packet(framed + delay, packet, packet_len);
+
+        memset(&cap, 0, sizeof(cap));
+        TEST_ASSERT_OK(ais_demod_new(&demod, &cap, _test_capture_cb, 162025000ul));
+
+        for (size_t i = 0; i < found; i++) {
+            TEST_ASSERT_OK(ais_demod_on_pcm(demod, framed + i, 1));
+            TEST_ASSERT_EQUALS(demod->state, AIS_DEMOD_STATE_SEARCH_SYNC);
+        }
+
+        TEST_ASSERT_OK(ais_demod_on_pcm(demod, framed + found, 1));
+        TEST_ASSERT_EQUALS(demod->state, AIS_DEMOD_STATE_RECEIVING);
+
+        TEST_ASSERT_OK(ais_demod_on_pcm(demod, framed + found + 1, nr_framed - found - 1));
+        TEST_ASSERT_EQUALS(cap.nr_packets, 1);
+        TEST_ASSERT_EQUALS(memcmp(cap.packet, packet, packet_len), 0);
+        TEST_ASSERT_OK(ais_demod_delete(&demod));
+
+        TEST_ASSERT_OK(ais_demod_new(&demod, &cap, _test_capture_cb, 162025000ul));
+        TEST_ASSERT_OK(ais_demod_on_pcm(demod, framed, found));
+        TEST_ASSERT_EQUALS(demod->state, AIS_DEMOD_STATE_SEARCH_SYNC);
+        TEST_ASSERT_OK(ais_demod_delete(&demod));
+
+        TEST_ASSERT_OK(ais_demod_new(&demod, &cap, _test_capture_cb, 162025000ul));
+        TEST_ASSERT_OK(ais_demod_on_pcm(demod, framed, found + 1));
+        TEST_ASSERT_EQUALS(demod->state, AIS_DEMOD_STATE_RECEIVING);
+        TEST_ASSERT_OK(ais_demod_delete(&demod));
+    }
+
+    return A_OK;
+}
+
+TEST_DECLARE_UNIT(test_preamble_split, ais_demod)
+{
+    static int16_t framed[TEST_MAX_SAMPLES + AIS_DECIMATION_RATE];
+    uint8_t packet[TEST_MAX_PACKET_BYTES];
+    size_t packet_len = 21;
+
+    srandom(73);
+
+    test_blurred = 0;
+
+    /* A position report, with the rest of the bits random */
+    for (size_t i = 0; i < packet_len; i++) {
+        packet[i] = random();
+    }
+    packet[0] = (AIS_MESSAGE_POSITION_REPORT_SOTDMA << 2) | (packet[0] & 0x3);
+
+    /*
+     * Split the samples between two calls at every sample from the start of the preamble to just
+     * after it's found, with the packet delayed so the preamble is found in each decimation phase.
+     */
+    for (size_t delay = 0; delay < AIS_DECIMATION_RATE; delay++) {
+        size_t nr_framed = 0;
+
+        memset(framed, 0, sizeof(int16_t) * delay);
+        nr_framed = delay + _test_frame_packet(framed + delay, packet, packet_len);
+
+        for (size_t split = delay + 16 * TEST_SAMPLES_PER_BIT; split <= TEST_PREAMBLE_FOUND_SAMPLE + delay + 1;
+                split++)
+        {
+            struct ais_decode *decode = NULL;
+
+            test_nr_reports = 0;
+
+            TEST_ASSERT_OK(ais_decode_new(&decode, 162025000ul, _test_count_position_report, NULL, NULL));
+            TEST_ASSERT_OK(ais_decode_on_pcm(decode, 0, framed, split));
+            TEST_ASSERT_OK(ais_decode_on_pcm(decode, 0, framed + split, nr_framed - split));
+            TEST_ASSERT_EQUALS(test_nr_reports, 1);
+            TEST_ASSERT_OK(ais_decode_delete(&decode));
+        }
+    }
+
+    return A_OK;
+}
+
 TEST_DECLARE_UNIT(test_smoke, ais_demod)
 {
     struct ais_demod *demod = NULL;
@@ -0,0 +1,250 @@
+#include <ais/ais_msg_format.h>
+
+#include <test/assert.h>
+#include <test/framework.h>
+
+#include <tsl/assert.h>
+
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+
+#define TEST_MAX_PACKET_BYTES       128
+
+/**
+ * Reference bit-at-a-time field extraction, most significant bit first.
+ */
+static
+uint64_t _test_get_bits(const uint8_t *packet, size_t offset, size_t len)
+{
+    uint64_t acc = 0;
+
+    for (size_t i = offset; i < offset + len; i++) {
+        acc = (acc << 1) | ((packet[i / 8] >> (7 - i % 8)) & 1);
+    }
+
+    return acc;
+}
+
+static
+void _test_set_bits(uint8_t *packet, size_t offset, size_t len, uint64_t value)
+{
+    for (size_t i = 0; i < len; i++) {
+        size_t bit = offset + i;
+        unsigned v = (value >> (len - 1 - i)) & 1;
+
+        packet[bit / 8] = (packet[bit / 8] & ~(0x80 >> (bit % 8))) | (v << (7 - bit % 8));
+    }
+}
+
+/**
+ * Check if a field should be present, per its condition and the packet length, the slow way.
+ */
+static
+bool _test_field_present(const uint8_t *packet, size_t nr_bits, const struct ais_field_desc *fd)
+{
+    if (0 != fd->cond_len && (fd->cond_offset + fd->cond_len > nr_bits ||
+                fd->cond_value != _test_get_bits(packet, fd->cond_offset, fd->cond_len)))
+    {
+        return false;
+    }
+
+    if (AIS_FIELD_TYPE_TEXT == fd->type || AIS_FIELD_TYPE_DATA == fd->type) {
+        return fd->offset < nr_bits;
+    }
+
+    return fd->offset + fd->len <= nr_bits;
+}
+
+TEST_DECLARE_UNIT(test_fields_match_reference, ais_msg_format)
+{
+    uint8_t packet[TEST_MAX_PACKET_BYTES + AIS_MESSAGE_PACKET_PAD];
+    struct ais_message msg;
+
+    srandom(72);
+
+    for (unsigned msg_id = 1; msg_id <= AIS_MESSAGE_TYPE_MAX; msg_id++) {
+        const struct ais_msg_desc *desc = &ais_msg_descs[msg_id];
+
+        TEST_ASSERT_NOT_NULL(desc->name);
+        TEST_ASSERT_NOT_EQUALS(desc->nr_fields, 0);
+
+        for (size_t n = 0; n < 256; n++) {
+            /* Full length packets, and packets cut short, so some fields are missing */
+            size_t packet_len = 0 == n % 4 ? 5 + random() % 20 : 21 + random() % (TEST_MAX_PACKET_BYTES - 21);
+            size_t nr_bits = packet_len * 8;
+
+            for (size_t i = 0; i < packet_len; i++) {
+                packet[i] = random();
+            }
+            memset(packet + packet_len, 0, AIS_MESSAGE_PACKET_PAD);
+
+            _test_set_bits(packet, 0, 6, msg_id);
+
+            TEST_ASSERT_OK(ais_message_extract(&msg, packet, packet_len, NULL));
+            TEST_ASSERT_EQUALS(msg.msg_id, msg_id);
+            TEST_ASSERT_EQUALS(msg.repeat, _test_get_bits(packet, 6, 2));
+            TEST_ASSERT_EQUALS(msg.mmsi, _test_get_bits(packet, 8, 30));
+            TEST_ASSERT_EQUALS(msg.desc == desc, true);
+
+            for (size_t f = 0; f < desc->nr_fields; f++) {
+                const struct ais_field_desc *fd = &desc->fields[f];
+                bool present = _test_field_present(packet, nr_bits, fd);
+
+                switch (fd->type) {
+                case AIS_FIELD_TYPE_UNSIGNED:
+                case AIS_FIELD_TYPE_SIGNED: {
+                    int64_t value = 0,
+                            expect = 0;
+
+                    if (false == present) {
+                        /* Variants can reuse a field; only the one that's present counts */
+                        break;
+                    }
+
+                    expect = _test_get_bits(packet, fd->offset, fd->len);
+                    if (AIS_FIELD_TYPE_SIGNED == fd->type && (expect >> (fd->len - 1)) & 1) {
+                        expect -= 1ll << fd->len;
+                    }
+
+                    TEST_ASSERT_EQUALS(ais_message_get(&msg, fd->field, &value), true);
+                    TEST_ASSERT_EQUALS(value, expect);
+                    break;
+                }
+                case AIS_FIELD_TYPE_TEXT: {
+                    char text[200];
+                    size_t nr_chars = 0;
+
+                    if (false == present) {
+                        break;
+                    }
+
+                    nr_chars = ais_message_get_text(&msg, fd->field, text, sizeof(text));
+                    TEST_ASSERT_EQUALS(nr_chars, BL_MIN2(fd->len, nr_bits - fd->offset) / 6);
+                    TEST_ASSERT_EQUALS(text[nr_chars], '\0');
+
+                    for (size_t i = 0; i < nr_chars; i++) {
+                        char v = _test_get_bits(packet, fd->offset + i * 6, 6);
+                        TEST_ASSERT_EQUALS(text[i], v > 0x1f ? v : v + 0x40);
+                    }
+                    break;
+                }
+                case AIS_FIELD_TYPE_DATA: {
+                    size_t offset = 0,
+                           nr_data_bits = 0;
+
+                    if (false == present) {
+                        break;
+                    }
+
+                    TEST_ASSERT_EQUALS(ais_message_get_data(&msg, fd->field, &offset, &nr_data_bits), true);
+                    TEST_ASSERT_EQUALS(offset, fd->offset);
+                    TEST_ASSERT_EQUALS(nr_data_bits, BL_MIN2(fd->len, nr_bits - fd->offset));
+                    break;
+                }
+                }
+            }
+        }
+    }
+
+    return A_OK;
+}
+
+TEST_DECLARE_UNIT(test_wanted_fields, ais_msg_format)
+{
+    uint8_t packet[TEST_MAX_PACKET_BYTES + AIS_MESSAGE_PACKET_PAD];
+    struct ais_field_set wanted;
+    struct ais_message msg;
+    int64_t value = 0;
+    double scaled = 0.0;
+
+    memset(packet, 0, sizeof(packet));
+    memset(&wanted, 0, sizeof(wanted));
+
+    /* A position report, at 49.5N 123.25W */
+    _test_set_bits(packet, 0, 6, AIS_MESSAGE_POSITION_REPORT_SOTDMA);
+    _test_set_bits(packet, 8, 30, 316001234);
+    _test_set_bits(packet, 50, 10, 123);
+    _test_set_bits(packet, 61, 28, (int32_t)(-123.25 * 600000.0));
+    _test_set_bits(packet, 89, 27, (uint32_t)(49.5 * 600000.0));
+
+    ais_field_set_add(&wanted, AIS_FIELD_LONGITUDE);
+    ais_field_set_add(&wanted, AIS_FIELD_SPEED_OVER_GROUND);
+
+    TEST_ASSERT_OK(ais_message_extract(&msg, packet, 21, &wanted));
+    TEST_ASSERT_EQUALS(msg.mmsi, 316001234);
+
+    /* Only what was asked for is extracted */
+    TEST_ASSERT_EQUALS(ais_message_get(&msg, AIS_FIELD_LATITUDE, &value), false);
+    TEST_ASSERT_EQUALS(ais_message_get(&msg, AIS_FIELD_NAV_STATUS, &value), false);
+
+    TEST_ASSERT_EQUALS(ais_message_get(&msg, AIS_FIELD_LONGITUDE, &value), true);
+    TEST_ASSERT_EQUALS(value, -123.25 * 600000.0);
+    TEST_ASSERT_EQUALS(ais_message_get_scaled(&msg, AIS_FIELD_LONGITUDE, &scaled), true);
+    TEST_ASSERT_EQUALS(scaled, -123.25);
+    TEST_ASSERT_EQUALS(ais_message_get_scaled(&msg, AIS_FIELD_SPEED_OVER_GROUND, &scaled), true);
+    TEST_ASSERT_EQUALS(scaled, 12.3);
+
+    /* Too short to even have a header */
+    TEST_ASSERT_EQUALS(ais_message_extract(&msg, packet, 4, NULL), A_E_INVAL);
+
+    return A_OK;
+}
+
+TEST_DECLARE_UNIT(test_variants, ais_msg_format)
+{
+    uint8_t packet[TEST_MAX_PACKET_BYTES + AIS_MESSAGE_PACKET_PAD];
+    struct ais_message msg;
+    char text[32];
+    int64_t value = 0;
+
+    memset(packet, 0, sizeof(packet));
+
+    /* Type 24 part A has the name, part B the call sign */
+    _test_set_bits(packet, 0, 6, AIS_MESSAGE_STATIC_DATA_REPORT);
+    _test_set_bits(packet, 38, 2, 0);
+    for (size_t i = 0; i < 20; i++) {
+        _test_set_bits(packet, 40 + i * 6, 6, 'A' - 0x40 + i % 26);
+    }
+
+    TEST_ASSERT_OK(ais_message_extract(&msg, packet, 21, NULL));
+    TEST_ASSERT_EQUALS(ais_message_get_text(&msg, AIS_FIELD_SHIP_NAME, text, sizeof(text)), 20);
+    TEST_ASSERT_EQUALS(strcmp(text, "ABCDEFGHIJKLMNOPQRST"), 0);
+    TEST_ASSERT_EQUALS(ais_message_get_text(&msg, AIS_FIELD_CALLSIGN, text, sizeof(text)), 0);
+    TEST_ASSERT_EQUALS(ais_message_get(&msg, AIS_FIELD_SHIP_TYPE, &value), false);
+
+    _test_set_bits(packet, 38, 2, 1);
+
+    TEST_ASSERT_OK(ais_message_extract(&msg, packet, 21, NULL));
+    TEST_ASSERT_EQUALS(ais_message_get_text(&msg, AIS_FIELD_SHIP_NAME, text, sizeof(text)), 0);
+    TEST_ASSERT_EQUALS(ais_message_get_text(&msg, AIS_FIELD_CALLSIGN, text, sizeof(text)), 7);
+    TEST_ASSERT_EQUALS(ais_message_get(&msg, AIS_FIELD_SHIP_TYPE, &value), true);
+
+    /* Truncated text stops at the end of the packet, and at the end of the buffer */
+    TEST_ASSERT_EQUALS(ais_message_get_text(&msg, AIS_FIELD_CALLSIGN, text, 4), 3);
+
+    /* Type 25, addressed and structured: the data starts after the destination and app ID */
+    memset(packet, 0, sizeof(packet));
+    _test_set_bits(packet, 0, 6, AIS_MESSAGE_SINGLE_SLOT_BINARY);
+    _test_set_bits(packet, 38, 2, 3);
+    _test_set_bits(packet, 40, 30, 2320001);
+    _test_set_bits(packet, 70, 16, 0x1234);
+
+    TEST_ASSERT_OK(ais_message_extract(&msg, packet, 21, NULL));
+    TEST_ASSERT_EQUALS(ais_message_get(&msg, AIS_FIELD_DEST_MMSI, &value), true);
+    TEST_ASSERT_EQUALS(value, 2320001);
+    TEST_ASSERT_EQUALS(ais_message_get(&msg, AIS_FIELD_APP_ID, &value), true);
+    TEST_ASSERT_EQUALS(value, 0x1234);
+
+    {
+        size_t offset = 0,
+               nr_bits = 0;
+        TEST_ASSERT_EQUALS(ais_message_get_data(&msg, AIS_FIELD_DATA, &offset, &nr_bits), true);
+        TEST_ASSERT_EQUALS(offset, 86);
+        TEST_ASSERT_EQUALS(nr_bits, 168 - 86);
+    }
+
+    return A_OK;
+}
+
+TEST_DECLARE_SUITE(ais_msg_format, NULL, NULL, NULL, NULL);
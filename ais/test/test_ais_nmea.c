@@ -0,0 +1,85 @@
+#include <ais/ais_nmea.h>
+
+#include <test/assert.h>
+#include <test/framework.h>
+
+#include <tsl/assert.h>
+
+#include <string.h>
+
+/**
+ * A position report: !AIVDM,1,1,,B,177KQJ5000G?tO`K>RA1wUbN0TKH,0*5C
+ */
+static const
+uint8_t _test_position_report[] = {
+    0x04, 0x71, 0xdb, 0x85, 0xa1, 0x40, 0x00, 0x05, 0xcf, 0xf1, 0xfa, 0x1b, 0x3a, 0x24, 0x41, 0xfe,
+    0x5a, 0x9e, 0x02, 0x46, 0xd8,
+};
+
+/**
+ * Static and voyage data, 424 bits, padded out to a whole byte
+ */
+static const
+uint8_t _test_static_voyage_data[] = {
+    0x14, 0x58, 0x05, 0x91, 0xc0, 0x01, 0x99, 0x9a, 0x51, 0x71, 0x01, 0xe7, 0x6d, 0xf4, 0x35, 0x4b,
+    0x8d, 0x25, 0x40, 0xc8, 0x14, 0xc3, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x63, 0x2d, 0x16,
+    0x8a, 0x28, 0x44, 0x48, 0x00, 0xf1, 0x31, 0x41, 0x51, 0x43, 0x05, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00,
+};
+
+TEST_DECLARE_UNIT(test_single_sentence, ais_nmea)
+{
+    static const char expected[] = "!AIVDM,1,1,,B,177KQJ5000G?tO`K>RA1wUbN0TKH,0*5C\r\n";
+    char out[AIS_NMEA_BUF_LEN(sizeof(_test_position_report))];
+    size_t used = 0;
+
+    TEST_ASSERT_OK(ais_nmea_format(out, sizeof(out), &used, _test_position_report, sizeof(_test_position_report),
+                'B', 7));
+    TEST_ASSERT_EQUALS(used, sizeof(expected) - 1);
+    TEST_ASSERT_EQUALS(memcmp(out, expected, used), 0);
+
+    /* Not enough room */
+    TEST_ASSERT_EQUALS(ais_nmea_format(out, AIS_NMEA_SENTENCE_MAX - 1, &used, _test_position_report,
+                sizeof(_test_position_report), 'B', 7), A_E_INVAL);
+
+    return A_OK;
+}
+
+TEST_DECLARE_UNIT(test_fragments, ais_nmea)
+{
+    static const char expected[] =
+        "!AIVDM,2,1,3,B,55P5TL01VIaAL@7WKO@mBplU@<PDhh000000001S;AJ::4A80?4i@E531@00,0*4F\r\n"
+        "!AIVDM,2,2,3,B,00000000000,2*24\r\n";
+    char out[AIS_NMEA_BUF_LEN(sizeof(_test_static_voyage_data))];
+    size_t used = 0;
+
+    TEST_ASSERT_OK(ais_nmea_format(out, sizeof(out), &used, _test_static_voyage_data,
+                sizeof(_test_static_voyage_data), 'B', 13));
+    TEST_ASSERT_EQUALS(used, sizeof(expected) - 1);
+    TEST_ASSERT_EQUALS(memcmp(out, expected, used), 0);
+
+    return A_OK;
+}
+
+TEST_DECLARE_UNIT(test_armor_fill, ais_nmea)
+{
+    static const uint8_t packet[] = { 0xff, 0x00, 0xff, 0x00, 0xff };
+    char out[8];
+    unsigned fill_bits = 0;
+
+    TEST_ASSERT_EQUALS(ais_nmea_armor(out, packet, 3, &fill_bits), 4);
+    TEST_ASSERT_EQUALS(fill_bits, 0);
+    TEST_ASSERT_EQUALS(memcmp(out, "wh3w", 4), 0);
+
+    TEST_ASSERT_EQUALS(ais_nmea_armor(out, packet, 4, &fill_bits), 6);
+    TEST_ASSERT_EQUALS(fill_bits, 4);
+    TEST_ASSERT_EQUALS(memcmp(out, "wh3w00", 6), 0);
+
+    TEST_ASSERT_EQUALS(ais_nmea_armor(out, packet, 5, &fill_bits), 7);
+    TEST_ASSERT_EQUALS(fill_bits, 2);
+    TEST_ASSERT_EQUALS(memcmp(out, "wh3w0?t", 7), 0);
+
+    return A_OK;
+}
+
+TEST_DECLARE_SUITE(ais_nmea, NULL, NULL, NULL, NULL);
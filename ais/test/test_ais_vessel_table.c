@@ -0,0 +1,218 @@
+#include <ais/ais_vessel_table.h>
+
+#include <test/assert.h>
+#include <test/framework.h>
+
+#include <tsl/assert.h>
+
+#include <stdlib.h>
+#include <string.h>
+
+static
+struct ais_vessel_table *table = NULL;
+
+static const
+struct ais_vessel_table_config _test_config = {
+    .max_vessels = 1024,
+    .min_distance = 50.0f,
+    .min_course_change = 10.0f,
+    .max_interval_ms = 60000,
+    .snapshot_interval_ms = 600000,
+    .expire_ms = 1800000,
+};
+
+static
+aresult_t test_ais_vessel_table_setup(void)
+{
+    return ais_vessel_table_new(&table, &_test_config);
+}
+
+static
+aresult_t test_ais_vessel_table_cleanup(void)
+{
+    if (NULL != table) {
+        TSL_BUG_IF_FAILED(ais_vessel_table_delete(&table));
+    }
+
+    return A_OK;
+}
+
+static
+bool _test_position(uint64_t now_ms, uint32_t mmsi, float latitude, float longitude, uint32_t course)
+{
+    struct ais_position_report rpt;
+    bool emit = false;
+
+    memset(&rpt, 0, sizeof(rpt));
+
+    rpt.mmsi = mmsi;
+    rpt.latitude = latitude;
+    rpt.longitude = longitude;
+    rpt.course = course;
+
+    TSL_BUG_IF_FAILED(ais_vessel_table_on_position_report(table, now_ms, &rpt, "13u?etPv2;0n:dDPwUM1U1Cb069D", &emit));
+
+    return emit;
+}
+
+TEST_DECLARE_UNIT(test_position_thresholds, ais_vessel_table)
+{
+    uint64_t nr_suppressed = 0;
+    size_t nr_vessels = 0;
+
+    TEST_ASSERT_OK(test_ais_vessel_table_cleanup());
+    TEST_ASSERT_OK(test_ais_vessel_table_setup());
+
+    /* First report always goes out */
+    TEST_ASSERT_EQUALS(_test_position(0, 316000001, 49.0f, -123.0f, 900), true);
+
+    /* Drifting around a little */
+    TEST_ASSERT_EQUALS(_test_position(2000, 316000001, 49.0001f, -123.0f, 905), false);
+    TEST_ASSERT_EQUALS(_test_position(4000, 316000001, 49.0002f, -123.0002f, 895), false);
+
+    /* Moved about 55 metres north since the last one emitted */
+    TEST_ASSERT_EQUALS(_test_position(6000, 316000001, 49.0005f, -123.0f, 900), true);
+
+    /* Turned */
+    TEST_ASSERT_EQUALS(_test_position(8000, 316000001, 49.0005f, -123.0f, 1010), true);
+
+    /* Turned the other way, across north */
+    TEST_ASSERT_EQUALS(_test_position(8000, 316000002, 49.0f, -123.0f, 3590), true);
+    TEST_ASSERT_EQUALS(_test_position(9000, 316000002, 49.0f, -123.0f, 50), false);
+    TEST_ASSERT_EQUALS(_test_position(10000, 316000002, 49.0f, -123.0f, 150), true);
+
+    /* Course became unavailable */
+    TEST_ASSERT_EQUALS(_test_position(11000, 316000002, 49.0f, -123.0f, 3600), true);
+
+    /* Sitting still, until the interval is up */
+    TEST_ASSERT_EQUALS(_test_position(60000, 316000001, 49.0005f, -123.0f, 1010), false);
+    TEST_ASSERT_EQUALS(_test_position(68000, 316000001, 49.0005f, -123.0f, 1010), true);
+
+    /* A channel a little behind the other is not a long time in the future */
+    TEST_ASSERT_EQUALS(_test_position(67990, 316000001, 49.0005f, -123.0f, 1010), false);
+
+    ais_vessel_table_stats(table, &nr_vessels, &nr_suppressed);
+    TEST_ASSERT_EQUALS(nr_vessels, 2);
+    TEST_ASSERT_EQUALS(nr_suppressed, 5);
+
+    return A_OK;
+}
+
+TEST_DECLARE_UNIT(test_static_voyage_data, ais_vessel_table)
+{
+    struct ais_static_voyage_data svd;
+    bool emit = false;
+
+    TEST_ASSERT_OK(test_ais_vessel_table_cleanup());
+    TEST_ASSERT_OK(test_ais_vessel_table_setup());
+
+    memset(&svd, 0, sizeof(svd));
+    svd.mmsi = 316000003;
+    strcpy(svd.ship_name, "SPIRIT OF VANCOUVER");
+
+    TEST_ASSERT_OK(ais_vessel_table_on_static_voyage_data(table, 1000, &svd, "5", &emit));
+    TEST_ASSERT_EQUALS(emit, true);
+    TEST_ASSERT_OK(ais_vessel_table_on_static_voyage_data(table, 7000, &svd, "5", &emit));
+    TEST_ASSERT_EQUALS(emit, false);
+
+    strcpy(svd.destination, "SWARTZ BAY");
+    TEST_ASSERT_OK(ais_vessel_table_on_static_voyage_data(table, 13000, &svd, "5", &emit));
+    TEST_ASSERT_EQUALS(emit, true);
+
+    TEST_ASSERT_OK(ais_vessel_table_on_static_voyage_data(table, 73000, &svd, "5", &emit));
+    TEST_ASSERT_EQUALS(emit, true);
+
+    return A_OK;
+}
+
+struct test_snapshot {
+    size_t nr_vessels;
+    uint64_t mmsi_sum;
+};
+
+static
+aresult_t _test_on_vessel(struct ais_vessel_table *tbl, void *state, const struct ais_vessel *vessel)
+{
+    struct test_snapshot *snap = state;
+
+    snap->nr_vessels++;
+    snap->mmsi_sum += vessel->mmsi;
+
+    return A_OK;
+}
+
+TEST_DECLARE_UNIT(test_snapshot_expiry, ais_vessel_table)
+{
+    static uint32_t mmsis[1000];
+    struct test_snapshot snap;
+    size_t nr_vessels = 0;
+    uint64_t expect_sum = 0;
+
+    TEST_ASSERT_OK(test_ais_vessel_table_cleanup());
+    TEST_ASSERT_OK(test_ais_vessel_table_setup());
+
+    TEST_ASSERT_EQUALS(ais_vessel_table_snapshot_due(table, 1000), false);
+
+    srandom(74);
+
+    /* Half the vessels go quiet early, and the rest keep reporting */
+    for (size_t i = 0; i < 1000; i++) {
+        mmsis[i] = 200000000 + random() % 600000000;
+        for (size_t j = 0; j < i; j++) {
+            if (mmsis[i] == mmsis[j]) {
+                mmsis[i]++;
+                j = -1;
+            }
+        }
+        TEST_ASSERT_EQUALS(_test_position(i % 2 ? 1000000 : 10000, mmsis[i], 49.0f, -123.0f, 0), true);
+        if (0 != i % 2) {
+            expect_sum += mmsis[i];
+        }
+    }
+
+    ais_vessel_table_stats(table, &nr_vessels, NULL);
+    TEST_ASSERT_EQUALS(nr_vessels, 1000);
+
+    /* The table is full up, so a new vessel is never suppressed */
+    for (size_t i = 0; i < 24; i++) {
+        TEST_ASSERT_EQUALS(_test_position(1000000, 100000000 + i, 49.0f, -123.0f, 0), true);
+    }
+    TEST_ASSERT_EQUALS(_test_position(1000000, 99999999, 49.0f, -123.0f, 0), true);
+    TEST_ASSERT_EQUALS(_test_position(1000001, 99999999, 49.0f, -123.0f, 0), true);
+
+    TEST_ASSERT_EQUALS(ais_vessel_table_snapshot_due(table, 1900000), true);
+    TEST_ASSERT_EQUALS(ais_vessel_table_snapshot_due(table, 1900000), false);
+
+    memset(&snap, 0, sizeof(snap));
+    TEST_ASSERT_OK(ais_vessel_table_snapshot(table, 1900000, _test_on_vessel, &snap));
+    TEST_ASSERT_EQUALS(snap.nr_vessels, 524);
+
+    ais_vessel_table_stats(table, &nr_vessels, NULL);
+    TEST_ASSERT_EQUALS(nr_vessels, 524);
+
+    /* Every vessel left is still found, and was just emitted by the snapshot */
+    for (size_t i = 1; i < 1000; i += 2) {
+        TEST_ASSERT_EQUALS(_test_position(1900001, mmsis[i], 49.0f, -123.0f, 0), false);
+    }
+
+    /* The vessels that were forgotten are new again */
+    for (size_t i = 0; i < 1000; i += 2) {
+        TEST_ASSERT_EQUALS(_test_position(1900001, mmsis[i], 49.0f, -123.0f, 0), true);
+    }
+
+    memset(&snap, 0, sizeof(snap));
+    TEST_ASSERT_OK(ais_vessel_table_snapshot(table, 1900002, _test_on_vessel, &snap));
+    TEST_ASSERT_EQUALS(snap.nr_vessels, 1024);
+
+    for (size_t i = 0; i < 1000; i += 2) {
+        expect_sum += mmsis[i];
+    }
+    for (size_t i = 0; i < 24; i++) {
+        expect_sum += 100000000 + i;
+    }
+    TEST_ASSERT_EQUALS(snap.mmsi_sum, expect_sum);
+
+    return A_OK;
+}
+
+TEST_DECLARE_SUITE(ais_vessel_table, test_ais_vessel_table_cleanup, test_ais_vessel_table_setup, NULL, NULL);
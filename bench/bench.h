@@ -0,0 +1,5 @@
+#pragma once
+
+#include <tsl/diag.h>
+
+#define BENCH_MSG(sev, sys, msg, ...) MESSAGE("BENCH", sev, sys, msg, ##__VA_ARGS__)
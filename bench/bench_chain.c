@@ -0,0 +1,411 @@
+/*
+ *  bench_chain.c - A single channel's processing chain, for benchmarking
+ *
+ *  Copyright (c)2017 Phil Vachon <phil@security-embedded.com>
+ *
+ *  This file is a part of The Standard Library (TSL)
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ */
+
+#include <bench/bench_chain.h>
+#include <bench/bench.h>
+
+#include <multifm/fm_demod.h>
+
+#include <pager/pager_flex.h>
+#include <pager/pager_pocsag.h>
+
+#include <ais/ais_decode.h>
+
+#include <filter/polyphase_fir.h>
+#include <filter/sample_buf.h>
+
+#include <tsl/frame_alloc.h>
+#include <tsl/safe_alloc.h>
+#include <tsl/errors.h>
+#include <tsl/assert.h>
+#include <tsl/diag.h>
+
+#include <string.h>
+
+/**
+ * Number of PCM sample buffers per chain: the resampler holds at most two, plus the one being filled.
+ */
+#define BENCH_CHAIN_NR_PCM_BUFS         4
+
+/**
+ * The chain currently being run on this thread. The decoder callbacks do not carry any state
+ * of their own, so this is how decoded messages are attributed to a chain.
+ */
+static _Thread_local
+struct bench_chain *_bench_chain_active = NULL;
+
+static inline
+void _bench_chain_count_message(void)
+{
+    TSL_BUG_ON(NULL == _bench_chain_active);
+    _bench_chain_active->nr_messages++;
+}
+
+static
+aresult_t _bench_chain_on_flex_alnum_msg(struct pager_flex *f, uint16_t baud, uint8_t phase, uint8_t cycle_no,
+        uint8_t frame_no, uint64_t cap_code, bool fragmented, bool maildrop, uint8_t seq_num,
+        const char *message_bytes, size_t message_len)
+{
+    _bench_chain_count_message();
+    return A_OK;
+}
+
+static
+aresult_t _bench_chain_on_flex_num_msg(struct pager_flex *f, uint16_t baud, uint8_t phase, uint8_t cycle_no,
+        uint8_t frame_no, uint64_t cap_code, const char *message_bytes, size_t message_len)
+{
+    _bench_chain_count_message();
+    return A_OK;
+}
+
+static
+aresult_t _bench_chain_on_flex_siv_msg(struct pager_flex *f, uint16_t baud, uint8_t phase, uint8_t cycle_no,
+        uint8_t frame_no, uint64_t cap_code, uint8_t siv_msg_type, uint32_t data)
+{
+    _bench_chain_count_message();
+    return A_OK;
+}
+
+static
+aresult_t _bench_chain_on_pocsag_msg(struct pager_pocsag *p, uint16_t baud_rate, uint32_t capcode,
+        const char *data, size_t data_len, uint8_t function)
+{
+    _bench_chain_count_message();
+    return A_OK;
+}
+
+static
+aresult_t _bench_chain_on_ais_position_report(struct ais_decode *decode, void *state,
+        struct ais_position_report *pr, const char *raw_msg)
+{
+    _bench_chain_count_message();
+    return A_OK;
+}
+
+static
+aresult_t _bench_chain_on_ais_base_station_report(struct ais_decode *decode, void *state,
+        struct ais_base_station_report *br, const char *raw_msg)
+{
+    _bench_chain_count_message();
+    return A_OK;
+}
+
+static
+aresult_t _bench_chain_on_ais_static_voyage_data(struct ais_decode *decode, void *state,
+        struct ais_static_voyage_data *svd, const char *raw_msg)
+{
+    _bench_chain_count_message();
+    return A_OK;
+}
+
+static
+aresult_t _bench_chain_pcm_buf_release(struct sample_buf *buf)
+{
+    struct frame_alloc *fa = NULL;
+
+    TSL_BUG_ON(NULL == buf);
+
+    fa = buf->priv;
+
+    TSL_BUG_IF_FAILED(frame_free(fa, (void **)&buf));
+
+    return A_OK;
+}
+
+/**
+ * Run the resampler until it can't produce any more output, handing each block of output
+ * to the protocol decoder.
+ */
+static
+aresult_t _bench_chain_decode(struct bench_chain *chain)
+{
+    aresult_t ret = A_OK;
+
+    size_t new_samples = 0;
+
+    do {
+        TSL_BUG_IF_FAILED(polyphase_fir_process(chain->pfir, chain->decoder_buf, BENCH_CHAIN_PCM_SAMPLES,
+                    &new_samples));
+
+        if (0 == new_samples) {
+            break;
+        }
+
+        if (true == chain->cfg->dc_block) {
+            TSL_BUG_IF_FAILED(dc_blocker_apply(&chain->blk, chain->decoder_buf, new_samples));
+        }
+
+        chain->nr_decoder_samples += new_samples;
+
+        switch (chain->cfg->proto) {
+        case BENCH_CHAIN_PROTO_FLEX:
+            TSL_BUG_IF_FAILED(pager_flex_on_pcm(chain->flex, chain->decoder_buf, new_samples));
+            break;
+        case BENCH_CHAIN_PROTO_POCSAG:
+            TSL_BUG_IF_FAILED(pager_pocsag_on_pcm(chain->pocsag, chain->decoder_buf, new_samples));
+            break;
+        case BENCH_CHAIN_PROTO_AIS:
+            TSL_BUG_IF_FAILED(ais_decode_on_pcm(chain->ais, 0, chain->decoder_buf, new_samples));
+            break;
+        default:
+            PANIC("Unknown protocol type %d, aborting", chain->cfg->proto);
+        }
+    } while (true);
+
+    return ret;
+}
+
+/**
+ * Accumulate demodulated PCM into fixed-size buffers, pushing each full buffer through the
+ * resampler and decoder, in the same way the decoder does when reading from its FIFO.
+ */
+static
+aresult_t _bench_chain_resample(struct bench_chain *chain, const int16_t *pcm, size_t nr_pcm)
+{
+    aresult_t ret = A_OK;
+
+    while (0 != nr_pcm) {
+        struct sample_buf *buf = NULL;
+        size_t nr_copy = 0;
+
+        if (NULL == chain->pcm_buf) {
+            TSL_BUG_IF_FAILED(frame_alloc(chain->pcm_alloc, (void **)&buf));
+
+            buf->refcount = 1;
+            buf->sample_type = COMPLEX_INT_16;
+            buf->sample_buf_bytes = BENCH_CHAIN_PCM_SAMPLES * sizeof(int16_t);
+            buf->nr_samples = 0;
+            buf->release = _bench_chain_pcm_buf_release;
+            buf->priv = chain->pcm_alloc;
+
+            chain->pcm_buf = buf;
+        }
+
+        buf = chain->pcm_buf;
+
+        nr_copy = BL_MIN2(BENCH_CHAIN_PCM_SAMPLES - buf->nr_samples, nr_pcm);
+        memcpy((int16_t *)buf->data_buf + buf->nr_samples, pcm, nr_copy * sizeof(int16_t));
+        buf->nr_samples += nr_copy;
+        pcm += nr_copy;
+        nr_pcm -= nr_copy;
+
+        if (BENCH_CHAIN_PCM_SAMPLES == buf->nr_samples) {
+            TSL_BUG_IF_FAILED(polyphase_fir_push_sample_buf(chain->pfir, buf));
+            chain->pcm_buf = NULL;
+
+            TSL_BUG_IF_FAILED(_bench_chain_decode(chain));
+        }
+    }
+
+    return ret;
+}
+
+aresult_t bench_chain_process(struct bench_chain *chain, struct sample_buf *sbuf)
+{
+    aresult_t ret = A_OK;
+
+    bool can_process = false;
+
+    TSL_ASSERT_ARG(NULL != chain);
+    TSL_ASSERT_ARG(NULL != sbuf);
+
+    _bench_chain_active = chain;
+
+    chain->nr_in_samples += sbuf->nr_samples;
+
+    TSL_BUG_IF_FAILED(direct_fir_push_sample_buf(&chain->fir, sbuf));
+    TSL_BUG_IF_FAILED(direct_fir_can_process(&chain->fir, &can_process, NULL));
+
+    while (true == can_process) {
+        size_t nr_samples = 0,
+               nr_pcm_samples = 0,
+               nr_pcm_bytes = 0;
+
+        /* Channelize and decimate */
+        TSL_BUG_IF_FAILED(direct_fir_process(&chain->fir, chain->filt_samp_buf, LPF_OUTPUT_LEN, &nr_samples));
+
+        if (0 != nr_samples) {
+            /* FM demodulate */
+            TSL_BUG_IF_FAILED(multifm_fm_demod_process(chain->demod, chain->filt_samp_buf, nr_samples,
+                        chain->pcm_out_buf, &nr_pcm_samples, &nr_pcm_bytes));
+
+            chain->nr_pcm_samples += nr_pcm_samples;
+
+            /* Resample and decode, if there is a decoder */
+            if (NULL != chain->pfir) {
+                TSL_BUG_IF_FAILED(_bench_chain_resample(chain, chain->pcm_out_buf, nr_pcm_samples));
+            }
+        }
+
+        TSL_BUG_IF_FAILED(direct_fir_can_process(&chain->fir, &can_process, NULL));
+    }
+
+    _bench_chain_active = NULL;
+
+    return ret;
+}
+
+aresult_t bench_chain_new(struct bench_chain **pchain, const struct bench_chain_config *cfg,
+        uint32_t sample_rate, int decimation, const double *lpf_taps, size_t lpf_nr_taps)
+{
+    aresult_t ret = A_OK;
+
+    struct bench_chain *chain = NULL;
+
+    TSL_ASSERT_ARG(NULL != pchain);
+    TSL_ASSERT_ARG(NULL != cfg);
+    TSL_ASSERT_ARG(0 != sample_rate);
+    TSL_ASSERT_ARG(0 < decimation);
+    TSL_ASSERT_ARG(NULL != lpf_taps);
+    TSL_ASSERT_ARG(0 != lpf_nr_taps);
+
+    *pchain = NULL;
+
+    if (FAILED(ret = TZAALLOC(chain, SYS_CACHE_LINE_LENGTH))) {
+        goto done;
+    }
+
+    chain->cfg = cfg;
+
+    if (FAILED(ret = demod_fir_prepare(&chain->fir, lpf_taps, lpf_nr_taps, cfg->offset_hz, sample_rate,
+                    decimation, cfg->gain)))
+    {
+        BENCH_MSG(SEV_ERROR, "BAD-CHANNEL-FIR", "Failed to prepare channel FIR for offset %d Hz", cfg->offset_hz);
+        goto done;
+    }
+
+    TSL_BUG_IF_FAILED(multifm_fm_demod_init(&chain->demod));
+
+    if (BENCH_CHAIN_PROTO_NONE == cfg->proto) {
+        /* Nothing more to set up */
+        goto done;
+    }
+
+    TSL_BUG_IF_FAILED(dc_blocker_init(&chain->blk, cfg->dc_block_pole));
+
+    if (FAILED(ret = frame_alloc_new(&chain->pcm_alloc,
+                    sizeof(struct sample_buf) + BENCH_CHAIN_PCM_SAMPLES * sizeof(int16_t),
+                    BENCH_CHAIN_NR_PCM_BUFS)))
+    {
+        goto done;
+    }
+
+    if (FAILED(ret = polyphase_fir_new(&chain->pfir, cfg->nr_resample_coeffs, cfg->resample_coeffs,
+                    cfg->interpolate, cfg->decimate)))
+    {
+        BENCH_MSG(SEV_ERROR, "BAD-RESAMPLER", "Failed to create %u/%u resampler", cfg->interpolate, cfg->decimate);
+        goto done;
+    }
+
+    switch (cfg->proto) {
+    case BENCH_CHAIN_PROTO_FLEX:
+        ret = pager_flex_new(&chain->flex, cfg->freq_hz, _bench_chain_on_flex_alnum_msg,
+                _bench_chain_on_flex_num_msg, _bench_chain_on_flex_siv_msg);
+        break;
+    case BENCH_CHAIN_PROTO_POCSAG:
+        ret = pager_pocsag_new(&chain->pocsag, cfg->freq_hz, _bench_chain_on_pocsag_msg,
+                _bench_chain_on_pocsag_msg);
+        break;
+    case BENCH_CHAIN_PROTO_AIS:
+        ret = ais_decode_new(&chain->ais, cfg->freq_hz, _bench_chain_on_ais_position_report,
+                _bench_chain_on_ais_base_station_report, _bench_chain_on_ais_static_voyage_data);
+        break;
+    default:
+        ret = A_E_INVAL;
+    }
+
+done:
+    if (FAILED(ret)) {
+        if (NULL != chain) {
+            TSL_BUG_IF_FAILED(bench_chain_delete(&chain));
+        }
+    } else {
+        *pchain = chain;
+    }
+
+    return ret;
+}
+
+aresult_t bench_chain_delete(struct bench_chain **pchain)
+{
+    aresult_t ret = A_OK;
+
+    struct bench_chain *chain = NULL;
+
+    TSL_ASSERT_ARG(NULL != pchain);
+    TSL_ASSERT_ARG(NULL != *pchain);
+
+    chain = *pchain;
+
+    if (NULL != chain->flex) {
+        TSL_BUG_IF_FAILED(pager_flex_delete(&chain->flex));
+    }
+
+    if (NULL != chain->pocsag) {
+        TSL_BUG_IF_FAILED(pager_pocsag_delete(&chain->pocsag));
+    }
+
+    if (NULL != chain->ais) {
+        TSL_BUG_IF_FAILED(ais_decode_delete(&chain->ais));
+    }
+
+    if (NULL != chain->pfir) {
+        TSL_BUG_IF_FAILED(polyphase_fir_delete(&chain->pfir));
+    }
+
+    if (NULL != chain->pcm_buf) {
+        TSL_BUG_IF_FAILED(sample_buf_decref(chain->pcm_buf));
+        chain->pcm_buf = NULL;
+    }
+
+    if (NULL != chain->pcm_alloc) {
+        TSL_BUG_IF_FAILED(frame_alloc_delete(&chain->pcm_alloc));
+    }
+
+    if (NULL != chain->demod) {
+        TSL_BUG_IF_FAILED(multifm_fm_demod_cleanup(&chain->demod));
+    }
+
+    TSL_BUG_IF_FAILED(direct_fir_cleanup(&chain->fir));
+
+    TFREE(chain);
+
+    *pchain = NULL;
+
+    return ret;
+}
+
+const char *bench_chain_protocol_name(enum bench_chain_protocol proto)
+{
+    switch (proto) {
+    case BENCH_CHAIN_PROTO_NONE:
+        return "none";
+    case BENCH_CHAIN_PROTO_FLEX:
+        return "flex";
+    case BENCH_CHAIN_PROTO_POCSAG:
+        return "pocsag";
+    case BENCH_CHAIN_PROTO_AIS:
+        return "ais";
+    }
+
+    return "unknown";
+}
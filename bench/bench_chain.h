@@ -0,0 +1,214 @@
+#pragma once
+
+#include <multifm/demod.h>
+
+#include <filter/direct_fir.h>
+#include <filter/dc_blocker.h>
+
+#include <tsl/result.h>
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stddef.h>
+
+/**
+ * Number of PCM samples accumulated before being handed to the resampler. This matches the
+ * read size used by the decoder.
+ */
+#define BENCH_CHAIN_PCM_SAMPLES         1024
+
+struct sample_buf;
+struct polyphase_fir;
+struct demod_base;
+struct frame_alloc;
+struct pager_flex;
+struct pager_pocsag;
+struct ais_decode;
+
+/**
+ * The protocol decoder at the end of a channel's processing chain
+ */
+enum bench_chain_protocol {
+    /**
+     * Stop after FM demodulation
+     */
+    BENCH_CHAIN_PROTO_NONE = 0,
+    BENCH_CHAIN_PROTO_FLEX = 1,
+    BENCH_CHAIN_PROTO_POCSAG = 2,
+    BENCH_CHAIN_PROTO_AIS = 3,
+};
+
+/**
+ * Parameters for a single channel's chain. Several chains can share one of these.
+ */
+struct bench_chain_config {
+    /**
+     * Frequency of the channel, in Hz. Used for record keeping by the decoders.
+     */
+    uint32_t freq_hz;
+
+    /**
+     * Offset of the channel from the center frequency, in Hz
+     */
+    int32_t offset_hz;
+
+    /**
+     * Linear gain of the channelizing FIR
+     */
+    double gain;
+
+    /**
+     * The protocol decoder to be run on the resampled PCM
+     */
+    enum bench_chain_protocol proto;
+
+    /**
+     * Resampler interpolation factor
+     */
+    unsigned interpolate;
+
+    /**
+     * Resampler decimation factor
+     */
+    unsigned decimate;
+
+    /**
+     * Resampler filter coefficients, in Q.15
+     */
+    int16_t *resample_coeffs;
+
+    /**
+     * Number of resampler filter coefficients
+     */
+    size_t nr_resample_coeffs;
+
+    /**
+     * Whether or not to apply the DC blocker ahead of the decoder
+     */
+    bool dc_block;
+
+    /**
+     * The DC blocker pole
+     */
+    double dc_block_pole;
+};
+
+/**
+ * A complete in-process channel: channelizing FIR, FM demodulator, resampler and protocol decoder.
+ * This is the same sequence of operations multifm and the decoder apply, without the FIFO in between.
+ */
+struct bench_chain {
+    /**
+     * Channelizing FIR, decimating to the channel sample rate
+     */
+    struct direct_fir fir;
+
+    /**
+     * FM demodulator state
+     */
+    struct demod_base *demod;
+
+    /**
+     * Polyphase resampler, to bring PCM to the decoder's rate. NULL if there is no decoder.
+     */
+    struct polyphase_fir *pfir;
+
+    /**
+     * DC blocking filter state
+     */
+    struct dc_blocker blk;
+
+    /**
+     * The configuration for this chain
+     */
+    const struct bench_chain_config *cfg;
+
+    /**
+     * The protocol decoders. Only the one matching cfg->proto is allocated.
+     */
+    struct pager_flex *flex;
+    struct pager_pocsag *pocsag;
+    struct ais_decode *ais;
+
+    /**
+     * Allocator for PCM sample buffers fed to the resampler
+     */
+    struct frame_alloc *pcm_alloc;
+
+    /**
+     * PCM sample buffer currently being filled
+     */
+    struct sample_buf *pcm_buf;
+
+    /**
+     * Thread CPU time spent in this chain, in nanoseconds
+     */
+    uint64_t cpu_ns;
+
+    /**
+     * Number of complex samples consumed from the receiver
+     */
+    size_t nr_in_samples;
+
+    /**
+     * Number of PCM samples out of the FM demodulator
+     */
+    size_t nr_pcm_samples;
+
+    /**
+     * Number of samples delivered to the protocol decoder
+     */
+    size_t nr_decoder_samples;
+
+    /**
+     * Number of messages decoded
+     */
+    size_t nr_messages;
+
+    /**
+     * Output of the channelizing FIR
+     */
+    int16_t filt_samp_buf[2 * LPF_OUTPUT_LEN];
+
+    /**
+     * Output of the FM demodulator
+     */
+    int16_t pcm_out_buf[LPF_OUTPUT_LEN];
+
+    /**
+     * Output of the resampler
+     */
+    int16_t decoder_buf[BENCH_CHAIN_PCM_SAMPLES];
+};
+
+/**
+ * Create a new channel processing chain.
+ *
+ * \param pchain The new chain, returned by reference.
+ * \param cfg The channel's configuration. Must outlive the chain.
+ * \param sample_rate The receiver sample rate
+ * \param decimation The channelizing FIR decimation factor
+ * \param lpf_taps The baseband low pass filter taps for channel selection
+ * \param lpf_nr_taps The number of taps in lpf_taps
+ *
+ * \return A_OK on success, an error code otherwise
+ */
+aresult_t bench_chain_new(struct bench_chain **pchain, const struct bench_chain_config *cfg,
+        uint32_t sample_rate, int decimation, const double *lpf_taps, size_t lpf_nr_taps);
+
+/**
+ * Destroy a channel processing chain, releasing any sample buffers it holds.
+ */
+aresult_t bench_chain_delete(struct bench_chain **pchain);
+
+/**
+ * Push a buffer of receiver samples through the chain, running every stage to completion.
+ * The chain takes the caller's reference on sbuf.
+ */
+aresult_t bench_chain_process(struct bench_chain *chain, struct sample_buf *sbuf);
+
+/**
+ * Get a human readable name for a chain protocol
+ */
+const char *bench_chain_protocol_name(enum bench_chain_protocol proto);
+
@@ -0,0 +1,1008 @@
+/*
+ *  bench_pipeline.c - End-to-end benchmark of the receive chain, from I/Q to decoded messages
+ *
+ *  Copyright (c)2017 Phil Vachon <phil@security-embedded.com>
+ *
+ *  This file is a part of The Standard Library (TSL)
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ */
+
+#include <bench/bench_chain.h>
+#include <bench/bench.h>
+
+#include <filter/filter.h>
+#include <filter/sample_buf.h>
+
+#include <app/app.h>
+
+#include <config/engine.h>
+
+#include <tsl/work_queue.h>
+#include <tsl/worker_thread.h>
+#include <tsl/frame_alloc.h>
+#include <tsl/safe_alloc.h>
+#include <tsl/time.h>
+#include <tsl/diag.h>
+#include <tsl/errors.h>
+#include <tsl/assert.h>
+
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <string.h>
+#include <math.h>
+#include <pthread.h>
+#include <sched.h>
+#include <time.h>
+#include <sys/stat.h>
+
+/**
+ * Maximum number of entries in a channel or thread count sweep
+ */
+#define BENCH_MAX_SWEEP                 32
+
+/**
+ * Maximum number of distinct channels in the configuration
+ */
+#define BENCH_MAX_CHANNEL_CONFIGS       64
+
+/**
+ * A worker thread, running the chains for a subset of the channels. Mirrors the demodulator
+ * threads in multifm.
+ */
+struct bench_worker {
+    /**
+     * SPSC queue used to deliver sample buffers to this worker
+     */
+    struct work_queue wq CAL_CACHE_ALIGNED;
+
+    /**
+     * Mutex protecting the work queue
+     */
+    pthread_mutex_t wq_mtx;
+
+    /**
+     * Signalled by the producer when there is work to be done
+     */
+    pthread_cond_t wq_cv;
+
+    /**
+     * Worker thread state
+     */
+    struct worker_thread wthr;
+
+    /**
+     * The chains this worker is responsible for
+     */
+    struct bench_chain **chains;
+
+    /**
+     * Number of chains in chains
+     */
+    size_t nr_chains;
+
+    /**
+     * Latency of each buffer, from delivery until every chain on this worker is done with it
+     */
+    uint64_t *latencies_ns;
+
+    /**
+     * Number of entries in latencies_ns
+     */
+    size_t nr_latencies;
+
+    /**
+     * Maximum number of entries in latencies_ns
+     */
+    size_t max_latencies;
+
+    /**
+     * Number of buffers this worker has finished processing
+     */
+    atomic_size_t nr_bufs_done;
+};
+
+/**
+ * The outcome of a single benchmark run
+ */
+struct bench_result {
+    unsigned nr_channels;
+    unsigned nr_threads;
+    uint64_t wall_ns;
+    size_t nr_samples;
+    size_t nr_bufs;
+    size_t nr_dropped_bufs;
+    size_t nr_dropped_samples;
+    size_t nr_messages;
+    uint64_t latency_p50_ns;
+    uint64_t latency_p99_ns;
+    uint64_t latency_max_ns;
+};
+
+static
+unsigned channel_counts[BENCH_MAX_SWEEP] = { 1 };
+
+static
+size_t nr_channel_counts = 1;
+
+static
+unsigned thread_counts[BENCH_MAX_SWEEP] = { 1 };
+
+static
+size_t nr_thread_counts = 1;
+
+static
+size_t samples_per_buf = 4 * 1024;
+
+static
+int nr_samp_bufs = 0;
+
+static
+unsigned nr_repeats = 1;
+
+static
+bool real_time = false;
+
+static
+FILE *out_file = NULL;
+
+static
+int16_t *iq_samples = NULL;
+
+static
+size_t nr_iq_samples = 0;
+
+static
+int sample_rate = 0;
+
+static
+int center_freq = 0;
+
+static
+int decimation_factor = 0;
+
+static
+double *lpf_taps = NULL;
+
+static
+size_t lpf_nr_taps = 0;
+
+static
+struct bench_chain_config chan_cfgs[BENCH_MAX_CHANNEL_CONFIGS];
+
+static
+size_t nr_chan_cfgs = 0;
+
+static
+void _usage(const char *appname)
+{
+    BENCH_MSG(SEV_INFO, "USAGE", "%s -i [I/Q file] [-c channel counts] [-t thread counts] [-b samples] [-n bufs] [-R repeat] [-r] [-o output JSON file] [config.json ...]",
+            appname);
+    BENCH_MSG(SEV_INFO, "USAGE", "        -i [file] Complex int16 I/Q recording (see synthgen -q)    ");
+    BENCH_MSG(SEV_INFO, "USAGE", "        -c [list] Comma separated channel counts to sweep          ");
+    BENCH_MSG(SEV_INFO, "USAGE", "        -t [list] Comma separated worker thread counts to sweep    ");
+    BENCH_MSG(SEV_INFO, "USAGE", "        -b [nr]   Samples per receiver buffer                      ");
+    BENCH_MSG(SEV_INFO, "USAGE", "        -n [nr]   Number of receiver buffers (nrSampBufs)          ");
+    BENCH_MSG(SEV_INFO, "USAGE", "        -R [nr]   Number of passes over the I/Q file per run       ");
+    BENCH_MSG(SEV_INFO, "USAGE", "        -r        Pace input at the sample rate, dropping buffers  ");
+    BENCH_MSG(SEV_INFO, "USAGE", "                  when none are free, like a real receiver       ");
+    BENCH_MSG(SEV_INFO, "USAGE", "        -o [file] Write JSON results to file, rather than stdout   ");
+    BENCH_MSG(SEV_INFO, "USAGE", "Configuration is the multifm format. Each channel may have a 'decoder'");
+    BENCH_MSG(SEV_INFO, "USAGE", "stanza with 'protocol', 'filterFile' (a resampler filter JSON), and");
+    BENCH_MSG(SEV_INFO, "USAGE", "optionally 'interpolate', 'decimate', 'dcBlock' and 'dcBlockPole'.");
+    exit(EXIT_SUCCESS);
+}
+
+static
+aresult_t _bench_parse_list(const char *list, unsigned *values, size_t max_values, size_t *pnr_values)
+{
+    aresult_t ret = A_OK;
+
+    const char *cur = list;
+    size_t nr_values = 0;
+
+    TSL_ASSERT_ARG(NULL != list);
+    TSL_ASSERT_ARG(NULL != values);
+    TSL_ASSERT_ARG(NULL != pnr_values);
+
+    while ('\0' != *cur) {
+        char *end = NULL;
+        unsigned long val = strtoul(cur, &end, 0);
+
+        if (end == cur || 0 == val || nr_values == max_values) {
+            ret = A_E_INVAL;
+            goto done;
+        }
+
+        values[nr_values++] = val;
+
+        if (',' == *end) {
+            end++;
+        } else if ('\0' != *end) {
+            ret = A_E_INVAL;
+            goto done;
+        }
+
+        cur = end;
+    }
+
+    if (0 == nr_values) {
+        ret = A_E_INVAL;
+        goto done;
+    }
+
+    *pnr_values = nr_values;
+
+done:
+    return ret;
+}
+
+/**
+ * Load the resampler filter for a channel's decoder. This is the same JSON file the decoder
+ * takes with -F.
+ */
+static
+aresult_t _bench_load_resampler(struct bench_chain_config *ccfg, struct config *decoder)
+{
+    aresult_t ret = A_OK;
+
+    struct config *filt_cfg CAL_CLEANUP(config_delete) = NULL;
+    const char *filter_file = NULL;
+    double *coeffs = NULL;
+    int interpolate = 0,
+        decimate = 0;
+
+    if (FAILED(ret = config_get_string(decoder, &filter_file, "filterFile"))) {
+        BENCH_MSG(SEV_ERROR, "MISSING-FILTER-FILE", "Decoder stanza needs a resampler 'filterFile'.");
+        goto done;
+    }
+
+    TSL_BUG_IF_FAILED(config_new(&filt_cfg));
+
+    if (FAILED(ret = config_add(filt_cfg, filter_file))) {
+        BENCH_MSG(SEV_ERROR, "BAD-FILTER-FILE", "Resampler filter file '%s' cannot be processed.", filter_file);
+        goto done;
+    }
+
+    if (FAILED(ret = config_get_float_array(filt_cfg, &coeffs, &ccfg->nr_resample_coeffs, "lpfCoeffs"))) {
+        BENCH_MSG(SEV_ERROR, "BAD-FILTER-FILE", "Resampler filter file '%s' has no 'lpfCoeffs'.", filter_file);
+        goto done;
+    }
+
+    /* The decoder stanza can override the filter file's resampling factors */
+    if (FAILED(config_get_integer(decoder, &interpolate, "interpolate"))) {
+        if (FAILED(config_get_integer(filt_cfg, &interpolate, "interpolate"))) {
+            interpolate = 1;
+        }
+    }
+
+    if (FAILED(config_get_integer(decoder, &decimate, "decimate"))) {
+        if (FAILED(config_get_integer(filt_cfg, &decimate, "decimate"))) {
+            decimate = 1;
+        }
+    }
+
+    if (0 >= interpolate || 0 >= decimate) {
+        BENCH_MSG(SEV_ERROR, "BAD-RESAMPLING", "Resampling factors must be positive (got %d/%d).",
+                interpolate, decimate);
+        ret = A_E_INVAL;
+        goto done;
+    }
+
+    ccfg->interpolate = interpolate;
+    ccfg->decimate = decimate;
+
+    if (FAILED(ret = TCALLOC((void **)&ccfg->resample_coeffs, sizeof(int16_t) * ccfg->nr_resample_coeffs, (size_t)1))) {
+        goto done;
+    }
+
+    for (size_t i = 0; i < ccfg->nr_resample_coeffs; i++) {
+        double q15 = 1 << Q_15_SHIFT;
+        ccfg->resample_coeffs[i] = (int16_t)(coeffs[i] * q15);
+    }
+
+done:
+    if (NULL != coeffs) {
+        TFREE(coeffs);
+    }
+
+    return ret;
+}
+
+static
+aresult_t _bench_load_channel(struct bench_chain_config *ccfg, struct config *channel)
+{
+    aresult_t ret = A_OK;
+
+    struct config decoder = CONFIG_INIT_EMPTY;
+    int chan_center_freq = 0;
+    double gain_db = 0.0;
+    const char *proto = NULL;
+
+    if (FAILED(ret = config_get_integer(channel, &chan_center_freq, "chanCenterFreq"))) {
+        BENCH_MSG(SEV_ERROR, "MISSING-CENTER-FREQ", "Missing output channel center frequency.");
+        goto done;
+    }
+
+    ccfg->freq_hz = chan_center_freq;
+    ccfg->offset_hz = chan_center_freq - center_freq;
+    ccfg->gain = 1.0;
+    ccfg->proto = BENCH_CHAIN_PROTO_NONE;
+    ccfg->dc_block_pole = 0.9999;
+
+    if (!FAILED(config_get_float(channel, &gain_db, "dBGain"))) {
+        ccfg->gain = pow(10.0, gain_db/10.0);
+    }
+
+    if (FAILED(config_get(channel, &decoder, "decoder"))) {
+        /* Demodulate only */
+        goto done;
+    }
+
+    if (FAILED(ret = config_get_string(&decoder, &proto, "protocol"))) {
+        BENCH_MSG(SEV_ERROR, "MISSING-PROTOCOL", "Decoder stanza for %d Hz needs a 'protocol'.", chan_center_freq);
+        goto done;
+    }
+
+    if (!strncasecmp(proto, "pocsag", 6)) {
+        ccfg->proto = BENCH_CHAIN_PROTO_POCSAG;
+    } else if (!strncasecmp(proto, "flex", 4)) {
+        ccfg->proto = BENCH_CHAIN_PROTO_FLEX;
+    } else if (!strncasecmp(proto, "ais", 3)) {
+        ccfg->proto = BENCH_CHAIN_PROTO_AIS;
+    } else {
+        BENCH_MSG(SEV_ERROR, "UNKNOWN-PROTOCOL-TYPE", "Unknown protocol type specified: %s", proto);
+        ret = A_E_INVAL;
+        goto done;
+    }
+
+    if (FAILED(config_get_boolean(&decoder, &ccfg->dc_block, "dcBlock"))) {
+        ccfg->dc_block = false;
+    }
+
+    if (FAILED(config_get_float(&decoder, &ccfg->dc_block_pole, "dcBlockPole"))) {
+        ccfg->dc_block_pole = 0.9999;
+    }
+
+    if (FAILED(ret = _bench_load_resampler(ccfg, &decoder))) {
+        goto done;
+    }
+
+done:
+    return ret;
+}
+
+static
+aresult_t _bench_load_config(struct config *cfg)
+{
+    aresult_t ret = A_OK;
+
+    struct config channels = CONFIG_INIT_EMPTY,
+                  channel = CONFIG_INIT_EMPTY;
+    size_t arr_ctr = 0;
+
+    if (FAILED(ret = config_get_integer(cfg, &sample_rate, "sampleRateHz")) || 0 >= sample_rate) {
+        BENCH_MSG(SEV_ERROR, "NO-SAMPLE-RATE", "Need to specify a sample rate, in Hertz.");
+        ret = A_E_INVAL;
+        goto done;
+    }
+
+    if (FAILED(ret = config_get_integer(cfg, &center_freq, "centerFreqHz"))) {
+        BENCH_MSG(SEV_ERROR, "NO-CENTER-FREQ", "You forgot to specify a center frequency, in Hz.");
+        goto done;
+    }
+
+    if (FAILED(ret = config_get_integer(cfg, &decimation_factor, "decimationFactor")) || 0 >= decimation_factor) {
+        BENCH_MSG(SEV_ERROR, "BAD-DECIMATION-FACTOR", "Need a positive 'decimationFactor'.");
+        ret = A_E_INVAL;
+        goto done;
+    }
+
+    if (0 == nr_samp_bufs && FAILED(config_get_integer(cfg, &nr_samp_bufs, "nrSampBufs"))) {
+        nr_samp_bufs = 64;
+    }
+
+    if (FAILED(ret = config_get_float_array(cfg, &lpf_taps, &lpf_nr_taps, "lpfTaps")) || 1 >= lpf_nr_taps) {
+        BENCH_MSG(SEV_ERROR, "BAD-FILTER-TAPS", "Need to provide a baseband filter with at least two filter taps as 'lpfTaps'.");
+        ret = A_E_INVAL;
+        goto done;
+    }
+
+    if (FAILED(ret = config_get(cfg, &channels, "channels"))) {
+        BENCH_MSG(SEV_ERROR, "MISSING-CHANNELS", "Need to specify at least one channel to demodulate.");
+        goto done;
+    }
+
+    CONFIG_ARRAY_FOR_EACH(channel, &channels, ret, arr_ctr) {
+        if (BENCH_MAX_CHANNEL_CONFIGS == nr_chan_cfgs) {
+            BENCH_MSG(SEV_WARNING, "TOO-MANY-CHANNELS", "Only using the first %d channels.", BENCH_MAX_CHANNEL_CONFIGS);
+            break;
+        }
+
+        if (FAILED(ret = _bench_load_channel(&chan_cfgs[nr_chan_cfgs], &channel))) {
+            goto done;
+        }
+
+        BENCH_MSG(SEV_INFO, "CHANNEL", "[%zu]: %4.5f MHz -> %s", nr_chan_cfgs,
+                (double)chan_cfgs[nr_chan_cfgs].freq_hz/1e6,
+                bench_chain_protocol_name(chan_cfgs[nr_chan_cfgs].proto));
+
+        nr_chan_cfgs++;
+    }
+
+    if (0 == nr_chan_cfgs) {
+        BENCH_MSG(SEV_ERROR, "MISSING-CHANNELS", "Need to specify at least one channel to demodulate.");
+        ret = A_E_INVAL;
+        goto done;
+    }
+
+    ret = A_OK;
+
+done:
+    return ret;
+}
+
+static
+aresult_t _bench_load_iq(const char *iq_file)
+{
+    aresult_t ret = A_OK;
+
+    int fd = -1;
+    struct stat st;
+    size_t nr_read = 0;
+
+    if (0 > (fd = open(iq_file, O_RDONLY))) {
+        int errnum = errno;
+        BENCH_MSG(SEV_ERROR, "BAD-INPUT", "Cannot open I/Q file %s: %s (%d)", iq_file, strerror(errnum), errnum);
+        ret = A_E_NOTFOUND;
+        goto done;
+    }
+
+    if (0 > fstat(fd, &st) || (size_t)st.st_size < 2 * sizeof(int16_t)) {
+        BENCH_MSG(SEV_ERROR, "BAD-INPUT", "I/Q file %s is empty or unreadable.", iq_file);
+        ret = A_E_INVAL;
+        goto done;
+    }
+
+    /* Read the whole recording up front, so file I/O doesn't factor into the measurement */
+    nr_iq_samples = st.st_size / (2 * sizeof(int16_t));
+
+    if (FAILED(ret = TACALLOC((void **)&iq_samples, nr_iq_samples, 2 * sizeof(int16_t), SYS_CACHE_LINE_LENGTH))) {
+        BENCH_MSG(SEV_ERROR, "NO-MEM", "Out of memory for %zu I/Q samples.", nr_iq_samples);
+        goto done;
+    }
+
+    while (nr_read < nr_iq_samples * 2 * sizeof(int16_t)) {
+        ssize_t op_ret = read(fd, (uint8_t *)iq_samples + nr_read, nr_iq_samples * 2 * sizeof(int16_t) - nr_read);
+
+        if (0 >= op_ret) {
+            int errnum = errno;
+            BENCH_MSG(SEV_ERROR, "READ-FAIL", "Failed to read I/Q file %s: %s (%d)", iq_file, strerror(errnum), errnum);
+            ret = A_E_INVAL;
+            goto done;
+        }
+
+        nr_read += op_ret;
+    }
+
+    BENCH_MSG(SEV_INFO, "INPUT", "Loaded %zu I/Q samples (%f seconds) from %s", nr_iq_samples,
+            (double)nr_iq_samples/(double)sample_rate, iq_file);
+
+done:
+    if (-1 != fd) {
+        close(fd);
+    }
+
+    return ret;
+}
+
+static
+void _set_options(int argc, char * const argv[])
+{
+    int arg = -1;
+    const char *iq_file = NULL,
+               *out_file_name = NULL;
+    struct config *cfg CAL_CLEANUP(config_delete) = NULL;
+
+    while ((arg = getopt(argc, argv, "i:c:t:b:n:R:ro:h")) != -1) {
+        switch (arg) {
+        case 'i':
+            iq_file = optarg;
+            break;
+        case 'c':
+            if (FAILED(_bench_parse_list(optarg, channel_counts, BENCH_MAX_SWEEP, &nr_channel_counts))) {
+                BENCH_MSG(SEV_FATAL, "BAD-CHANNEL-COUNTS", "Bad channel count list: '%s'", optarg);
+                exit(EXIT_FAILURE);
+            }
+            break;
+        case 't':
+            if (FAILED(_bench_parse_list(optarg, thread_counts, BENCH_MAX_SWEEP, &nr_thread_counts))) {
+                BENCH_MSG(SEV_FATAL, "BAD-THREAD-COUNTS", "Bad thread count list: '%s'", optarg);
+                exit(EXIT_FAILURE);
+            }
+            break;
+        case 'b':
+            samples_per_buf = strtoull(optarg, NULL, 0);
+            break;
+        case 'n':
+            nr_samp_bufs = strtol(optarg, NULL, 0);
+            break;
+        case 'R':
+            nr_repeats = strtoul(optarg, NULL, 0);
+            break;
+        case 'r':
+            real_time = true;
+            break;
+        case 'o':
+            out_file_name = optarg;
+            break;
+        case 'h':
+            _usage(argv[0]);
+            break;
+        }
+    }
+
+    if (optind >= argc) {
+        BENCH_MSG(SEV_FATAL, "MISSING-CONFIG", "Need at least one configuration file.");
+        exit(EXIT_FAILURE);
+    }
+
+    if (NULL == iq_file) {
+        BENCH_MSG(SEV_FATAL, "MISSING-INPUT", "Need to specify an I/Q file with -i.");
+        exit(EXIT_FAILURE);
+    }
+
+    if (0 == samples_per_buf || 0 == nr_repeats || 0 > nr_samp_bufs) {
+        BENCH_MSG(SEV_FATAL, "BAD-PARAMETERS", "Buffer size, buffer count and repeat count must be positive.");
+        exit(EXIT_FAILURE);
+    }
+
+    TSL_BUG_IF_FAILED(config_new(&cfg));
+
+    for (int i = optind; i < argc; i++) {
+        if (FAILED(config_add(cfg, argv[i]))) {
+            BENCH_MSG(SEV_FATAL, "MALFORMED-CONFIG", "Configuration file [%s] is malformed.", argv[i]);
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    if (FAILED(_bench_load_config(cfg))) {
+        BENCH_MSG(SEV_FATAL, "BAD-CONFIG", "Configuration is not usable, aborting.");
+        exit(EXIT_FAILURE);
+    }
+
+    if (FAILED(_bench_load_iq(iq_file))) {
+        exit(EXIT_FAILURE);
+    }
+
+    if (NULL == out_file_name) {
+        out_file = stdout;
+    } else if (NULL == (out_file = fopen(out_file_name, "w+"))) {
+        BENCH_MSG(SEV_FATAL, "BAD-OUTPUT-FILE", "Failed to open output file '%s', aborting.", out_file_name);
+        exit(EXIT_FAILURE);
+    }
+}
+
+static
+uint64_t _bench_thread_cpu_ns(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+
+    return (uint64_t)ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+static
+aresult_t _bench_worker_process(struct bench_worker *wkr, struct sample_buf *buf)
+{
+    /* The buffer can be released by the last chain to finish with it, so grab this now */
+    uint64_t delivered_ns = buf->start_time_ns;
+
+    for (size_t i = 0; i < wkr->nr_chains; i++) {
+        uint64_t cpu_start = _bench_thread_cpu_ns();
+        TSL_BUG_IF_FAILED(bench_chain_process(wkr->chains[i], buf));
+        wkr->chains[i]->cpu_ns += _bench_thread_cpu_ns() - cpu_start;
+    }
+
+    if (wkr->nr_latencies < wkr->max_latencies) {
+        wkr->latencies_ns[wkr->nr_latencies++] = tsl_get_clock_monotonic() - delivered_ns;
+    }
+
+    atomic_fetch_add(&wkr->nr_bufs_done, 1);
+
+    return A_OK;
+}
+
+static
+aresult_t _bench_worker_work(struct worker_thread *wthr)
+{
+    aresult_t ret = A_OK;
+
+    struct bench_worker *wkr = BL_CONTAINER_OF(wthr, struct bench_worker, wthr);
+
+    pthread_mutex_lock(&wkr->wq_mtx);
+
+    while (worker_thread_is_running(wthr)) {
+        struct sample_buf *buf = NULL;
+        TSL_BUG_IF_FAILED(work_queue_pop(&wkr->wq, (void **)&buf));
+
+        if (NULL != buf) {
+            pthread_mutex_unlock(&wkr->wq_mtx);
+            TSL_BUG_IF_FAILED(_bench_worker_process(wkr, buf));
+            pthread_mutex_lock(&wkr->wq_mtx);
+        } else {
+            /* Wait until the producer wakes us up */
+            struct timespec ts;
+            clock_gettime(CLOCK_REALTIME, &ts);
+            ts.tv_sec += 1;
+            pthread_cond_timedwait(&wkr->wq_cv, &wkr->wq_mtx, &ts);
+        }
+    }
+
+    pthread_mutex_unlock(&wkr->wq_mtx);
+
+    return ret;
+}
+
+static
+aresult_t _bench_sample_buf_release(struct sample_buf *buf)
+{
+    struct frame_alloc *fa = NULL;
+
+    TSL_BUG_ON(NULL == buf);
+
+    fa = buf->priv;
+
+    TSL_BUG_IF_FAILED(frame_free(fa, (void **)&buf));
+
+    return A_OK;
+}
+
+static
+int _bench_compare_u64(const void *a, const void *b)
+{
+    uint64_t va = *(const uint64_t *)a,
+             vb = *(const uint64_t *)b;
+
+    return (va > vb) - (va < vb);
+}
+
+/**
+ * Feed the I/Q recording to the workers. If pacing at the sample rate, buffers are dropped when
+ * the pool is exhausted, the same as a receiver would. Otherwise, wait for a buffer to be freed.
+ */
+static
+aresult_t _bench_produce(struct bench_worker *workers, unsigned nr_workers, unsigned nr_channels,
+        struct frame_alloc *samp_alloc, struct bench_result *res)
+{
+    aresult_t ret = A_OK;
+
+    uint64_t start_ns = tsl_get_clock_monotonic();
+    size_t nr_offered = 0;
+
+    for (unsigned rep = 0; rep < nr_repeats && app_running(); rep++) {
+        for (size_t offs = 0; offs < nr_iq_samples && app_running(); offs += samples_per_buf) {
+            struct sample_buf *sbuf = NULL;
+            size_t nr_samples = BL_MIN2(samples_per_buf, nr_iq_samples - offs);
+
+            if (true == real_time) {
+                uint64_t due_ns = start_ns + (uint64_t)((double)nr_offered * 1e9 / (double)sample_rate);
+                struct timespec ts = { .tv_sec = due_ns / 1000000000ull, .tv_nsec = due_ns % 1000000000ull };
+                clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL);
+            }
+
+            nr_offered += nr_samples;
+
+            while (FAILED(frame_alloc(samp_alloc, (void **)&sbuf))) {
+                if (true == real_time) {
+                    break;
+                }
+                sched_yield();
+            }
+
+            if (NULL == sbuf) {
+                res->nr_dropped_bufs++;
+                res->nr_dropped_samples += nr_samples;
+                continue;
+            }
+
+            memcpy(sbuf->data_buf, &iq_samples[2 * offs], nr_samples * 2 * sizeof(int16_t));
+            sbuf->sample_type = COMPLEX_INT_16;
+            sbuf->nr_samples = nr_samples;
+            sbuf->sample_buf_bytes = samples_per_buf * 2 * sizeof(int16_t);
+            sbuf->release = _bench_sample_buf_release;
+            sbuf->priv = samp_alloc;
+            sbuf->start_time_ns = tsl_get_clock_monotonic();
+            atomic_store(&sbuf->refcount, nr_channels);
+
+            for (unsigned i = 0; i < nr_workers; i++) {
+                struct bench_worker *wkr = &workers[i];
+                pthread_mutex_lock(&wkr->wq_mtx);
+                TSL_BUG_IF_FAILED(work_queue_push(&wkr->wq, sbuf));
+                pthread_mutex_unlock(&wkr->wq_mtx);
+                pthread_cond_signal(&wkr->wq_cv);
+            }
+
+            res->nr_bufs++;
+            res->nr_samples += nr_samples;
+        }
+    }
+
+    /* Wait for the workers to drain their queues */
+    for (unsigned i = 0; i < nr_workers; i++) {
+        while (atomic_load(&workers[i].nr_bufs_done) < res->nr_bufs) {
+            sched_yield();
+        }
+    }
+
+    res->wall_ns = tsl_get_clock_monotonic() - start_ns;
+
+    return ret;
+}
+
+static
+void _bench_report_run(struct bench_result *res, struct bench_chain **chains, bool first)
+{
+    double wall_sec = (double)res->wall_ns / 1e9,
+           msps = (double)res->nr_samples / wall_sec / 1e6,
+           input_sec = (double)res->nr_samples / (double)sample_rate;
+
+    fprintf(out_file, "%s\n    {\"channels\":%u,\"threads\":%u,\"wallSec\":%f,\"samples\":%zu,\"msps\":%f,"
+            "\"realTimeFactor\":%f,\"buffers\":%zu,\"drops\":{\"buffers\":%zu,\"samples\":%zu},"
+            "\"bufLatencyUs\":{\"p50\":%f,\"p99\":%f,\"max\":%f},\"messages\":%zu,\"channelStats\":[",
+            first ? "" : ",",
+            res->nr_channels, res->nr_threads, wall_sec, res->nr_samples, msps,
+            msps * 1e6 / (double)sample_rate, res->nr_bufs, res->nr_dropped_bufs, res->nr_dropped_samples,
+            (double)res->latency_p50_ns / 1e3, (double)res->latency_p99_ns / 1e3, (double)res->latency_max_ns / 1e3,
+            res->nr_messages);
+
+    for (unsigned i = 0; i < res->nr_channels; i++) {
+        struct bench_chain *chain = chains[i];
+        double cpu_sec = (double)chain->cpu_ns / 1e9;
+
+        fprintf(out_file, "%s{\"id\":%u,\"freqHz\":%u,\"protocol\":\"%s\",\"cpuSec\":%f,\"cpuPct\":%f,"
+                "\"pcmSamples\":%zu,\"decoderSamples\":%zu,\"messages\":%zu}",
+                0 == i ? "" : ",", i, chain->cfg->freq_hz, bench_chain_protocol_name(chain->cfg->proto),
+                cpu_sec, 0.0 != input_sec ? 100.0 * cpu_sec / input_sec : 0.0,
+                chain->nr_pcm_samples, chain->nr_decoder_samples, chain->nr_messages);
+    }
+
+    fprintf(out_file, "]}");
+}
+
+static
+aresult_t _bench_run(unsigned nr_channels, unsigned nr_threads, struct bench_result *res, bool first)
+{
+    aresult_t ret = A_OK;
+
+    struct bench_chain **chains = NULL;
+    struct bench_worker *workers = NULL;
+    struct frame_alloc *samp_alloc = NULL;
+    uint64_t *latencies = NULL;
+    size_t max_bufs = nr_repeats * ((nr_iq_samples + samples_per_buf - 1) / samples_per_buf),
+           nr_latencies = 0;
+    unsigned nr_workers_started = 0;
+
+    memset(res, 0, sizeof(*res));
+    res->nr_channels = nr_channels;
+    res->nr_threads = nr_threads;
+
+    if (FAILED(ret = TCALLOC((void **)&chains, sizeof(struct bench_chain *), (size_t)nr_channels))) {
+        goto done;
+    }
+
+    if (FAILED(ret = TACALLOC((void **)&workers, nr_threads, sizeof(struct bench_worker), SYS_CACHE_LINE_LENGTH))) {
+        goto done;
+    }
+
+    if (FAILED(ret = frame_alloc_new(&samp_alloc, sizeof(struct sample_buf) + samples_per_buf * 2 * sizeof(int16_t),
+                    nr_samp_bufs)))
+    {
+        goto done;
+    }
+
+    /* Replicate the configured channels as many times as needed */
+    for (unsigned i = 0; i < nr_channels; i++) {
+        if (FAILED(ret = bench_chain_new(&chains[i], &chan_cfgs[i % nr_chan_cfgs], sample_rate, decimation_factor,
+                        lpf_taps, lpf_nr_taps)))
+        {
+            goto done;
+        }
+    }
+
+    /* Hand the chains out round-robin, and start the workers */
+    for (unsigned i = 0; i < nr_threads; i++) {
+        struct bench_worker *wkr = &workers[i];
+
+        if (FAILED(ret = TCALLOC((void **)&wkr->chains, sizeof(struct bench_chain *), (size_t)nr_channels))) {
+            goto done;
+        }
+
+        TSL_BUG_IF_FAILED(work_queue_new(&wkr->wq, nr_samp_bufs));
+        pthread_mutex_init(&wkr->wq_mtx, NULL);
+        pthread_cond_init(&wkr->wq_cv, NULL);
+        atomic_init(&wkr->nr_bufs_done, 0);
+
+        for (unsigned j = i; j < nr_channels; j += nr_threads) {
+            wkr->chains[wkr->nr_chains++] = chains[j];
+        }
+
+        wkr->max_latencies = max_bufs;
+        if (FAILED(ret = TCALLOC((void **)&wkr->latencies_ns, sizeof(uint64_t), max_bufs))) {
+            goto done;
+        }
+    }
+
+    for (unsigned i = 0; i < nr_threads; i++) {
+        TSL_BUG_IF_FAILED(worker_thread_new(&workers[i].wthr, _bench_worker_work, WORKER_THREAD_CPU_MASK_ANY));
+        nr_workers_started++;
+    }
+
+    BENCH_MSG(SEV_INFO, "RUN", "Running %u channels on %u threads", nr_channels, nr_threads);
+
+    TSL_BUG_IF_FAILED(_bench_produce(workers, nr_threads, nr_channels, samp_alloc, res));
+
+    /* Gather up buffer latencies from all workers */
+    if (FAILED(ret = TCALLOC((void **)&latencies, sizeof(uint64_t), max_bufs * nr_threads))) {
+        goto done;
+    }
+
+    for (unsigned i = 0; i < nr_threads; i++) {
+        memcpy(&latencies[nr_latencies], workers[i].latencies_ns, workers[i].nr_latencies * sizeof(uint64_t));
+        nr_latencies += workers[i].nr_latencies;
+    }
+
+    if (0 != nr_latencies) {
+        qsort(latencies, nr_latencies, sizeof(uint64_t), _bench_compare_u64);
+        res->latency_p50_ns = latencies[(nr_latencies - 1) / 2];
+        res->latency_p99_ns = latencies[(size_t)((double)(nr_latencies - 1) * 0.99)];
+        res->latency_max_ns = latencies[nr_latencies - 1];
+    }
+
+    for (unsigned i = 0; i < nr_channels; i++) {
+        res->nr_messages += chains[i]->nr_messages;
+    }
+
+    _bench_report_run(res, chains, first);
+
+done:
+    if (NULL != workers) {
+        for (unsigned i = 0; i < nr_workers_started; i++) {
+            TSL_BUG_IF_FAILED(worker_thread_request_shutdown(&workers[i].wthr));
+            pthread_cond_signal(&workers[i].wq_cv);
+            TSL_BUG_IF_FAILED(worker_thread_delete(&workers[i].wthr));
+        }
+
+        for (unsigned i = 0; i < nr_threads; i++) {
+            if (NULL != workers[i].chains) {
+                TFREE(workers[i].chains);
+                TSL_BUG_IF_FAILED(work_queue_release(&workers[i].wq));
+                pthread_mutex_destroy(&workers[i].wq_mtx);
+                pthread_cond_destroy(&workers[i].wq_cv);
+            }
+
+            if (NULL != workers[i].latencies_ns) {
+                TFREE(workers[i].latencies_ns);
+            }
+        }
+
+        TFREE(workers);
+    }
+
+    if (NULL != chains) {
+        for (unsigned i = 0; i < nr_channels; i++) {
+            if (NULL != chains[i]) {
+                TSL_BUG_IF_FAILED(bench_chain_delete(&chains[i]));
+            }
+        }
+        TFREE(chains);
+    }
+
+    /* All sample buffers are back in the pool once the chains are gone */
+    if (NULL != samp_alloc) {
+        TSL_BUG_IF_FAILED(frame_alloc_delete(&samp_alloc));
+    }
+
+    if (NULL != latencies) {
+        TFREE(latencies);
+    }
+
+    return ret;
+}
+
+int main(int argc, char * const argv[])
+{
+    int ret = EXIT_FAILURE;
+
+    bool first = true;
+    unsigned max_channels[BENCH_MAX_SWEEP] = { 0 };
+
+    TSL_BUG_IF_FAILED(app_init("bench_pipeline", NULL));
+    TSL_BUG_IF_FAILED(app_sigint_catch(NULL));
+
+    _set_options(argc, argv);
+
+    fprintf(out_file, "{\"sampleRateHz\":%d,\"decimationFactor\":%d,\"inputSamples\":%zu,\"repeats\":%u,"
+            "\"bufferSamples\":%zu,\"nrSampBufs\":%d,\"realTime\":%s,\"runs\":[",
+            sample_rate, decimation_factor, nr_iq_samples, nr_repeats, samples_per_buf, nr_samp_bufs,
+            real_time ? "true" : "false");
+
+    for (size_t t = 0; t < nr_thread_counts && app_running(); t++) {
+        for (size_t c = 0; c < nr_channel_counts && app_running(); c++) {
+            struct bench_result res;
+
+            /* More threads than channels would just leave threads idle */
+            if (thread_counts[t] > channel_counts[c]) {
+                continue;
+            }
+
+            if (FAILED(_bench_run(channel_counts[c], thread_counts[t], &res, first))) {
+                BENCH_MSG(SEV_FATAL, "RUN-FAILED", "Failed to run %u channels on %u threads, aborting.",
+                        channel_counts[c], thread_counts[t]);
+                goto done;
+            }
+
+            first = false;
+
+            /* When pacing, keeping up means nothing was dropped. Otherwise, we need to beat the clock. */
+            if (0 == res.nr_dropped_bufs &&
+                    (true == real_time || (double)res.nr_samples * 1e9 / (double)res.wall_ns >= (double)sample_rate) &&
+                    res.nr_channels > max_channels[t])
+            {
+                max_channels[t] = res.nr_channels;
+            }
+        }
+
+        BENCH_MSG(SEV_INFO, "SUSTAINABLE", "%u threads: sustained up to %u channels in real time",
+                thread_counts[t], max_channels[t]);
+    }
+
+    fprintf(out_file, "\n  ],\n  \"sustainable\":[");
+
+    for (size_t t = 0; t < nr_thread_counts; t++) {
+        fprintf(out_file, "%s{\"threads\":%u,\"maxChannels\":%u}", 0 == t ? "" : ",",
+                thread_counts[t], max_channels[t]);
+    }
+
+    fprintf(out_file, "]\n}\n");
+
+    ret = EXIT_SUCCESS;
+
+done:
+    if (NULL != out_file && stdout != out_file) {
+        fclose(out_file);
+    }
+
+    for (size_t i = 0; i < nr_chan_cfgs; i++) {
+        if (NULL != chan_cfgs[i].resample_coeffs) {
+            TFREE(chan_cfgs[i].resample_coeffs);
+        }
+    }
+
+    if (NULL != lpf_taps) {
+        TFREE(lpf_taps);
+    }
+
+    if (NULL != iq_samples) {
+        TFREE(iq_samples);
+    }
+
+    return ret;
+}
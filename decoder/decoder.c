@@ -19,10 +19,17 @@
  *  along with this program; if not, write to the Free Software
  *  Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
  */
+#include <decoder/decoder.h>
+#include <decoder/stream_pool.h>
+#include <decoder/msg_sink.h>
+#include <decoder/page_dedup.h>
+#include <decoder/msg_record.h>
+
 #include <pager/pager_flex.h>
 #include <pager/pager_pocsag.h>
 
 #include <ais/ais_decode.h>
+#include <ais/ais_vessel_table.h>
 
 #include <filter/filter.h>
 #include <filter/sample_buf.h>
@@ -33,28 +40,55 @@
 
 #include <config/engine.h>
 
+#include <tsl/time.h>
+#include <tsl/safe_alloc.h>
 #include <tsl/diag.h>
 #include <tsl/errors.h>
 #include <tsl/assert.h>
 
+#include <stdio.h>
 #include <stdlib.h>
 #include <unistd.h>
 #include <fcntl.h>
 #include <errno.h>
 #include <string.h>
-#include <ctype.h>
+#include <stdint.h>
+#include <inttypes.h>
+#include <math.h>
 #include <time.h>
+#include <sys/stat.h>
 
-#define DEC_MSG(sev, sys, msg, ...) MESSAGE("DECODER", sev, sys, msg, ##__VA_ARGS__)
+#define NR_SAMPLES                  1024
 
 enum decoder_decoder_type {
     DECODER_PAGER_TYPE_FLEX = 0,
     DECODER_PAGER_TYPE_POCSAG = 1,
     DECODER_PROTO_TYPE_AIS = 2,
+    DECODER_PROTO_TYPE_MAX,
 };
 
+/**
+ * Bit for a protocol in a mask of protocols to be decoded
+ */
+#define DECODER_PROTO_FLAG(type)    (1u << (type))
+
+/**
+ * Most passes a stream's processing chain gets each time the stream pool finds its input
+ * readable. Each pass reads at most one buffer of NR_SAMPLES.
+ */
+#define DECODER_STREAM_STEPS_PER_WAKEUP 8
+
+/**
+ * Maximum number of resamplers a single stream can feed. At worst, every protocol runs at its
+ * own sample rate.
+ */
+#define DECODER_MAX_BRANCHES        DECODER_PROTO_TYPE_MAX
+
+/**
+ * The protocols to decode from the input stream
+ */
 static
-enum decoder_decoder_type _decoder_type = DECODER_PAGER_TYPE_FLEX;
+unsigned _decoder_protocols = DECODER_PROTO_FLAG(DECODER_PAGER_TYPE_FLEX);
 
 static
 unsigned interpolate = 1;
@@ -65,6 +99,12 @@ unsigned decimate = 1;
 static
 unsigned input_sample_rate = 0;
 
+/**
+ * Sample rate the pager decoders are fed after resampling, in Hz, or 0 for their default rates
+ */
+static
+unsigned pager_sample_rate = 0;
+
 static
 int in_fifo = -1;
 
@@ -74,9 +114,6 @@ int16_t *filter_coeffs = NULL;
 static
 size_t nr_filter_coeffs = 0;
 
-static
-struct polyphase_fir *pfir = NULL;
-
 static
 bool dc_blocker = false;
 
@@ -84,89 +121,425 @@ static
 unsigned center_freq = 0;
 
 static
-struct pager_flex *flex = NULL;
+int sample_debug_fd = -1;
+
+static
+double dc_block_pole = 0.9999;
 
 static
-struct pager_pocsag *pocsag = NULL;
+bool _invert = false;
 
 static
-struct ais_decode *ais_decode = NULL;
+double _gain = 1.0;
 
+/**
+ * Bias added to every input sample, before inversion and gain
+ */
 static
-int sample_debug_fd = -1;
+int _bias = 0;
 
+/**
+ * Number of bit errors the FLEX decoders tolerate in the BS1 sync pattern
+ */
 static
-double dc_block_pole = 0.9999;
+int _flex_sync_errors = 0;
 
 static
-bool _invert = false;
+bool benchmark = false;
+
+/**
+ * Multi-stream configuration file, if we're decoding more than one input
+ */
+static
+const char *streams_file = NULL;
+
+/**
+ * Counters and timings gathered in benchmark mode
+ */
+struct decoder_bench_stats {
+    /**
+     * Number of samples read from the input
+     */
+    size_t nr_in_samples;
+
+    /**
+     * Number of samples out of the resampler
+     */
+    size_t nr_out_samples;
+
+    /**
+     * Number of resampler output samples skipped over, because no decoder looked at them
+     */
+    size_t nr_skipped_samples;
+
+    /**
+     * Time spent reading the input, in nanoseconds
+     */
+    uint64_t read_ns;
+
+    /**
+     * Time spent in the polyphase resampler, in nanoseconds
+     */
+    uint64_t resample_ns;
+
+    /**
+     * Time spent in the DC blocker, in nanoseconds
+     */
+    uint64_t dc_block_ns;
+
+    /**
+     * Time spent in the protocol decoder, in nanoseconds
+     */
+    uint64_t protocol_ns;
+
+    /**
+     * Decoded message counts
+     */
+    size_t nr_alnum_msgs;
+    size_t nr_numeric_msgs;
+    size_t nr_other_msgs;
+};
+
+/**
+ * Message counts, across all streams. Only updated while holding the output file lock.
+ */
+static
+struct decoder_bench_stats bench_stats;
+
+/**
+ * A resampler, and the protocol decoders that consume its output. All the protocols that run at
+ * the same rate share a branch, so resampling and DC blocking is only done once for them.
+ */
+struct decoder_branch {
+    /**
+     * Mask of the protocols decoded off this branch
+     */
+    unsigned protocols;
+
+    /**
+     * Whether or not to apply the DC blocker to the resampled stream
+     */
+    bool dc_block;
+
+    /**
+     * The processing chain
+     */
+    struct dc_blocker blck;
+    struct polyphase_fir *pfir;
+    struct pager_flex *flex;
+    struct pager_pocsag *pocsag;
+
+    /**
+     * The shared AIS decoder, and which of its channels this branch feeds, if this branch decodes
+     * AIS
+     */
+    struct ais_decode *ais_decode;
+    unsigned ais_channel;
+
+    /**
+     * Resampler output
+     */
+    int16_t output_buf[NR_SAMPLES];
+};
+
+/**
+ * A single input stream, and the resamplers and protocol decoders it feeds. Each stream owns
+ * all of its state, so a stream can be serviced by any one thread without locking.
+ */
+struct decoder_stream {
+    /**
+     * Name of the input, for diagnostics
+     */
+    const char *name;
+
+    /**
+     * The input file descriptor
+     */
+    int fd;
+
+    /**
+     * Center frequency of the channel, in Hz
+     */
+    unsigned center_freq;
+
+    /**
+     * Sample rate of the input, in Hz, or 0 if not known. Only used to check the pager sample
+     * rate against the resampling factors. Must be set before any branches are added.
+     */
+    unsigned sample_rate;
+
+    /**
+     * Whether or not the input samples need to be inverted, and the gain to apply to them.
+     * These are folded into the resampler taps when a branch is added, so they must be set
+     * before any branches are added.
+     */
+    bool invert;
+    double gain;
+
+    /**
+     * A constant added to every input sample, before the inversion and gain, i.e. to cancel a
+     * known DC offset. Folded into the resampler as an offset on each of its outputs, so it must
+     * also be set before any branches are added.
+     */
+    int16_t bias;
+
+    /**
+     * If true, a zero-length read is the end of the input, and we drain what is left in the
+     * resampler. Otherwise, it is an error.
+     */
+    bool drain_on_eof;
+
+    /**
+     * Set once the end of the input has been reached
+     */
+    bool eof;
+
+    /**
+     * File to write the resampled samples of the first branch to, or -1
+     */
+    int debug_fd;
+
+    /**
+     * The partially filled buffer we're reading into. Once full, it is shared by all the
+     * branches.
+     */
+    struct sample_buf *read_buf;
+
+    /**
+     * Timings and sample counts for this stream, when benchmarking
+     */
+    struct decoder_bench_stats stats;
+
+    /**
+     * The resampler branches fed by this stream
+     */
+    struct decoder_branch branches[DECODER_MAX_BRANCHES];
+    size_t nr_branches;
+};
+
+/**
+ * Get a timestamp for benchmarking. Returns 0 if we're not benchmarking, to avoid adding
+ * overhead to the normal decode path.
+ */
+static inline
+uint64_t _decoder_bench_ts(void)
+{
+    return true == benchmark ? tsl_get_clock_monotonic() : 0;
+}
 
 static
 void _usage(const char *appname)
 {
-    DEC_MSG(SEV_INFO, "USAGE", "%s -I [interpolate] -D [decimate] -F [filter file] -d [sample_debug_file] -S [input sample rate] -f [center freq] [-c] [-o output JSON file] [-b] [-i] [in_fifo]",
+    DEC_MSG(SEV_INFO, "USAGE", "%s -I [interpolate] -D [decimate] -F [filter file] -d [sample_debug_file] -S [input sample rate] -r [pager sample rate] -f [center freq] [-c] [-o output file] [-O format] [-b] [-a bias] [-g gain] [-i] [-E errors] [-B] [in_fifo]",
             appname);
+    DEC_MSG(SEV_INFO, "USAGE", "%s -C [streams config] [-c] [-o output file] [-O format]", appname);
+    DEC_MSG(SEV_INFO, "USAGE", "        -a [bias] Add to every input sample, before  ");
+    DEC_MSG(SEV_INFO, "USAGE", "                  inverting or scaling it            ");
     DEC_MSG(SEV_INFO, "USAGE", "        -b        Enable DC blocking filter          ");
-    DEC_MSG(SEV_INFO, "USAGE", "        -c        Create JSON output file            ");
+    DEC_MSG(SEV_INFO, "USAGE", "        -B        Benchmark: read a PCM file at full ");
+    DEC_MSG(SEV_INFO, "USAGE", "                  speed, report throughput at EOF    ");
+    DEC_MSG(SEV_INFO, "USAGE", "        -c        Create output file                 ");
+    DEC_MSG(SEV_INFO, "USAGE", "        -C [file] Decode all the streams described   ");
+    DEC_MSG(SEV_INFO, "USAGE", "                  in a JSON file, with a thread pool.");
+    DEC_MSG(SEV_INFO, "USAGE", "                  The inputs are FIFOs, which never  ");
+    DEC_MSG(SEV_INFO, "USAGE", "                  end, so this runs until signalled  ");
+    DEC_MSG(SEV_INFO, "USAGE", "        -E [nr]   Bit errors allowed in the FLEX sync");
+    DEC_MSG(SEV_INFO, "USAGE", "                  pattern, 0 (default) to 8          ");
+    DEC_MSG(SEV_INFO, "USAGE", "        -g [gain] Scale the input sample stream      ");
     DEC_MSG(SEV_INFO, "USAGE", "        -i        Invert input sample stream         ");
-    DEC_MSG(SEV_INFO, "USAGE", "        -m [type] Specify protocol to decode         ");
+    DEC_MSG(SEV_INFO, "USAGE", "        -O [fmt]  Output format, json (default) or   ");
+    DEC_MSG(SEV_INFO, "USAGE", "                  binary, see msgcat to convert, or  ");
+    DEC_MSG(SEV_INFO, "USAGE", "                  nmea, AIS as !AIVDM sentences      ");
+    DEC_MSG(SEV_INFO, "USAGE", "        -r [rate] Sample rate the resampler feeds the");
+    DEC_MSG(SEV_INFO, "USAGE", "                  pagers, if not their defaults      ");
+    DEC_MSG(SEV_INFO, "USAGE", "                  (FLEX 16000, POCSAG 38400). FLEX   ");
+    DEC_MSG(SEV_INFO, "USAGE", "                  takes 12800 to 16000 in steps of   ");
+    DEC_MSG(SEV_INFO, "USAGE", "                  1600, POCSAG 9600 to 38400         ");
+    DEC_MSG(SEV_INFO, "USAGE", "        -S [rate] Input sample rate, if known        ");
+    DEC_MSG(SEV_INFO, "USAGE", "        -u [secs] Only write a page once, if it's    ");
+    DEC_MSG(SEV_INFO, "USAGE", "                  repeated within this many seconds  ");
+    DEC_MSG(SEV_INFO, "USAGE", "        -V [secs] Only write AIS reports for a vessel");
+    DEC_MSG(SEV_INFO, "USAGE", "                  when it moves or turns, or at most ");
+    DEC_MSG(SEV_INFO, "USAGE", "                  this often, with periodic snapshots");
+    DEC_MSG(SEV_INFO, "USAGE", "        -m [type] Specify protocol(s) to decode, as  ");
+    DEC_MSG(SEV_INFO, "USAGE", "                  a comma separated list. They share ");
+    DEC_MSG(SEV_INFO, "USAGE", "                  a resampler, so AIS can't be mixed ");
+    DEC_MSG(SEV_INFO, "USAGE", "                  with the pagers, and FLEX and      ");
+    DEC_MSG(SEV_INFO, "USAGE", "                  POCSAG need -r                     ");
     DEC_MSG(SEV_INFO, "USAGE", "           POCSAG - the POCSAG pager protocol        ");
     DEC_MSG(SEV_INFO, "USAGE", "           FLEX   - Motorola FLEX pager protocol     ");
     DEC_MSG(SEV_INFO, "USAGE", "           AIS    - Automatic Identification System  ");
     exit(EXIT_SUCCESS);
 }
 
-static const
-char phase_id[] = {
-    [0] = 'A',
-    [1] = 'B',
-    [2] = 'C',
-    [3] = 'D',
-};
-
+/**
+ * Decoded message output file
+ */
 static
 FILE *out_file = NULL;
 
-static inline
-void _decoder_put_alnum_char(FILE *fp, char ch)
+/**
+ * Whether to write compact binary records (see msg_record.h) rather than JSON
+ */
+static
+bool binary_out = false;
+
+/**
+ * Whether to write AIS messages as NMEA !AIVDM sentences, straight from the packets. Messages from
+ * other protocols are still written as JSON.
+ */
+static
+bool nmea_out = false;
+
+/**
+ * Decoded messages are formatted into the sink, which batches them up and writes them to the
+ * output file from its own thread. Shared by all streams; records are never interleaved.
+ */
+static
+struct msg_sink *sink = NULL;
+
+/**
+ * The AIS decoder, shared by every stream that decodes AIS. Each stream is a channel of it (i.e.
+ * 87B and 88B, out of the same multifm), so a packet heard on both is only written out once.
+ */
+static
+struct ais_decode *ais_decode = NULL;
+
+/**
+ * Pages repeated within this many seconds are only written once, or 0 to write every page
+ */
+static
+unsigned page_dedup_secs = 0;
+
+/**
+ * Pages seen recently, shared by every stream, so a page repeated on another frame or another
+ * frequency is dropped
+ */
+static
+struct page_dedup *page_dedup = NULL;
+
+/**
+ * Number of capcodes the page dedup cache remembers at once
+ */
+#define DECODER_PAGE_DEDUP_CAPCODES     16384
+
+/**
+ * Longest time between AIS reports for a vessel, in seconds, or 0 to write out every report
+ */
+static
+unsigned ais_vessel_interval = 0;
+
+/**
+ * When rate limiting AIS reports, most vessels tracked at once...
+ */
+#define DECODER_AIS_MAX_VESSELS         16384
+
+/**
+ * ...distance a vessel must move, in metres, or the change in course, in degrees, for its position
+ * to be reported before the interval is up...
+ */
+#define DECODER_AIS_MIN_DISTANCE        50.0f
+#define DECODER_AIS_MIN_COURSE_CHANGE   10.0f
+
+/**
+ * ...how often to write out the latest reports for every vessel, and how long until a vessel that
+ * has gone quiet is forgotten, in seconds
+ */
+#define DECODER_AIS_SNAPSHOT_SECS       600
+#define DECODER_AIS_EXPIRE_SECS         1800
+
+/**
+ * Hand records to the writer thread once this many bytes are buffered...
+ */
+#define DECODER_SINK_FLUSH_BYTES        (64 * 1024)
+
+/**
+ * ...or once the oldest record has waited this long, in milliseconds
+ */
+#define DECODER_SINK_FLUSH_MS           250
+
+/**
+ * Check if a page was already written within the dedup window, by any stream. A page is the same
+ * if it went to the same capcode with the same contents, whichever frame or frequency it was
+ * sent on. Only pages are checked, not the other message types.
+ */
+static
+bool _decoder_page_is_duplicate(const struct msg_record_hdr *hdr, const void *fields, const char *payload)
 {
-    switch (ch) {
-    case '\n':
-        fprintf(fp, "\\n");
-        break;
-    case '\r':
-        fprintf(fp, "\\n");
-        break;
-    case '\"':
-        fprintf(fp, "\\\"");
-        break;
-    case '\\':
-        fprintf(fp, "\\\\");
-        break;
-    case '/':
-        fprintf(fp, "\\/");
-        break;
-    case '\b':
-        fprintf(fp, "<BKSP>");
-        break;
-    case '\f':
-        fprintf(fp, "<FF>");
-        break;
-    case '\t':
-        fprintf(fp, "\\t");
+    uint64_t hash = PAGE_DEDUP_HASH_INIT;
+
+    if (MSG_RECORD_TYPE_ALPHANUMERIC != hdr->type && MSG_RECORD_TYPE_NUMERIC != hdr->type) {
+        return false;
+    }
+
+    hash = page_dedup_hash(hash, &hdr->type, sizeof(hdr->type));
+    hash = page_dedup_hash(hash, &hdr->function, sizeof(hdr->function));
+    hash = page_dedup_hash(hash, &hdr->flags, sizeof(hdr->flags));
+    hash = page_dedup_hash(hash, &hdr->frag_seq, sizeof(hdr->frag_seq));
+    hash = page_dedup_hash(hash, &hdr->payload_len, sizeof(hdr->payload_len));
+    hash = page_dedup_hash(hash, fields, hdr->fields_len);
+    hash = page_dedup_hash(hash, payload, hdr->payload_len);
+
+    /* FLEX and POCSAG capcodes are separate address spaces */
+    return page_dedup_check(page_dedup, hdr->timestamp_ns / 1000000ull,
+            hdr->address ^ ((uint64_t)hdr->proto << 56), hash);
+}
+
+/**
+ * Timestamp a decoded message, and write it to the output in the selected format.
+ */
+static
+void _decoder_emit(struct msg_record_hdr *hdr, const void *fields, const char *payload)
+{
+    struct timespec now;
+
+    /* TODO: this sucks, should move it closer to the capture clock */
+    clock_gettime(CLOCK_REALTIME, &now);
+    hdr->timestamp_ns = (uint64_t)now.tv_sec * 1000000000ull + (uint64_t)now.tv_nsec;
+
+    if (NULL != page_dedup && true == _decoder_page_is_duplicate(hdr, fields, payload)) {
+        return;
+    }
+
+    msg_sink_begin(sink);
+
+    if (true == binary_out) {
+        msg_record_put(sink, hdr, fields, payload);
+    } else {
+        msg_record_put_json(sink, hdr, fields, payload);
+    }
+
+    switch (hdr->type) {
+    case MSG_RECORD_TYPE_ALPHANUMERIC:
+        bench_stats.nr_alnum_msgs++;
         break;
-    case 0x03:
-    case 0x04:
-    case 0x17:
-        fprintf(fp, " ");
+    case MSG_RECORD_TYPE_NUMERIC:
+        bench_stats.nr_numeric_msgs++;
         break;
     default:
-        if (isprint(ch)) {
-            fprintf(fp, "%c", ch);
-        } else {
-            fprintf(fp, "\\u%04x", (unsigned)ch);
-        }
+        bench_stats.nr_other_msgs++;
+    }
+
+    msg_sink_commit(sink);
+}
+
+/**
+ * Start a binary output with the file header. When appending to an existing archive, the header
+ * is already there, so it's skipped. Readers skip headers that turn up between records anyway,
+ * so concatenated archives are fine.
+ */
+static
+void _decoder_put_file_hdr(void)
+{
+    struct stat st;
+
+    if (0 == fstat(fileno(out_file), &st) && S_ISREG(st.st_mode) && 0 != st.st_size) {
+        return;
     }
+
+    msg_sink_begin(sink);
+    msg_record_put_file_hdr(sink);
+    msg_sink_commit(sink);
 }
 
 static
@@ -183,23 +556,20 @@ aresult_t _on_flex_alnum_msg(
         const char *message_bytes,
         size_t message_len)
 {
-    /* TODO: this sucks, should move it closer to the capture clock */
-    time_t now = time(NULL);
-    struct tm *gmt = gmtime(&now);
-
-    fprintf(out_file, "{\"proto\":\"flex\",\"type\":\"alphanumeric\",\"timestamp\":\"%04i-%02i-%02i %02i:%02i:%02i UTC\","
-            "\"baud\":%i,\"syncLevel\":%i,\"frameNo\":%u,\"cycleNo\":%u,\"phaseNo\":\"%c\",\"capCode\":%lu,\"fragment\":%s,"
-            "\"maildrop\":%s,\"fragSeq\":%u,\"message\":\"",
-            gmt->tm_year + 1900, gmt->tm_mon + 1, gmt->tm_mday, gmt->tm_hour, gmt->tm_min, gmt->tm_sec,
-            baud, 0, frame_no, cycle_no, phase_id[phase], cap_code,
-            fragmented ? "true" : "false", maildrop ? "true" : "false", seq_num);
-
-    for (size_t i = 0; i < message_len; i++) {
-        _decoder_put_alnum_char(out_file, message_bytes[i]);
-    }
-
-    fprintf(out_file, "\"}\n");
-    fflush(out_file);
+    struct msg_record_hdr hdr = {
+        .proto = MSG_RECORD_PROTO_FLEX,
+        .type = MSG_RECORD_TYPE_ALPHANUMERIC,
+        .address = cap_code,
+        .baud = baud,
+        .phase = phase,
+        .cycle_no = cycle_no,
+        .frame_no = frame_no,
+        .flags = (fragmented ? MSG_RECORD_FLAG_FRAGMENTED : 0) | (maildrop ? MSG_RECORD_FLAG_MAILDROP : 0),
+        .frag_seq = seq_num,
+        .payload_len = message_len,
+    };
+
+    _decoder_emit(&hdr, NULL, message_bytes);
 
     return A_OK;
 }
@@ -215,21 +585,18 @@ aresult_t _on_flex_num_msg(
         const char *message_bytes,
         size_t message_len)
 {
-    /* TODO: this sucks, should move it closer to the capture clock */
-    time_t now = time(NULL);
-    struct tm *gmt = gmtime(&now);
-
-    fprintf(out_file, "{\"proto\":\"flex\",\"type\":\"numeric\",\"timestamp\":\"%04i-%02i-%02i %02i:%02i:%02i UTC\","
-            "\"baud\":%i,\"syncLevel\":%i,\"frameNo\":%u,\"cycleNo\":%u,\"phaseNo\":\"%c\",\"capCode\":%lu,\"message\":\"",
-            gmt->tm_year + 1900, gmt->tm_mon + 1, gmt->tm_mday, gmt->tm_hour, gmt->tm_min, gmt->tm_sec,
-            baud, 0, frame_no, cycle_no, phase_id[phase], cap_code);
-
-    for (size_t i = 0; i < message_len; i++) {
-        _decoder_put_alnum_char(out_file, message_bytes[i]);
-    }
-
-    fprintf(out_file, "\"}\n");
-    fflush(out_file);
+    struct msg_record_hdr hdr = {
+        .proto = MSG_RECORD_PROTO_FLEX,
+        .type = MSG_RECORD_TYPE_NUMERIC,
+        .address = cap_code,
+        .baud = baud,
+        .phase = phase,
+        .cycle_no = cycle_no,
+        .frame_no = frame_no,
+        .payload_len = message_len,
+    };
+
+    _decoder_emit(&hdr, NULL, message_bytes);
 
     return A_OK;
 }
@@ -245,18 +612,23 @@ aresult_t _on_flex_siv_msg(
         uint8_t siv_msg_type,
         uint32_t data)
 {
-    /* TODO: this sucks, should move it closer to the capture clock */
-    time_t now = time(NULL);
-    struct tm *gmt = gmtime(&now);
-
-    switch (siv_msg_type) {
-    case PAGER_FLEX_SIV_TEMP_ADDRESS_ACTIVATION:
-        fprintf(out_file, "{\"proto\":\"flex\",\"type\":\"tempAddrActivation\",\"timestamp\":\"%04i-%02i-%02i %02i:%02i:%02i UTC\","
-                "\"baud\":%i,\"syncLevel\":%i,\"frameNo\":%u,\"cycleNo\":%u,\"phaseNo\":\"%c\",\"capCode\":%lu,\"startFrameNo\":%u,\"tempAddressId\":%u}\n",
-                gmt->tm_year + 1900, gmt->tm_mon + 1, gmt->tm_mday, gmt->tm_hour, gmt->tm_min, gmt->tm_sec,
-                baud, 0, frame_no, cycle_no, phase_id[phase], cap_code, data & 0x7f, (data >> 7) & 0xf);
-        break;
-    }
+    struct msg_record_flex_siv siv = {
+        .data = data,
+        .siv_type = siv_msg_type,
+    };
+    struct msg_record_hdr hdr = {
+        .proto = MSG_RECORD_PROTO_FLEX,
+        .type = MSG_RECORD_TYPE_FLEX_SIV,
+        .fields_len = sizeof(siv),
+        .address = cap_code,
+        .baud = baud,
+        .phase = phase,
+        .cycle_no = cycle_no,
+        .frame_no = frame_no,
+    };
+
+    _decoder_emit(&hdr, &siv, NULL);
+
     return A_OK;
 }
 
@@ -269,21 +641,16 @@ aresult_t _on_pocsag_alnum_msg(
         size_t data_len,
         uint8_t function)
 {
-    /* TODO: this sucks, should move it closer to the capture clock */
-    time_t now = time(NULL);
-    struct tm *gmt = gmtime(&now);
-
-    fprintf(out_file, "{\"proto\":\"pocsag\",\"type\":\"alphanumeric\",\"timestamp\":\"%04i-%02i-%02i %02i:%02i:%02i UTC\","
-            "\"baud\":%i,\"capCode\":%u,\"function\":%u,\"message\":\"",
-            gmt->tm_year + 1900, gmt->tm_mon + 1, gmt->tm_mday, gmt->tm_hour, gmt->tm_min, gmt->tm_sec,
-            baud_rate, capcode, (unsigned)function);
-
-    for (size_t i = 0; i < data_len; i++) {
-        _decoder_put_alnum_char(out_file, data[i]);
-    }
+    struct msg_record_hdr hdr = {
+        .proto = MSG_RECORD_PROTO_POCSAG,
+        .type = MSG_RECORD_TYPE_ALPHANUMERIC,
+        .address = capcode,
+        .baud = baud_rate,
+        .function = function,
+        .payload_len = data_len,
+    };
 
-    fprintf(out_file, "\"}\n");
-    fflush(out_file);
+    _decoder_emit(&hdr, NULL, data);
 
     return A_OK;
 }
@@ -297,99 +664,240 @@ aresult_t _on_pocsag_num_msg(
         size_t data_len,
         uint8_t function)
 {
-    /* TODO: this sucks, should move it closer to the capture clock */
-    time_t now = time(NULL);
-    struct tm *gmt = gmtime(&now);
+    struct msg_record_hdr hdr = {
+        .proto = MSG_RECORD_PROTO_POCSAG,
+        .type = MSG_RECORD_TYPE_NUMERIC,
+        .address = capcode,
+        .baud = baud_rate,
+        .function = function,
+        .payload_len = data_len,
+    };
 
-    fprintf(out_file, "{\"proto\":\"pocsag\",\"type\":\"numeric\",\"timestamp\":\"%04i-%02i-%02i %02i:%02i:%02i UTC\","
-            "\"baud\":%i,\"capCode\":%u,\"function\":%u,\"message\":\"",
-            gmt->tm_year + 1900, gmt->tm_mon + 1, gmt->tm_mday, gmt->tm_hour, gmt->tm_min, gmt->tm_sec,
-            baud_rate, capcode, (unsigned)function);
+    _decoder_emit(&hdr, NULL, data);
 
-    for (size_t i = 0; i < data_len; i++) {
-        _decoder_put_alnum_char(out_file, data[i]);
-    }
+    return A_OK;
+}
 
-    fprintf(out_file, "\"}\n");
-    fflush(out_file);
+static
+aresult_t _on_ais_position_report(struct ais_decode *decode, void *state, struct ais_position_report *pr, const char *raw_msg)
+{
+    struct msg_record_ais_position_report fields = {
+        .nav_stat = pr->nav_stat,
+        .position_acc = pr->position_acc,
+        .course = pr->course,
+        .heading = pr->heading,
+        .seconds = pr->timestamp,
+        .rate_of_turn = pr->rate_of_turn,
+        .speed_over_ground = pr->speed_over_ground,
+        .longitude = pr->longitude,
+        .latitude = pr->latitude,
+    };
+    struct msg_record_hdr hdr = {
+        .proto = MSG_RECORD_PROTO_AIS,
+        .type = MSG_RECORD_TYPE_AIS_POSITION_REPORT,
+        .fields_len = sizeof(fields),
+        .address = pr->mmsi,
+        .payload_len = strlen(raw_msg),
+    };
+
+    _decoder_emit(&hdr, &fields, raw_msg);
 
     return A_OK;
 }
 
 static
-aresult_t _on_ais_position_report(struct ais_decode *decode, void *state, struct ais_position_report *pr, const char *raw_msg)
+aresult_t _on_ais_base_station_report(struct ais_decode *decode, void *state, struct ais_base_station_report *br,
+        const char *raw_msg)
+{
+    struct msg_record_ais_base_station_report fields = {
+        .year = br->year,
+        .month = br->month,
+        .day = br->day,
+        .hour = br->hour,
+        .minute = br->minute,
+        .second = br->second,
+        .epfd_type = br->epfd_type,
+        .longitude = br->longitude,
+        .latitude = br->latitude,
+    };
+    struct msg_record_hdr hdr = {
+        .proto = MSG_RECORD_PROTO_AIS,
+        .type = MSG_RECORD_TYPE_AIS_BASE_STATION_REPORT,
+        .fields_len = sizeof(fields),
+        .address = br->mmsi,
+        .payload_len = strlen(raw_msg),
+    };
+
+    _decoder_emit(&hdr, &fields, raw_msg);
+
+    return A_OK;
+}
+
+static
+aresult_t _on_ais_static_voyage_data(struct ais_decode *decode, void *state, struct ais_static_voyage_data *svd,
+        const char *raw_msg)
+{
+    struct msg_record_ais_static_voyage_data fields = {
+        .version = svd->version,
+        .imo_number = svd->imo_number,
+        .ship_type = svd->ship_type,
+        .dim_to_bow = svd->dim_to_bow,
+        .dim_to_stern = svd->dim_to_stern,
+        .dim_to_port = svd->dim_to_port,
+        .dim_to_starboard = svd->dim_to_starboard,
+        .fix_type = svd->fix_type,
+        .eta_month = svd->eta_month,
+        .eta_day = svd->eta_day,
+        .eta_hour = svd->eta_hour,
+        .eta_minute = svd->eta_minute,
+        .draught = svd->draught,
+    };
+    struct msg_record_hdr hdr = {
+        .proto = MSG_RECORD_PROTO_AIS,
+        .type = MSG_RECORD_TYPE_AIS_STATIC_VOYAGE_DATA,
+        .fields_len = sizeof(fields),
+        .address = svd->mmsi,
+        .payload_len = strlen(raw_msg),
+    };
+
+    memcpy(fields.callsign, svd->callsign, sizeof(fields.callsign));
+    memcpy(fields.ship_name, svd->ship_name, sizeof(fields.ship_name));
+    memcpy(fields.destination, svd->destination, sizeof(fields.destination));
+
+    _decoder_emit(&hdr, &fields, raw_msg);
+
+    return A_OK;
+}
+
+/**
+ * Write out the NMEA sentences for an AIS message, as is.
+ */
+static
+aresult_t _on_ais_nmea(struct ais_decode *decode, void *state, const char *sentences, size_t len)
 {
-    time_t now = time(NULL);
-    struct tm *gmt = gmtime(&now);
+    char *out = NULL;
 
-    fprintf(out_file,
-            "{\"proto\":\"ais\",\"type\":\"positionReport\",\"timestamp\":\"%04i-%02i-%02i %02i:%02i:%02i UTC\","
-            "\"mmsi\":%u,\"navStat\":%u,\"rateOfTurn\":%d,\"speedOverGround\":%f,\"positionAcc\":%u,"
-            "\"geoPosition\":{\"lon\":%f,\"lat\":%f},\"course\":%u,\"heading\":%u,\"seconds\":%u,\"rawAscii\":\"",
-            gmt->tm_year + 1900, gmt->tm_mon + 1, gmt->tm_mday, gmt->tm_hour, gmt->tm_min, gmt->tm_sec,
-            pr->mmsi, pr->nav_stat, pr->rate_of_turn, (double)pr->speed_over_ground, pr->position_acc,
-            (double)pr->longitude, (double)pr->latitude, pr->course, pr->heading, pr->timestamp);
+    msg_sink_begin(sink);
 
-    for (size_t i = 0; i < strlen(raw_msg); i++) {
-        _decoder_put_alnum_char(out_file, raw_msg[i]);
+    if (NULL != (out = msg_sink_reserve(sink, len))) {
+        memcpy(out, sentences, len);
     }
 
-    fprintf(out_file, "\"}\n");
+    bench_stats.nr_other_msgs++;
+
+    msg_sink_commit(sink);
 
     return A_OK;
 }
 
+/**
+ * Load the resampler filter from a JSON file, converting the coefficients to Q.15. If the
+ * file specifies resampling factors, and pinterp/pdecim are not NULL, they are returned too.
+ */
 static
-aresult_t _on_ais_base_station_report(struct ais_decode *decode, void *state, struct ais_base_station_report *br,
-        const char *raw_msg)
+aresult_t _decoder_load_filter(const char *filter_file, int16_t **pcoeffs, size_t *pnr_coeffs,
+        int *pinterp, int *pdecim)
 {
-    time_t now = time(NULL);
-    struct tm *gmt = gmtime(&now);
+    aresult_t ret = A_OK;
+
+    struct config *cfg CAL_CLEANUP(config_delete) = NULL;
+    double *coeffs_f = NULL;
+    int16_t *coeffs = NULL;
+    size_t nr_coeffs = 0;
+
+    TSL_ASSERT_ARG(NULL != filter_file);
+    TSL_ASSERT_ARG(NULL != pcoeffs);
+    TSL_ASSERT_ARG(NULL != pnr_coeffs);
+
+    TSL_BUG_IF_FAILED(config_new(&cfg));
+
+    if (FAILED(ret = config_add(cfg, filter_file))) {
+        DEC_MSG(SEV_ERROR, "BAD-CONFIG", "Configuration file '%s' cannot be processed.", filter_file);
+        goto done;
+    }
 
-    fprintf(out_file,
-            "{\"proto\":\"ais\",\"type\":\"baseStationReport\",\"timestamp\":\"%04i-%02i-%02i %02i:%02i:%02i UTC\","
-            "\"mmsi\":%u,\"baseStationDate\":\"%04u-%02u-%02u %02u:%02u:%02u UTC\","
-            "\"geoPosition\":{\"lon\":%f,\"lat\":%f},\"fixType\":\"%s\",\"rawAscii\":\"",
-            gmt->tm_year + 1900, gmt->tm_mon + 1, gmt->tm_mday, gmt->tm_hour, gmt->tm_min, gmt->tm_sec,
-            br->mmsi, br->year, br->month, br->day, br->hour, br->minute, br->second,
-            (double)br->longitude, (double)br->latitude, br->epfd_name);
+    if (FAILED(ret = config_get_float_array(cfg, &coeffs_f, &nr_coeffs, "lpfCoeffs"))) {
+        DEC_MSG(SEV_ERROR, "BAD-FILTER-FILE", "Filter file '%s' is missing 'lpfCoeffs'.", filter_file);
+        goto done;
+    }
 
-    for (size_t i = 0; i < strlen(raw_msg); i++) {
-        _decoder_put_alnum_char(out_file, raw_msg[i]);
+    if (FAILED(ret = TCALLOC((void **)&coeffs, sizeof(int16_t) * nr_coeffs, (size_t)1))) {
+        goto done;
     }
 
-    fprintf(out_file, "\"}\n");
+    for (size_t i = 0; i < nr_coeffs; i++) {
+        double q15 = 1 << Q_15_SHIFT;
+        coeffs[i] = (int16_t)(coeffs_f[i] * q15);
+    }
 
-    return A_OK;
+    if (NULL != pinterp) {
+        config_get_integer(cfg, pinterp, "interpolate");
+    }
+
+    if (NULL != pdecim) {
+        config_get_integer(cfg, pdecim, "decimate");
+    }
+
+    *pcoeffs = coeffs;
+    *pnr_coeffs = nr_coeffs;
+
+done:
+    if (NULL != coeffs_f) {
+        TFREE(coeffs_f);
+    }
+
+    return ret;
 }
 
+static const
+char *decoder_protocol_names[DECODER_PROTO_TYPE_MAX] = {
+    [DECODER_PAGER_TYPE_FLEX] = "flex",
+    [DECODER_PAGER_TYPE_POCSAG] = "pocsag",
+    [DECODER_PROTO_TYPE_AIS] = "ais",
+};
+
+/**
+ * Parse a comma separated list of protocol names (i.e. "flex,pocsag") into a mask of
+ * protocols.
+ */
 static
-aresult_t _on_ais_static_voyage_data(struct ais_decode *decode, void *state, struct ais_static_voyage_data *svd,
-        const char *raw_msg)
+aresult_t _decoder_parse_protocols(const char *list, unsigned *pprotocols)
 {
-    time_t now = time(NULL);
-    struct tm *gmt = gmtime(&now);
+    aresult_t ret = A_OK;
 
-    /* TODO: Ensure we escape the callsign, ship name and destination */
+    const char *tok = list;
+    unsigned protocols = 0;
 
-    fprintf(out_file,
-            "{\"proto\":\"ais\",\"type\":\"staticAndVoyageData\",\"timestamp\":\"%04i-%02i-%02i %02i:%02i:%02i UTC\","
-            "\"mmsi\":%u,\"version\":%u,\"imoNumber\":%u,\"callsign\":\"%s\",\"shipName\":\"%s\","
-            "\"shipType\":%u,\"dimensions\":{\"toBow\":%u,\"toStern\":%u,\"toPort\":%u,\"toStarboard\":%u},"
-            "\"fixType\":\"%s\",\"eta\":\"%02u-%02u %02u:%02u\",\"draught\":%f,\"destination\":\"%s\","
-            "\"rawAscii\":\"",
-            gmt->tm_year + 1900, gmt->tm_mon + 1, gmt->tm_mday, gmt->tm_hour, gmt->tm_min, gmt->tm_sec,
-            svd->mmsi, svd->version, svd->imo_number, svd->callsign, svd->ship_name,
-            svd->ship_type, svd->dim_to_bow, svd->dim_to_stern, svd->dim_to_port, svd->dim_to_starboard,
-            svd->epfd_name, svd->eta_month, svd->eta_day, svd->eta_hour, svd->eta_minute, svd->draught, svd->destination);
+    TSL_ASSERT_ARG(NULL != list);
+    TSL_ASSERT_ARG(NULL != pprotocols);
 
-    for (size_t i = 0; i < strlen(raw_msg); i++) {
-        _decoder_put_alnum_char(out_file, raw_msg[i]);
+    while (NULL != tok) {
+        const char *next = strchr(tok, ',');
+        size_t len = NULL != next ? (size_t)(next - tok) : strlen(tok);
+        unsigned type = 0;
+
+        for (type = 0; type < DECODER_PROTO_TYPE_MAX; type++) {
+            if (strlen(decoder_protocol_names[type]) == len &&
+                    !strncasecmp(tok, decoder_protocol_names[type], len))
+            {
+                break;
+            }
+        }
+
+        if (DECODER_PROTO_TYPE_MAX == type) {
+            DEC_MSG(SEV_ERROR, "UNKNOWN-PROTOCOL-TYPE", "Unknown protocol type specified: %.*s", (int)len, tok);
+            ret = A_E_INVAL;
+            goto done;
+        }
+
+        protocols |= DECODER_PROTO_FLAG(type);
+        tok = NULL != next ? next + 1 : NULL;
     }
 
-    fprintf(out_file, "\"}\n");
+    *pprotocols = protocols;
 
-    return A_OK;
+done:
+    return ret;
 }
 
 static
@@ -398,11 +906,9 @@ void _set_options(int argc, char * const argv[])
     int arg = -1;
     const char *filter_file = NULL,
                *out_file_name = NULL;
-    struct config *cfg CAL_CLEANUP(config_delete) = NULL;
-    double *filter_coeffs_f = NULL;
     bool create_out = false;
 
-    while ((arg = getopt(argc, argv, "co:I:D:S:F:f:d:p:m:bih")) != -1) {
+    while ((arg = getopt(argc, argv, "co:O:I:D:S:r:F:f:d:p:a:g:m:E:C:V:u:biBh")) != -1) {
         switch (arg) {
         case 'o':
             out_file_name = optarg;
@@ -410,9 +916,26 @@ void _set_options(int argc, char * const argv[])
         case 'c':
             create_out = true;
             break;
+        case 'O':
+            if (!strcasecmp(optarg, "binary")) {
+                binary_out = true;
+            } else if (!strcasecmp(optarg, "nmea")) {
+                nmea_out = true;
+            } else if (strcasecmp(optarg, "json")) {
+                DEC_MSG(SEV_FATAL, "BAD-OUTPUT-FORMAT", "Unknown output format '%s', must be one of json, binary or nmea.",
+                        optarg);
+                exit(EXIT_FAILURE);
+            }
+            break;
         case 'f':
             center_freq = strtoll(optarg, NULL, 0);
             break;
+        case 'V':
+            ais_vessel_interval = strtoul(optarg, NULL, 0);
+            break;
+        case 'u':
+            page_dedup_secs = strtoul(optarg, NULL, 0);
+            break;
         case 'I':
             interpolate = strtoll(optarg, NULL, 0);
             break;
@@ -422,6 +945,9 @@ void _set_options(int argc, char * const argv[])
         case 'S':
             input_sample_rate = strtoll(optarg, NULL, 0);
             break;
+        case 'r':
+            pager_sample_rate = strtoul(optarg, NULL, 0);
+            break;
         case 'F':
             filter_file = optarg;
             break;
@@ -440,14 +966,7 @@ void _set_options(int argc, char * const argv[])
             break;
 
         case 'm':
-            if (!strncasecmp(optarg, "pocsag", 6)) {
-                _decoder_type = DECODER_PAGER_TYPE_POCSAG;
-            } else if (!strncasecmp(optarg, "flex", 4)) {
-                _decoder_type = DECODER_PAGER_TYPE_FLEX;
-            } else if (!strncasecmp(optarg, "ais", 3)) {
-                _decoder_type = DECODER_PROTO_TYPE_AIS;
-            } else {
-                DEC_MSG(SEV_ERROR, "UNKNOWN-PROTOCOL-TYPE", "Unknown protocol type specified: %s", optarg);
+            if (FAILED(_decoder_parse_protocols(optarg, &_decoder_protocols))) {
                 exit(EXIT_FAILURE);
             }
             break;
@@ -457,43 +976,88 @@ void _set_options(int argc, char * const argv[])
             DEC_MSG(SEV_INFO, "DC-BLOCK-POLE", "Setting DC Blocker pole to %f", dc_block_pole);
             break;
 
+        case 'g':
+            _gain = strtod(optarg, NULL);
+            if (0.0 >= _gain) {
+                DEC_MSG(SEV_FATAL, "BAD-GAIN", "Gain must be positive, use -i to invert the input.");
+                exit(EXIT_FAILURE);
+            }
+            DEC_MSG(SEV_INFO, "GAIN", "Applying a gain of %f to the input sample stream.", _gain);
+            break;
+
+        case 'a':
+            _bias = strtol(optarg, NULL, 0);
+            if (INT16_MIN > _bias || INT16_MAX < _bias) {
+                DEC_MSG(SEV_FATAL, "BAD-BIAS", "Input bias must be from %d to %d.", INT16_MIN, INT16_MAX);
+                exit(EXIT_FAILURE);
+            }
+            DEC_MSG(SEV_INFO, "BIAS", "Adding a bias of %d to the input sample stream.", _bias);
+            break;
+
+        case 'E':
+            _flex_sync_errors = strtoll(optarg, NULL, 0);
+            DEC_MSG(SEV_INFO, "FLEX-SYNC-ERRORS", "Tolerating up to %d bit errors in the FLEX sync pattern.",
+                    _flex_sync_errors);
+            break;
+
         case 'i':
             _invert = true;
             DEC_MSG(SEV_INFO, "INVERTING", "Inverting input sample stream, due to a non-phase correcting input source.");
             break;
 
+        case 'B':
+            benchmark = true;
+            DEC_MSG(SEV_INFO, "BENCHMARK", "Benchmark mode: will run until the end of the input and report throughput.");
+            break;
+
+        case 'C':
+            streams_file = optarg;
+            break;
+
         case 'h':
             _usage(argv[0]);
             break;
         }
     }
 
-    if (optind > argc) {
-        DEC_MSG(SEV_FATAL, "MISSING-SRC-DEST", "Missing source/destination file");
-        exit(EXIT_FAILURE);
-    }
+    if (NULL != streams_file) {
+        if (true == benchmark) {
+            DEC_MSG(SEV_FATAL, "BENCHMARK-MULTI-STREAM", "Benchmark mode only supports a single input stream.");
+            exit(EXIT_FAILURE);
+        }
 
-    if (0 == decimate) {
-        DEC_MSG(SEV_FATAL, "BAD-DECIMATION", "Decimation factor must be a non-zero integer.");
-        exit(EXIT_FAILURE);
-    }
+        if (-1 != sample_debug_fd) {
+            DEC_MSG(SEV_FATAL, "DEBUG-MULTI-STREAM", "A sample debug file can only be written for a single input stream.");
+            exit(EXIT_FAILURE);
+        }
+    } else {
+        if (optind >= argc) {
+            DEC_MSG(SEV_FATAL, "MISSING-SRC-DEST", "Missing source/destination file");
+            exit(EXIT_FAILURE);
+        }
 
-    if (0 == decimate) {
-        DEC_MSG(SEV_FATAL, "BAD-INTERPOLATION", "Interpolation factor must be a non-zero integer.");
-        exit(EXIT_FAILURE);
-    }
+        if (0 == decimate) {
+            DEC_MSG(SEV_FATAL, "BAD-DECIMATION", "Decimation factor must be a non-zero integer.");
+            exit(EXIT_FAILURE);
+        }
 
-    if (0 == center_freq) {
-        DEC_MSG(SEV_FATAL, "BAD-PAGER-FREQ", "Pager frequency must be non-zero");
-        exit(EXIT_FAILURE);
-    }
+        if (0 == interpolate) {
+            DEC_MSG(SEV_FATAL, "BAD-INTERPOLATION", "Interpolation factor must be a non-zero integer.");
+            exit(EXIT_FAILURE);
+        }
 
-    if (NULL == filter_file) {
-        DEC_MSG(SEV_FATAL, "BAD-FILTER-FILE", "Need to specify a filter JSON file.");
-        exit(EXIT_FAILURE);
-    }
+        if (0 == center_freq) {
+            DEC_MSG(SEV_FATAL, "BAD-PAGER-FREQ", "Pager frequency must be non-zero");
+            exit(EXIT_FAILURE);
+        }
 
-    if (NULL == out_file_name) {
+        if (NULL == filter_file) {
+            DEC_MSG(SEV_FATAL, "BAD-FILTER-FILE", "Need to specify a filter JSON file.");
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    if (NULL == out_file_name) {
         DEC_MSG(SEV_INFO, "WRITE-TO-STDOUT", "Output decoded data is going to stdout.");
         out_file = stdout;
     } else {
@@ -511,26 +1075,21 @@ void _set_options(int argc, char * const argv[])
         }
     }
 
+    if (NULL != streams_file) {
+        /* The streams are set up from the configuration file */
+        return;
+    }
+
     DEC_MSG(SEV_INFO, "CONFIG", "Resampling: %u/%u from %u to %f", interpolate, decimate, input_sample_rate,
             ((double)interpolate/(double)decimate)*(double)input_sample_rate);
     DEC_MSG(SEV_INFO, "CONFIG", "Loading filter coefficients from '%s'", filter_file);
 
-    TSL_BUG_IF_FAILED(config_new(&cfg));
-
-    if (FAILED(config_add(cfg, filter_file))) {
+    if (FAILED(_decoder_load_filter(filter_file, &filter_coeffs, &nr_filter_coeffs, NULL, NULL))) {
         DEC_MSG(SEV_INFO, "BAD-CONFIG", "Configuration file '%s' cannot be processed, aborting.",
                 filter_file);
         exit(EXIT_FAILURE);
     }
 
-    TSL_BUG_IF_FAILED(config_get_float_array(cfg, &filter_coeffs_f, &nr_filter_coeffs, "lpfCoeffs"));
-    TSL_BUG_IF_FAILED(TCALLOC((void **)&filter_coeffs, sizeof(int16_t) * nr_filter_coeffs, (size_t)1));
-
-    for (size_t i = 0; i < nr_filter_coeffs; i++) {
-        double q15 = 1 << Q_15_SHIFT;
-        filter_coeffs[i] = (int16_t)(filter_coeffs_f[i] * q15);
-    }
-
     if (0 > (in_fifo = open(argv[optind], O_RDONLY))) {
         DEC_MSG(SEV_INFO, "BAD-INPUT", "Bad input - cannot open %s", argv[optind]);
         exit(EXIT_FAILURE);
@@ -545,8 +1104,6 @@ aresult_t _free_sample_buf(struct sample_buf *buf)
     return A_OK;
 }
 
-#define NR_SAMPLES                  1024
-
 static
 aresult_t _alloc_sample_buf(struct sample_buf **pbuf)
 {
@@ -574,154 +1131,1193 @@ done:
 }
 
 static
-int16_t output_buf[NR_SAMPLES];
+aresult_t _decoder_stream_delete(struct decoder_stream **pst)
+{
+    aresult_t ret = A_OK;
+
+    struct decoder_stream *st = NULL;
+
+    TSL_ASSERT_ARG(NULL != pst);
+    TSL_ASSERT_ARG(NULL != *pst);
+
+    st = *pst;
+
+    if (NULL != st->read_buf) {
+        TSL_BUG_IF_FAILED(sample_buf_decref(st->read_buf));
+        st->read_buf = NULL;
+    }
+
+    for (size_t i = 0; i < st->nr_branches; i++) {
+        struct decoder_branch *br = &st->branches[i];
+
+        if (NULL != br->flex) {
+            pager_flex_delete(&br->flex);
+        }
+
+        if (NULL != br->pocsag) {
+            pager_pocsag_delete(&br->pocsag);
+        }
+
+        if (NULL != br->pfir) {
+            polyphase_fir_delete(&br->pfir);
+        }
+    }
 
+    TFREE(st);
+
+    *pst = NULL;
+
+    return ret;
+}
+
+/**
+ * Create a new stream. The caller keeps ownership of the file descriptor. The stream needs at
+ * least one branch before it can be used.
+ */
 static
-aresult_t process_samples(void)
+aresult_t _decoder_stream_new(struct decoder_stream **pst, const char *name, int fd, unsigned freq)
 {
-    int ret = A_OK;
+    aresult_t ret = A_OK;
 
-    struct dc_blocker blck;
-    struct sample_buf *read_buf = NULL;
+    struct decoder_stream *st = NULL;
 
-    TSL_BUG_IF_FAILED(dc_blocker_init(&blck, dc_block_pole));
+    TSL_ASSERT_ARG(NULL != pst);
+    TSL_ASSERT_ARG(NULL != name);
+    TSL_ASSERT_ARG(0 <= fd);
 
-    do {
-        int op_ret = 0;
-        size_t new_samples = 0;
-        bool full = false;
+    *pst = NULL;
 
-        TSL_BUG_IF_FAILED(polyphase_fir_full(pfir, &full));
+    if (FAILED(ret = TZAALLOC(st, SYS_CACHE_LINE_LENGTH))) {
+        goto done;
+    }
 
-        if (false == full) {
-            size_t nr_sample_bytes = 0;
+    st->name = name;
+    st->fd = fd;
+    st->center_freq = freq;
+    st->gain = 1.0;
+    st->debug_fd = -1;
 
-            if (NULL == read_buf) {
-                /* Allocate a new buffer */
-                TSL_BUG_IF_FAILED(_alloc_sample_buf(&read_buf));
-            }
+    *pst = st;
+
+done:
+    return ret;
+}
+
+/**
+ * Fold the stream's inversion and gain into a copy of the resampler taps. The resampler is
+ * linear, so scaling the taps is the same as scaling every input sample, but costs nothing per
+ * sample. Taps that no longer fit in Q.15 are saturated.
+ */
+static
+aresult_t _decoder_stream_shape_coeffs(struct decoder_stream *st, const int16_t *coeffs, size_t nr_coeffs,
+        int16_t **pshaped)
+{
+    aresult_t ret = A_OK;
 
-            nr_sample_bytes = read_buf->nr_samples * sizeof(int16_t);
+    int16_t *shaped = NULL;
+    double scale = 0.0;
+    size_t nr_clipped = 0;
 
-            if (0 >= (op_ret = read(in_fifo, (uint8_t *)read_buf->data_buf + nr_sample_bytes, read_buf->sample_buf_bytes - nr_sample_bytes))) {
-                int errnum = errno;
-                ret = A_E_INVAL;
-                DEC_MSG(SEV_FATAL, "READ-FIFO-FAIL", "Failed to read from input fifo: %s (%d)",
-                        strerror(errnum), errnum);
+    TSL_ASSERT_ARG(NULL != st);
+    TSL_ASSERT_ARG(NULL != coeffs);
+    TSL_ASSERT_ARG(NULL != pshaped);
+
+    *pshaped = NULL;
+
+    if (FAILED(ret = TCALLOC((void **)&shaped, sizeof(int16_t), nr_coeffs))) {
+        goto done;
+    }
+
+    scale = true == st->invert ? -st->gain : st->gain;
+
+    for (size_t i = 0; i < nr_coeffs; i++) {
+        double tap = round((double)coeffs[i] * scale);
+
+        if (tap > INT16_MAX) {
+            tap = INT16_MAX;
+            nr_clipped++;
+        } else if (tap < INT16_MIN) {
+            tap = INT16_MIN;
+            nr_clipped++;
+        }
+
+        shaped[i] = (int16_t)tap;
+    }
+
+    if (0 != nr_clipped) {
+        DEC_MSG(SEV_WARNING, "CLIPPED-TAPS", "[%s] A gain of %f saturates %zu of %zu resampler taps.",
+                st->name, st->gain, nr_clipped, nr_coeffs);
+    }
+
+    *pshaped = shaped;
+
+done:
+    return ret;
+}
+
+/**
+ * Add a resampler to the stream, and create the decoders for each of the protocols that will
+ * consume its output. The pager decoders are told they are fed pager_rate, or assume their
+ * default rates if it is 0.
+ */
+static
+aresult_t _decoder_stream_add_branch(struct decoder_stream *st, unsigned protocols, const int16_t *coeffs,
+        size_t nr_coeffs, unsigned interp, unsigned decim, bool dc_block, double pole, unsigned pager_rate)
+{
+    aresult_t ret = A_OK;
+
+    struct decoder_branch *br = NULL;
+    int16_t *shaped = NULL;
+
+    TSL_ASSERT_ARG(NULL != st);
+    TSL_ASSERT_ARG(0 != protocols);
+    TSL_ASSERT_ARG(NULL != coeffs);
+    TSL_ASSERT_ARG(0 != nr_coeffs);
+
+    if (DECODER_MAX_BRANCHES == st->nr_branches) {
+        DEC_MSG(SEV_ERROR, "TOO-MANY-RESAMPLERS", "[%s] Can have at most %d resamplers per stream.",
+                st->name, DECODER_MAX_BRANCHES);
+        ret = A_E_INVAL;
+        goto done;
+    }
+
+    /*
+     * Every protocol on a branch is fed the same samples, so they all have to run at the same
+     * rate. AIS runs faster than either pager decoder can take, and FLEX and POCSAG only share
+     * a rate if one is set that both can decode at.
+     */
+    if ((protocols & DECODER_PROTO_FLAG(DECODER_PROTO_TYPE_AIS)) &&
+            (protocols & ~DECODER_PROTO_FLAG(DECODER_PROTO_TYPE_AIS)))
+    {
+        DEC_MSG(SEV_ERROR, "PROTOCOL-RATE-MISMATCH", "[%s] AIS can't share a resampler with the pager decoders, "
+                "it runs at a different sample rate.", st->name);
+        ret = A_E_INVAL;
+        goto done;
+    }
+
+    if ((protocols & DECODER_PROTO_FLAG(DECODER_PAGER_TYPE_FLEX)) &&
+            (protocols & DECODER_PROTO_FLAG(DECODER_PAGER_TYPE_POCSAG)) && 0 == pager_rate)
+    {
+        DEC_MSG(SEV_ERROR, "PROTOCOL-RATE-MISMATCH", "[%s] FLEX and POCSAG default to different sample rates. "
+                "Set a pager sample rate both decode at, from 12800 to 16000 Hz, or give each its own resampler.",
+                st->name);
+        ret = A_E_INVAL;
+        goto done;
+    }
+
+    if (0 != st->sample_rate && 0 != pager_rate &&
+            (uint64_t)st->sample_rate * interp != (uint64_t)pager_rate * decim)
+    {
+        DEC_MSG(SEV_WARNING, "PAGER-RATE-MISMATCH", "[%s] Resampling %u Hz by %u/%u doesn't give the pager sample "
+                "rate of %u Hz.", st->name, st->sample_rate, interp, decim, pager_rate);
+    }
+
+    /* Claim the branch up front, so it is cleaned up with the stream if we fail part way */
+    br = &st->branches[st->nr_branches++];
+
+    br->protocols = protocols;
+    br->dc_block = dc_block;
+
+    TSL_BUG_IF_FAILED(dc_blocker_init(&br->blck, pole));
+
+    if (FAILED(ret = _decoder_stream_shape_coeffs(st, coeffs, nr_coeffs, &shaped))) {
+        goto done;
+    }
+
+    /* Create the polyphase resampling filter */
+    if (FAILED(ret = polyphase_fir_new(&br->pfir, nr_coeffs, shaped, interp, decim))) {
+        DEC_MSG(SEV_ERROR, "BAD-RESAMPLER", "[%s] Failed to create %u/%u resampler.", st->name, interp, decim);
+        goto done;
+    }
+
+    if (FAILED(ret = polyphase_fir_set_input_bias(br->pfir, st->bias))) {
+        goto done;
+    }
+
+    /* Set up the requested protocol decoders */
+    if (protocols & DECODER_PROTO_FLAG(DECODER_PAGER_TYPE_FLEX)) {
+        DEC_MSG(SEV_INFO, "PROTOCOL", "[%s] Using the Motorola FLEX pager protocol.", st->name);
+        if (FAILED(ret = pager_flex_new(&br->flex, st->center_freq, _on_flex_alnum_msg, _on_flex_num_msg,
+                        _on_flex_siv_msg)))
+        {
+            goto done;
+        }
+
+        if (FAILED(ret = pager_flex_set_sync_errors(br->flex, _flex_sync_errors))) {
+            DEC_MSG(SEV_ERROR, "BAD-FLEX-SYNC-ERRORS", "[%s] Can't tolerate %d bit errors in the FLEX sync pattern.",
+                    st->name, _flex_sync_errors);
+            goto done;
+        }
+
+        if (0 != pager_rate && FAILED(ret = pager_flex_set_sample_rate(br->flex, pager_rate))) {
+            DEC_MSG(SEV_ERROR, "BAD-FLEX-RATE", "[%s] FLEX can't be decoded at %u Hz, it needs a multiple of "
+                    "1600 Hz, from 12800 to 16000 Hz.", st->name, pager_rate);
+            goto done;
+        }
+    }
+
+    if (protocols & DECODER_PROTO_FLAG(DECODER_PAGER_TYPE_POCSAG)) {
+        DEC_MSG(SEV_INFO, "PROTOCOL", "[%s] Using the POCSAG Pager Protocol.", st->name);
+        if (FAILED(ret = pager_pocsag_new(&br->pocsag, st->center_freq, _on_pocsag_num_msg,
+                        _on_pocsag_alnum_msg)))
+        {
+            goto done;
+        }
+
+        if (0 != pager_rate && FAILED(ret = pager_pocsag_set_sample_rate(br->pocsag, pager_rate))) {
+            DEC_MSG(SEV_ERROR, "BAD-POCSAG-RATE", "[%s] POCSAG can't be decoded at %u Hz, it needs from 9600 to "
+                    "38400 Hz.", st->name, pager_rate);
+            goto done;
+        }
+    }
+
+    if (protocols & DECODER_PROTO_FLAG(DECODER_PROTO_TYPE_AIS)) {
+        DEC_MSG(SEV_INFO, "PROTOCOL", "[%s] Using the AIS Message Format.", st->name);
+        if (NULL == ais_decode && true == nmea_out) {
+            /* Only the packets are needed, so don't bother with any of the fields */
+            if (FAILED(ret = ais_decode_new(&ais_decode, st->center_freq, NULL, NULL, NULL))) {
+                goto done;
+            }
+            TSL_BUG_IF_FAILED(ais_decode_set_on_nmea(ais_decode, _on_ais_nmea, NULL));
+            br->ais_channel = 0;
+        } else if (NULL == ais_decode) {
+            if (FAILED(ret = ais_decode_new(&ais_decode, st->center_freq, _on_ais_position_report,
+                            _on_ais_base_station_report, _on_ais_static_voyage_data)))
+            {
                 goto done;
             }
 
-            TSL_BUG_ON((1 & op_ret) != 0);
+            if (0 != ais_vessel_interval) {
+                struct ais_vessel_table_config vessels = {
+                    .max_vessels = DECODER_AIS_MAX_VESSELS,
+                    .min_distance = DECODER_AIS_MIN_DISTANCE,
+                    .min_course_change = DECODER_AIS_MIN_COURSE_CHANGE,
+                    .max_interval_ms = ais_vessel_interval * 1000ull,
+                    .snapshot_interval_ms = DECODER_AIS_SNAPSHOT_SECS * 1000ull,
+                    .expire_ms = DECODER_AIS_EXPIRE_SECS * 1000ull,
+                };
+
+                DEC_MSG(SEV_INFO, "AIS-RATE-LIMIT", "Writing AIS reports for each vessel at most every %u seconds, "
+                        "unless it moves or turns.", ais_vessel_interval);
+
+                if (FAILED(ret = ais_decode_set_vessel_table(ais_decode, &vessels))) {
+                    goto done;
+                }
+            }
+
+            br->ais_channel = 0;
+        } else if (FAILED(ret = ais_decode_add_channel(ais_decode, st->center_freq, &br->ais_channel))) {
+            goto done;
+        }
 
-            read_buf->nr_samples += op_ret/sizeof(int16_t);
+        br->ais_decode = ais_decode;
+    }
 
-            if (true == _invert) {
-                int16_t *samp = (int16_t *)read_buf->data_buf;
-                for (size_t i = 0; i < read_buf->nr_samples; i++) {
-                    samp[i] *= -1;
-                }
+done:
+    if (NULL != shaped) {
+        TFREE(shaped);
+    }
+
+    if (FAILED(ret) && NULL != br) {
+        DEC_MSG(SEV_ERROR, "BAD-PROTOCOL", "[%s] Failed to set up resampler and protocol decoders.", st->name);
+    }
+
+    return ret;
+}
+
+/**
+ * Hand the filled read buffer to every branch. Each branch holds its own reference.
+ */
+static
+void _decoder_stream_push(struct decoder_stream *st)
+{
+    struct sample_buf *buf = st->read_buf;
+
+    buf->refcount = st->nr_branches;
+
+    for (size_t i = 0; i < st->nr_branches; i++) {
+        TSL_BUG_IF_FAILED(polyphase_fir_push_sample_buf(st->branches[i].pfir, buf));
+    }
+
+    st->read_buf = NULL;
+}
+
+/**
+ * Find out how many of the upcoming resampled samples none of the branch's decoders will look
+ * at. Returns false if any decoder needs every sample.
+ */
+static
+bool _decoder_branch_demand(struct decoder_branch *br, size_t *pnr_skip)
+{
+    bool sparse = false;
+    size_t nr_skip = SIZE_MAX,
+           proto_skip = 0;
+
+    if (NULL != br->flex) {
+        TSL_BUG_IF_FAILED(pager_flex_sample_demand(br->flex, &sparse, &proto_skip));
+        if (false == sparse) {
+            goto done;
+        }
+        nr_skip = BL_MIN2(nr_skip, proto_skip);
+    }
+
+    if (NULL != br->pocsag) {
+        TSL_BUG_IF_FAILED(pager_pocsag_sample_demand(br->pocsag, &sparse, &proto_skip));
+        if (false == sparse) {
+            goto done;
+        }
+        nr_skip = BL_MIN2(nr_skip, proto_skip);
+    }
+
+    if (NULL != br->ais_decode) {
+        TSL_BUG_IF_FAILED(ais_decode_sample_demand(br->ais_decode, br->ais_channel, &sparse, &proto_skip));
+        if (false == sparse) {
+            goto done;
+        }
+        nr_skip = BL_MIN2(nr_skip, proto_skip);
+    }
+
+    *pnr_skip = nr_skip;
+
+done:
+    return sparse;
+}
+
+/**
+ * Once every decoder on a branch is synchronized, each only looks at one sample per symbol. Skip
+ * the resampler over the samples in between, and only compute the ones that are looked at.
+ *
+ * Returns the number of resampled samples the branch advanced by, computed or not.
+ */
+static
+size_t _decoder_branch_process_sparse(struct decoder_stream *st, struct decoder_branch *br)
+{
+    size_t nr_advanced = 0,
+           nr_skip = 0,
+           nr_skipped = 0,
+           new_samples = 0;
+    uint64_t ts = 0;
+
+    while (NR_SAMPLES > nr_advanced && true == _decoder_branch_demand(br, &nr_skip)) {
+        if (0 != nr_skip) {
+            ts = _decoder_bench_ts();
+            TSL_BUG_IF_FAILED(polyphase_fir_skip(br->pfir, BL_MIN2(nr_skip, NR_SAMPLES - nr_advanced), &nr_skipped));
+            st->stats.resample_ns += _decoder_bench_ts() - ts;
+
+            if (0 == nr_skipped) {
+                break;
+            }
+
+            if (NULL != br->flex) {
+                TSL_BUG_IF_FAILED(pager_flex_skip(br->flex, nr_skipped));
+            }
+
+            if (NULL != br->pocsag) {
+                TSL_BUG_IF_FAILED(pager_pocsag_skip(br->pocsag, nr_skipped));
+            }
+
+            if (NULL != br->ais_decode) {
+                TSL_BUG_IF_FAILED(ais_decode_skip(br->ais_decode, br->ais_channel, nr_skipped));
             }
 
-            if (read_buf->nr_samples == NR_SAMPLES) {
-                TSL_BUG_IF_FAILED(polyphase_fir_push_sample_buf(pfir, read_buf));
-                read_buf = NULL;
+            nr_advanced += nr_skipped;
+            st->stats.nr_skipped_samples += nr_skipped;
+
+            if (nr_skipped != nr_skip) {
+                /* Out of input, or we've done enough for now */
+                break;
             }
         }
 
-        /* Filter the samples, decimating as appropriate */
-        TSL_BUG_IF_FAILED(polyphase_fir_process(pfir, output_buf, NR_SAMPLES, &new_samples));
+        /* Compute just the sample that's needed */
+        ts = _decoder_bench_ts();
+        TSL_BUG_IF_FAILED(polyphase_fir_process(br->pfir, br->output_buf, 1, &new_samples));
+        st->stats.resample_ns += _decoder_bench_ts() - ts;
 
         if (0 == new_samples) {
-            /* Skip further sample processing */
-            continue;
+            break;
         }
 
-        /* Apply DC blocker, if asked */
-        if (true == dc_blocker) {
-            TSL_BUG_IF_FAILED(dc_blocker_apply(&blck, output_buf, new_samples));
+        nr_advanced++;
+
+        ts = _decoder_bench_ts();
+        if (NULL != br->flex) {
+            TSL_BUG_IF_FAILED(pager_flex_on_pcm(br->flex, br->output_buf, 1));
         }
 
-        /* Process with the protocol object */
-        if (_decoder_type == DECODER_PAGER_TYPE_FLEX) {
-            TSL_BUG_IF_FAILED(pager_flex_on_pcm(flex, output_buf, new_samples));
-        } else if (_decoder_type == DECODER_PAGER_TYPE_POCSAG) {
-            TSL_BUG_IF_FAILED(pager_pocsag_on_pcm(pocsag, output_buf, new_samples));
-        } else if (_decoder_type == DECODER_PROTO_TYPE_AIS) {
-            TSL_BUG_IF_FAILED(ais_decode_on_pcm(ais_decode, output_buf, new_samples));
-        } else {
-            PANIC("Unknown decoder type, aborting");
+        if (NULL != br->pocsag) {
+            TSL_BUG_IF_FAILED(pager_pocsag_on_pcm(br->pocsag, br->output_buf, 1));
         }
 
-        /* If a sample debug file was specified, write to the sample debug file */
-        if (-1 != sample_debug_fd) {
-            if (0 > write(sample_debug_fd, output_buf, new_samples * sizeof(int16_t))) {
-                int errnum = errno;
-                DEC_MSG(SEV_FATAL, "WRITE-DEBUG-FAIL", "Failed to write to output debug file: %s (%d)",
-                        strerror(errnum), errnum);
+        if (NULL != br->ais_decode) {
+            TSL_BUG_IF_FAILED(ais_decode_on_pcm(br->ais_decode, br->ais_channel, br->output_buf, 1));
+        }
+        st->stats.protocol_ns += _decoder_bench_ts() - ts;
+    }
+
+    st->stats.nr_out_samples += nr_advanced;
+
+    return nr_advanced;
+}
+
+/**
+ * Resample, DC block and decode a block of samples on a single branch.
+ *
+ * \return The number of samples the resampler produced.
+ */
+static
+size_t _decoder_branch_process(struct decoder_stream *st, struct decoder_branch *br)
+{
+    size_t new_samples = 0,
+           nr_skip = 0;
+    uint64_t ts = 0;
+
+    /*
+     * The DC blocker has to see every sample, as does the sample debug file, so only skip
+     * samples if neither is in play.
+     */
+    if (false == br->dc_block && (-1 == st->debug_fd || br != &st->branches[0]) &&
+            true == _decoder_branch_demand(br, &nr_skip))
+    {
+        return _decoder_branch_process_sparse(st, br);
+    }
+
+    /* Filter the samples, decimating as appropriate */
+    ts = _decoder_bench_ts();
+    TSL_BUG_IF_FAILED(polyphase_fir_process(br->pfir, br->output_buf, NR_SAMPLES, &new_samples));
+    st->stats.resample_ns += _decoder_bench_ts() - ts;
+
+    if (0 == new_samples) {
+        goto done;
+    }
+
+    st->stats.nr_out_samples += new_samples;
+
+    /* Apply DC blocker, if asked */
+    if (true == br->dc_block) {
+        ts = _decoder_bench_ts();
+        TSL_BUG_IF_FAILED(dc_blocker_apply(&br->blck, br->output_buf, new_samples));
+        st->stats.dc_block_ns += _decoder_bench_ts() - ts;
+    }
+
+    /* Hand the same samples to each of the protocol objects */
+    ts = _decoder_bench_ts();
+    if (NULL != br->flex) {
+        TSL_BUG_IF_FAILED(pager_flex_on_pcm(br->flex, br->output_buf, new_samples));
+    }
+
+    if (NULL != br->pocsag) {
+        TSL_BUG_IF_FAILED(pager_pocsag_on_pcm(br->pocsag, br->output_buf, new_samples));
+    }
+
+    if (NULL != br->ais_decode) {
+        TSL_BUG_IF_FAILED(ais_decode_on_pcm(br->ais_decode, br->ais_channel, br->output_buf, new_samples));
+    }
+    st->stats.protocol_ns += _decoder_bench_ts() - ts;
+
+    /* If a sample debug file was specified, write to the sample debug file */
+    if (-1 != st->debug_fd && br == &st->branches[0]) {
+        if (0 > write(st->debug_fd, br->output_buf, new_samples * sizeof(int16_t))) {
+            int errnum = errno;
+            DEC_MSG(SEV_FATAL, "WRITE-DEBUG-FAIL", "Failed to write to output debug file: %s (%d)",
+                    strerror(errnum), errnum);
+        }
+    }
+
+done:
+    return new_samples;
+}
+
+/**
+ * Run one pass of a stream's processing chain: top up the resamplers from the input if they
+ * have room, then resample, DC block and decode a block of samples on each branch.
+ *
+ * \return A_OK if any work was done, A_E_BUSY if the input had nothing for us (i.e. a
+ *         non-blocking read would have blocked) and there was nothing left to process,
+ *         A_E_DONE once the end of the input was reached and the resamplers are drained, or
+ *         an error code.
+ */
+static
+aresult_t _decoder_stream_step(struct decoder_stream *st)
+{
+    aresult_t ret = A_OK;
+
+    ssize_t op_ret = 0;
+    size_t new_samples = 0;
+    bool full = false,
+         read_data = false;
+    uint64_t ts = 0;
+
+    TSL_ASSERT_ARG(NULL != st);
+
+    /* Only read when every resampler can take another buffer */
+    for (size_t i = 0; i < st->nr_branches && false == full; i++) {
+        TSL_BUG_IF_FAILED(polyphase_fir_full(st->branches[i].pfir, &full));
+    }
+
+    if (false == full && false == st->eof) {
+        size_t nr_sample_bytes = 0;
+
+        if (NULL == st->read_buf) {
+            /* Allocate a new buffer */
+            TSL_BUG_IF_FAILED(_alloc_sample_buf(&st->read_buf));
+        }
+
+        nr_sample_bytes = st->read_buf->nr_samples * sizeof(int16_t);
+
+        ts = _decoder_bench_ts();
+        op_ret = read(st->fd, (uint8_t *)st->read_buf->data_buf + nr_sample_bytes,
+                st->read_buf->sample_buf_bytes - nr_sample_bytes);
+        st->stats.read_ns += _decoder_bench_ts() - ts;
+
+        if (0 == op_ret && true == st->drain_on_eof) {
+            /* End of the input: flush what we have, and drain the resamplers */
+            DEC_MSG(SEV_INFO, "END-OF-INPUT", "[%s] Reached the end of the input.", st->name);
+            st->eof = true;
+            if (0 != st->read_buf->nr_samples) {
+                _decoder_stream_push(st);
+            } else {
+                TSL_BUG_IF_FAILED(sample_buf_decref(st->read_buf));
+                st->read_buf = NULL;
             }
+        } else if (0 > op_ret && (EAGAIN == errno || EWOULDBLOCK == errno)) {
+            /* Nothing to read right now, process what the resamplers have on hand */
+        } else if (0 >= op_ret) {
+            int errnum = errno;
+            ret = A_E_INVAL;
+            DEC_MSG(SEV_FATAL, "READ-FIFO-FAIL", "[%s] Failed to read from input fifo: %s (%d)",
+                    st->name, strerror(errnum), errnum);
+            goto done;
+        } else {
+            TSL_BUG_ON((1 & op_ret) != 0);
+
+            read_data = true;
+
+            st->read_buf->nr_samples += op_ret/sizeof(int16_t);
+            st->stats.nr_in_samples += op_ret/sizeof(int16_t);
+
+            if (st->read_buf->nr_samples == NR_SAMPLES) {
+                _decoder_stream_push(st);
+            }
+        }
+    }
+
+    for (size_t i = 0; i < st->nr_branches; i++) {
+        new_samples += _decoder_branch_process(st, &st->branches[i]);
+    }
+
+    if (0 == new_samples) {
+        if (true == st->eof) {
+            /* Nothing left to process */
+            ret = A_E_DONE;
+        } else if (false == read_data) {
+            ret = A_E_BUSY;
         }
+    }
+
+done:
+    return ret;
+}
+
+/**
+ * Process a single, blocking input stream until it ends or we're asked to terminate.
+ */
+static
+aresult_t process_samples(struct decoder_stream *st)
+{
+    aresult_t ret = A_OK;
+
+    do {
+        ret = _decoder_stream_step(st);
 
-        /* Release the sample buffer */
+        if (A_E_DONE == ret) {
+            ret = A_OK;
+            break;
+        } else if (A_E_BUSY == ret) {
+            ret = A_OK;
+        } else if (FAILED(ret)) {
+            goto done;
+        }
     } while (app_running());
 
 done:
     return ret;
 }
 
+/**
+ * Stream pool handler: process what the input has for us right now, up to
+ * DECODER_STREAM_STEPS_PER_WAKEUP buffers. A stream with a backlog is handed back to epoll,
+ * which calls us again, so it can't starve the other streams on its worker.
+ */
+static
+aresult_t _decoder_stream_on_readable(void *state)
+{
+    aresult_t ret = A_OK;
+
+    struct decoder_stream *st = state;
+
+    TSL_BUG_ON(NULL == st);
+
+    for (size_t i = 0; i < DECODER_STREAM_STEPS_PER_WAKEUP && A_OK == ret && app_running(); i++) {
+        ret = _decoder_stream_step(st);
+    }
+
+    if (A_E_BUSY == ret) {
+        ret = A_OK;
+    }
+
+    return ret;
+}
+
+/**
+ * Resampler and protocol settings for a stream, as read from the configuration. Decoders with
+ * identical resampler settings are merged, and share a branch.
+ */
+struct decoder_branch_config {
+    unsigned protocols;
+    const char *filter_file;
+    int interp;
+    int decim;
+    bool dc_block;
+    double pole;
+    int pager_rate;
+};
+
+static
+aresult_t _decoder_load_branch_config(struct decoder_branch_config *bcfg, struct config *cfg, size_t id)
+{
+    aresult_t ret = A_OK;
+
+    const char *proto = NULL;
+
+    TSL_ASSERT_ARG(NULL != bcfg);
+    TSL_ASSERT_ARG(NULL != cfg);
+
+    if (FAILED(ret = config_get_string(cfg, &proto, "protocol"))) {
+        DEC_MSG(SEV_ERROR, "MISSING-PROTOCOL", "Stream %zu needs a 'protocol'.", id);
+        goto done;
+    }
+
+    if (FAILED(ret = _decoder_parse_protocols(proto, &bcfg->protocols))) {
+        goto done;
+    }
+
+    if (FAILED(ret = config_get_string(cfg, &bcfg->filter_file, "filterFile"))) {
+        DEC_MSG(SEV_ERROR, "BAD-FILTER-FILE", "Stream %zu needs a resampler 'filterFile'.", id);
+        goto done;
+    }
+
+    /* 0 means take the resampling factors from the filter file */
+    if (FAILED(config_get_integer(cfg, &bcfg->interp, "interpolate"))) {
+        bcfg->interp = 0;
+    }
+
+    if (FAILED(config_get_integer(cfg, &bcfg->decim, "decimate"))) {
+        bcfg->decim = 0;
+    }
+
+    if (FAILED(config_get_boolean(cfg, &bcfg->dc_block, "dcBlock"))) {
+        bcfg->dc_block = false;
+    }
+
+    if (FAILED(config_get_float(cfg, &bcfg->pole, "dcBlockPole"))) {
+        bcfg->pole = 0.9999;
+    }
+
+    /* 0 means the pager decoders assume their default rates */
+    if (FAILED(config_get_integer(cfg, &bcfg->pager_rate, "pagerSampleRate"))) {
+        bcfg->pager_rate = 0;
+    }
+
+    if (0 > bcfg->pager_rate) {
+        DEC_MSG(SEV_ERROR, "BAD-PAGER-RATE", "Stream %zu has a negative 'pagerSampleRate'.", id);
+        ret = A_E_INVAL;
+        goto done;
+    }
+
+done:
+    return ret;
+}
+
+static
+aresult_t _decoder_stream_add_branch_config(struct decoder_stream *st, struct decoder_branch_config *bcfg,
+        size_t id)
+{
+    aresult_t ret = A_OK;
+
+    int16_t *coeffs = NULL;
+    size_t nr_coeffs = 0;
+    int interp = 1,
+        decim = 1;
+
+    if (FAILED(ret = _decoder_load_filter(bcfg->filter_file, &coeffs, &nr_coeffs, &interp, &decim))) {
+        goto done;
+    }
+
+    /* The stream can override the filter file's resampling factors */
+    if (0 != bcfg->interp) {
+        interp = bcfg->interp;
+    }
+
+    if (0 != bcfg->decim) {
+        decim = bcfg->decim;
+    }
+
+    if (0 >= interp || 0 >= decim) {
+        DEC_MSG(SEV_ERROR, "BAD-RESAMPLING", "Stream %zu: resampling factors must be positive (got %d/%d).",
+                id, interp, decim);
+        ret = A_E_INVAL;
+        goto done;
+    }
+
+    if (FAILED(ret = _decoder_stream_add_branch(st, bcfg->protocols, coeffs, nr_coeffs, interp, decim,
+                    bcfg->dc_block, bcfg->pole, bcfg->pager_rate)))
+    {
+        goto done;
+    }
+
+    DEC_MSG(SEV_INFO, "STREAM", "[%zu]: %s -> %4.5f MHz, resampling %d/%d%s", id, st->name,
+            (double)st->center_freq/1e6, interp, decim, bcfg->dc_block ? ", DC blocked" : "");
+
+done:
+    if (NULL != coeffs) {
+        TFREE(coeffs);
+    }
+
+    return ret;
+}
+
+/**
+ * Set up a stream from its stanza in the streams configuration file. A stream either has a
+ * single resampler, described in the stanza itself, or a list of 'decoders', each with its own
+ * resampler settings. Decoders that share settings share a resampler.
+ */
+static
+aresult_t _decoder_load_stream(struct decoder_stream **pst, struct config *stream, size_t id)
+{
+    aresult_t ret = A_OK;
+
+    const char *input = NULL;
+    int freq = 0,
+        sample_rate = 0,
+        fd = -1;
+    bool invert = false;
+    double gain = 1.0;
+    int bias = 0;
+    struct config decoders = CONFIG_INIT_EMPTY,
+                  decoder = CONFIG_INIT_EMPTY;
+    struct decoder_branch_config bcfgs[DECODER_MAX_BRANCHES];
+    size_t nr_bcfgs = 0,
+           arr_ctr = 0;
+    unsigned all_protocols = 0;
+    struct decoder_stream *st = NULL;
+    struct stat sbuf;
+
+    TSL_ASSERT_ARG(NULL != pst);
+    TSL_ASSERT_ARG(NULL != stream);
+
+    *pst = NULL;
+
+    if (FAILED(ret = config_get_string(stream, &input, "input"))) {
+        DEC_MSG(SEV_ERROR, "MISSING-INPUT", "Stream %zu is missing its 'input'.", id);
+        goto done;
+    }
+
+    if (FAILED(ret = config_get_integer(stream, &freq, "chanCenterFreq")) || 0 >= freq) {
+        DEC_MSG(SEV_ERROR, "BAD-PAGER-FREQ", "Stream %zu needs a positive 'chanCenterFreq'.", id);
+        ret = A_E_INVAL;
+        goto done;
+    }
+
+    if (FAILED(config_get_boolean(stream, &invert, "invert"))) {
+        invert = false;
+    }
+
+    if (FAILED(config_get_float(stream, &gain, "gain"))) {
+        gain = 1.0;
+    }
+
+    if (FAILED(config_get_integer(stream, &bias, "dcBias"))) {
+        bias = 0;
+    }
+
+    if (INT16_MIN > bias || INT16_MAX < bias) {
+        DEC_MSG(SEV_ERROR, "BAD-BIAS", "Stream %zu has a 'dcBias' out of range.", id);
+        ret = A_E_INVAL;
+        goto done;
+    }
+
+    /* Only used to check the resampling against the pager sample rate */
+    if (FAILED(config_get_integer(stream, &sample_rate, "sampleRate"))) {
+        sample_rate = 0;
+    }
+
+    if (0 > sample_rate) {
+        DEC_MSG(SEV_ERROR, "BAD-SAMPLE-RATE", "Stream %zu has a negative 'sampleRate'.", id);
+        ret = A_E_INVAL;
+        goto done;
+    }
+
+    if (0.0 >= gain) {
+        DEC_MSG(SEV_ERROR, "BAD-GAIN", "Stream %zu has a non-positive 'gain', use 'invert' to flip the input.", id);
+        ret = A_E_INVAL;
+        goto done;
+    }
+
+    if (FAILED(config_get(stream, &decoders, "decoders"))) {
+        /* Just the one resampler */
+        if (FAILED(ret = _decoder_load_branch_config(&bcfgs[0], stream, id))) {
+            goto done;
+        }
+        nr_bcfgs = 1;
+    } else {
+        CONFIG_ARRAY_FOR_EACH(decoder, &decoders, ret, arr_ctr) {
+            struct decoder_branch_config bcfg;
+            size_t i = 0;
+
+            if (FAILED(ret = _decoder_load_branch_config(&bcfg, &decoder, id))) {
+                goto done;
+            }
+
+            if (0 != (all_protocols & bcfg.protocols)) {
+                DEC_MSG(SEV_ERROR, "DUPLICATE-PROTOCOL", "Stream %zu decodes the same protocol more than once.", id);
+                ret = A_E_INVAL;
+                goto done;
+            }
+
+            all_protocols |= bcfg.protocols;
+
+            /* Find a resampler with the same settings to share */
+            for (i = 0; i < nr_bcfgs; i++) {
+                if (!strcmp(bcfgs[i].filter_file, bcfg.filter_file) && bcfgs[i].interp == bcfg.interp &&
+                        bcfgs[i].decim == bcfg.decim && bcfgs[i].dc_block == bcfg.dc_block &&
+                        bcfgs[i].pole == bcfg.pole && bcfgs[i].pager_rate == bcfg.pager_rate)
+                {
+                    break;
+                }
+            }
+
+            if (i == nr_bcfgs) {
+                /* There are fewer protocols than branches, so this can't overflow */
+                bcfgs[nr_bcfgs++] = bcfg;
+            } else {
+                bcfgs[i].protocols |= bcfg.protocols;
+            }
+        }
+
+        if (0 == nr_bcfgs) {
+            DEC_MSG(SEV_ERROR, "MISSING-DECODERS", "Stream %zu has an empty list of 'decoders'.", id);
+            ret = A_E_INVAL;
+            goto done;
+        }
+
+        ret = A_OK;
+    }
+
+    /*
+     * Open the input for reading and writing, so that a FIFO never reports end-of-file when the
+     * process feeding it restarts. The pool needs non-blocking inputs.
+     */
+    if (0 > (fd = open(input, O_RDWR | O_NONBLOCK))) {
+        int errnum = errno;
+        DEC_MSG(SEV_ERROR, "BAD-INPUT", "Bad input - cannot open %s: %s (%d)", input, strerror(errnum), errnum);
+        ret = A_E_INVAL;
+        goto done;
+    }
+
+    /* The pool waits on its inputs with epoll, which can't poll a regular file */
+    if (0 != fstat(fd, &sbuf) || !S_ISFIFO(sbuf.st_mode)) {
+        DEC_MSG(SEV_ERROR, "BAD-INPUT-TYPE", "Bad input - %s is not a FIFO. Decode recordings one at a time, "
+                "without a streams file.", input);
+        ret = A_E_INVAL;
+        goto done;
+    }
+
+    if (FAILED(ret = _decoder_stream_new(&st, input, fd, freq))) {
+        goto done;
+    }
+
+    st->invert = invert;
+    st->gain = gain;
+    st->bias = bias;
+    st->sample_rate = sample_rate;
+
+    for (size_t i = 0; i < nr_bcfgs; i++) {
+        if (FAILED(ret = _decoder_stream_add_branch_config(st, &bcfgs[i], id))) {
+            goto done;
+        }
+    }
+
+    *pst = st;
+
+done:
+    if (FAILED(ret)) {
+        if (NULL != st) {
+            _decoder_stream_delete(&st);
+        }
+
+        if (-1 != fd) {
+            close(fd);
+        }
+    }
+
+    return ret;
+}
+
+/**
+ * Decode all the streams described in the streams configuration file, with a pool of worker
+ * threads. Each stream is pinned to one worker, and each worker waits on its streams with
+ * epoll, so a handful of threads can service any number of inputs.
+ *
+ * The inputs are FIFOs, held open for writing too, so they never reach end-of-file. This runs
+ * until we're signalled to stop, or a stream fails.
+ */
+static
+aresult_t _decoder_run_streams(void)
+{
+    aresult_t ret = A_OK;
+
+    struct config *cfg CAL_CLEANUP(config_delete) = NULL;
+    struct config streams_cfg = CONFIG_INIT_EMPTY,
+                  stream_cfg = CONFIG_INIT_EMPTY;
+    struct decoder_stream **streams = NULL;
+    struct stream_pool *pool = NULL;
+    size_t nr_streams = 0,
+           arr_ctr = 0;
+    int nr_workers = 1;
+
+    TSL_BUG_IF_FAILED(config_new(&cfg));
+
+    if (FAILED(ret = config_add(cfg, streams_file))) {
+        DEC_MSG(SEV_ERROR, "BAD-CONFIG", "Streams configuration file '%s' cannot be processed.", streams_file);
+        goto done;
+    }
+
+    if (FAILED(config_get_integer(cfg, &nr_workers, "workers"))) {
+        nr_workers = 1;
+    }
+
+    /* Otherwise, keep what was set on the command line */
+    config_get_integer(cfg, &_flex_sync_errors, "flexSyncErrors");
+
+    if (0 >= nr_workers) {
+        DEC_MSG(SEV_ERROR, "BAD-WORKERS", "Need at least one worker thread (got %d).", nr_workers);
+        ret = A_E_INVAL;
+        goto done;
+    }
+
+    if (FAILED(ret = config_get(cfg, &streams_cfg, "streams"))) {
+        DEC_MSG(SEV_ERROR, "MISSING-STREAMS", "Need to specify at least one stream to decode.");
+        goto done;
+    }
+
+    /* Count the streams, so we can keep track of them */
+    CONFIG_ARRAY_FOR_EACH(stream_cfg, &streams_cfg, ret, arr_ctr) {
+        nr_streams++;
+    }
+
+    if (0 == nr_streams) {
+        DEC_MSG(SEV_ERROR, "MISSING-STREAMS", "Need to specify at least one stream to decode.");
+        ret = A_E_INVAL;
+        goto done;
+    }
+
+    if (FAILED(ret = TCALLOC((void **)&streams, sizeof(struct decoder_stream *), nr_streams))) {
+        goto done;
+    }
+
+    if (FAILED(ret = stream_pool_new(&pool, nr_workers))) {
+        goto done;
+    }
+
+    for (size_t i = 0; i < nr_streams; i++) {
+        TSL_BUG_IF_FAILED(config_array_at(&streams_cfg, &stream_cfg, i));
+
+        if (FAILED(ret = _decoder_load_stream(&streams[i], &stream_cfg, i))) {
+            goto done;
+        }
+
+        if (FAILED(ret = stream_pool_add(pool, streams[i]->fd, _decoder_stream_on_readable, streams[i]))) {
+            goto done;
+        }
+    }
+
+    DEC_MSG(SEV_INFO, "STARTING", "Decoding %zu streams with %d worker threads.", nr_streams, nr_workers);
+
+    if (FAILED(ret = stream_pool_start(pool))) {
+        DEC_MSG(SEV_FATAL, "POOL-START-FAIL", "Failed to start worker threads, aborting.");
+        goto done;
+    }
+
+    while (app_running() && false == stream_pool_failed(pool)) {
+        sleep(1);
+    }
+
+    if (true == stream_pool_failed(pool)) {
+        DEC_MSG(SEV_FATAL, "STREAM-POOL-FAIL", "A stream failed, stopping all streams.");
+        ret = A_E_INVAL;
+        goto done;
+    }
+
+done:
+    /* Stop the workers before tearing down the streams they're using */
+    if (NULL != pool) {
+        stream_pool_delete(&pool);
+    }
+
+    if (NULL != streams) {
+        for (size_t i = 0; i < nr_streams; i++) {
+            if (NULL != streams[i]) {
+                close(streams[i]->fd);
+                _decoder_stream_delete(&streams[i]);
+            }
+        }
+        TFREE(streams);
+    }
+
+    return ret;
+}
+
+static
+void _decoder_bench_report(const struct decoder_stream *st, uint64_t wall_ns)
+{
+    const struct decoder_bench_stats *stats = &st->stats;
+    double wall_sec = (double)wall_ns / 1e9,
+           in_sec = 0 != input_sample_rate ? (double)stats->nr_in_samples / (double)input_sample_rate : 0.0;
+    uint64_t other_ns = wall_ns - BL_MIN2(wall_ns, stats->read_ns + stats->resample_ns +
+            stats->dc_block_ns + stats->protocol_ns);
+
+    DEC_MSG(SEV_INFO, "BENCHMARK", "Processed %zu samples (%f seconds at %u Hz) in %f seconds: %f samples/sec, %f times real time",
+            stats->nr_in_samples, in_sec, input_sample_rate, wall_sec,
+            (double)stats->nr_in_samples / wall_sec, in_sec / wall_sec);
+    DEC_MSG(SEV_INFO, "BENCHMARK", "Resampler output %zu samples (%f samples/sec), %zu (%5.1f%%) skipped without being computed",
+            stats->nr_out_samples, (double)stats->nr_out_samples / wall_sec, stats->nr_skipped_samples,
+            0 != stats->nr_out_samples ? 100.0 * (double)stats->nr_skipped_samples / (double)stats->nr_out_samples : 0.0);
+    DEC_MSG(SEV_INFO, "BENCHMARK", "    Read:       %10.6f s (%5.1f%%)", (double)stats->read_ns / 1e9,
+            100.0 * (double)stats->read_ns / (double)wall_ns);
+    DEC_MSG(SEV_INFO, "BENCHMARK", "    Resampler:  %10.6f s (%5.1f%%)", (double)stats->resample_ns / 1e9,
+            100.0 * (double)stats->resample_ns / (double)wall_ns);
+    DEC_MSG(SEV_INFO, "BENCHMARK", "    DC Blocker: %10.6f s (%5.1f%%)", (double)stats->dc_block_ns / 1e9,
+            100.0 * (double)stats->dc_block_ns / (double)wall_ns);
+    DEC_MSG(SEV_INFO, "BENCHMARK", "    Protocol:   %10.6f s (%5.1f%%)", (double)stats->protocol_ns / 1e9,
+            100.0 * (double)stats->protocol_ns / (double)wall_ns);
+    DEC_MSG(SEV_INFO, "BENCHMARK", "    Other:      %10.6f s (%5.1f%%)", (double)other_ns / 1e9,
+            100.0 * (double)other_ns / (double)wall_ns);
+    DEC_MSG(SEV_INFO, "BENCHMARK", "Decoded %zu messages: %zu alphanumeric, %zu numeric, %zu other",
+            bench_stats.nr_alnum_msgs + bench_stats.nr_numeric_msgs + bench_stats.nr_other_msgs,
+            bench_stats.nr_alnum_msgs, bench_stats.nr_numeric_msgs, bench_stats.nr_other_msgs);
+}
+
 int main(int argc, char * const argv[])
 {
     int ret = EXIT_FAILURE;
+    uint64_t start_ns = 0;
+    struct decoder_stream *stream = NULL;
 
     TSL_BUG_IF_FAILED(app_init("resampler", NULL));
     TSL_BUG_IF_FAILED(app_sigint_catch(NULL));
 
     _set_options(argc, argv);
 
-    /* Create the polyphase resampling filter */
-    TSL_BUG_IF_FAILED(polyphase_fir_new(&pfir, nr_filter_coeffs, filter_coeffs, interpolate, decimate));
+    if (FAILED(msg_sink_new(&sink, fileno(out_file), DECODER_SINK_FLUSH_BYTES, DECODER_SINK_FLUSH_MS))) {
+        DEC_MSG(SEV_FATAL, "SINK-FAILED", "Failed to set up the message output, aborting.");
+        goto done;
+    }
+
+    if (true == binary_out) {
+        _decoder_put_file_hdr();
+    }
+
+    if (0 != page_dedup_secs) {
+        DEC_MSG(SEV_INFO, "PAGE-DEDUP", "Writing pages repeated within %u seconds only once.", page_dedup_secs);
+        if (FAILED(page_dedup_new(&page_dedup, DECODER_PAGE_DEDUP_CAPCODES, page_dedup_secs * 1000ull))) {
+            DEC_MSG(SEV_FATAL, "PAGE-DEDUP-FAILED", "Failed to set up the page dedup cache, aborting.");
+            goto done;
+        }
+    }
+
+    if (NULL != streams_file) {
+        if (FAILED(_decoder_run_streams())) {
+            DEC_MSG(SEV_FATAL, "STREAMS-FAILED", "Failed while decoding streams, aborting.");
+            goto done;
+        }
+
+        ret = EXIT_SUCCESS;
+        goto done;
+    }
 
-    /* Set up the appropriate protocol decoder */
-    if (_decoder_type == DECODER_PAGER_TYPE_FLEX) {
-        DEC_MSG(SEV_INFO, "PROTOCOL", "Using the Motorola FLEX pager protocol.");
-        TSL_BUG_IF_FAILED(pager_flex_new(&flex, center_freq, _on_flex_alnum_msg, _on_flex_num_msg, _on_flex_siv_msg));
-    } else if (_decoder_type == DECODER_PAGER_TYPE_POCSAG) {
-        DEC_MSG(SEV_INFO, "PROTOCOL", "Using the POCSAG Pager Protocol.");
-        TSL_BUG_IF_FAILED(pager_pocsag_new(&pocsag, center_freq, _on_pocsag_num_msg, _on_pocsag_alnum_msg));
-    } else if (_decoder_type == DECODER_PROTO_TYPE_AIS) {
-        DEC_MSG(SEV_INFO, "PROTOCOL", "Using the AIS Message Format.");
-        TSL_BUG_IF_FAILED(ais_decode_new(&ais_decode, center_freq, _on_ais_position_report, _on_ais_base_station_report, _on_ais_static_voyage_data));
+    TSL_BUG_IF_FAILED(_decoder_stream_new(&stream, argv[optind], in_fifo, center_freq));
+
+    stream->invert = _invert;
+    stream->gain = _gain;
+    stream->bias = _bias;
+    stream->sample_rate = input_sample_rate;
+
+    /* All the protocols share the one resampler */
+    if (FAILED(_decoder_stream_add_branch(stream, _decoder_protocols, filter_coeffs, nr_filter_coeffs,
+                    interpolate, decimate, dc_blocker, dc_block_pole, pager_sample_rate)))
+    {
+        DEC_MSG(SEV_FATAL, "STREAM-FAILED", "Failed to set up the decoder, aborting.");
+        goto done;
     }
 
+    stream->drain_on_eof = benchmark;
+    stream->debug_fd = sample_debug_fd;
+
     DEC_MSG(SEV_INFO, "STARTING", "Starting message decoder on frequency %u Hz.", center_freq);
 
-    if (FAILED(process_samples())) {
+    start_ns = tsl_get_clock_monotonic();
+
+    if (FAILED(process_samples(stream))) {
         DEC_MSG(SEV_FATAL, "FIR-FAILED", "Failed during message processing, aborting.");
         goto done;
     }
 
+    if (true == benchmark) {
+        _decoder_bench_report(stream, tsl_get_clock_monotonic() - start_ns);
+    }
+
     ret = EXIT_SUCCESS;
 
 done:
-    if (NULL != out_file && stdout != out_file) {
-        fclose(out_file);
+    /* Write out any messages that are still buffered */
+    if (NULL != sink) {
+        msg_sink_delete(&sink);
     }
 
-    if (NULL != flex) {
-        pager_flex_delete(&flex);
+    if (NULL != out_file && stdout != out_file) {
+        fclose(out_file);
     }
 
-    if (NULL != pocsag) {
-        pager_pocsag_delete(&pocsag);
+    if (NULL != stream) {
+        _decoder_stream_delete(&stream);
     }
 
     if (NULL != ais_decode) {
+        DEC_MSG(SEV_INFO, "AIS-DUPLICATES", "Dropped %" PRIu64 " duplicate AIS packets.",
+                ais_decode_nr_duplicates(ais_decode));
+        if (NULL != ais_decode_vessel_table(ais_decode)) {
+            size_t nr_vessels = 0;
+            uint64_t nr_suppressed = 0;
+            ais_vessel_table_stats(ais_decode_vessel_table(ais_decode), &nr_vessels, &nr_suppressed);
+            DEC_MSG(SEV_INFO, "AIS-VESSELS", "Tracking %zu vessels, suppressed %" PRIu64 " AIS reports.",
+                    nr_vessels, nr_suppressed);
+        }
         ais_decode_delete(&ais_decode);
     }
 
-    if (NULL != pfir) {
-        polyphase_fir_delete(&pfir);
+    if (NULL != page_dedup) {
+        struct page_dedup_stats stats;
+        page_dedup_get_stats(page_dedup, &stats);
+        DEC_MSG(SEV_INFO, "PAGE-DUPLICATES", "Dropped %" PRIu64 " duplicate pages, wrote %" PRIu64
+                " (%" PRIu64 " capcodes and %" PRIu64 " pages evicted early).", stats.nr_duplicates,
+                stats.nr_unique, stats.nr_capcode_evictions, stats.nr_page_evictions);
+        page_dedup_delete(&page_dedup);
+    }
+
+    if (NULL != filter_coeffs) {
+        TFREE(filter_coeffs);
     }
 
     return ret;
 }
-
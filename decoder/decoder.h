@@ -0,0 +1,5 @@
+#pragma once
+
+#include <tsl/diag.h>
+
+#define DEC_MSG(sev, sys, msg, ...) MESSAGE("DECODER", sev, sys, msg, ##__VA_ARGS__)
@@ -0,0 +1,270 @@
+/*
+ *  msg_record.c - Compact binary records for decoded messages
+ *
+ *  Copyright (c)2017 Phil Vachon <phil@security-embedded.com>
+ *
+ *  This file is a part of The Standard Library (TSL)
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ */
+#include <decoder/msg_record.h>
+#include <decoder/msg_sink.h>
+
+#include <pager/pager_flex.h>
+
+#include <ais/ais_decode.h>
+
+#include <tsl/errors.h>
+#include <tsl/assert.h>
+
+#include <inttypes.h>
+#include <string.h>
+
+static const
+char _msg_record_phase_id[] = {
+    [0] = 'A',
+    [1] = 'B',
+    [2] = 'C',
+    [3] = 'D',
+};
+
+/**
+ * Size of the typed fields for each record type. Records whose fields don't match are rejected.
+ */
+static const
+size_t _msg_record_fields_len[] = {
+    [MSG_RECORD_TYPE_ALPHANUMERIC] = 0,
+    [MSG_RECORD_TYPE_NUMERIC] = 0,
+    [MSG_RECORD_TYPE_FLEX_SIV] = sizeof(struct msg_record_flex_siv),
+    [MSG_RECORD_TYPE_AIS_POSITION_REPORT] = sizeof(struct msg_record_ais_position_report),
+    [MSG_RECORD_TYPE_AIS_BASE_STATION_REPORT] = sizeof(struct msg_record_ais_base_station_report),
+    [MSG_RECORD_TYPE_AIS_STATIC_VOYAGE_DATA] = sizeof(struct msg_record_ais_static_voyage_data),
+};
+
+aresult_t msg_record_put_file_hdr(struct msg_sink *sink)
+{
+    aresult_t ret = A_OK;
+
+    struct msg_record_file_hdr *fhdr = NULL;
+
+    TSL_ASSERT_ARG(NULL != sink);
+
+    if (NULL == (fhdr = msg_sink_reserve(sink, sizeof(*fhdr)))) {
+        ret = A_E_NOMEM;
+        goto done;
+    }
+
+    memcpy(fhdr->magic, MSG_RECORD_FILE_MAGIC, sizeof(fhdr->magic));
+    fhdr->version = MSG_RECORD_VERSION;
+    fhdr->hdr_bytes = sizeof(struct msg_record_hdr);
+
+done:
+    return ret;
+}
+
+aresult_t msg_record_put(struct msg_sink *sink, const struct msg_record_hdr *hdr, const void *fields,
+        const char *payload)
+{
+    aresult_t ret = A_OK;
+
+    size_t body_len = 0,
+           rec_len = 0;
+    uint8_t *rec = NULL;
+
+    TSL_ASSERT_ARG(NULL != sink);
+    TSL_ASSERT_ARG(NULL != hdr);
+    TSL_ASSERT_ARG(0 == hdr->fields_len || NULL != fields);
+    TSL_ASSERT_ARG(0 == hdr->payload_len || NULL != payload);
+
+    body_len = sizeof(*hdr) + hdr->fields_len + hdr->payload_len;
+    rec_len = MSG_RECORD_LEN(hdr->fields_len, hdr->payload_len);
+
+    if (NULL == (rec = msg_sink_reserve(sink, rec_len))) {
+        ret = A_E_NOMEM;
+        goto done;
+    }
+
+    memcpy(rec, hdr, sizeof(*hdr));
+    ((struct msg_record_hdr *)rec)->len = rec_len;
+    memcpy(rec + sizeof(*hdr), fields, hdr->fields_len);
+    memcpy(rec + sizeof(*hdr) + hdr->fields_len, payload, hdr->payload_len);
+    memset(rec + body_len, 0, rec_len - body_len);
+
+done:
+    return ret;
+}
+
+static
+void _msg_record_put_pager_json(struct msg_sink *sink, const struct msg_record_hdr *hdr, const void *fields,
+        const char *payload)
+{
+    const char *ts = msg_sink_timestamp(sink, hdr->timestamp_ns / 1000000000ull);
+    const char *type = MSG_RECORD_TYPE_ALPHANUMERIC == hdr->type ? "alphanumeric" : "numeric";
+
+    if (MSG_RECORD_PROTO_POCSAG == hdr->proto) {
+        msg_sink_printf(sink, "{\"proto\":\"pocsag\",\"type\":\"%s\",\"timestamp\":\"%s\","
+                "\"baud\":%i,\"capCode\":%u,\"function\":%u,\"message\":\"",
+                type, ts, hdr->baud, (unsigned)hdr->address, (unsigned)hdr->function);
+    } else if (MSG_RECORD_TYPE_FLEX_SIV == hdr->type) {
+        const struct msg_record_flex_siv *siv = fields;
+
+        /* Only temporary address activations are reported */
+        if (PAGER_FLEX_SIV_TEMP_ADDRESS_ACTIVATION == siv->siv_type) {
+            msg_sink_printf(sink, "{\"proto\":\"flex\",\"type\":\"tempAddrActivation\",\"timestamp\":\"%s\","
+                    "\"baud\":%i,\"syncLevel\":%i,\"frameNo\":%u,\"cycleNo\":%u,\"phaseNo\":\"%c\",\"capCode\":%" PRIu64 ","
+                    "\"startFrameNo\":%u,\"tempAddressId\":%u}\n",
+                    ts, hdr->baud, 0, hdr->frame_no, hdr->cycle_no, _msg_record_phase_id[hdr->phase & 3],
+                    hdr->address, siv->data & 0x7f, (siv->data >> 7) & 0xf);
+        }
+        return;
+    } else if (MSG_RECORD_TYPE_ALPHANUMERIC == hdr->type) {
+        msg_sink_printf(sink, "{\"proto\":\"flex\",\"type\":\"alphanumeric\",\"timestamp\":\"%s\","
+                "\"baud\":%i,\"syncLevel\":%i,\"frameNo\":%u,\"cycleNo\":%u,\"phaseNo\":\"%c\",\"capCode\":%" PRIu64 ","
+                "\"fragment\":%s,\"maildrop\":%s,\"fragSeq\":%u,\"message\":\"",
+                ts, hdr->baud, 0, hdr->frame_no, hdr->cycle_no, _msg_record_phase_id[hdr->phase & 3], hdr->address,
+                hdr->flags & MSG_RECORD_FLAG_FRAGMENTED ? "true" : "false",
+                hdr->flags & MSG_RECORD_FLAG_MAILDROP ? "true" : "false", hdr->frag_seq);
+    } else {
+        msg_sink_printf(sink, "{\"proto\":\"flex\",\"type\":\"numeric\",\"timestamp\":\"%s\","
+                "\"baud\":%i,\"syncLevel\":%i,\"frameNo\":%u,\"cycleNo\":%u,\"phaseNo\":\"%c\",\"capCode\":%" PRIu64 ","
+                "\"message\":\"",
+                ts, hdr->baud, 0, hdr->frame_no, hdr->cycle_no, _msg_record_phase_id[hdr->phase & 3], hdr->address);
+    }
+
+    msg_sink_put_escaped(sink, payload, hdr->payload_len);
+    msg_sink_printf(sink, "\"}\n");
+}
+
+/**
+ * Append a fixed-size, possibly unterminated, string field
+ */
+static
+void _msg_record_put_str(struct msg_sink *sink, const char *str, size_t max_len)
+{
+    msg_sink_put_escaped(sink, str, strnlen(str, max_len));
+}
+
+static
+void _msg_record_put_ais_json(struct msg_sink *sink, const struct msg_record_hdr *hdr, const void *fields,
+        const char *payload)
+{
+    const char *ts = msg_sink_timestamp(sink, hdr->timestamp_ns / 1000000000ull);
+
+    switch (hdr->type) {
+    case MSG_RECORD_TYPE_AIS_POSITION_REPORT: {
+        const struct msg_record_ais_position_report *pr = fields;
+
+        msg_sink_printf(sink,
+                "{\"proto\":\"ais\",\"type\":\"positionReport\",\"timestamp\":\"%s\","
+                "\"mmsi\":%u,\"navStat\":%u,\"rateOfTurn\":%d,\"speedOverGround\":%f,\"positionAcc\":%u,"
+                "\"geoPosition\":{\"lon\":%f,\"lat\":%f},\"course\":%u,\"heading\":%u,\"seconds\":%u,\"rawAscii\":\"",
+                ts, (unsigned)hdr->address, pr->nav_stat, pr->rate_of_turn, (double)pr->speed_over_ground,
+                pr->position_acc, (double)pr->longitude, (double)pr->latitude, pr->course, pr->heading,
+                pr->seconds);
+        break;
+    }
+    case MSG_RECORD_TYPE_AIS_BASE_STATION_REPORT: {
+        const struct msg_record_ais_base_station_report *br = fields;
+
+        msg_sink_printf(sink,
+                "{\"proto\":\"ais\",\"type\":\"baseStationReport\",\"timestamp\":\"%s\","
+                "\"mmsi\":%u,\"baseStationDate\":\"%04u-%02u-%02u %02u:%02u:%02u UTC\","
+                "\"geoPosition\":{\"lon\":%f,\"lat\":%f},\"fixType\":\"%s\",\"rawAscii\":\"",
+                ts, (unsigned)hdr->address, br->year, br->month, br->day, br->hour, br->minute, br->second,
+                (double)br->longitude, (double)br->latitude, ais_decode_epfd_name(br->epfd_type));
+        break;
+    }
+    case MSG_RECORD_TYPE_AIS_STATIC_VOYAGE_DATA: {
+        const struct msg_record_ais_static_voyage_data *svd = fields;
+
+        msg_sink_printf(sink,
+                "{\"proto\":\"ais\",\"type\":\"staticAndVoyageData\",\"timestamp\":\"%s\","
+                "\"mmsi\":%u,\"version\":%u,\"imoNumber\":%u,\"callsign\":\"",
+                ts, (unsigned)hdr->address, svd->version, svd->imo_number);
+        _msg_record_put_str(sink, svd->callsign, sizeof(svd->callsign));
+        msg_sink_printf(sink, "\",\"shipName\":\"");
+        _msg_record_put_str(sink, svd->ship_name, sizeof(svd->ship_name));
+        msg_sink_printf(sink, "\","
+                "\"shipType\":%u,\"dimensions\":{\"toBow\":%u,\"toStern\":%u,\"toPort\":%u,\"toStarboard\":%u},"
+                "\"fixType\":\"%s\",\"eta\":\"%02u-%02u %02u:%02u\",\"draught\":%f,\"destination\":\"",
+                svd->ship_type, svd->dim_to_bow, svd->dim_to_stern, svd->dim_to_port, svd->dim_to_starboard,
+                ais_decode_epfd_name(svd->fix_type), svd->eta_month, svd->eta_day, svd->eta_hour,
+                svd->eta_minute, (double)svd->draught);
+        _msg_record_put_str(sink, svd->destination, sizeof(svd->destination));
+        msg_sink_printf(sink, "\",\"rawAscii\":\"");
+        break;
+    }
+    default:
+        return;
+    }
+
+    msg_sink_put_escaped(sink, payload, hdr->payload_len);
+    msg_sink_printf(sink, "\"}\n");
+}
+
+aresult_t msg_record_put_json(struct msg_sink *sink, const struct msg_record_hdr *hdr, const void *fields,
+        const char *payload)
+{
+    aresult_t ret = A_OK;
+
+    TSL_ASSERT_ARG(NULL != sink);
+    TSL_ASSERT_ARG(NULL != hdr);
+
+    switch (hdr->proto) {
+    case MSG_RECORD_PROTO_FLEX:
+    case MSG_RECORD_PROTO_POCSAG:
+        _msg_record_put_pager_json(sink, hdr, fields, payload);
+        break;
+    case MSG_RECORD_PROTO_AIS:
+        _msg_record_put_ais_json(sink, hdr, fields, payload);
+        break;
+    default:
+        ret = A_E_INVAL;
+        goto done;
+    }
+
+done:
+    return ret;
+}
+
+aresult_t msg_record_check(const struct msg_record_hdr *hdr, size_t avail)
+{
+    aresult_t ret = A_OK;
+
+    TSL_ASSERT_ARG(NULL != hdr);
+
+    if (avail < sizeof(*hdr)) {
+        ret = A_E_BUSY;
+        goto done;
+    }
+
+    if (hdr->type < MSG_RECORD_TYPE_ALPHANUMERIC || hdr->type > MSG_RECORD_TYPE_AIS_STATIC_VOYAGE_DATA ||
+            hdr->proto < MSG_RECORD_PROTO_FLEX || hdr->proto > MSG_RECORD_PROTO_AIS ||
+            hdr->fields_len != _msg_record_fields_len[hdr->type] ||
+            hdr->len > MSG_SINK_MAX_RECORD ||
+            hdr->len != MSG_RECORD_LEN(hdr->fields_len, hdr->payload_len))
+    {
+        ret = A_E_INVAL;
+        goto done;
+    }
+
+    if (avail < hdr->len) {
+        ret = A_E_BUSY;
+        goto done;
+    }
+
+done:
+    return ret;
+}
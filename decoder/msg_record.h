@@ -0,0 +1,191 @@
+#pragma once
+
+#include <tsl/result.h>
+
+#include <stdint.h>
+#include <stddef.h>
+
+struct msg_sink;
+
+/**
+ * Binary message records
+ *
+ * A record file optionally starts with a struct msg_record_file_hdr, followed by back-to-back
+ * records. Each record is a struct msg_record_hdr, then fields_len bytes of typed fields (one
+ * of the msg_record_* field structs, depending on the record type), then payload_len bytes of
+ * raw payload (the message text, or the raw AIS sentence), padded so the next record starts on
+ * an 8 byte boundary. This means a reader can mmap an archive and walk it with nothing but the
+ * length of each record.
+ *
+ * Everything is in host byte order, which is little endian on every target we build for.
+ */
+
+#define MSG_RECORD_FILE_MAGIC           "TSLMSG\0\0"
+#define MSG_RECORD_VERSION              1
+#define MSG_RECORD_ALIGN                8
+
+struct msg_record_file_hdr {
+    char magic[8];
+    uint32_t version;
+    uint32_t hdr_bytes;
+};
+
+enum msg_record_proto {
+    MSG_RECORD_PROTO_FLEX = 1,
+    MSG_RECORD_PROTO_POCSAG = 2,
+    MSG_RECORD_PROTO_AIS = 3,
+};
+
+enum msg_record_type {
+    MSG_RECORD_TYPE_ALPHANUMERIC = 1,
+    MSG_RECORD_TYPE_NUMERIC = 2,
+    MSG_RECORD_TYPE_FLEX_SIV = 3,
+    MSG_RECORD_TYPE_AIS_POSITION_REPORT = 4,
+    MSG_RECORD_TYPE_AIS_BASE_STATION_REPORT = 5,
+    MSG_RECORD_TYPE_AIS_STATIC_VOYAGE_DATA = 6,
+};
+
+/**
+ * FLEX message flags
+ */
+#define MSG_RECORD_FLAG_FRAGMENTED      (1 << 0)
+#define MSG_RECORD_FLAG_MAILDROP        (1 << 1)
+
+struct msg_record_hdr {
+    /**
+     * Total length of the record, including this header and padding
+     */
+    uint32_t len;
+
+    /**
+     * The protocol, and type of message (enum msg_record_proto and msg_record_type)
+     */
+    uint8_t proto;
+    uint8_t type;
+
+    /**
+     * Length of the typed fields following the header
+     */
+    uint16_t fields_len;
+
+    /**
+     * Wall clock time the message was decoded at, in nanoseconds since the epoch
+     */
+    uint64_t timestamp_ns;
+
+    /**
+     * The pager capcode, or AIS MMSI
+     */
+    uint64_t address;
+
+    /**
+     * Pager framing information
+     */
+    uint16_t baud;
+    uint8_t phase;
+    uint8_t cycle_no;
+    uint8_t frame_no;
+    uint8_t function;
+    uint8_t flags;
+    uint8_t frag_seq;
+
+    /**
+     * Length of the raw payload following the typed fields
+     */
+    uint32_t payload_len;
+    uint32_t reserved;
+};
+
+struct msg_record_flex_siv {
+    uint32_t data;
+    uint32_t siv_type;
+};
+
+struct msg_record_ais_position_report {
+    uint32_t nav_stat;
+    uint32_t position_acc;
+    uint32_t course;
+    uint32_t heading;
+    uint32_t seconds;
+    int32_t rate_of_turn;
+    float speed_over_ground;
+    float longitude;
+    float latitude;
+};
+
+struct msg_record_ais_base_station_report {
+    uint32_t year;
+    uint32_t month;
+    uint32_t day;
+    uint32_t hour;
+    uint32_t minute;
+    uint32_t second;
+    uint32_t epfd_type;
+    float longitude;
+    float latitude;
+};
+
+struct msg_record_ais_static_voyage_data {
+    uint32_t version;
+    uint32_t imo_number;
+    uint32_t ship_type;
+    uint32_t dim_to_bow;
+    uint32_t dim_to_stern;
+    uint32_t dim_to_port;
+    uint32_t dim_to_starboard;
+    uint32_t fix_type;
+    uint32_t eta_month;
+    uint32_t eta_day;
+    uint32_t eta_hour;
+    uint32_t eta_minute;
+    float draught;
+    char callsign[8];
+    char ship_name[21];
+    char destination[21];
+    uint8_t pad[2];
+};
+
+/**
+ * Total length of a record with the given field and payload lengths
+ */
+#define MSG_RECORD_LEN(fields_len, payload_len) \
+    ((sizeof(struct msg_record_hdr) + (fields_len) + (payload_len) + MSG_RECORD_ALIGN - 1) & \
+        ~((size_t)MSG_RECORD_ALIGN - 1))
+
+static inline
+const void *msg_record_fields(const struct msg_record_hdr *hdr)
+{
+    return (const uint8_t *)hdr + sizeof(*hdr);
+}
+
+static inline
+const char *msg_record_payload(const struct msg_record_hdr *hdr)
+{
+    return (const char *)hdr + sizeof(*hdr) + hdr->fields_len;
+}
+
+/**
+ * Append the file header to the current sink record.
+ */
+aresult_t msg_record_put_file_hdr(struct msg_sink *sink);
+
+/**
+ * Append a binary record to the current sink record. The len field of the header is filled
+ * in; fields_len and payload_len must be set by the caller.
+ */
+aresult_t msg_record_put(struct msg_sink *sink, const struct msg_record_hdr *hdr, const void *fields,
+        const char *payload);
+
+/**
+ * Render a record as a line of JSON into the current sink record.
+ */
+aresult_t msg_record_put_json(struct msg_sink *sink, const struct msg_record_hdr *hdr, const void *fields,
+        const char *payload);
+
+/**
+ * Check that a record read back from a file is well formed, given the number of bytes that
+ * are available from the start of the record.
+ *
+ * \return A_OK if the record is good, A_E_BUSY if more bytes are needed, A_E_INVAL otherwise.
+ */
+aresult_t msg_record_check(const struct msg_record_hdr *hdr, size_t avail);
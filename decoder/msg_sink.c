@@ -0,0 +1,509 @@
+/*
+ *  msg_sink.c - Buffered, asynchronous output for decoded messages
+ *
+ *  Copyright (c)2017 Phil Vachon <phil@security-embedded.com>
+ *
+ *  This file is a part of The Standard Library (TSL)
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ */
+#include <decoder/msg_sink.h>
+#include <decoder/decoder.h>
+
+#include <tsl/worker_thread.h>
+#include <tsl/safe_alloc.h>
+#include <tsl/time.h>
+#include <tsl/diag.h>
+#include <tsl/errors.h>
+#include <tsl/assert.h>
+
+#include <pthread.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <unistd.h>
+#include <errno.h>
+#include <string.h>
+#include <time.h>
+
+/**
+ * Number of output buffers. One is being filled while the others wait to be written.
+ */
+#define MSG_SINK_NR_BUFS                4
+
+struct msg_sink_buf {
+    /**
+     * The formatted records
+     */
+    char *data;
+
+    /**
+     * Number of bytes in the buffer
+     */
+    size_t len;
+};
+
+/**
+ * How to write out each byte of a string inside of a JSON string
+ */
+struct msg_sink_escape {
+    uint8_t len;
+    char seq[7];
+};
+
+struct msg_sink {
+    /**
+     * Protects everything below
+     */
+    pthread_mutex_t lock;
+
+    /**
+     * Signalled when there's a buffer ready to be written, or on shutdown
+     */
+    pthread_cond_t writer_cv;
+
+    /**
+     * Signalled when the writer returns a buffer to the free list
+     */
+    pthread_cond_t space_cv;
+
+    /**
+     * The writer thread
+     */
+    struct worker_thread wthr;
+    bool writer_started;
+
+    /**
+     * Where records go
+     */
+    int fd;
+
+    /**
+     * Size of each buffer, and the fill level at which a buffer is handed to the writer
+     */
+    size_t buf_bytes;
+    size_t flush_bytes;
+
+    /**
+     * Longest a record sits in the active buffer before being written, in nanoseconds
+     */
+    uint64_t flush_ns;
+
+    /**
+     * The buffer records are currently being formatted into, and when its first record
+     * arrived. NULL if every buffer is waiting to be written.
+     */
+    struct msg_sink_buf *active;
+    uint64_t active_since_ns;
+
+    /**
+     * Buffers waiting to be written, in order
+     */
+    struct msg_sink_buf *full[MSG_SINK_NR_BUFS];
+    size_t full_head;
+    size_t nr_full;
+
+    /**
+     * Buffers available to be filled
+     */
+    struct msg_sink_buf *free[MSG_SINK_NR_BUFS];
+    size_t nr_free;
+
+    /**
+     * The record being built: where it starts in the active buffer, and whether it overflowed
+     */
+    size_t rec_start;
+    bool rec_truncated;
+
+    /**
+     * Number of records dropped because they were too long
+     */
+    size_t nr_dropped;
+
+    /**
+     * Cached wall clock timestamp, refreshed once a second
+     */
+    time_t cached_sec;
+    char cached_ts[32];
+
+    struct msg_sink_buf bufs[MSG_SINK_NR_BUFS];
+};
+
+static
+struct msg_sink_escape _msg_sink_escapes[256];
+
+static
+pthread_once_t _msg_sink_escapes_once = PTHREAD_ONCE_INIT;
+
+static
+void _msg_sink_escape_set(unsigned ch, const char *seq)
+{
+    _msg_sink_escapes[ch].len = strlen(seq);
+    memcpy(_msg_sink_escapes[ch].seq, seq, _msg_sink_escapes[ch].len);
+}
+
+/**
+ * Build the escape table. Printable ASCII passes through as is, a few control characters get
+ * pager-friendly substitutions, and everything else becomes a \u escape.
+ */
+static
+void _msg_sink_escapes_init(void)
+{
+    for (unsigned i = 0; i < 256; i++) {
+        struct msg_sink_escape *esc = &_msg_sink_escapes[i];
+
+        if (0x20 <= i && i < 0x7f) {
+            esc->len = 1;
+            esc->seq[0] = (char)i;
+        } else {
+            esc->len = snprintf(esc->seq, sizeof(esc->seq), "\\u%04x", i);
+        }
+    }
+
+    _msg_sink_escape_set('\n', "\\n");
+    _msg_sink_escape_set('\r', "\\n");
+    _msg_sink_escape_set('\"', "\\\"");
+    _msg_sink_escape_set('\\', "\\\\");
+    _msg_sink_escape_set('/', "\\/");
+    _msg_sink_escape_set('\b', "<BKSP>");
+    _msg_sink_escape_set('\f', "<FF>");
+    _msg_sink_escape_set('\t', "\\t");
+    _msg_sink_escape_set(0x03, " ");
+    _msg_sink_escape_set(0x04, " ");
+    _msg_sink_escape_set(0x17, " ");
+}
+
+/**
+ * Move the active buffer to the back of the write queue, and pick up a free buffer, if there is
+ * one. Must be called with the lock held.
+ */
+static
+void _msg_sink_hand_off(struct msg_sink *sink)
+{
+    TSL_BUG_ON(NULL == sink->active);
+    TSL_BUG_ON(MSG_SINK_NR_BUFS == sink->nr_full);
+
+    sink->full[(sink->full_head + sink->nr_full) % MSG_SINK_NR_BUFS] = sink->active;
+    sink->nr_full++;
+    sink->active = NULL;
+
+    if (0 != sink->nr_free) {
+        sink->active = sink->free[--sink->nr_free];
+    }
+
+    pthread_cond_signal(&sink->writer_cv);
+}
+
+static
+void _msg_sink_write(struct msg_sink *sink, struct msg_sink_buf *buf)
+{
+    size_t written = 0;
+
+    while (written < buf->len) {
+        ssize_t op_ret = write(sink->fd, buf->data + written, buf->len - written);
+
+        if (0 > op_ret) {
+            int errnum = errno;
+
+            if (EINTR == errnum) {
+                continue;
+            }
+
+            DEC_MSG(SEV_ERROR, "WRITE-FAIL", "Failed to write %zu bytes of messages: %s (%d)",
+                    buf->len - written, strerror(errnum), errnum);
+            break;
+        }
+
+        written += op_ret;
+    }
+}
+
+static
+aresult_t _msg_sink_writer_thread(struct worker_thread *wthr)
+{
+    struct msg_sink *sink = BL_CONTAINER_OF(wthr, struct msg_sink, wthr);
+    bool running = true;
+
+    pthread_mutex_lock(&sink->lock);
+
+    do {
+        struct msg_sink_buf *buf = NULL;
+
+        running = worker_thread_is_running(wthr);
+
+        if (0 == sink->nr_full) {
+            uint64_t age_ns = 0;
+            bool pending = NULL != sink->active && 0 != sink->active->len;
+
+            if (true == pending) {
+                age_ns = tsl_get_clock_monotonic() - sink->active_since_ns;
+            }
+
+            /* Flush the active buffer if it's been sitting around for too long, or we're done */
+            if (true == pending && (false == running || age_ns >= sink->flush_ns)) {
+                _msg_sink_hand_off(sink);
+            } else if (true == running) {
+                struct timespec ts;
+
+                /* Wake up in time to flush whatever is already waiting */
+                uint64_t wait_ns = sink->flush_ns - age_ns;
+
+                clock_gettime(CLOCK_REALTIME, &ts);
+                ts.tv_nsec += wait_ns % 1000000000ull;
+                ts.tv_sec += wait_ns / 1000000000ull + ts.tv_nsec / 1000000000l;
+                ts.tv_nsec %= 1000000000l;
+                pthread_cond_timedwait(&sink->writer_cv, &sink->lock, &ts);
+                continue;
+            } else {
+                break;
+            }
+        }
+
+        buf = sink->full[sink->full_head];
+        sink->full_head = (sink->full_head + 1) % MSG_SINK_NR_BUFS;
+        sink->nr_full--;
+
+        /* Do the actual I/O without holding up the decoders */
+        pthread_mutex_unlock(&sink->lock);
+        _msg_sink_write(sink, buf);
+        pthread_mutex_lock(&sink->lock);
+
+        buf->len = 0;
+
+        if (NULL == sink->active) {
+            sink->active = buf;
+        } else {
+            sink->free[sink->nr_free++] = buf;
+        }
+
+        pthread_cond_broadcast(&sink->space_cv);
+    } while (true == running || 0 != sink->nr_full || (NULL != sink->active && 0 != sink->active->len));
+
+    pthread_mutex_unlock(&sink->lock);
+
+    return A_OK;
+}
+
+aresult_t msg_sink_new(struct msg_sink **psink, int fd, size_t flush_bytes, unsigned flush_ms)
+{
+    aresult_t ret = A_OK;
+
+    struct msg_sink *sink = NULL;
+
+    TSL_ASSERT_ARG(NULL != psink);
+    TSL_ASSERT_ARG(0 <= fd);
+    TSL_ASSERT_ARG(0 != flush_bytes);
+    TSL_ASSERT_ARG(0 != flush_ms);
+
+    *psink = NULL;
+
+    pthread_once(&_msg_sink_escapes_once, _msg_sink_escapes_init);
+
+    if (FAILED(ret = TZAALLOC(sink, SYS_CACHE_LINE_LENGTH))) {
+        goto done;
+    }
+
+    pthread_mutex_init(&sink->lock, NULL);
+    pthread_cond_init(&sink->writer_cv, NULL);
+    pthread_cond_init(&sink->space_cv, NULL);
+
+    sink->fd = fd;
+    sink->cached_sec = (time_t)-1;
+    sink->flush_bytes = flush_bytes;
+    sink->flush_ns = (uint64_t)flush_ms * 1000000ull;
+
+    /* A buffer that hasn't reached the flush threshold always has room for one more record */
+    sink->buf_bytes = flush_bytes + MSG_SINK_MAX_RECORD;
+
+    for (size_t i = 0; i < MSG_SINK_NR_BUFS; i++) {
+        if (FAILED(ret = TACALLOC((void **)&sink->bufs[i].data, sink->buf_bytes, 1, SYS_CACHE_LINE_LENGTH))) {
+            goto done;
+        }
+    }
+
+    sink->active = &sink->bufs[0];
+
+    for (size_t i = 1; i < MSG_SINK_NR_BUFS; i++) {
+        sink->free[sink->nr_free++] = &sink->bufs[i];
+    }
+
+    if (FAILED(ret = worker_thread_new(&sink->wthr, _msg_sink_writer_thread, WORKER_THREAD_CPU_MASK_ANY))) {
+        goto done;
+    }
+
+    sink->writer_started = true;
+
+    *psink = sink;
+
+done:
+    if (FAILED(ret)) {
+        if (NULL != sink) {
+            msg_sink_delete(&sink);
+        }
+    }
+
+    return ret;
+}
+
+aresult_t msg_sink_delete(struct msg_sink **psink)
+{
+    aresult_t ret = A_OK;
+
+    struct msg_sink *sink = NULL;
+
+    TSL_ASSERT_ARG(NULL != psink);
+    TSL_ASSERT_ARG(NULL != *psink);
+
+    sink = *psink;
+
+    if (true == sink->writer_started) {
+        /* The writer drains everything that's pending before it exits */
+        TSL_BUG_IF_FAILED(worker_thread_request_shutdown(&sink->wthr));
+        pthread_mutex_lock(&sink->lock);
+        pthread_cond_signal(&sink->writer_cv);
+        pthread_mutex_unlock(&sink->lock);
+        TSL_BUG_IF_FAILED(worker_thread_delete(&sink->wthr));
+    }
+
+    if (0 != sink->nr_dropped) {
+        DEC_MSG(SEV_WARNING, "DROPPED-RECORDS", "Dropped %zu records that were longer than %d bytes.",
+                sink->nr_dropped, MSG_SINK_MAX_RECORD);
+    }
+
+    for (size_t i = 0; i < MSG_SINK_NR_BUFS; i++) {
+        if (NULL != sink->bufs[i].data) {
+            TFREE(sink->bufs[i].data);
+        }
+    }
+
+    pthread_cond_destroy(&sink->space_cv);
+    pthread_cond_destroy(&sink->writer_cv);
+    pthread_mutex_destroy(&sink->lock);
+
+    TFREE(sink);
+
+    *psink = NULL;
+
+    return ret;
+}
+
+void msg_sink_begin(struct msg_sink *sink)
+{
+    TSL_BUG_ON(NULL == sink);
+
+    pthread_mutex_lock(&sink->lock);
+
+    /* If the writer has fallen behind, wait for it to hand back a buffer */
+    while (NULL == sink->active) {
+        pthread_cond_wait(&sink->space_cv, &sink->lock);
+    }
+
+    if (0 == sink->active->len) {
+        sink->active_since_ns = tsl_get_clock_monotonic();
+    }
+
+    sink->rec_start = sink->active->len;
+    sink->rec_truncated = false;
+}
+
+void msg_sink_printf(struct msg_sink *sink, const char *fmt, ...)
+{
+    struct msg_sink_buf *buf = sink->active;
+    size_t room = sink->rec_start + MSG_SINK_MAX_RECORD - buf->len;
+    va_list ap;
+    int nr_bytes = 0;
+
+    if (true == sink->rec_truncated) {
+        return;
+    }
+
+    va_start(ap, fmt);
+    nr_bytes = vsnprintf(buf->data + buf->len, room, fmt, ap);
+    va_end(ap);
+
+    if (0 > nr_bytes || (size_t)nr_bytes >= room) {
+        sink->rec_truncated = true;
+        return;
+    }
+
+    buf->len += nr_bytes;
+}
+
+void msg_sink_put_escaped(struct msg_sink *sink, const char *str, size_t len)
+{
+    struct msg_sink_buf *buf = sink->active;
+    size_t limit = sink->rec_start + MSG_SINK_MAX_RECORD;
+    char *out = buf->data + buf->len;
+
+    if (true == sink->rec_truncated) {
+        return;
+    }
+
+    /* The longest escape sequence is 6 bytes, so check for space once per input byte */
+    for (size_t i = 0; i < len; i++) {
+        const struct msg_sink_escape *esc = &_msg_sink_escapes[(uint8_t)str[i]];
+
+        if ((size_t)(out - buf->data) + sizeof(esc->seq) > limit) {
+            sink->rec_truncated = true;
+            return;
+        }
+
+        memcpy(out, esc->seq, sizeof(esc->seq));
+        out += esc->len;
+    }
+
+    buf->len = out - buf->data;
+}
+
+void *msg_sink_reserve(struct msg_sink *sink, size_t len)
+{
+    struct msg_sink_buf *buf = sink->active;
+    void *ptr = NULL;
+
+    if (true == sink->rec_truncated || buf->len + len > sink->rec_start + MSG_SINK_MAX_RECORD) {
+        sink->rec_truncated = true;
+        return NULL;
+    }
+
+    ptr = buf->data + buf->len;
+    buf->len += len;
+
+    return ptr;
+}
+
+const char *msg_sink_timestamp(struct msg_sink *sink, time_t when)
+{
+    if (when != sink->cached_sec) {
+        struct tm gmt;
+
+        gmtime_r(&when, &gmt);
+        strftime(sink->cached_ts, sizeof(sink->cached_ts), "%Y-%m-%d %H:%M:%S UTC", &gmt);
+        sink->cached_sec = when;
+    }
+
+    return sink->cached_ts;
+}
+
+void msg_sink_commit(struct msg_sink *sink)
+{
+    if (true == sink->rec_truncated) {
+        /* Roll back the partial record */
+        sink->active->len = sink->rec_start;
+        sink->nr_dropped++;
+    } else if (sink->active->len >= sink->flush_bytes) {
+        _msg_sink_hand_off(sink);
+    }
+
+    pthread_mutex_unlock(&sink->lock);
+}
@@ -0,0 +1,61 @@
+#pragma once
+
+#include <tsl/result.h>
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <time.h>
+
+struct msg_sink;
+
+/**
+ * Largest single record the sink will accept, in bytes. Longer records are dropped.
+ */
+#define MSG_SINK_MAX_RECORD             8192
+
+/**
+ * Create a new message sink, writing to the given file descriptor. Records are formatted into
+ * preallocated buffers, and a writer thread writes them out once a buffer has flush_bytes in
+ * it, or once the oldest unwritten record is flush_ms old, whichever comes first.
+ *
+ * The sink does not take ownership of the file descriptor.
+ */
+aresult_t msg_sink_new(struct msg_sink **psink, int fd, size_t flush_bytes, unsigned flush_ms);
+
+/**
+ * Write out everything that's pending, stop the writer thread and release the sink.
+ */
+aresult_t msg_sink_delete(struct msg_sink **psink);
+
+/**
+ * Start a new record. This locks the sink: records from different threads are never
+ * interleaved. Must be followed by msg_sink_commit.
+ */
+void msg_sink_begin(struct msg_sink *sink);
+
+/**
+ * Append formatted text to the current record.
+ */
+void msg_sink_printf(struct msg_sink *sink, const char *fmt, ...) __attribute__((format(printf, 2, 3)));
+
+/**
+ * Append a string to the current record, escaped so it can appear inside a JSON string.
+ */
+void msg_sink_put_escaped(struct msg_sink *sink, const char *str, size_t len);
+
+/**
+ * Reserve len bytes in the current record, to be filled in directly by the caller. Returns NULL
+ * if the record would be too long, in which case the record is dropped at commit time.
+ */
+void *msg_sink_reserve(struct msg_sink *sink, size_t len);
+
+/**
+ * Format a wall clock time as "YYYY-MM-DD HH:MM:SS UTC". Only valid between msg_sink_begin and
+ * msg_sink_commit. The string is only reformatted when the second changes.
+ */
+const char *msg_sink_timestamp(struct msg_sink *sink, time_t when);
+
+/**
+ * Finish the current record, and unlock the sink.
+ */
+void msg_sink_commit(struct msg_sink *sink);
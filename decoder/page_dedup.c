@@ -0,0 +1,249 @@
+/*
+ *  page_dedup.c - Drop pages repeated across frames, frequencies and streams
+ *
+ *  Copyright (c)2017 Phil Vachon <phil@security-embedded.com>
+ *
+ *  This file is a part of The Standard Library (TSL)
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ */
+#include <decoder/page_dedup.h>
+
+#include <tsl/safe_alloc.h>
+#include <tsl/diag.h>
+#include <tsl/errors.h>
+#include <tsl/assert.h>
+
+#include <pthread.h>
+#include <string.h>
+
+/**
+ * A page recently passed on
+ */
+struct page_dedup_page {
+    /**
+     * Hash of the page contents
+     */
+    uint64_t hash;
+
+    /**
+     * When the page was passed on, in milliseconds
+     */
+    uint64_t when_ms;
+};
+
+/**
+ * The recent pages for a capcode
+ */
+struct page_dedup_capcode {
+    uint64_t capcode;
+
+    /**
+     * When a page for this capcode was last seen, for picking which capcode to evict from a set
+     */
+    uint64_t last_seen_ms;
+
+    /**
+     * The pages, most recently seen first. The entry is unused if there are none.
+     */
+    size_t nr_pages;
+    struct page_dedup_page pages[PAGE_DEDUP_PAGES_PER_CAPCODE];
+};
+
+/**
+ * A set-associative cache of capcodes: each capcode can only live in one set, so the cache is
+ * bounded and a lookup only ever looks at a handful of entries.
+ */
+struct page_dedup {
+    /**
+     * Pages arrive from every stream's thread
+     */
+    pthread_mutex_t lock;
+
+    struct page_dedup_capcode *capcodes;
+    unsigned set_bits;
+    uint64_t ttl_ms;
+
+    struct page_dedup_stats stats;
+};
+
+/**
+ * Time since then, in milliseconds
+ */
+static inline
+uint64_t _page_dedup_since(uint64_t now_ms, uint64_t then_ms)
+{
+    return now_ms > then_ms ? now_ms - then_ms : 0;
+}
+
+/**
+ * Find the entry for a capcode, or claim one for it: an unused entry in its set if there is one,
+ * otherwise the one least recently seen.
+ */
+static
+struct page_dedup_capcode *_page_dedup_find(struct page_dedup *dedup, uint64_t now_ms, uint64_t capcode)
+{
+    size_t set = 0 == dedup->set_bits ? 0 : (size_t)((capcode * 0x9e3779b97f4a7c15ull) >> (64 - dedup->set_bits));
+    struct page_dedup_capcode *ways = &dedup->capcodes[set * PAGE_DEDUP_WAYS],
+                              *victim = NULL;
+
+    for (size_t i = 0; i < PAGE_DEDUP_WAYS; i++) {
+        struct page_dedup_capcode *ent = &ways[i];
+
+        if (0 != ent->nr_pages && capcode == ent->capcode) {
+            return ent;
+        }
+
+        if (NULL == victim || (0 != victim->nr_pages &&
+                    (0 == ent->nr_pages || ent->last_seen_ms < victim->last_seen_ms)))
+        {
+            victim = ent;
+        }
+    }
+
+    if (0 != victim->nr_pages && _page_dedup_since(now_ms, victim->last_seen_ms) < dedup->ttl_ms) {
+        dedup->stats.nr_capcode_evictions++;
+    }
+
+    victim->capcode = capcode;
+    victim->nr_pages = 0;
+
+    return victim;
+}
+
+aresult_t page_dedup_new(struct page_dedup **pdedup, size_t nr_capcodes, uint64_t ttl_ms)
+{
+    aresult_t ret = A_OK;
+
+    struct page_dedup *dedup = NULL;
+
+    TSL_ASSERT_ARG(NULL != pdedup);
+    TSL_ASSERT_ARG(0 != nr_capcodes);
+    TSL_ASSERT_ARG(0 != ttl_ms);
+
+    *pdedup = NULL;
+
+    if (FAILED(ret = TZAALLOC(dedup, SYS_CACHE_LINE_LENGTH))) {
+        goto done;
+    }
+
+    dedup->ttl_ms = ttl_ms;
+
+    /* A power of 2 number of sets, enough to hold all the capcodes */
+    while (((size_t)PAGE_DEDUP_WAYS << dedup->set_bits) < nr_capcodes) {
+        dedup->set_bits++;
+    }
+
+    if (FAILED(ret = TCALLOC((void **)&dedup->capcodes, sizeof(struct page_dedup_capcode),
+                    (size_t)PAGE_DEDUP_WAYS << dedup->set_bits)))
+    {
+        goto done;
+    }
+
+    pthread_mutex_init(&dedup->lock, NULL);
+
+    *pdedup = dedup;
+
+done:
+    if (FAILED(ret)) {
+        if (NULL != dedup) {
+            TFREE(dedup);
+        }
+    }
+    return ret;
+}
+
+aresult_t page_dedup_delete(struct page_dedup **pdedup)
+{
+    struct page_dedup *dedup = NULL;
+
+    TSL_ASSERT_ARG(NULL != pdedup);
+    TSL_ASSERT_ARG(NULL != *pdedup);
+
+    dedup = *pdedup;
+
+    pthread_mutex_destroy(&dedup->lock);
+    TFREE(dedup->capcodes);
+    TFREE(dedup);
+
+    *pdedup = NULL;
+
+    return A_OK;
+}
+
+bool page_dedup_check(struct page_dedup *dedup, uint64_t now_ms, uint64_t capcode, uint64_t hash)
+{
+    struct page_dedup_capcode *ent = NULL;
+    struct page_dedup_page page = { .hash = hash, .when_ms = now_ms };
+    size_t nr_live = 0,
+           found = PAGE_DEDUP_PAGES_PER_CAPCODE;
+    bool duplicate = false;
+
+    TSL_BUG_ON(NULL == dedup);
+
+    pthread_mutex_lock(&dedup->lock);
+
+    ent = _page_dedup_find(dedup, now_ms, capcode);
+    ent->last_seen_ms = now_ms;
+
+    /* Forget the pages whose window is up, and look for this one among the rest */
+    for (size_t i = 0; i < ent->nr_pages; i++) {
+        if (_page_dedup_since(now_ms, ent->pages[i].when_ms) >= dedup->ttl_ms) {
+            continue;
+        }
+
+        if (hash == ent->pages[i].hash) {
+            found = nr_live;
+        }
+
+        ent->pages[nr_live++] = ent->pages[i];
+    }
+
+    ent->nr_pages = nr_live;
+
+    if (PAGE_DEDUP_PAGES_PER_CAPCODE != found) {
+        /* Keep the window from when it was passed on, but move it to the front */
+        duplicate = true;
+        page = ent->pages[found];
+        memmove(&ent->pages[1], &ent->pages[0], found * sizeof(struct page_dedup_page));
+        dedup->stats.nr_duplicates++;
+    } else {
+        if (PAGE_DEDUP_PAGES_PER_CAPCODE == ent->nr_pages) {
+            /* Forget the least recently seen page */
+            ent->nr_pages--;
+            dedup->stats.nr_page_evictions++;
+        }
+
+        memmove(&ent->pages[1], &ent->pages[0], ent->nr_pages * sizeof(struct page_dedup_page));
+        ent->nr_pages++;
+        dedup->stats.nr_unique++;
+    }
+
+    ent->pages[0] = page;
+
+    pthread_mutex_unlock(&dedup->lock);
+
+    return duplicate;
+}
+
+void page_dedup_get_stats(struct page_dedup *dedup, struct page_dedup_stats *stats)
+{
+    TSL_BUG_ON(NULL == dedup);
+    TSL_BUG_ON(NULL == stats);
+
+    pthread_mutex_lock(&dedup->lock);
+    *stats = dedup->stats;
+    pthread_mutex_unlock(&dedup->lock);
+}
@@ -0,0 +1,90 @@
+#pragma once
+
+#include <tsl/result.h>
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+struct page_dedup;
+
+/**
+ * Number of recent pages remembered for each capcode. When a capcode gets more distinct pages than
+ * this within the window, the least recently seen one is forgotten.
+ */
+#define PAGE_DEDUP_PAGES_PER_CAPCODE    8
+
+/**
+ * Number of capcodes sharing a set in the cache. A new capcode evicts the least recently used
+ * capcode in its set.
+ */
+#define PAGE_DEDUP_WAYS                 4
+
+struct page_dedup_stats {
+    /**
+     * Pages seen for the first time within the window, and passed on
+     */
+    uint64_t nr_unique;
+
+    /**
+     * Pages dropped as repeats of one already passed on
+     */
+    uint64_t nr_duplicates;
+
+    /**
+     * Capcodes evicted to make room for another while they still had live pages
+     */
+    uint64_t nr_capcode_evictions;
+
+    /**
+     * Pages forgotten within the window to make room for another page for the same capcode
+     */
+    uint64_t nr_page_evictions;
+};
+
+/**
+ * Create a new page dedup cache. Can be shared by any number of threads.
+ *
+ * \param pdedup The new cache, returned by reference
+ * \param nr_capcodes The number of capcodes to remember, rounded up to a whole number of sets
+ * \param ttl_ms How long a page is remembered for after it was passed on, in milliseconds
+ */
+aresult_t page_dedup_new(struct page_dedup **pdedup, size_t nr_capcodes, uint64_t ttl_ms);
+aresult_t page_dedup_delete(struct page_dedup **pdedup);
+
+/**
+ * Check if a page was already passed on within the window, and remember it if not. The window
+ * starts when a page is first passed on, so a page that keeps being repeated is still passed on
+ * once per window.
+ *
+ * \param dedup The cache
+ * \param now_ms The current time, in milliseconds
+ * \param capcode The capcode the page was sent to. Include the protocol in the upper bits, if
+ *                more than one protocol shares the cache.
+ * \param hash Hash of the page contents
+ *
+ * \return true if the page is a duplicate, and should be dropped
+ */
+bool page_dedup_check(struct page_dedup *dedup, uint64_t now_ms, uint64_t capcode, uint64_t hash);
+
+/**
+ * Hash a buffer into a running page hash (FNV-1a). Start with PAGE_DEDUP_HASH_INIT.
+ */
+#define PAGE_DEDUP_HASH_INIT            0xcbf29ce484222325ull
+
+static inline
+uint64_t page_dedup_hash(uint64_t hash, const void *buf, size_t len)
+{
+    const uint8_t *bytes = buf;
+
+    for (size_t i = 0; i < len; i++) {
+        hash = (hash ^ bytes[i]) * 0x100000001b3ull;
+    }
+
+    return hash;
+}
+
+/**
+ * Get a copy of the counters
+ */
+void page_dedup_get_stats(struct page_dedup *dedup, struct page_dedup_stats *stats);
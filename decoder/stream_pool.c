@@ -0,0 +1,339 @@
+/*
+ *  stream_pool.c - Multiplex many input streams onto a small pool of worker threads
+ *
+ *  Copyright (c)2017 Phil Vachon <phil@security-embedded.com>
+ *
+ *  This file is a part of The Standard Library (TSL)
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ */
+#include <decoder/stream_pool.h>
+#include <decoder/decoder.h>
+
+#include <tsl/worker_thread.h>
+#include <tsl/safe_alloc.h>
+#include <tsl/diag.h>
+#include <tsl/errors.h>
+#include <tsl/assert.h>
+
+#include <sys/epoll.h>
+
+#include <stdatomic.h>
+#include <unistd.h>
+#include <errno.h>
+#include <string.h>
+
+/**
+ * How long a worker waits in epoll_wait before checking if it has been asked to shut down
+ */
+#define STREAM_POOL_WAIT_MS             250
+
+/**
+ * Maximum number of events a worker handles per wakeup
+ */
+#define STREAM_POOL_MAX_EVENTS          16
+
+struct stream_pool_entry {
+    /**
+     * The file descriptor being polled
+     */
+    int fd;
+
+    /**
+     * Handler, and its state
+     */
+    stream_pool_on_readable_func_t on_readable;
+    void *state;
+
+    /**
+     * The next entry in the pool
+     */
+    struct stream_pool_entry *next;
+};
+
+struct stream_pool_worker {
+    /**
+     * The worker thread
+     */
+    struct worker_thread wthr;
+
+    /**
+     * The epoll set for just the streams owned by this worker
+     */
+    int epoll_fd;
+
+    /**
+     * Number of streams assigned to this worker
+     */
+    size_t nr_streams;
+
+    /**
+     * Back-pointer to the pool
+     */
+    struct stream_pool *pool;
+
+    /**
+     * Whether or not the worker thread was started
+     */
+    bool started;
+};
+
+struct stream_pool {
+    /**
+     * The workers
+     */
+    struct stream_pool_worker *workers;
+    unsigned nr_workers;
+
+    /**
+     * All the streams in the pool
+     */
+    struct stream_pool_entry *entries;
+    size_t nr_entries;
+
+    /**
+     * Set if a worker stopped because a stream failed
+     */
+    atomic_bool failed;
+
+    /**
+     * Set once stream_pool_start is called
+     */
+    bool started;
+};
+
+static
+aresult_t _stream_pool_worker_thread(struct worker_thread *wthr)
+{
+    aresult_t ret = A_OK;
+
+    struct stream_pool_worker *wkr = BL_CONTAINER_OF(wthr, struct stream_pool_worker, wthr);
+    struct epoll_event events[STREAM_POOL_MAX_EVENTS];
+
+    while (worker_thread_is_running(wthr)) {
+        int nr_events = 0;
+
+        if (0 > (nr_events = epoll_wait(wkr->epoll_fd, events, STREAM_POOL_MAX_EVENTS, STREAM_POOL_WAIT_MS))) {
+            int errnum = errno;
+
+            if (EINTR == errnum) {
+                continue;
+            }
+
+            DEC_MSG(SEV_FATAL, "EPOLL-WAIT-FAIL", "Failed to wait for input streams: %s (%d)",
+                    strerror(errnum), errnum);
+            ret = A_E_INVAL;
+            atomic_store(&wkr->pool->failed, true);
+            goto done;
+        }
+
+        for (int i = 0; i < nr_events; i++) {
+            struct stream_pool_entry *ent = events[i].data.ptr;
+
+            if (FAILED(ret = ent->on_readable(ent->state))) {
+                DEC_MSG(SEV_FATAL, "STREAM-FAIL", "Failed while processing stream (fd=%d), aborting.", ent->fd);
+                atomic_store(&wkr->pool->failed, true);
+                goto done;
+            }
+        }
+    }
+
+done:
+    return ret;
+}
+
+aresult_t stream_pool_new(struct stream_pool **ppool, unsigned nr_workers)
+{
+    aresult_t ret = A_OK;
+
+    struct stream_pool *pool = NULL;
+
+    TSL_ASSERT_ARG(NULL != ppool);
+    TSL_ASSERT_ARG(0 != nr_workers);
+
+    *ppool = NULL;
+
+    if (FAILED(ret = TZAALLOC(pool, SYS_CACHE_LINE_LENGTH))) {
+        goto done;
+    }
+
+    if (FAILED(ret = TCALLOC((void **)&pool->workers, sizeof(struct stream_pool_worker), nr_workers))) {
+        goto done;
+    }
+
+    pool->nr_workers = nr_workers;
+    atomic_init(&pool->failed, false);
+
+    for (unsigned i = 0; i < nr_workers; i++) {
+        pool->workers[i].epoll_fd = -1;
+    }
+
+    for (unsigned i = 0; i < nr_workers; i++) {
+        struct stream_pool_worker *wkr = &pool->workers[i];
+
+        wkr->pool = pool;
+
+        if (0 > (wkr->epoll_fd = epoll_create1(EPOLL_CLOEXEC))) {
+            int errnum = errno;
+            DEC_MSG(SEV_FATAL, "EPOLL-CREATE-FAIL", "Failed to create epoll set: %s (%d)",
+                    strerror(errnum), errnum);
+            ret = A_E_INVAL;
+            goto done;
+        }
+    }
+
+    *ppool = pool;
+
+done:
+    if (FAILED(ret)) {
+        if (NULL != pool) {
+            stream_pool_delete(&pool);
+        }
+    }
+    return ret;
+}
+
+aresult_t stream_pool_add(struct stream_pool *pool, int fd, stream_pool_on_readable_func_t on_readable, void *state)
+{
+    aresult_t ret = A_OK;
+
+    struct stream_pool_entry *ent = NULL;
+    struct stream_pool_worker *wkr = NULL;
+    struct epoll_event evt;
+
+    TSL_ASSERT_ARG(NULL != pool);
+    TSL_ASSERT_ARG(0 <= fd);
+    TSL_ASSERT_ARG(NULL != on_readable);
+
+    if (true == pool->started) {
+        DEC_MSG(SEV_ERROR, "POOL-STARTED", "Cannot add streams to a running pool.");
+        ret = A_E_BUSY;
+        goto done;
+    }
+
+    if (FAILED(ret = TZAALLOC(ent, SYS_CACHE_LINE_LENGTH))) {
+        goto done;
+    }
+
+    ent->fd = fd;
+    ent->on_readable = on_readable;
+    ent->state = state;
+
+    /* Pin the stream to a worker, so its state is only ever touched by one thread */
+    wkr = &pool->workers[pool->nr_entries % pool->nr_workers];
+
+    memset(&evt, 0, sizeof(evt));
+    evt.events = EPOLLIN;
+    evt.data.ptr = ent;
+
+    if (0 > epoll_ctl(wkr->epoll_fd, EPOLL_CTL_ADD, fd, &evt)) {
+        int errnum = errno;
+        DEC_MSG(SEV_ERROR, "EPOLL-ADD-FAIL", "Failed to add fd %d to epoll set: %s (%d)",
+                fd, strerror(errnum), errnum);
+        TFREE(ent);
+        ret = A_E_INVAL;
+        goto done;
+    }
+
+    ent->next = pool->entries;
+    pool->entries = ent;
+    pool->nr_entries++;
+    wkr->nr_streams++;
+
+done:
+    return ret;
+}
+
+aresult_t stream_pool_start(struct stream_pool *pool)
+{
+    aresult_t ret = A_OK;
+
+    TSL_ASSERT_ARG(NULL != pool);
+
+    if (true == pool->started) {
+        goto done;
+    }
+
+    pool->started = true;
+
+    for (unsigned i = 0; i < pool->nr_workers; i++) {
+        struct stream_pool_worker *wkr = &pool->workers[i];
+
+        if (0 == wkr->nr_streams) {
+            /* No point in spinning up an idle thread */
+            continue;
+        }
+
+        DIAG("Starting stream pool worker %u with %zu streams", i, wkr->nr_streams);
+
+        if (FAILED(ret = worker_thread_new(&wkr->wthr, _stream_pool_worker_thread, WORKER_THREAD_CPU_MASK_ANY))) {
+            goto done;
+        }
+
+        wkr->started = true;
+    }
+
+done:
+    return ret;
+}
+
+bool stream_pool_failed(struct stream_pool *pool)
+{
+    TSL_BUG_ON(NULL == pool);
+    return atomic_load(&pool->failed);
+}
+
+aresult_t stream_pool_delete(struct stream_pool **ppool)
+{
+    aresult_t ret = A_OK;
+
+    struct stream_pool *pool = NULL;
+    struct stream_pool_entry *ent = NULL;
+
+    TSL_ASSERT_ARG(NULL != ppool);
+    TSL_ASSERT_ARG(NULL != *ppool);
+
+    pool = *ppool;
+
+    if (NULL != pool->workers) {
+        for (unsigned i = 0; i < pool->nr_workers; i++) {
+            struct stream_pool_worker *wkr = &pool->workers[i];
+
+            if (true == wkr->started) {
+                TSL_BUG_IF_FAILED(worker_thread_request_shutdown(&wkr->wthr));
+                TSL_BUG_IF_FAILED(worker_thread_delete(&wkr->wthr));
+            }
+
+            if (0 <= wkr->epoll_fd) {
+                close(wkr->epoll_fd);
+            }
+        }
+
+        TFREE(pool->workers);
+    }
+
+    ent = pool->entries;
+    while (NULL != ent) {
+        struct stream_pool_entry *next = ent->next;
+        TFREE(ent);
+        ent = next;
+    }
+
+    TFREE(pool);
+
+    *ppool = NULL;
+
+    return ret;
+}
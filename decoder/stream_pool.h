@@ -0,0 +1,49 @@
+#pragma once
+
+#include <tsl/result.h>
+
+#include <stdbool.h>
+#include <stddef.h>
+
+struct stream_pool;
+
+/**
+ * Called from a pool worker when the stream's file descriptor is readable. The handler should
+ * not block, and should return after a bounded amount of work, so the other streams on the
+ * worker get their turn. It is called again for as long as the input has data.
+ *
+ * A stream is only ever serviced by the one worker it was assigned to, so the handler does
+ * not need to lock any per-stream state.
+ */
+typedef aresult_t (*stream_pool_on_readable_func_t)(void *state);
+
+/**
+ * Create a new stream pool, with the given number of worker threads. The workers are not
+ * started until stream_pool_start is called.
+ */
+aresult_t stream_pool_new(struct stream_pool **ppool, unsigned nr_workers);
+
+/**
+ * Add a stream to the pool. The file descriptor must be non-blocking, and something epoll can
+ * wait on (a FIFO or a socket, but not a regular file). Streams are assigned
+ * to workers round-robin, and stay with that worker until the pool is deleted.
+ *
+ * Streams can only be added before the pool is started.
+ */
+aresult_t stream_pool_add(struct stream_pool *pool, int fd, stream_pool_on_readable_func_t on_readable, void *state);
+
+/**
+ * Start the pool's worker threads.
+ */
+aresult_t stream_pool_start(struct stream_pool *pool);
+
+/**
+ * Check if a worker has stopped because one of its streams failed. The failed worker's streams
+ * are no longer serviced, so the pool should be torn down.
+ */
+bool stream_pool_failed(struct stream_pool *pool);
+
+/**
+ * Stop the workers and release the pool. The file descriptors are not closed.
+ */
+aresult_t stream_pool_delete(struct stream_pool **ppool);
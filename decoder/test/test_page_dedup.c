@@ -0,0 +1,126 @@
+#include <decoder/page_dedup.h>
+
+#include <test/assert.h>
+#include <test/framework.h>
+
+#include <tsl/assert.h>
+
+#include <stdio.h>
+#include <string.h>
+
+#define TEST_TTL_MS                     60000
+
+static
+struct page_dedup *dedup = NULL;
+
+static
+aresult_t test_page_dedup_setup(void)
+{
+    /* A single set, so it's easy to fill up */
+    return page_dedup_new(&dedup, PAGE_DEDUP_WAYS, TEST_TTL_MS);
+}
+
+static
+aresult_t test_page_dedup_cleanup(void)
+{
+    if (NULL != dedup) {
+        TSL_BUG_IF_FAILED(page_dedup_delete(&dedup));
+    }
+
+    return A_OK;
+}
+
+static
+bool _test_page(uint64_t now_ms, uint64_t capcode, const char *msg)
+{
+    return page_dedup_check(dedup, now_ms, capcode, page_dedup_hash(PAGE_DEDUP_HASH_INIT, msg, strlen(msg)));
+}
+
+TEST_DECLARE_UNIT(test_ttl, page_dedup)
+{
+    struct page_dedup_stats stats;
+
+    TEST_ASSERT_OK(test_page_dedup_cleanup());
+    TEST_ASSERT_OK(test_page_dedup_setup());
+
+    TEST_ASSERT_EQUALS(_test_page(1000, 1234567, "CALL THE WARD"), false);
+
+    /* Repeated on another frame, and to another capcode */
+    TEST_ASSERT_EQUALS(_test_page(3000, 1234567, "CALL THE WARD"), true);
+    TEST_ASSERT_EQUALS(_test_page(3000, 7654321, "CALL THE WARD"), false);
+    TEST_ASSERT_EQUALS(_test_page(4000, 1234567, "CALL THE DESK"), false);
+
+    /* The window runs from when the page was passed on, not when it was last repeated */
+    TEST_ASSERT_EQUALS(_test_page(1000 + TEST_TTL_MS - 1, 1234567, "CALL THE WARD"), true);
+    TEST_ASSERT_EQUALS(_test_page(1000 + TEST_TTL_MS, 1234567, "CALL THE WARD"), false);
+    TEST_ASSERT_EQUALS(_test_page(2000 + TEST_TTL_MS, 1234567, "CALL THE WARD"), true);
+
+    page_dedup_get_stats(dedup, &stats);
+    TEST_ASSERT_EQUALS(stats.nr_unique, 4);
+    TEST_ASSERT_EQUALS(stats.nr_duplicates, 3);
+    TEST_ASSERT_EQUALS(stats.nr_capcode_evictions, 0);
+    TEST_ASSERT_EQUALS(stats.nr_page_evictions, 0);
+
+    return A_OK;
+}
+
+TEST_DECLARE_UNIT(test_capcode_eviction, page_dedup)
+{
+    struct page_dedup_stats stats;
+
+    TEST_ASSERT_OK(test_page_dedup_cleanup());
+    TEST_ASSERT_OK(test_page_dedup_setup());
+
+    /* Fill the set, then make capcode 100 the most recently seen */
+    for (uint64_t i = 0; i < PAGE_DEDUP_WAYS; i++) {
+        TEST_ASSERT_EQUALS(_test_page(1000 + i, 100 + i, "PAGE"), false);
+    }
+    TEST_ASSERT_EQUALS(_test_page(2000, 100, "PAGE"), true);
+
+    /* A new capcode evicts the least recently seen, capcode 101 */
+    TEST_ASSERT_EQUALS(_test_page(3000, 200, "PAGE"), false);
+    TEST_ASSERT_EQUALS(_test_page(3001, 100, "PAGE"), true);
+    TEST_ASSERT_EQUALS(_test_page(3002, 101, "PAGE"), false);
+
+    page_dedup_get_stats(dedup, &stats);
+    TEST_ASSERT_EQUALS(stats.nr_capcode_evictions, 2);
+
+    /* Once every page in the set has expired, claiming an entry isn't an early eviction */
+    TEST_ASSERT_EQUALS(_test_page(3002 + TEST_TTL_MS, 300, "PAGE"), false);
+
+    page_dedup_get_stats(dedup, &stats);
+    TEST_ASSERT_EQUALS(stats.nr_capcode_evictions, 2);
+    TEST_ASSERT_EQUALS(stats.nr_unique, PAGE_DEDUP_WAYS + 3);
+    TEST_ASSERT_EQUALS(stats.nr_duplicates, 2);
+
+    return A_OK;
+}
+
+TEST_DECLARE_UNIT(test_page_eviction, page_dedup)
+{
+    struct page_dedup_stats stats;
+    char msg[32];
+
+    TEST_ASSERT_OK(test_page_dedup_cleanup());
+    TEST_ASSERT_OK(test_page_dedup_setup());
+
+    for (size_t i = 0; i < PAGE_DEDUP_PAGES_PER_CAPCODE; i++) {
+        snprintf(msg, sizeof(msg), "PAGE %zu", i);
+        TEST_ASSERT_EQUALS(_test_page(1000 + i, 42, msg), false);
+    }
+
+    /* Seeing the first page again makes the second the least recently seen */
+    TEST_ASSERT_EQUALS(_test_page(2000, 42, "PAGE 0"), true);
+    TEST_ASSERT_EQUALS(_test_page(2001, 42, "ONE TOO MANY"), false);
+
+    TEST_ASSERT_EQUALS(_test_page(2002, 42, "PAGE 0"), true);
+    TEST_ASSERT_EQUALS(_test_page(2003, 42, "PAGE 1"), false);
+
+    page_dedup_get_stats(dedup, &stats);
+    TEST_ASSERT_EQUALS(stats.nr_page_evictions, 2);
+    TEST_ASSERT_EQUALS(stats.nr_capcode_evictions, 0);
+
+    return A_OK;
+}
+
+TEST_DECLARE_SUITE(page_dedup, test_page_dedup_cleanup, test_page_dedup_setup, NULL, NULL);
@@ -392,10 +392,12 @@ aresult_t _direct_fir_process_sample(struct direct_fir *fir, int16_t *psample_re
 
     /* Check if the next sample will start in the following buffer; if so, move along */
     if (fir->sample_offset + fir->decimate_factor > fir->sb_active->nr_samples) {
+        size_t cur_nr_samples = fir->sb_active->nr_samples;
+
         TSL_BUG_IF_FAILED(sample_buf_decref(fir->sb_active));
         fir->sb_active = fir->sb_next;
         fir->sb_next = NULL;
-        fir->sample_offset = (fir->sample_offset + fir->decimate_factor) - fir->sb_active->nr_samples;
+        fir->sample_offset = (fir->sample_offset + fir->decimate_factor) - cur_nr_samples;
     } else {
         fir->sample_offset += fir->decimate_factor;
     }
@@ -125,12 +125,50 @@ aresult_t polyphase_fir_delete(struct polyphase_fir **pfir)
         TFREE(fir->phase_filters);
     }
 
+    if (NULL != fir->phase_biases) {
+        TFREE(fir->phase_biases);
+    }
+
     TFREE(fir);
     *pfir = NULL;
 
     return ret;
 }
 
+aresult_t polyphase_fir_set_input_bias(struct polyphase_fir *fir, int16_t bias)
+{
+    aresult_t ret = A_OK;
+
+    TSL_ASSERT_ARG(NULL != fir);
+
+    if (0 == bias) {
+        if (NULL != fir->phase_biases) {
+            TFREE(fir->phase_biases);
+        }
+        goto done;
+    }
+
+    if (NULL == fir->phase_biases &&
+            FAILED(ret = TCALLOC((void **)&fir->phase_biases, sizeof(int32_t), fir->nr_phase_filters)))
+    {
+        goto done;
+    }
+
+    for (size_t i = 0; i < fir->nr_phase_filters; i++) {
+        int64_t dc_gain = 0;
+
+        for (size_t j = 0; j < fir->nr_filter_coeffs; j++) {
+            dc_gain += fir->phase_filters[i * fir->nr_filter_coeffs + j];
+        }
+
+        /* Q.30 to Q.15, rounding half up like the dot product does */
+        fir->phase_biases[i] = (int32_t)((dc_gain * bias + (1ll << (Q_15_SHIFT - 1))) >> Q_15_SHIFT);
+    }
+
+done:
+    return ret;
+}
+
 aresult_t polyphase_fir_push_sample_buf(struct polyphase_fir *fir, struct sample_buf *buf)
 {
     aresult_t ret = A_OK;
@@ -200,6 +238,11 @@ aresult_t polyphase_fir_process(struct polyphase_fir *fir, int16_t *out_buf, siz
             goto done;
         }
 
+        if (NULL != fir->phase_biases) {
+            int32_t biased = out_buf[i] + fir->phase_biases[phase_id];
+            out_buf[i] = biased > INT16_MAX ? INT16_MAX : biased < INT16_MIN ? INT16_MIN : biased;
+        }
+
         nr_computed_samples++;
 
         /* Calculate the next phase to process */
@@ -232,6 +275,55 @@ done:
     return ret;
 }
 
+aresult_t polyphase_fir_skip(struct polyphase_fir *fir, size_t nr_out_samples, size_t *nr_out_samples_skipped)
+{
+    aresult_t ret = A_OK;
+
+    size_t avail = 0,
+           nr_skip = 0,
+           total_phase = 0,
+           nr_consumed = 0;
+
+    TSL_ASSERT_ARG(NULL != fir);
+    TSL_ASSERT_ARG(NULL != nr_out_samples_skipped);
+
+    *nr_out_samples_skipped = 0;
+
+    if (NULL == fir->sb_active || fir->nr_samples <= fir->nr_filter_coeffs) {
+        goto done;
+    }
+
+    /*
+     * Output k starts floor((last_phase + k * D)/L) samples in, and can be generated as long as
+     * there are more than nr_filter_coeffs samples left from there. This is the same condition
+     * polyphase_fir_process checks for each output, solved for k.
+     */
+    avail = fir->nr_samples - fir->nr_filter_coeffs;
+    nr_skip = (avail * fir->interpolation - fir->last_phase + fir->decimation - 1) / fir->decimation;
+    nr_skip = BL_MIN2(nr_skip, nr_out_samples);
+
+    total_phase = fir->last_phase + nr_skip * fir->decimation;
+    nr_consumed = total_phase / fir->interpolation;
+
+    fir->last_phase = total_phase % fir->interpolation;
+    fir->nr_samples -= nr_consumed;
+    fir->sample_offset += nr_consumed;
+
+    /* Retire the active buffer if we walked off the end of it */
+    if (fir->sample_offset > fir->sb_active->nr_samples) {
+        size_t old_nr_samples = fir->sb_active->nr_samples;
+        TSL_BUG_IF_FAILED(sample_buf_decref(fir->sb_active));
+        fir->sb_active = fir->sb_next;
+        fir->sb_next = NULL;
+        fir->sample_offset -= old_nr_samples;
+    }
+
+    *nr_out_samples_skipped = nr_skip;
+
+done:
+    return ret;
+}
+
 aresult_t polyphase_fir_can_process(struct polyphase_fir *fir, bool *pcan_process)
 {
     aresult_t ret = A_OK;
@@ -10,9 +10,24 @@ struct polyphase_fir;
 aresult_t polyphase_fir_new(struct polyphase_fir **pfir, size_t nr_coeffs, const int16_t *fir_real_coeff,
         unsigned interpolate, unsigned decimate);
 aresult_t polyphase_fir_delete(struct polyphase_fir **pfir);
+/**
+ * Add a constant bias to every input sample. The FIR is linear, so rather than touching every
+ * input sample, each output is offset by the bias times the DC gain of the phase filter that
+ * computed it. The outputs are within 1 of filtering the biased input, saturated to Q.15.
+ */
+aresult_t polyphase_fir_set_input_bias(struct polyphase_fir *fir, int16_t bias);
+
 aresult_t polyphase_fir_push_sample_buf(struct polyphase_fir *fir, struct sample_buf *buf);
 aresult_t polyphase_fir_process(struct polyphase_fir *fir, int16_t *out_buf, size_t nr_out_samples,
         size_t *nr_out_samples_generated);
+
+/**
+ * Advance the resampler past up to nr_out_samples output samples without computing them. The
+ * state afterwards is exactly as if they had been generated by polyphase_fir_process and thrown
+ * away, so a consumer that only looks at some of the output samples can skip the rest.
+ */
+aresult_t polyphase_fir_skip(struct polyphase_fir *fir, size_t nr_out_samples, size_t *nr_out_samples_skipped);
+
 aresult_t polyphase_fir_can_process(struct polyphase_fir *fir, bool *pcan_process);
 aresult_t polyphase_fir_full(struct polyphase_fir *fir, bool *pfull);
 
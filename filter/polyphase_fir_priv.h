@@ -26,6 +26,12 @@ struct polyphase_fir {
      */
     int16_t *phase_filters;
 
+    /**
+     * For each phase filter, the constant its outputs are offset by, if a bias is added to every
+     * input sample. NULL if there is no bias.
+     */
+    int32_t *phase_biases;
+
     /**
      * The number of phase filters in this polyphase FIR
      */
@@ -1,4 +1,9 @@
 #include <filter/filter.h>
+#include <filter/sample_buf.h>
+
+#include <tsl/safe_alloc.h>
+
+#include <stdlib.h>
 
 #include <test/assert.h>
 #include <test/framework.h>
@@ -32,5 +37,194 @@ TEST_DECLARE_UNIT(test_smoke, polyphase)
     return A_OK;
 }
 
+#define TEST_POLYPHASE_BUF_SAMPLES         64
+#define TEST_POLYPHASE_NR_BUFS              16
+#define TEST_POLYPHASE_NR_OUT               1024
+
+static
+aresult_t _test_polyphase_free_buf(struct sample_buf *buf)
+{
+    TFREE(buf);
+    return A_OK;
+}
+
+/**
+ * Make a buffer of a deterministic ramp, offset by bias, with a reference held by each of
+ * nr_refs resamplers
+ */
+static
+aresult_t _test_polyphase_make_buf(struct sample_buf **pbuf, size_t id, int16_t bias, unsigned nr_refs)
+{
+    aresult_t ret = A_OK;
+
+    struct sample_buf *buf = NULL;
+    int16_t *samples = NULL;
+
+    if (FAILED(ret = TCALLOC((void **)&buf, TEST_POLYPHASE_BUF_SAMPLES * sizeof(int16_t) + sizeof(struct sample_buf), 1ul))) {
+        goto done;
+    }
+
+    buf->refcount = nr_refs;
+    buf->nr_samples = TEST_POLYPHASE_BUF_SAMPLES;
+    buf->sample_buf_bytes = TEST_POLYPHASE_BUF_SAMPLES * sizeof(int16_t);
+    buf->release = _test_polyphase_free_buf;
+
+    samples = (int16_t *)buf->data_buf;
+    for (size_t i = 0; i < TEST_POLYPHASE_BUF_SAMPLES; i++) {
+        samples[i] = (int16_t)(((id * TEST_POLYPHASE_BUF_SAMPLES + i) * 37) % 511) - 255 + bias;
+    }
+
+    *pbuf = buf;
+
+done:
+    return ret;
+}
+
+/**
+ * Run two resamplers side by side. One generates every output, the other skips all but every
+ * stride'th output. The outputs that are generated must match.
+ */
+static
+aresult_t _test_polyphase_check_skip(unsigned interp, unsigned decim, size_t stride)
+{
+    struct polyphase_fir *full = NULL,
+                         *lazy = NULL;
+    static int16_t ref[TEST_POLYPHASE_NR_OUT],
+                   out[TEST_POLYPHASE_NR_OUT];
+    size_t nr_ref = 0,
+           nr_out = 0,
+           nr_checked = 0,
+           next_buf = 0;
+
+    TEST_ASSERT_OK(polyphase_fir_new(&full, sizeof(test_polyphase_fir_coeffs)/sizeof(int16_t),
+                test_polyphase_fir_coeffs, interp, decim));
+    TEST_ASSERT_OK(polyphase_fir_new(&lazy, sizeof(test_polyphase_fir_coeffs)/sizeof(int16_t),
+                test_polyphase_fir_coeffs, interp, decim));
+
+    for (;;) {
+        bool full_full = false,
+             lazy_full = false;
+        size_t nr_generated = 0,
+               generated = 0,
+               skipped = 0;
+
+        TEST_ASSERT_OK(polyphase_fir_full(full, &full_full));
+        TEST_ASSERT_OK(polyphase_fir_full(lazy, &lazy_full));
+        TEST_ASSERT_EQUALS(full_full, lazy_full);
+
+        if (false == full_full && next_buf < TEST_POLYPHASE_NR_BUFS) {
+            struct sample_buf *buf = NULL;
+            TEST_ASSERT_OK(_test_polyphase_make_buf(&buf, next_buf++, 0, 2));
+            TEST_ASSERT_OK(polyphase_fir_push_sample_buf(full, buf));
+            TEST_ASSERT_OK(polyphase_fir_push_sample_buf(lazy, buf));
+        }
+
+        TEST_ASSERT_OK(polyphase_fir_process(full, ref + nr_ref, TEST_POLYPHASE_NR_OUT - nr_ref, &nr_generated));
+        nr_ref += nr_generated;
+
+        /* Skip up to the next output we want, then generate just that one */
+        while (nr_out < nr_ref) {
+            if (0 != nr_out % stride) {
+                size_t to_skip = stride - nr_out % stride;
+
+                if (to_skip > nr_ref - nr_out) {
+                    to_skip = nr_ref - nr_out;
+                }
+
+                TEST_ASSERT_OK(polyphase_fir_skip(lazy, to_skip, &skipped));
+                nr_out += skipped;
+                if (0 == skipped) {
+                    break;
+                }
+            } else {
+                TEST_ASSERT_OK(polyphase_fir_process(lazy, out, 1, &generated));
+                if (0 == generated) {
+                    break;
+                }
+                TEST_ASSERT_EQUALS(out[0], ref[nr_out]);
+                nr_out++;
+                nr_checked++;
+            }
+        }
+
+        if (TEST_POLYPHASE_NR_OUT == nr_ref || (0 == nr_generated && next_buf == TEST_POLYPHASE_NR_BUFS)) {
+            break;
+        }
+    }
+
+    TEST_ASSERT_NOT_EQUALS(nr_checked, 0);
+    TEST_ASSERT_EQUALS(nr_out, nr_ref);
+
+    TEST_ASSERT_OK(polyphase_fir_delete(&full));
+    TEST_ASSERT_OK(polyphase_fir_delete(&lazy));
+
+    return A_OK;
+}
+
+TEST_DECLARE_UNIT(test_skip, polyphase)
+{
+    TEST_ASSERT_OK(_test_polyphase_check_skip(3, 2, 1));
+    TEST_ASSERT_OK(_test_polyphase_check_skip(3, 2, 5));
+    TEST_ASSERT_OK(_test_polyphase_check_skip(16, 25, 7));
+    TEST_ASSERT_OK(_test_polyphase_check_skip(1, 1, 32));
+    TEST_ASSERT_OK(_test_polyphase_check_skip(2, 5, 3));
+    return A_OK;
+}
+
+/**
+ * A resampler with an input bias must match one fed the biased samples, to within rounding
+ */
+static
+aresult_t _test_polyphase_check_bias(unsigned interp, unsigned decim, int16_t bias)
+{
+    struct polyphase_fir *biased = NULL,
+                         *ref = NULL;
+    static int16_t ref_out[TEST_POLYPHASE_NR_OUT],
+                   out[TEST_POLYPHASE_NR_OUT];
+    size_t nr_ref = 0,
+           nr_out = 0;
+
+    TEST_ASSERT_OK(polyphase_fir_new(&biased, sizeof(test_polyphase_fir_coeffs)/sizeof(int16_t),
+                test_polyphase_fir_coeffs, interp, decim));
+    TEST_ASSERT_OK(polyphase_fir_new(&ref, sizeof(test_polyphase_fir_coeffs)/sizeof(int16_t),
+                test_polyphase_fir_coeffs, interp, decim));
+    TEST_ASSERT_OK(polyphase_fir_set_input_bias(biased, bias));
+
+    for (size_t next_buf = 0; next_buf < TEST_POLYPHASE_NR_BUFS && nr_out < TEST_POLYPHASE_NR_OUT; next_buf++) {
+        struct sample_buf *buf = NULL;
+        size_t nr_generated = 0;
+
+        TEST_ASSERT_OK(_test_polyphase_make_buf(&buf, next_buf, 0, 1));
+        TEST_ASSERT_OK(polyphase_fir_push_sample_buf(biased, buf));
+        TEST_ASSERT_OK(_test_polyphase_make_buf(&buf, next_buf, bias, 1));
+        TEST_ASSERT_OK(polyphase_fir_push_sample_buf(ref, buf));
+
+        TEST_ASSERT_OK(polyphase_fir_process(biased, out + nr_out, TEST_POLYPHASE_NR_OUT - nr_out, &nr_generated));
+        nr_out += nr_generated;
+        TEST_ASSERT_OK(polyphase_fir_process(ref, ref_out + nr_ref, TEST_POLYPHASE_NR_OUT - nr_ref, &nr_generated));
+        nr_ref += nr_generated;
+    }
+
+    TEST_ASSERT_NOT_EQUALS(nr_out, 0);
+    TEST_ASSERT_EQUALS(nr_out, nr_ref);
+
+    for (size_t i = 0; i < nr_out; i++) {
+        TEST_ASSERT_EQUALS(abs(out[i] - ref_out[i]) <= 1, true);
+    }
+
+    TEST_ASSERT_OK(polyphase_fir_delete(&biased));
+    TEST_ASSERT_OK(polyphase_fir_delete(&ref));
+
+    return A_OK;
+}
+
+TEST_DECLARE_UNIT(test_input_bias, polyphase)
+{
+    TEST_ASSERT_OK(_test_polyphase_check_bias(3, 2, 100));
+    TEST_ASSERT_OK(_test_polyphase_check_bias(16, 25, -77));
+    TEST_ASSERT_OK(_test_polyphase_check_bias(1, 1, 255));
+    return A_OK;
+}
+
 TEST_DECLARE_SUITE(polyphase, test_polyphase_fir_cleanup, test_polyphase_fir_setup, NULL, NULL);
 
@@ -0,0 +1,222 @@
+/*
+ *  msgcat.c - Convert binary decoder output back to JSON
+ *
+ *  Copyright (c)2017 Phil Vachon <phil@security-embedded.com>
+ *
+ *  This file is a part of The Standard Library (TSL)
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ */
+#include <decoder/msg_record.h>
+#include <decoder/msg_sink.h>
+
+#include <app/app.h>
+
+#include <tsl/diag.h>
+#include <tsl/errors.h>
+#include <tsl/assert.h>
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <string.h>
+
+#define MCAT_MSG(sev, sys, msg, ...) MESSAGE("MSGCAT", sev, sys, msg, ##__VA_ARGS__)
+
+/**
+ * Size of the read buffer. Must hold at least two of the largest records, so there's always
+ * room to read the rest of a record that straddles the end of the buffer.
+ */
+#define MSGCAT_BUF_LEN              (4 * MSG_SINK_MAX_RECORD)
+
+/**
+ * The read buffer. Records are 8 byte aligned in the file, and are kept aligned in here.
+ */
+static
+uint64_t read_buf[MSGCAT_BUF_LEN / sizeof(uint64_t)];
+
+static
+struct msg_sink *sink = NULL;
+
+static
+void _usage(const char *appname)
+{
+    MCAT_MSG(SEV_INFO, "USAGE", "%s [file ...]", appname);
+    MCAT_MSG(SEV_INFO, "USAGE", "Converts binary message records written by decoder -O binary to JSON,");
+    MCAT_MSG(SEV_INFO, "USAGE", "one message per line, on stdout. Reads stdin if no files are given.");
+    exit(EXIT_SUCCESS);
+}
+
+/**
+ * Convert all the complete records in the buffer. Returns the number of bytes consumed in
+ * pconsumed; whatever is left over is the start of a record that hasn't been read in yet.
+ */
+static
+aresult_t _msgcat_convert(const char *name, const uint8_t *buf, size_t len, size_t *pconsumed, size_t base_offs)
+{
+    aresult_t ret = A_OK;
+
+    size_t offs = 0;
+
+    while (offs < len) {
+        const struct msg_record_hdr *hdr = (const void *)(buf + offs);
+        size_t avail = len - offs;
+
+        /* File headers can show up anywhere, if archives were concatenated */
+        if (avail >= sizeof(struct msg_record_file_hdr) &&
+                !memcmp(buf + offs, MSG_RECORD_FILE_MAGIC, sizeof(((struct msg_record_file_hdr *)0)->magic)))
+        {
+            const struct msg_record_file_hdr *fhdr = (const void *)(buf + offs);
+
+            if (MSG_RECORD_VERSION != fhdr->version || sizeof(struct msg_record_hdr) != fhdr->hdr_bytes) {
+                MCAT_MSG(SEV_ERROR, "BAD-VERSION", "%s: unsupported record version %u (header is %u bytes) at offset %zu",
+                        name, fhdr->version, fhdr->hdr_bytes, base_offs + offs);
+                ret = A_E_INVAL;
+                goto done;
+            }
+
+            offs += sizeof(*fhdr);
+            continue;
+        }
+
+        ret = msg_record_check(hdr, avail);
+
+        if (A_E_BUSY == ret) {
+            /* Need more bytes */
+            ret = A_OK;
+            break;
+        } else if (FAILED(ret)) {
+            MCAT_MSG(SEV_ERROR, "BAD-RECORD", "%s: malformed record at offset %zu, aborting.",
+                    name, base_offs + offs);
+            goto done;
+        }
+
+        msg_sink_begin(sink);
+        msg_record_put_json(sink, hdr, msg_record_fields(hdr), msg_record_payload(hdr));
+        msg_sink_commit(sink);
+
+        offs += hdr->len;
+    }
+
+done:
+    *pconsumed = offs;
+    return ret;
+}
+
+static
+aresult_t _msgcat_file(const char *name, int fd)
+{
+    aresult_t ret = A_OK;
+
+    uint8_t *buf = (uint8_t *)read_buf;
+    size_t len = 0,
+           base_offs = 0;
+
+    for (;;) {
+        ssize_t nr_read = 0;
+        size_t consumed = 0;
+
+        if (0 > (nr_read = read(fd, buf + len, sizeof(read_buf) - len))) {
+            int errnum = errno;
+
+            if (EINTR == errnum) {
+                continue;
+            }
+
+            MCAT_MSG(SEV_ERROR, "READ-FAIL", "%s: failed to read: %s (%d)", name, strerror(errnum), errnum);
+            ret = A_E_INVAL;
+            goto done;
+        }
+
+        if (0 == nr_read) {
+            break;
+        }
+
+        len += nr_read;
+
+        if (FAILED(ret = _msgcat_convert(name, buf, len, &consumed, base_offs))) {
+            goto done;
+        }
+
+        memmove(buf, buf + consumed, len - consumed);
+        len -= consumed;
+        base_offs += consumed;
+    }
+
+    if (0 != len) {
+        MCAT_MSG(SEV_WARNING, "TRUNCATED", "%s: ignoring %zu bytes of partial record at the end of the file.",
+                name, len);
+    }
+
+done:
+    return ret;
+}
+
+int main(int argc, char * const argv[])
+{
+    int ret = EXIT_FAILURE,
+        arg = -1;
+
+    TSL_BUG_IF_FAILED(app_init("msgcat", NULL));
+
+    while ((arg = getopt(argc, argv, "h")) != -1) {
+        switch (arg) {
+        case 'h':
+        default:
+            _usage(argv[0]);
+            break;
+        }
+    }
+
+    if (FAILED(msg_sink_new(&sink, STDOUT_FILENO, 64 * 1024, 250))) {
+        MCAT_MSG(SEV_FATAL, "SINK-FAILED", "Failed to set up the output, aborting.");
+        goto done;
+    }
+
+    if (optind >= argc) {
+        if (FAILED(_msgcat_file("stdin", STDIN_FILENO))) {
+            goto done;
+        }
+    }
+
+    for (int i = optind; i < argc; i++) {
+        int fd = -1;
+        aresult_t fret = A_OK;
+
+        if (0 > (fd = open(argv[i], O_RDONLY))) {
+            int errnum = errno;
+            MCAT_MSG(SEV_ERROR, "OPEN-FAIL", "Failed to open %s: %s (%d)", argv[i], strerror(errnum), errnum);
+            goto done;
+        }
+
+        fret = _msgcat_file(argv[i], fd);
+        close(fd);
+
+        if (FAILED(fret)) {
+            goto done;
+        }
+    }
+
+    ret = EXIT_SUCCESS;
+
+done:
+    if (NULL != sink) {
+        msg_sink_delete(&sink);
+    }
+
+    return ret;
+}
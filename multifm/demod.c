@@ -192,17 +192,17 @@ aresult_t demod_thread_delete(struct demod_thread **pthr)
 /**
  * Prepare a FIR for channelizing. Converts tuned LPF to a band-pass filter.
  *
- * \param thr The thread to attach the FIR to
+ * \param fir The direct-form FIR to initialize
  * \param lpf_taps The taps for the direct-form FIR. These are real, the filter must be at baseband.
  * \param lpf_nr_taps The number of taps in the direct-form FIR. This is the order of the filter + 1.
  * \param offset_hz The offset, in hertz, from the center frequency
  * \param sample_rate The sample rate of the input stream
  * \param decimation The decimation factor for the output from this FIR.
+ * \param gain The linear gain to apply to the filter taps
  *
  * \return A_OK on success, an error code otherwise
  */
-static
-aresult_t _demod_fir_prepare(struct demod_thread *thr, const double *lpf_taps, size_t lpf_nr_taps, int32_t offset_hz, uint32_t sample_rate, int decimation, double gain)
+aresult_t demod_fir_prepare(struct direct_fir *fir, const double *lpf_taps, size_t lpf_nr_taps, int32_t offset_hz, uint32_t sample_rate, int decimation, double gain)
 {
     aresult_t ret = A_OK;
 
@@ -216,7 +216,7 @@ aresult_t _demod_fir_prepare(struct demod_thread *thr, const double *lpf_taps, s
 
     DIAG("Preparing LPF for offset %d Hz", offset_hz);
 
-    TSL_ASSERT_ARG(NULL != thr);
+    TSL_ASSERT_ARG(NULL != fir);
     TSL_ASSERT_ARG(NULL != lpf_taps);
     TSL_ASSERT_ARG(0 != lpf_nr_taps);
 
@@ -258,7 +258,7 @@ aresult_t _demod_fir_prepare(struct demod_thread *thr, const double *lpf_taps, s
 #endif /* defined(_DUMP_LPF) */
 
     /* Create a Direct Type FIR implementation */
-    TSL_BUG_IF_FAILED(direct_fir_init(&thr->fir, lpf_nr_taps, coeffs, &coeffs[base], decimation, true, sample_rate, offset_hz));
+    TSL_BUG_IF_FAILED(direct_fir_init(fir, lpf_nr_taps, coeffs, &coeffs[base], decimation, true, sample_rate, offset_hz));
 
 done:
     if (NULL != coeffs) {
@@ -311,7 +311,7 @@ aresult_t demod_thread_new(struct demod_thread **pthr, unsigned core_id,
     }
 
     /* Initialize the filter */
-    if (FAILED(ret = _demod_fir_prepare(thr, lpf_taps, lpf_nr_taps, offset_hz, samp_hz, decimation_factor, channel_gain))) {
+    if (FAILED(ret = demod_fir_prepare(&thr->fir, lpf_taps, lpf_nr_taps, offset_hz, samp_hz, decimation_factor, channel_gain))) {
         goto done;
     }
 
@@ -115,3 +115,10 @@ aresult_t demod_thread_new(struct demod_thread **pthr, unsigned core_id,
         const char *fir_debug_output,
         double channel_gain);
 
+/**
+ * Initialize a direct-form FIR that selects the channel at offset_hz from the center frequency,
+ * shifting the real-valued baseband LPF to be a complex band-pass filter.
+ */
+aresult_t demod_fir_prepare(struct direct_fir *fir, const double *lpf_taps, size_t lpf_nr_taps,
+        int32_t offset_hz, uint32_t sample_rate, int decimation, double gain);
+
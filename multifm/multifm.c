@@ -37,6 +37,7 @@
 #endif
 
 #include <multifm/file_if.h>
+#include <multifm/synthetic_if.h>
 
 #include <multifm/receiver.h>
 
@@ -150,6 +151,12 @@ int main(int argc, const char *argv[])
     } else if (!strncmp(dev_type, "file", 4)) {
         /* Source samples from a binary file o' samples */
         TSL_BUG_IF_FAILED(file_worker_thread_new(&rx_thr, cfg));
+    } else if (!strncmp(dev_type, "synthetic", 9)) {
+        /* Generate a synthetic multi-carrier signal, for load testing */
+        if (FAILED(synthetic_worker_thread_new(&rx_thr, cfg))) {
+            MFM_MSG(SEV_FATAL, "SYNTHETIC-FAILED", "Failed to set up the synthetic signal source, aborting.");
+            goto done;
+        }
     } else {
         MFM_MSG(SEV_FATAL, "UNKNOWN-DEV-TYPE", "Unknown device type: '%s'", dev_type);
         goto done;
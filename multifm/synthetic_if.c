@@ -0,0 +1,735 @@
+/*
+ *  synthetic_if.c - Synthetic multi-carrier receiver, for load testing without
+ *      real RF or a large recording.
+ *
+ *  Copyright (c)2017 Phil Vachon <phil@security-embedded.com>
+ *
+ *  This file is a part of The Standard Library (TSL)
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ */
+
+#include <multifm/synthetic_if.h>
+#include <multifm/synthetic_if_priv.h>
+#include <multifm/receiver.h>
+
+#include <synth/noise.h>
+#include <synth/fm_mod.h>
+#include <synth/baseband.h>
+#include <synth/pocsag_enc.h>
+#include <synth/flex_enc.h>
+#include <synth/ais_enc.h>
+
+#include <ais/ais_decode.h>
+
+#include <config/engine.h>
+
+#include <filter/sample_buf.h>
+
+#include <tsl/assert.h>
+#include <tsl/diag.h>
+#include <tsl/errors.h>
+#include <tsl/safe_alloc.h>
+
+#include <unistd.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#define SAMPLES_PER_BUF                 (4 * 1024)
+
+/**
+ * Peak amplitude of the generated I/Q samples, leaving a bit of headroom for the noise tails.
+ */
+#define SYNTHETIC_PEAK_AMPLITUDE        30000.0f
+
+static
+aresult_t _synthetic_worker_thread_work(struct receiver *rx)
+{
+    aresult_t ret = A_OK;
+
+    struct synthetic_worker_thread *thr = NULL;
+    uint64_t next_deadline = 0;
+
+    TSL_ASSERT_ARG(NULL != rx);
+
+    thr = BL_CONTAINER_OF(rx, struct synthetic_worker_thread, rcvr);
+
+    next_deadline = tsl_get_clock_monotonic();
+
+    while (receiver_thread_running(rx)) {
+        struct sample_buf *sbuf = NULL;
+        int16_t *out_buf = NULL;
+        size_t nr_copied = 0;
+
+        if (thr->real_time) {
+            /* Pace against an absolute schedule, so sleep jitter doesn't accumulate */
+            uint64_t now = tsl_get_clock_monotonic();
+            if (now < next_deadline) {
+                usleep((next_deadline - now)/1000);
+            }
+            next_deadline += thr->time_per_buf_ns;
+        }
+
+        if (FAILED(receiver_sample_buf_alloc(rx, &sbuf))) {
+            if (thr->real_time) {
+                /* A real device would have dropped these samples; so do we. */
+                thr->nr_dropped_bufs++;
+                thr->loop_offset = (thr->loop_offset + SAMPLES_PER_BUF) % thr->loop_nr_samples;
+            } else {
+                /* Free-running, so just wait for the demodulators to catch up */
+                usleep(100);
+            }
+            continue;
+        }
+
+        out_buf = (int16_t *)sbuf->data_buf;
+
+        /* Copy out of the loop buffer, wrapping around as needed */
+        while (nr_copied < SAMPLES_PER_BUF) {
+            size_t nr_copy = BL_MIN2(SAMPLES_PER_BUF - nr_copied, thr->loop_nr_samples - thr->loop_offset);
+
+            memcpy(&out_buf[2 * nr_copied], &thr->loop_buf[2 * thr->loop_offset],
+                    nr_copy * 2 * sizeof(int16_t));
+
+            nr_copied += nr_copy;
+            thr->loop_offset += nr_copy;
+
+            if (thr->loop_offset == thr->loop_nr_samples) {
+                thr->loop_offset = 0;
+            }
+        }
+
+        sbuf->sample_type = COMPLEX_INT_16;
+        sbuf->nr_samples = SAMPLES_PER_BUF;
+
+        TSL_BUG_IF_FAILED(receiver_sample_buf_deliver(rx, sbuf));
+    }
+
+    return ret;
+}
+
+static
+aresult_t _synthetic_worker_thread_cleanup(struct receiver *rx)
+{
+    aresult_t ret = A_OK;
+
+    struct synthetic_worker_thread *swt = NULL;
+
+    TSL_ASSERT_ARG(NULL != rx);
+
+    swt = BL_CONTAINER_OF(rx, struct synthetic_worker_thread, rcvr);
+
+    if (0 != swt->nr_dropped_bufs) {
+        SYN_IF_MSG(SEV_INFO, "DROPPED-BUFFERS", "Dropped %zu buffers (%zu samples) during the run",
+                swt->nr_dropped_bufs, swt->nr_dropped_bufs * SAMPLES_PER_BUF);
+    }
+
+    if (NULL != swt->loop_buf) {
+        TFREE(swt->loop_buf);
+    }
+
+    return ret;
+}
+
+static
+aresult_t _synthetic_payload_parse(const char *payload, enum synthetic_payload *ppayload)
+{
+    aresult_t ret = A_OK;
+
+    TSL_ASSERT_ARG(NULL != payload);
+    TSL_ASSERT_ARG(NULL != ppayload);
+
+    if (!strcmp(payload, "carrier")) {
+        *ppayload = SYNTHETIC_PAYLOAD_CARRIER;
+    } else if (!strcmp(payload, "tone")) {
+        *ppayload = SYNTHETIC_PAYLOAD_TONE;
+    } else if (!strcmp(payload, "fsk")) {
+        *ppayload = SYNTHETIC_PAYLOAD_FSK;
+    } else if (!strcmp(payload, "pocsag")) {
+        *ppayload = SYNTHETIC_PAYLOAD_POCSAG;
+    } else if (!strcmp(payload, "flex")) {
+        *ppayload = SYNTHETIC_PAYLOAD_FLEX;
+    } else if (!strcmp(payload, "ais")) {
+        *ppayload = SYNTHETIC_PAYLOAD_AIS;
+    } else {
+        SYN_IF_MSG(SEV_FATAL, "UNKNOWN-PAYLOAD", "Payload type [%s] is not supported, aborting.", payload);
+        ret = A_E_INVAL;
+    }
+
+    return ret;
+}
+
+/**
+ * Generate a random FSK baseband signal, filling the entire buffer.
+ */
+static
+aresult_t _synthetic_fsk_baseband(float *baseband, size_t nr_samples, uint32_t sample_rate,
+        int baud_rate, int nr_levels, struct synth_noise *noise)
+{
+    aresult_t ret = A_OK;
+
+    int8_t *levels = NULL;
+    size_t nr_symbols = 0,
+           nr_generated = 0;
+    double samples_per_symbol = 0.0;
+
+    TSL_ASSERT_ARG(NULL != baseband);
+    TSL_ASSERT_ARG(NULL != noise);
+
+    if (0 >= baud_rate || (unsigned)baud_rate > sample_rate) {
+        SYN_IF_MSG(SEV_FATAL, "BAD-BAUD-RATE", "Baud rate of %d is not valid at a sample rate of %u",
+                baud_rate, sample_rate);
+        ret = A_E_INVAL;
+        goto done;
+    }
+
+    if (2 != nr_levels && 4 != nr_levels) {
+        SYN_IF_MSG(SEV_FATAL, "BAD-FSK-LEVELS", "Only 2FSK and 4FSK are supported (asked for %d levels)",
+                nr_levels);
+        ret = A_E_INVAL;
+        goto done;
+    }
+
+    samples_per_symbol = (double)sample_rate / (double)baud_rate;
+    nr_symbols = (size_t)ceil((double)nr_samples / samples_per_symbol) + 1;
+
+    if (FAILED(ret = TACALLOC((void **)&levels, nr_symbols, sizeof(int8_t), SYS_CACHE_LINE_LENGTH))) {
+        goto done;
+    }
+
+    /* Map random symbols onto -1/+1, or -3/-1/+1/+3 */
+    for (size_t i = 0; i < nr_symbols; i++) {
+        levels[i] = 2 * (int8_t)(synth_noise_uniform(noise) % (unsigned)nr_levels) - (nr_levels - 1);
+    }
+
+    if (FAILED(ret = synth_fsk_generate(baseband, nr_samples, samples_per_symbol, levels, nr_symbols,
+                    1.0f/(float)(nr_levels - 1), &nr_generated)))
+    {
+        goto done;
+    }
+
+    TSL_BUG_ON(nr_generated != nr_samples);
+
+done:
+    if (NULL != levels) {
+        TFREE(levels);
+    }
+
+    return ret;
+}
+
+/**
+ * Encode a single protocol transmission, as described by the carrier configuration. Returns the
+ * symbol levels, the symbol rate and the deviation for a level of 1.
+ */
+static
+aresult_t _synthetic_protocol_encode(struct config *carrier, enum synthetic_payload payload, int8_t **plevels,
+        size_t *pnr_levels, double *psymbol_rate, int *pdeviation)
+{
+    aresult_t ret = A_OK;
+
+    const char *message = "TSL-SDR SYNTHETIC TEST PAGE",
+               *speed_name = NULL;
+    int capcode = 1234567,
+        baud_rate = 1200;
+
+    TSL_ASSERT_ARG(NULL != carrier);
+    TSL_ASSERT_ARG(NULL != plevels);
+    TSL_ASSERT_ARG(NULL != pnr_levels);
+    TSL_ASSERT_ARG(NULL != psymbol_rate);
+    TSL_ASSERT_ARG(NULL != pdeviation);
+
+    if (FAILED(config_get_string(carrier, &message, "message"))) {
+        message = "TSL-SDR SYNTHETIC TEST PAGE";
+    }
+
+    if (FAILED(config_get_integer(carrier, &capcode, "capcode"))) {
+        capcode = 1234567;
+    }
+
+    switch (payload) {
+    case SYNTHETIC_PAYLOAD_POCSAG: {
+            struct synth_pocsag_enc *enc = NULL;
+            struct synth_pocsag_msg msg = {
+                .capcode = capcode,
+                .function = 3,
+                .type = SYNTH_POCSAG_MSG_TYPE_ALPHA,
+                .msg = message,
+            };
+
+            if (FAILED(config_get_integer(carrier, &baud_rate, "baudRate"))) {
+                baud_rate = 1200;
+            }
+
+            if (512 != baud_rate && 1200 != baud_rate && 2400 != baud_rate) {
+                SYN_IF_MSG(SEV_FATAL, "BAD-BAUD-RATE", "POCSAG baud rate must be 512, 1200 or 2400 (got %d)",
+                        baud_rate);
+                ret = A_E_INVAL;
+                goto done;
+            }
+
+            TSL_BUG_IF_FAILED(synth_pocsag_enc_new(&enc));
+            ret = synth_pocsag_enc_transmission(enc, &msg, 1, plevels, pnr_levels);
+            TSL_BUG_IF_FAILED(synth_pocsag_enc_delete(&enc));
+
+            *psymbol_rate = baud_rate;
+            *pdeviation = 4500;
+        }
+        break;
+    case SYNTHETIC_PAYLOAD_FLEX: {
+            struct synth_flex_enc *enc = NULL;
+            enum synth_flex_speed speed = SYNTH_FLEX_SPEED_1600_2FSK;
+            struct synth_flex_msg msg = {
+                .capcode = capcode,
+                .type = SYNTH_FLEX_MSG_TYPE_ALPHA,
+                .msg = message,
+            };
+
+            if (!FAILED(config_get_string(carrier, &speed_name, "flexSpeed")) &&
+                    FAILED(ret = synth_flex_speed_parse(speed_name, &speed)))
+            {
+                SYN_IF_MSG(SEV_FATAL, "BAD-FLEX-SPEED", "Unknown FLEX speed [%s], aborting.", speed_name);
+                goto done;
+            }
+
+            TSL_BUG_IF_FAILED(synth_flex_enc_new(&enc));
+            ret = synth_flex_enc_frame(enc, speed, 0, 0, &msg, 1, plevels, pnr_levels);
+            TSL_BUG_IF_FAILED(synth_flex_enc_delete(&enc));
+
+            *psymbol_rate = SYNTH_FLEX_SYMBOL_RATE;
+            *pdeviation = SYNTH_FLEX_LEVEL_DEVIATION_HZ;
+        }
+        break;
+    case SYNTHETIC_PAYLOAD_AIS: {
+            struct ais_position_report rpt;
+            uint8_t packet[SYNTH_AIS_POSITION_REPORT_BYTES];
+            int mmsi = 316001234;
+
+            if (FAILED(config_get_integer(carrier, &mmsi, "mmsi"))) {
+                mmsi = 316001234;
+            }
+
+            memset(&rpt, 0, sizeof(rpt));
+            rpt.mmsi = mmsi;
+            rpt.rate_of_turn = -128;
+            rpt.latitude = 49.2827f;
+            rpt.longitude = -123.1207f;
+            rpt.heading = 511;
+
+            TSL_BUG_IF_FAILED(synth_ais_position_report_pack(1, &rpt, packet, sizeof(packet)));
+            ret = synth_ais_enc_frame(packet, sizeof(packet), plevels, pnr_levels);
+
+            *psymbol_rate = SYNTH_AIS_BIT_RATE;
+            *pdeviation = SYNTH_AIS_LEVEL_DEVIATION_HZ;
+        }
+        break;
+    default:
+        PANIC("Not a protocol payload, aborting.");
+    }
+
+done:
+    return ret;
+}
+
+/**
+ * Fill the baseband buffer with back-to-back copies of a protocol transmission, each followed by
+ * a gap of unmodulated carrier. Returns the deviation to use for a full-scale baseband sample.
+ */
+static
+aresult_t _synthetic_protocol_baseband(struct config *carrier, enum synthetic_payload payload, float *baseband,
+        size_t nr_samples, uint32_t sample_rate, int *pdeviation)
+{
+    aresult_t ret = A_OK;
+
+    int8_t *levels = NULL;
+    size_t nr_levels = 0,
+           nr_filled = 0;
+    double symbol_rate = 0.0,
+           samples_per_symbol = 0.0;
+    int level_deviation = 0,
+        gap_ms = 250,
+        max_level = 1;
+
+    TSL_ASSERT_ARG(NULL != carrier);
+    TSL_ASSERT_ARG(NULL != baseband);
+    TSL_ASSERT_ARG(NULL != pdeviation);
+
+    if (FAILED(ret = _synthetic_protocol_encode(carrier, payload, &levels, &nr_levels, &symbol_rate,
+                    &level_deviation)))
+    {
+        goto done;
+    }
+
+    if (FAILED(config_get_integer(carrier, &gap_ms, "gapMs"))) {
+        gap_ms = 250;
+    }
+
+    for (size_t i = 0; i < nr_levels; i++) {
+        if (abs(levels[i]) > max_level) {
+            max_level = abs(levels[i]);
+        }
+    }
+
+    samples_per_symbol = (double)sample_rate / symbol_rate;
+
+    memset(baseband, 0, nr_samples * sizeof(float));
+
+    while (nr_filled < nr_samples) {
+        size_t nr_generated = 0;
+
+        if (FAILED(ret = synth_fsk_generate(&baseband[nr_filled], nr_samples - nr_filled, samples_per_symbol,
+                        levels, nr_levels, 1.0f/(float)max_level, &nr_generated)))
+        {
+            goto done;
+        }
+
+        nr_filled += nr_generated + (size_t)gap_ms * sample_rate / 1000;
+    }
+
+    *pdeviation = level_deviation * max_level;
+
+done:
+    if (NULL != levels) {
+        TFREE(levels);
+    }
+
+    return ret;
+}
+
+/**
+ * Generate a single carrier, as described by its configuration, and add it to the wideband
+ * accumulator.
+ */
+static
+aresult_t _synthetic_carrier_generate(struct config *carrier, uint32_t sample_rate, int center_freq,
+        float *accum, float *baseband, size_t nr_samples, struct synth_noise *noise)
+{
+    aresult_t ret = A_OK;
+
+    const char *payload_name = NULL;
+    enum synthetic_payload payload = SYNTHETIC_PAYLOAD_UNKNOWN;
+    int carrier_freq = 0,
+        deviation = 5000,
+        tone_freq = 1000,
+        baud_rate = 1600,
+        nr_levels = 2;
+    double level_db = 0.0;
+    struct synth_fm_mod mod;
+
+    TSL_ASSERT_ARG(NULL != carrier);
+    TSL_ASSERT_ARG(NULL != accum);
+    TSL_ASSERT_ARG(NULL != baseband);
+    TSL_ASSERT_ARG(NULL != noise);
+
+    if (FAILED(ret = config_get_integer(carrier, &carrier_freq, "carrierFreqHz"))) {
+        SYN_IF_MSG(SEV_FATAL, "MISSING-CARRIER-FREQ", "Each carrier needs a 'carrierFreqHz', aborting.");
+        goto done;
+    }
+
+    if (FAILED(ret = config_get_string(carrier, &payload_name, "payload"))) {
+        SYN_IF_MSG(SEV_FATAL, "MISSING-PAYLOAD", "Each carrier needs a 'payload' type, aborting.");
+        goto done;
+    }
+
+    if (FAILED(ret = _synthetic_payload_parse(payload_name, &payload))) {
+        goto done;
+    }
+
+    if (FAILED(config_get_integer(carrier, &deviation, "deviationHz"))) {
+        deviation = 5000;
+    }
+
+    if (FAILED(config_get_float(carrier, &level_db, "dBLevel"))) {
+        level_db = 0.0;
+    }
+
+    switch (payload) {
+    case SYNTHETIC_PAYLOAD_CARRIER:
+        break;
+    case SYNTHETIC_PAYLOAD_TONE:
+        if (FAILED(config_get_integer(carrier, &tone_freq, "toneHz"))) {
+            tone_freq = 1000;
+        }
+
+        if (FAILED(ret = synth_tone_generate(baseband, nr_samples, sample_rate, tone_freq))) {
+            goto done;
+        }
+        break;
+    case SYNTHETIC_PAYLOAD_FSK:
+        if (FAILED(config_get_integer(carrier, &baud_rate, "baudRate"))) {
+            baud_rate = 1600;
+        }
+
+        if (FAILED(config_get_integer(carrier, &nr_levels, "fskLevels"))) {
+            nr_levels = 2;
+        }
+
+        if (FAILED(ret = _synthetic_fsk_baseband(baseband, nr_samples, sample_rate, baud_rate, nr_levels, noise))) {
+            goto done;
+        }
+        break;
+    case SYNTHETIC_PAYLOAD_POCSAG:
+    case SYNTHETIC_PAYLOAD_FLEX:
+    case SYNTHETIC_PAYLOAD_AIS: {
+            int protocol_deviation = 0;
+
+            if (FAILED(ret = _synthetic_protocol_baseband(carrier, payload, baseband, nr_samples, sample_rate,
+                            &protocol_deviation)))
+            {
+                goto done;
+            }
+
+            /* Protocols have a natural deviation, unless the configuration overrides it */
+            if (FAILED(config_get_integer(carrier, &deviation, "deviationHz"))) {
+                deviation = protocol_deviation;
+            }
+        }
+        break;
+    default:
+        PANIC("Payload type is corrupted, aborting.");
+    }
+
+    if (FAILED(ret = synth_fm_mod_init(&mod, sample_rate, carrier_freq - center_freq, deviation))) {
+        goto done;
+    }
+
+    if (FAILED(ret = synth_fm_mod_process(&mod, SYNTHETIC_PAYLOAD_CARRIER == payload ? NULL : baseband,
+                    nr_samples, (float)pow(10.0, level_db/20.0), accum)))
+    {
+        goto done;
+    }
+
+    SYN_IF_MSG(SEV_INFO, "CARRIER", "%4.5f MHz: %s, deviation %d Hz, level %f dB",
+            (double)carrier_freq/1e6, payload_name, deviation, level_db);
+
+done:
+    return ret;
+}
+
+/**
+ * Generate the loop buffer. All the expensive work happens here, up front, so that
+ * playback costs no more than a memcpy and doesn't pollute measurements.
+ */
+static
+aresult_t _synthetic_loop_generate(struct synthetic_worker_thread *thr, struct config *cfg,
+        struct config *devcfg)
+{
+    aresult_t ret = A_OK;
+
+    float *accum = NULL,
+          *baseband = NULL;
+    struct config carriers = CONFIG_INIT_EMPTY,
+                  carrier = CONFIG_INIT_EMPTY;
+    struct synth_noise noise;
+    size_t arr_ctr = 0,
+           nr_samples = 0;
+    int center_freq = 0,
+        loop_ms = 2000,
+        noise_bw = 25000,
+        seed = 0;
+    double snr_db = 0.0;
+    float peak = 0.0f,
+          scale = 0.0f;
+    bool add_noise = true;
+
+    TSL_ASSERT_ARG(NULL != thr);
+    TSL_ASSERT_ARG(NULL != cfg);
+    TSL_ASSERT_ARG(NULL != devcfg);
+
+    if (FAILED(ret = config_get_integer(cfg, &center_freq, "centerFreqHz"))) {
+        SYN_IF_MSG(SEV_FATAL, "NO-CENTER-FREQ", "Need to specify a center frequency, in Hz.");
+        goto done;
+    }
+
+    if (FAILED(config_get_integer(devcfg, &loop_ms, "loopLengthMs"))) {
+        loop_ms = 2000;
+    }
+
+    if (0 >= loop_ms) {
+        SYN_IF_MSG(SEV_FATAL, "BAD-LOOP-LENGTH", "Loop length of %d ms is not valid.", loop_ms);
+        ret = A_E_INVAL;
+        goto done;
+    }
+
+    if (FAILED(config_get_float(devcfg, &snr_db, "snrDb"))) {
+        add_noise = false;
+    }
+
+    if (FAILED(config_get_integer(devcfg, &noise_bw, "noiseBandwidthHz"))) {
+        noise_bw = 25000;
+    }
+
+    if (0 >= noise_bw) {
+        SYN_IF_MSG(SEV_FATAL, "BAD-NOISE-BANDWIDTH", "Noise bandwidth of %d Hz is not valid.", noise_bw);
+        ret = A_E_INVAL;
+        goto done;
+    }
+
+    if (FAILED(config_get_integer(devcfg, &seed, "seed"))) {
+        seed = 0;
+    }
+
+    TSL_BUG_IF_FAILED(synth_noise_init(&noise, (uint64_t)seed));
+
+    nr_samples = ((uint64_t)thr->sample_rate * loop_ms)/1000;
+
+    if (nr_samples < SAMPLES_PER_BUF) {
+        nr_samples = SAMPLES_PER_BUF;
+    }
+
+    if (FAILED(ret = TACALLOC((void **)&accum, nr_samples, 2 * sizeof(float), SYS_CACHE_LINE_LENGTH))) {
+        goto done;
+    }
+
+    if (FAILED(ret = TACALLOC((void **)&baseband, nr_samples, sizeof(float), SYS_CACHE_LINE_LENGTH))) {
+        goto done;
+    }
+
+    if (FAILED(ret = config_get(devcfg, &carriers, "carriers"))) {
+        SYN_IF_MSG(SEV_FATAL, "MISSING-CARRIERS", "Need to specify at least one carrier to generate.");
+        goto done;
+    }
+
+    CONFIG_ARRAY_FOR_EACH(carrier, &carriers, ret, arr_ctr) {
+        if (FAILED(ret = _synthetic_carrier_generate(&carrier, thr->sample_rate, center_freq, accum,
+                        baseband, nr_samples, &noise)))
+        {
+            goto done;
+        }
+    }
+
+    if (0 == arr_ctr) {
+        SYN_IF_MSG(SEV_FATAL, "NO-CARRIERS", "Need to specify at least one carrier to generate.");
+        ret = A_E_INVAL;
+        goto done;
+    }
+
+    ret = A_OK;
+
+    if (true == add_noise) {
+        /*
+         * The SNR is that of a 0 dB carrier, measured in the noise bandwidth. Spread the noise
+         * power across the full sampled bandwidth, split evenly between I and Q.
+         */
+        double noise_power = pow(10.0, -snr_db/10.0) * (double)thr->sample_rate / (double)noise_bw;
+        TSL_BUG_IF_FAILED(synth_noise_add_awgn(&noise, accum, 2 * nr_samples, (float)sqrt(noise_power/2.0)));
+    }
+
+    /* Find the peak, and scale everything to fit in 16 bits */
+    for (size_t i = 0; i < 2 * nr_samples; i++) {
+        float mag = fabsf(accum[i]);
+        if (mag > peak) {
+            peak = mag;
+        }
+    }
+
+    scale = 0.0f == peak ? 0.0f : SYNTHETIC_PEAK_AMPLITUDE/peak;
+
+    if (FAILED(ret = TACALLOC((void **)&thr->loop_buf, nr_samples, 2 * sizeof(int16_t), SYS_CACHE_LINE_LENGTH))) {
+        goto done;
+    }
+
+    for (size_t i = 0; i < 2 * nr_samples; i++) {
+        thr->loop_buf[i] = (int16_t)lrintf(accum[i] * scale);
+    }
+
+    thr->loop_nr_samples = nr_samples;
+    thr->loop_offset = 0;
+
+    SYN_IF_MSG(SEV_INFO, "LOOP-GENERATED", "Generated %zu carriers in a %d ms loop (%zu samples)%s",
+            arr_ctr, loop_ms, nr_samples, add_noise ? "" : ", no noise");
+    if (true == add_noise) {
+        SYN_IF_MSG(SEV_INFO, "LOOP-SNR", "SNR is %f dB in a %d Hz bandwidth", snr_db, noise_bw);
+    }
+
+done:
+    if (NULL != accum) {
+        TFREE(accum);
+    }
+
+    if (NULL != baseband) {
+        TFREE(baseband);
+    }
+
+    return ret;
+}
+
+aresult_t synthetic_worker_thread_new(struct receiver **pthr, struct config *cfg)
+{
+    aresult_t ret = A_OK;
+
+    struct synthetic_worker_thread *thr = NULL;
+    struct config devcfg = CONFIG_INIT_EMPTY;
+    int sample_rate = 0;
+    bool real_time = true;
+
+    TSL_ASSERT_ARG(NULL != pthr);
+    TSL_ASSERT_ARG(NULL != cfg);
+
+    if (FAILED(ret = config_get(cfg, &devcfg, "device"))) {
+        SYN_IF_MSG(SEV_FATAL, "MISSING-DEVICE-STANZA", "Missing 'device' stanza of configuration, aborting.");
+        goto done;
+    }
+
+    if (FAILED(ret = config_get_integer(cfg, &sample_rate, "sampleRateHz"))) {
+        SYN_IF_MSG(SEV_FATAL, "NO-SAMPLE-RATE", "Need to specify a sample rate, in Hertz.");
+        goto done;
+    }
+
+    if (0 >= sample_rate) {
+        SYN_IF_MSG(SEV_FATAL, "BAD-SAMPLE-RATE", "Sample rate of %d Hz is not valid.", sample_rate);
+        ret = A_E_INVAL;
+        goto done;
+    }
+
+    if (FAILED(config_get_boolean(&devcfg, &real_time, "realTime"))) {
+        real_time = true;
+    }
+
+    if (FAILED(ret = TZAALLOC(thr, SYS_CACHE_LINE_LENGTH))) {
+        goto done;
+    }
+
+    thr->sample_rate = sample_rate;
+    thr->real_time = real_time;
+    thr->time_per_buf_ns = ((uint64_t)SAMPLES_PER_BUF * 1000000000ull)/(uint64_t)sample_rate;
+
+    if (FAILED(ret = _synthetic_loop_generate(thr, cfg, &devcfg))) {
+        goto done;
+    }
+
+    SYN_IF_MSG(SEV_INFO, "CREATING-SYNTHETIC-SOURCE", "Generating samples at %d Hz, %s",
+            sample_rate, real_time ? "paced in real time" : "free-running");
+
+    /* Initialize the receiver subsystem */
+    TSL_BUG_IF_FAILED(receiver_init(&thr->rcvr, cfg, _synthetic_worker_thread_work,
+                _synthetic_worker_thread_cleanup, SAMPLES_PER_BUF));
+
+    *pthr = &thr->rcvr;
+
+done:
+    if (FAILED(ret)) {
+        if (NULL != thr) {
+            if (NULL != thr->loop_buf) {
+                TFREE(thr->loop_buf);
+            }
+            TFREE(thr);
+            thr = NULL;
+        }
+    }
+    return ret;
+}
+
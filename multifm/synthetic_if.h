@@ -0,0 +1,8 @@
+#pragma once
+
+#include <tsl/result.h>
+
+struct receiver;
+struct config;
+
+aresult_t synthetic_worker_thread_new(struct receiver **pthr, struct config *cfg);
@@ -0,0 +1,60 @@
+#pragma once
+
+#include <multifm/receiver.h>
+
+#include <tsl/result.h>
+
+#include <stdbool.h>
+
+enum synthetic_payload {
+    SYNTHETIC_PAYLOAD_UNKNOWN = 0,
+    SYNTHETIC_PAYLOAD_CARRIER,      /* Unmodulated carrier */
+    SYNTHETIC_PAYLOAD_TONE,         /* FM-modulated sine tone */
+    SYNTHETIC_PAYLOAD_FSK,          /* FM-modulated random 2FSK or 4FSK symbols */
+    SYNTHETIC_PAYLOAD_POCSAG,       /* Repeated POCSAG page */
+    SYNTHETIC_PAYLOAD_FLEX,         /* Repeated FLEX frame */
+    SYNTHETIC_PAYLOAD_AIS,          /* Repeated AIS position report */
+};
+
+struct synthetic_worker_thread {
+    struct receiver rcvr;
+
+    /**
+     * The sample rate of the generated stream, in Hz
+     */
+    uint32_t sample_rate;
+
+    /**
+     * Whether or not buffers are paced at the sample rate. If false, buffers are delivered
+     * as fast as the demodulator threads will release them.
+     */
+    bool real_time;
+
+    /**
+     * The time it takes, at the sample rate, to fill one sample buffer
+     */
+    uint64_t time_per_buf_ns;
+
+    /**
+     * Pre-generated interleaved I/Q samples. Played back in a loop.
+     */
+    int16_t *loop_buf;
+
+    /**
+     * The number of complex samples in loop_buf
+     */
+    size_t loop_nr_samples;
+
+    /**
+     * The offset of the next sample to be delivered from loop_buf
+     */
+    size_t loop_offset;
+
+    /**
+     * The number of buffers that could not be delivered because no sample buffer was free
+     */
+    size_t nr_dropped_bufs;
+};
+
+#define SYN_IF_MSG(sev, sys, msg, ...)      MESSAGE("SYNTHIF", sev, sys, msg, ##__VA_ARGS__)
+
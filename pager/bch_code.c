@@ -36,8 +36,20 @@ struct bch_code {
     int *index_of;   // antilog table of GF(2**5)
     int *g;          // coefficients of generator polynomial, g(x) [n - k + 1]=[11]
     int *bb;         // coefficients of redundancy polynomial ( x**(10) i(x) ) modulo g(x)
+    uint16_t *syndrome_lut; // per byte of the received word, the remainder modulo g(x) of its bits
+    uint32_t *error_lut;    // remainder modulo g(x) -> error pattern, or BCH_CODE_UNCORRECTABLE
 };
 
+/**
+ * Flag in the error pattern table for a syndrome that can't be corrected
+ */
+#define BCH_CODE_UNCORRECTABLE          (1ul << 31)
+
+/**
+ * Number of bytes in a received word the syndrome lookup tables cover
+ */
+#define BCH_CODE_SYNDROME_BYTES         4
+
 static
 void generate_gf(struct bch_code *bch_code_data)
 {
@@ -200,6 +212,20 @@ void bch_code_encode(struct bch_code *bch_code_data, int data[])
     };
 };
 
+void bch_code_get_redundancy(struct bch_code *bch_code_data, int bb[])
+{
+    TSL_BUG_ON(NULL == bch_code_data);
+    TSL_BUG_ON(NULL == bb);
+
+    /*
+     * Copy out the redundancy bits from the last call to bch_code_encode(). bb[i] is the
+     * coefficient of X**i of the redundancy polynomial.
+     */
+    for (int i = 0; i < bch_code_data->n - bch_code_data->k; i++) {
+        bb[i] = bch_code_data->bb[i];
+    }
+}
+
 #if 0
 int bch_code_decode(struct bch_code *bch_code_data, int recd[])
 {
@@ -304,7 +330,7 @@ int bch_code_decode(struct bch_code *bch_code_data, int recd[])
 }
 #endif
 
-int bch_code_decode(struct bch_code *bch_code_data, uint32_t *precd)
+int bch_code_decode_reference(struct bch_code *bch_code_data, uint32_t *precd)
 {
     TSL_BUG_ON(NULL == bch_code_data);
     TSL_BUG_ON(NULL == precd);
@@ -397,6 +423,158 @@ int bch_code_decode(struct bch_code *bch_code_data, uint32_t *precd)
     return retval;
 }
 
+/**
+ * Remainder modulo g(x) of the 31 bit word held in word. Bit (n - 1 - j) of the word is the
+ * coefficient of x**j, as in bch_code_decode_reference.
+ */
+static inline
+uint32_t _bch_code_syndrome(const struct bch_code *bch_code_data, uint32_t word)
+{
+    const uint16_t *lut = bch_code_data->syndrome_lut;
+
+    return lut[word & 0xff] ^
+           lut[256 + ((word >> 8) & 0xff)] ^
+           lut[512 + ((word >> 16) & 0xff)] ^
+           lut[768 + ((word >> 24) & 0x7f)];
+}
+
+/**
+ * Build the syndrome and error pattern lookup tables. The error pattern for each syndrome is
+ * found by running the reference decoder on a word with that syndrome, so the two decoders
+ * always agree, including on words with more errors than the code can correct.
+ */
+static
+aresult_t _bch_code_build_luts(struct bch_code *bch_code_data)
+{
+    aresult_t ret = A_OK;
+
+    int rdncy = bch_code_data->n - bch_code_data->k;
+    uint32_t gmask = 0,
+             bit_rem[32];
+    size_t nr_syndromes = 1ul << rdncy;
+
+    if (FAILED(ret = TCALLOC((void **)&bch_code_data->syndrome_lut, sizeof(uint16_t), 256 * BCH_CODE_SYNDROME_BYTES))) {
+        goto done;
+    }
+
+    if (FAILED(ret = TCALLOC((void **)&bch_code_data->error_lut, sizeof(uint32_t), nr_syndromes))) {
+        goto done;
+    }
+
+    for (int i = 0; i <= rdncy; i++) {
+        if (0 != bch_code_data->g[i]) {
+            gmask |= 1ul << i;
+        }
+    }
+
+    /* Bit b of the word is x**(n - 1 - b). Find its remainder modulo g(x) */
+    for (int b = 0; b < bch_code_data->n; b++) {
+        uint32_t rem = 1;
+
+        for (int j = 0; j < bch_code_data->n - 1 - b; j++) {
+            rem <<= 1;
+            if (rem & (1ul << rdncy)) {
+                rem ^= gmask;
+            }
+        }
+
+        bit_rem[b] = rem;
+    }
+
+    for (int b = bch_code_data->n; b < 32; b++) {
+        bit_rem[b] = 0;
+    }
+
+    /* The remainder is linear, so it can be assembled a byte at a time */
+    for (size_t byte = 0; byte < BCH_CODE_SYNDROME_BYTES; byte++) {
+        for (unsigned v = 0; v < 256; v++) {
+            uint32_t rem = 0;
+
+            for (unsigned b = 0; b < 8; b++) {
+                if (v & (1u << b)) {
+                    rem ^= bit_rem[byte * 8 + b];
+                }
+            }
+
+            bch_code_data->syndrome_lut[byte * 256 + v] = rem;
+        }
+    }
+
+    /*
+     * A polynomial of degree less than n - k is its own remainder, so it's a word that has
+     * that syndrome.
+     */
+    for (size_t syn = 0; syn < nr_syndromes; syn++) {
+        uint32_t word = 0,
+                 decoded = 0;
+
+        for (int j = 0; j < rdncy; j++) {
+            if (syn & (1ul << j)) {
+                word |= 1ul << (bch_code_data->n - 1 - j);
+            }
+        }
+
+        TSL_BUG_ON(_bch_code_syndrome(bch_code_data, word) != syn);
+
+        decoded = word;
+        if (0 != bch_code_decode_reference(bch_code_data, &decoded)) {
+            bch_code_data->error_lut[syn] = BCH_CODE_UNCORRECTABLE;
+        } else {
+            bch_code_data->error_lut[syn] = decoded ^ word;
+        }
+    }
+
+done:
+    return ret;
+}
+
+int bch_code_decode(struct bch_code *bch_code_data, uint32_t *precd)
+{
+    uint32_t syn = 0,
+             err = 0;
+
+    TSL_BUG_ON(NULL == bch_code_data);
+    TSL_BUG_ON(NULL == precd);
+
+    if (NULL == bch_code_data->error_lut) {
+        return bch_code_decode_reference(bch_code_data, precd);
+    }
+
+    if (0 == (syn = _bch_code_syndrome(bch_code_data, *precd))) {
+        return 0;
+    }
+
+    err = bch_code_data->error_lut[syn];
+
+    if (err & BCH_CODE_UNCORRECTABLE) {
+        return 1;
+    }
+
+    *precd ^= err;
+
+    return 0;
+}
+
+size_t bch_code_decode_words(struct bch_code *bch_code_data, uint32_t *words, size_t nr_words, bool *pfailed)
+{
+    size_t nr_failed = 0;
+
+    TSL_BUG_ON(NULL == bch_code_data);
+    TSL_BUG_ON(NULL == words);
+
+    for (size_t i = 0; i < nr_words; i++) {
+        int failed = bch_code_decode(bch_code_data, &words[i]);
+
+        nr_failed += failed;
+
+        if (NULL != pfailed) {
+            pfailed[i] = !!failed;
+        }
+    }
+
+    return nr_failed;
+}
+
 /*
  * Example usage BCH(31,21,5)
  *
@@ -453,6 +631,14 @@ aresult_t bch_code_new(struct bch_code **pcode, const int p[], int m, int n, int
 
         generate_gf(bch_code_data);          /* generate the Galois Field GF(2**m) */
         gen_poly(bch_code_data);             /* Compute the generator polynomial of BCH code */
+
+        /* The lookup tables only cover codes that fit in a 32-bit word */
+        if (n < 32 && n - k <= 16) {
+            if (FAILED(ret = _bch_code_build_luts(bch_code_data))) {
+                bch_code_delete(&bch_code_data);
+                goto done;
+            }
+        }
     }
 
     *pcode = bch_code_data;
@@ -474,6 +660,14 @@ void bch_code_delete(struct bch_code **pbch_code_data)
     if (bch_code_data->g        != NULL) free(bch_code_data->g);
     if (bch_code_data->bb       != NULL) free(bch_code_data->bb);
 
+    if (NULL != bch_code_data->syndrome_lut) {
+        TFREE(bch_code_data->syndrome_lut);
+    }
+
+    if (NULL != bch_code_data->error_lut) {
+        TFREE(bch_code_data->error_lut);
+    }
+
     free(bch_code_data);
 
     *pbch_code_data = NULL;
@@ -2,10 +2,37 @@
 
 #include <tsl/result.h>
 
+#include <stdint.h>
+#include <stdbool.h>
+
 struct bch_code;
 
 aresult_t bch_code_new(struct bch_code **pcode, const int p[], int m, int n, int k, int t);
 void bch_code_delete(struct bch_code **bch_code_data);
 void bch_code_encode(struct bch_code *bch_code_data, int data[]);
+void bch_code_get_redundancy(struct bch_code *bch_code_data, int bb[]);
+
+/**
+ * Correct up to two bit errors in a 31-bit codeword, held in the low 31 bits of *precd. The top
+ * bit is left as is. Uses a syndrome lookup table, so this is a handful of instructions per word.
+ *
+ * \return 0 if the word is good or was corrected, 1 if the errors could not be corrected.
+ */
 int bch_code_decode(struct bch_code *bch_code_data, uint32_t *precd);
 
+/**
+ * Correct a block of words in place, such as a whole FLEX phase. Words that can't be corrected
+ * are left as they are.
+ *
+ * \param pfailed If not NULL, pfailed[i] is set to whether words[i] could not be corrected.
+ *
+ * \return The number of words that could not be corrected.
+ */
+size_t bch_code_decode_words(struct bch_code *bch_code_data, uint32_t *words, size_t nr_words, bool *pfailed);
+
+/**
+ * Decode by solving for the error locator polynomial directly. bch_code_decode gives exactly
+ * the same results; this is what its tables are built from.
+ */
+int bch_code_decode_reference(struct bch_code *bch_code_data, uint32_t *precd);
+
@@ -4,25 +4,70 @@
 #include <tsl/diag.h>
 #include <tsl/assert.h>
 
+#include <stddef.h>
 #include <string.h>
 #include <math.h>
 
+/**
+ * Bits in the mantissa of a fixed point loop gain. An error of up to 2^38 or so can be scaled
+ * without overflowing 64 bits.
+ */
+#define MM_GAIN_MANTISSA_BITS       24
+
+/**
+ * Convert a loop gain, in samples per unit of error, to fixed point.
+ */
+static
+void _mm_gain_init(struct mueller_muller_gain *gain, float value)
+{
+    int exponent = 0;
+    float mantissa = frexpf(value * (float)MM_ONE, &exponent);
+    int shift = MM_GAIN_MANTISSA_BITS - exponent;
+
+    gain->mantissa = 0;
+    gain->shift = 0;
+
+    if (0.0f == value || 63 < shift) {
+        /* Too small to ever make a difference */
+        return;
+    }
+
+    if (0 > shift) {
+        /* Far bigger than any sane gain, so saturate */
+        gain->mantissa = 0.0f < value ? INT32_MAX : -INT32_MAX;
+        return;
+    }
+
+    gain->mantissa = (int32_t)lrintf(ldexpf(mantissa, MM_GAIN_MANTISSA_BITS));
+    gain->shift = shift;
+}
+
+/**
+ * Scale an error by a loop gain, giving an adjustment in fixed point samples.
+ */
+static inline
+int64_t _mm_gain_apply(const struct mueller_muller_gain *gain, int64_t error)
+{
+    return (error * gain->mantissa) >> gain->shift;
+}
+
 aresult_t mm_init(struct mueller_muller *mm, float kw, float km, float samples_per_bit, float error_min, float error_max)
 {
     aresult_t ret = A_OK;
 
     TSL_ASSERT_ARG(NULL != mm);
+    TSL_ASSERT_ARG(1.0f <= samples_per_bit);
 
     /* Clear the memory */
     memset(mm, 0, sizeof(struct mueller_muller));
 
-    mm->next_offset = 0.0;
-    mm->m = mm->w = mm->ideal_step_size = samples_per_bit;
-    mm->kw = kw;
-    mm->km = km;
-    mm->error_min = error_min;
-    mm->error_max = error_max;
-    mm->samples_per_bit = samples_per_bit;
+    mm->next_offset = 0;
+    mm->m = 0;
+    mm->w = mm->samples_per_bit = llrint((double)samples_per_bit * MM_ONE);
+    _mm_gain_init(&mm->kw, kw);
+    _mm_gain_init(&mm->km, km);
+    mm->error_min = llrint((double)error_min * MM_ONE);
+    mm->error_max = llrint((double)error_max * MM_ONE);
 
 #ifdef _MM_DEBUG
     mm->nr_samples = 0;
@@ -31,10 +76,64 @@ aresult_t mm_init(struct mueller_muller *mm, float kw, float km, float samples_p
     return ret;
 }
 
-static
-float _mm_get_sign(float v)
+static inline
+int32_t _mm_get_sign(int32_t v)
+{
+    return (v > 0) - (v < 0);
+}
+
+/**
+ * Clamp omega to the configured range.
+ */
+static inline
+int64_t _mm_clamp_omega(struct mueller_muller *mm, int64_t w)
+{
+    if (mm->error_min > w) {
+        w = mm->error_min;
+    } else if (mm->error_max < w) {
+        w = mm->error_max;
+    }
+
+    return w;
+}
+
+/**
+ * Interpolate between s0 and s1 at fractional position mu (of MM_MU_BITS), with a cubic
+ * (Catmull-Rom) through the samples either side of them.
+ */
+static inline
+int16_t _mm_interpolate(int32_t sm1, int32_t s0, int32_t s1, int32_t s2, int32_t mu)
 {
-    return (float)(v > 0) - (float)(v < 0);
+    int64_t a = s1 - sm1,
+            b = 2 * sm1 - 5 * s0 + 4 * s1 - s2,
+            c = 3 * (s0 - s1) + s2 - sm1,
+            t = 0;
+    int32_t y = 0;
+
+    /* Horner's rule, one fixed point multiply per term */
+    t = (c * mu) >> MM_MU_BITS;
+    t = ((b + t) * mu) >> MM_MU_BITS;
+    t = ((a + t) * mu) >> MM_MU_BITS;
+
+    y = s0 + (int32_t)(t >> 1);
+
+    if (INT16_MAX < y) {
+        y = INT16_MAX;
+    } else if (INT16_MIN > y) {
+        y = INT16_MIN;
+    }
+
+    return y;
+}
+
+/**
+ * Get the sample at offset off in the current block, reaching back into the history of the prior
+ * block for the few samples before it.
+ */
+static inline
+int32_t _mm_sample_at(const struct mueller_muller *mm, const int16_t *samples, ptrdiff_t off)
+{
+    return 0 > off ? mm->history[3 + off] : samples[off];
 }
 
 aresult_t mm_process(struct mueller_muller *mm, const int16_t *samples, size_t nr_samples, int16_t *decisions,
@@ -42,10 +141,9 @@ aresult_t mm_process(struct mueller_muller *mm, const int16_t *samples, size_t n
 {
     aresult_t ret = A_OK;
 
-    float cur_sample = 0.0f,
-          nr_samples_f = 0.0f,
-          w = 0.0f,
-          m = 0.0f;
+    int64_t cur_sample = 0,
+            w = 0;
+    int16_t history[3];
     size_t cur_decision = 0;
 
     TSL_ASSERT_ARG(NULL != mm);
@@ -54,47 +152,46 @@ aresult_t mm_process(struct mueller_muller *mm, const int16_t *samples, size_t n
     TSL_ASSERT_ARG(NULL != pnr_decisions_out);
 
     cur_sample = mm->next_offset;
-    nr_samples_f = (float)nr_samples;
     w = mm->w;
-    m = mm->m;
 
 #ifdef _MM_DEBUG
-    DIAG("mm_process: nr_samples_f = %f, next_step_size = %f, cur_sample = %f", nr_samples_f, w, cur_sample);
+    DIAG("mm_process: nr_samples = %zu, next_step_size = %f, cur_sample = %f", nr_samples,
+            (double)w / MM_ONE, (double)cur_sample / MM_ONE);
 #endif
 
-    while (cur_sample < nr_samples_f) {
-        float sample = samples[(size_t)(cur_sample + 0.5f)];
-        float w_error = 0.0f;
+    /* Each decision needs the sample after the next one, too */
+    while ((cur_sample >> MM_FRAC_BITS) + 2 < (int64_t)nr_samples) {
+        ptrdiff_t off = cur_sample >> MM_FRAC_BITS;
+        int32_t mu = (cur_sample & (MM_ONE - 1)) >> (MM_FRAC_BITS - MM_MU_BITS),
+                sample = 0,
+                w_error = 0;
+        int64_t step = 0;
+
+        if (1 <= off) {
+            sample = _mm_interpolate(samples[off - 1], samples[off], samples[off + 1], samples[off + 2], mu);
+        } else {
+            sample = _mm_interpolate(_mm_sample_at(mm, samples, off - 1), _mm_sample_at(mm, samples, off),
+                    _mm_sample_at(mm, samples, off + 1), _mm_sample_at(mm, samples, off + 2), mu);
+        }
+
+        TSL_BUG_ON(cur_decision >= nr_decisions);
 
-        /* TODO: we might want to interpolate here */
         decisions[cur_decision] = sample;
         cur_decision++;
 
-        TSL_BUG_ON(cur_decision > nr_decisions);
-
         /* Calculate the error for our PI loop */
         w_error = _mm_get_sign(mm->last_sample) * sample - _mm_get_sign(sample) * mm->last_sample;
 
-        /* Determine the next sample to process */
-        w += w_error * mm->kw;
+        /* Determine the next sample to process, clamping if our error is becoming too big */
+        w = _mm_clamp_omega(mm, w + _mm_gain_apply(&mm->kw, w_error));
 
 #ifdef _MM_DEBUG
-        fprintf(stdout, "%f, %f, %f;\n", (double)cur_sample + (double)mm->nr_samples, (double)sample, (double)w_error);
+        fprintf(stdout, "%f, %d, %d;\n", (double)cur_sample / MM_ONE + (double)mm->nr_samples, sample, w_error);
 #endif
 
-        /* Clamp if our error is becoming too big */
-        if (mm->error_min > w) {
-            w = mm->error_min;
-        } else if (mm->error_max < w) {
-            w = mm->error_max;
-        }
-
-        m += w + mm->km * sample;
-
-        /* Calculate the offset of the next sample to be processed */
-        cur_sample += floorf(m);
-
-        m -= floorf(m);
+        /* Calculate the offset of the next sample to be processed, always moving forward */
+        step = w + _mm_gain_apply(&mm->km, w_error);
+        cur_sample += MM_ONE > step ? MM_ONE : step;
 
         /* Store the sample we just processed */
         mm->last_sample = sample;
@@ -104,13 +201,46 @@ aresult_t mm_process(struct mueller_muller *mm, const int16_t *samples, size_t n
     mm->nr_samples += nr_samples;
 #endif
 
+    /* Keep the tail of this block, to interpolate across into the following one */
+    for (size_t i = 0; i < 3; i++) {
+        history[i] = _mm_sample_at(mm, samples, (ptrdiff_t)nr_samples - 3 + (ptrdiff_t)i);
+    }
+    memcpy(mm->history, history, sizeof(history));
+
     /* Store the offset of the next sample to be processed in the following buffer */
-    mm->next_offset = cur_sample - nr_samples_f;
+    mm->next_offset = cur_sample - ((int64_t)nr_samples << MM_FRAC_BITS);
     mm->w = w;
-    mm->m = m;
 
     *pnr_decisions_out = cur_decision;
 
     return ret;
 }
 
+size_t mm_gardner_decision(struct mueller_muller *mm, int16_t sample, int16_t mid_sample)
+{
+    int64_t w_error = 0,
+            step = 0;
+
+#ifdef _TSL_DEBUG
+    TSL_BUG_ON(NULL == mm);
+#endif
+
+    /*
+     * The sample halfway between decisions sits on the transition, if there was one. Which side of
+     * it that sample falls on says whether we're early or late. Measure it from the middle of the
+     * two levels, so this works for transitions between any two levels of a multi-level signal.
+     */
+    w_error = (int64_t)(mm->last_sample - sample) * (mid_sample - (mm->last_sample + sample) / 2);
+
+    /* Adjust the estimate of the symbol period, clamping if the error is becoming too big */
+    mm->w = _mm_clamp_omega(mm, mm->w + _mm_gain_apply(&mm->kw, w_error));
+
+    /* Step ahead by a symbol period, nudged by the error, and keep the fractional part */
+    mm->m += mm->w + _mm_gain_apply(&mm->km, w_error);
+    step = mm->m >> MM_FRAC_BITS;
+    mm->m -= step << MM_FRAC_BITS;
+
+    mm->last_sample = sample;
+
+    return 1 > step ? 1 : (size_t)step;
+}
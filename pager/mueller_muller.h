@@ -6,52 +6,87 @@
 
 //#define _MM_DEBUG
 
+/**
+ * Number of fractional bits in the fixed point sample positions and periods the clock recovery
+ * works in.
+ */
+#define MM_FRAC_BITS                32
+
+/**
+ * One sample, in fixed point.
+ */
+#define MM_ONE                      (1ll << MM_FRAC_BITS)
+
+/**
+ * Number of bits of the fractional position used to interpolate a decision.
+ */
+#define MM_MU_BITS                  16
+
+/**
+ * A control loop gain, in fixed point: an error is multiplied by the mantissa, then shifted down
+ * by the shift, to give an adjustment in fixed point samples.
+ */
+struct mueller_muller_gain {
+    int32_t mantissa;
+    uint8_t shift;
+};
+
 /**
  * State for a Mueller-Muller clock recovery.
  *
- * This is a soft-decision block, but it does not interpolate the samples. Thus, the
- * caller must slice the ouputs per their requirements.
- *
- * TODO: make this fixed point. Using an int32_t is probably enough overkill for error
- * accumulation to not murder us.
+ * This is a soft-decision block, so the caller must slice the outputs per their requirements.
+ * mm_process interpolates decisions from the samples around the ideal sampling point, so it works
+ * down to a couple of samples per bit. Everything past initialization is in fixed point.
  */
 struct mueller_muller {
-    /* Number of samples, per bit, based on the sample rate */
-    float samples_per_bit;
+    /**
+     * Number of samples, per bit, based on the sample rate, in fixed point
+     */
+    int64_t samples_per_bit;
 
-    /* Omega gain for control loop */
-    float kw;
+    /**
+     * Omega gain for control loop
+     */
+    struct mueller_muller_gain kw;
 
-    /* Mu gain for control loop */
-    float km;
+    /**
+     * Mu gain for control loop
+     */
+    struct mueller_muller_gain km;
 
-    float error_min;
-    float error_max;
+    /**
+     * Range omega is clamped to, in fixed point
+     */
+    int64_t error_min;
+    int64_t error_max;
 
     /**
-     * Omega
+     * Omega: the current estimate of the number of samples per bit, in fixed point
      */
-    float w;
+    int64_t w;
 
     /**
-     * Mu
+     * Mu: the fractional part of the offset to the next decision, in fixed point. Only used by
+     * mm_gardner_decision.
      */
-    float m;
+    int64_t m;
 
     /**
-     * Offset of the next sample to process in the following block.
+     * Offset of the next sample to process in the following block, in fixed point. Can be
+     * negative, reaching back into the history.
      */
-    float next_offset;
+    int64_t next_offset;
 
     /**
      * Prior sample processed
      */
-    float last_sample;
+    int16_t last_sample;
 
     /**
-     * The step size, specified at initialization
+     * The last few samples of the prior block, oldest first, for interpolating around the start
+     * of the following block.
      */
-    float ideal_step_size;
+    int16_t history[3];
 
 #ifdef _MM_DEBUG
     /**
@@ -72,6 +107,9 @@ struct mueller_muller {
  * \param error_max The maximum range of error in the control loop before clamping
  *
  * \return A_OK on success, an error code otherwise
+ *
+ * \note The parameters are converted to fixed point here; this is the only place floating point
+ *       is used.
  */
 aresult_t mm_init(struct mueller_muller *mm, float kp, float km, float samples_per_bit, float error_min, float error_max);
 
@@ -90,8 +128,31 @@ aresult_t mm_init(struct mueller_muller *mm, float kp, float km, float samples_p
  *       call to mm_process should be able to process the entirety of the input sample
  *       buffer in a single shot.
  *
- * \note The state for the Mueller-Muller Clock Recovery block will track the offset to the
- *       next sample in the subsequent sample buffer.
+ * \note Each decision is interpolated from the two samples either side of it, so a decision
+ *       that falls in the last two samples of a block is made at the start of the following
+ *       block. The state for the Mueller-Muller Clock Recovery block will track the offset to
+ *       the next sample in the subsequent sample buffer.
  */
 aresult_t mm_process(struct mueller_muller *mm, const int16_t *samples, size_t nr_samples, int16_t *decisions,
         size_t nr_decisions, size_t *pnr_decisions_out);
+
+/**
+ * Run the control loop for one decision, for callers that pick out the samples themselves (i.e.
+ * by counting down the samples between decisions, rather than handing over whole blocks).
+ *
+ * This is not the Mueller-Muller detector mm_process uses. On a signal with flat-topped symbols,
+ * like the NRZ out of a pager discriminator, the decision samples alone say nothing about timing,
+ * so this is a Gardner detector: the error is taken from the sample halfway between the last
+ * decision and this one, which sits on the transition if there was one. It shares the loop state
+ * and gains with mm_process.
+ *
+ * Decisions are made on whole samples, without interpolation, so the sampling point can be up to
+ * half a sample from the ideal. That needs about 4 samples per symbol to stay in the eye.
+ *
+ * \param mm The Mueller-Muller Clock Recovery instance
+ * \param sample The sample taken at the current decision point
+ * \param mid_sample The sample taken halfway between the last decision point and this one
+ *
+ * \return The number of samples from this decision point to the next, at least 1.
+ */
+size_t mm_gardner_decision(struct mueller_muller *mm, int16_t sample, int16_t mid_sample);
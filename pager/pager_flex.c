@@ -38,6 +38,8 @@
 
 static inline int8_t _pager_flex_slice_2fsk(struct pager_flex *flex, int16_t sample);
 static inline int8_t _pager_flex_slice_4fsk(struct pager_flex *flex, int16_t sample);
+static void _pager_flex_slice_block_2fsk(struct pager_flex *flex, int8_t *symbols, const int16_t *samples, size_t nr_samples);
+static void _pager_flex_slice_block_4fsk(struct pager_flex *flex, int8_t *symbols, const int16_t *samples, size_t nr_samples);
 
 /**
  * Sync codes indicating the FSK mode used for SYNC 2 and beyond.
@@ -48,11 +50,10 @@ struct pager_flex_coding _pager_codings[] = {
         .seq_a = 0x78f3,
         .baud = 1600,
         .fsk_levels = 2,
-        .sample_skip = 9,
         .sync_2_samples = 4,
         .sym_bits = 1,
         .slice = _pager_flex_slice_2fsk,
-        .sample_fudge = 0,
+        .slice_block = _pager_flex_slice_block_2fsk,
         .symbols_per_block = 2816,
         .nr_phases = 1,
     },
@@ -60,11 +61,10 @@ struct pager_flex_coding _pager_codings[] = {
         .seq_a = 0x84e7,
         .baud = 3200,
         .fsk_levels = 2,
-        .sample_skip = 4,
         .sync_2_samples = 24,
         .sym_bits = 1,
         .slice = _pager_flex_slice_2fsk,
-        .sample_fudge = 2,
+        .slice_block = _pager_flex_slice_block_2fsk,
         .symbols_per_block = 5632,
         .nr_phases = 2,
     },
@@ -72,11 +72,10 @@ struct pager_flex_coding _pager_codings[] = {
         .seq_a = 0x4f97,
         .baud = 3200,
         .fsk_levels = 4,
-        .sample_skip = 9,
         .sync_2_samples = 12,
         .sym_bits = 2,
         .slice = _pager_flex_slice_4fsk,
-        .sample_fudge = 0,
+        .slice_block = _pager_flex_slice_block_4fsk,
         .symbols_per_block = 2816,
         .nr_phases = 2,
     },
@@ -84,11 +83,10 @@ struct pager_flex_coding _pager_codings[] = {
         .seq_a = 0x215f,
         .baud = 6400,
         .fsk_levels = 4,
-        .sample_skip = 4,
         .sync_2_samples = 32,
         .sym_bits = 2,
         .slice = _pager_flex_slice_4fsk,
-        .sample_fudge = 2,
+        .slice_block = _pager_flex_slice_block_4fsk,
         .symbols_per_block = 5632,
         .nr_phases = 4,
     },
@@ -169,6 +167,46 @@ int8_t _pager_flex_slice_4fsk(struct pager_flex *flex, int16_t sample)
     }
 }
 
+/**
+ * Slice an array of symbol-center samples into 2FSK symbols, as _pager_flex_slice_2fsk does.
+ *
+ * Written as a plain loop with no branches so the compiler can vectorise it.
+ */
+static
+void _pager_flex_slice_block_2fsk(struct pager_flex *flex, int8_t *symbols, const int16_t *samples, size_t nr_samples)
+{
+#ifdef _TSL_DEBUG
+    TSL_BUG_ON(NULL == flex);
+#endif
+
+    for (size_t i = 0; i < nr_samples; i++) {
+        symbols[i] = !((uint16_t)samples[i] >> 15);
+    }
+}
+
+/**
+ * Slice an array of symbol-center samples into 4FSK symbols, as _pager_flex_slice_4fsk does.
+ *
+ * The sign of the sample picks the high bit of the symbol, and whether it is inside the
+ * threshold picks the low bit, so this also comes out without branches.
+ */
+static
+void _pager_flex_slice_block_4fsk(struct pager_flex *flex, int8_t *symbols, const int16_t *samples, size_t nr_samples)
+{
+#ifdef _TSL_DEBUG
+    TSL_BUG_ON(NULL == flex);
+#endif
+    int16_t delta = flex->sample_delta;
+    int threshold = flex->sample_range/4;
+
+    for (size_t i = 0; i < nr_samples; i++) {
+        int16_t sample = samples[i] - delta;
+        int magnitude = sample < 0 ? -sample : sample;
+
+        symbols[i] = ((sample >= 0) << 1) | (magnitude <= threshold);
+    }
+}
+
 static
 void _pager_flex_block_reset(struct pager_flex_block *block)
 {
@@ -185,6 +223,8 @@ void _pager_flex_block_reset(struct pager_flex_block *block)
         ph->cur_bit = 0;
         ph->cur_word = 0;
         ph->base_word = 0;
+        ph->nr_raw_bits = 0;
+        ph->raw_bits = 0;
     }
 
 #ifdef _TSL_DEBUG
@@ -213,11 +253,18 @@ void _pager_flex_sync_reset(struct pager_flex_sync *sync)
 #endif
 
     memset(sync->sync_words, 0, sizeof(sync->sync_words));
-    sync->state = PAGER_FLEX_SYNC_STATE_BS1;
+    sync->state = PAGER_FLEX_SYNC_STATE_SEARCH_BS1;
 
     sync->sample_counter = 0;
     sync->bit_counter = 0;
 
+    sync->run_errors = 0;
+    sync->best_eye = 0;
+    sync->best_errors = 0;
+    sync->best_phase = 0;
+    sync->best_age = 0;
+    sync->quiet_age = 0;
+
     /* Clear the various words from the sync header */
     sync->a = 0;
     sync->b = 0;
@@ -247,6 +294,7 @@ void _pager_flex_reset_sync(struct pager_flex *flex)
 
     flex->skip = 0;
     flex->skip_count = 0;
+    flex->mid_count = 0;
 
     flex->sample_range = 0;
     flex->sample_delta = 0;
@@ -285,6 +333,325 @@ bool _pager_flex_sync_check_baud(struct pager_flex_sync *sync)
     return false;
 }
 
+/**
+ * Check a sample phase's shift register against the BS1 pattern, allowing for the configured
+ * number of bit errors.
+ */
+static inline
+bool _pager_flex_sync_is_bs1(struct pager_flex *flex, uint32_t sync_word)
+{
+    return __builtin_popcount(sync_word ^ PAGER_FLEX_SYNC_BS1) <= flex->sync_max_errors;
+}
+
+/**
+ * A sample phase matched BS1 while searching for it: start measuring the eye.
+ */
+static inline
+void _pager_flex_sync_found_bs1(struct pager_flex_sync *sync, uint32_t sync_word)
+{
+    sync->bit_counter = 1;
+    sync->run_errors = __builtin_popcount(sync_word ^ PAGER_FLEX_SYNC_BS1);
+    sync->best_eye = 0;
+    sync->state = PAGER_FLEX_SYNC_STATE_BS1;
+    DIAG("SEARCH_BS1 -> BS1 (sample = %u)", sync->sample_counter);
+}
+
+/**
+ * Number of samples to wait for another run of sample phases matching BS1, before settling on the
+ * best one so far. A run can only come every other bit.
+ */
+#define PAGER_FLEX_SYNC_BS1_HOLD(phases)        (3 * (phases))
+
+/**
+ * Longest to hold on to the best run of sample phases matching BS1, while worse ones keep turning
+ * up. The bits of A that arrive in the meantime have to fit in the sync words.
+ */
+#define PAGER_FLEX_SYNC_BS1_MAX_AGE(phases)     (20 * (phases))
+
+/**
+ * Track the BS1 eye when bit errors are allowed.
+ *
+ * An exact match only happens on the last bit of BS1, so with no errors allowed, the first sample
+ * phase that stops matching marks where A begins. Allowing errors, the pattern also matches every
+ * other bit before that, as the dotting or noise ahead of BS1 shifts out of the sync words, and
+ * the eye gets wider and cleaner until the real end of BS1. So keep the widest run of matching
+ * sample phases, preferring fewer errors and then the later run on a tie, until no run has turned
+ * up for a few bits. The bits of A received in the meantime are still in the sync words, so
+ * recover them from there.
+ */
+static
+void _pager_flex_sync_track_bs1(struct pager_flex *flex)
+{
+    struct pager_flex_sync *sync = &flex->sync;
+    unsigned errors = __builtin_popcount(sync->sync_words[sync->sample_counter] ^ PAGER_FLEX_SYNC_BS1),
+             phases = flex->sync_phases;
+
+    if (0 != sync->best_eye) {
+        sync->best_age++;
+        sync->quiet_age++;
+    }
+
+    if (errors <= flex->sync_max_errors) {
+        if (0 == sync->bit_counter || errors < sync->run_errors) {
+            sync->run_errors = errors;
+        }
+        sync->bit_counter++;
+        return;
+    }
+
+    if (0 != sync->bit_counter) {
+        /* End of a run of matching sample phases. While they keep coming, BS1 hasn't ended. */
+        if (sync->bit_counter >= 3) {
+            if (sync->bit_counter > sync->best_eye ||
+                    (sync->bit_counter == sync->best_eye && sync->run_errors <= sync->best_errors))
+            {
+                sync->best_eye = sync->bit_counter;
+                sync->best_errors = sync->run_errors;
+                sync->best_phase = sync->sample_counter;
+                sync->best_age = 0;
+            }
+            sync->quiet_age = 0;
+        }
+
+        sync->bit_counter = 0;
+
+        if (0 == sync->best_eye) {
+            /* We didn't actually find our sync sequence, just bad luck. */
+            sync->state = PAGER_FLEX_SYNC_STATE_SEARCH_BS1;
+        }
+    }
+
+    if (0 != sync->best_eye &&
+            (PAGER_FLEX_SYNC_BS1_HOLD(phases) <= sync->quiet_age || PAGER_FLEX_SYNC_BS1_MAX_AGE(phases) <= sync->best_age))
+    {
+        unsigned center = sync->best_eye / 2,
+                 age = sync->best_age;
+
+        /*
+         * Pick up as if we'd moved on to A right after the best run: the sample clock is where it
+         * would have been, and the bits of A it would have sampled come from the sync words.
+         */
+        sync->state = PAGER_FLEX_SYNC_STATE_A;
+        sync->a = 0;
+        sync->bit_counter = 0;
+
+        for (unsigned j = 1; j <= age; j++) {
+            if (0 == (center + j) % phases) {
+                unsigned phase = (sync->best_phase + j) % phases;
+                sync->a <<= 1;
+                sync->a |= (sync->sync_words[phase] >> ((age - j) / phases)) & 1;
+                sync->bit_counter++;
+            }
+        }
+
+        sync->sample_counter = (center + age) % phases;
+
+        DIAG("BS1 -> A (eye = %u, %u errors, %u bits of A)", sync->best_eye, sync->best_errors, sync->bit_counter);
+    }
+}
+
+/**
+ * Number of past samples the BS1 search keeps: 32 bits for each sample phase, rounded up to a
+ * whole number of 64-bit words.
+ */
+#define PAGER_FLEX_SYNC_HISTORY(phases)     (((phases) * 32 + 63) / 64 * 64)
+
+/**
+ * Number of samples the BS1 search slices and searches at a time.
+ */
+#define PAGER_FLEX_SYNC_CHUNK           1024
+
+/**
+ * Number of 64-bit words to hold the sliced history and a chunk of samples, plus a word of
+ * padding so a 64-bit window can be read from any offset.
+ */
+#define PAGER_FLEX_SYNC_BUF_WORDS       \
+    ((PAGER_FLEX_SYNC_HISTORY(PAGER_FLEX_SYNC_MAX_SAMPLE_PHASES) + PAGER_FLEX_SYNC_CHUNK) / 64 + 1)
+
+/**
+ * Read the 64 sliced bits starting at bit offset off of the packed bit buffer.
+ */
+static inline
+uint64_t __pager_flex_sync_bits_at(const uint64_t *bits, size_t off)
+{
+    size_t word = off / 64,
+           shift = off % 64;
+
+    if (0 == shift) {
+        return bits[word];
+    }
+
+    return (bits[word] >> shift) | (bits[word + 1] << (64 - shift));
+}
+
+/**
+ * Gather the shift register for the sample phase of the sample at bit offset off of the packed
+ * bit buffer: bit m of the register is the sample phases * m samples earlier.
+ */
+static
+uint32_t __pager_flex_sync_word_at(const uint64_t *bits, size_t off, unsigned phases)
+{
+    uint32_t word = 0;
+
+    for (size_t m = 0; m < 32; m++) {
+        size_t pos = off - phases * m;
+        word |= (uint32_t)((bits[pos / 64] >> (pos % 64)) & 1) << m;
+    }
+
+    return word;
+}
+
+/**
+ * Slice samples into the packed bit buffer, starting at a 64-bit aligned bit offset. A sample that
+ * is 0 or more slices to a 1, as in _pager_flex_slice_2fsk.
+ */
+static
+void _pager_flex_sync_slice(uint64_t *bits, const int16_t *samples, size_t nr_samples)
+{
+    for (size_t i = 0; i < nr_samples; i += 64) {
+        size_t nr = BL_MIN2(nr_samples - i, 64);
+        uint64_t sign = 0;
+
+        /* Gather the sign bits, which the compiler can turn into compares and a movemask */
+        for (size_t j = 0; j < nr; j++) {
+            sign |= (uint64_t)((uint16_t)samples[i + j] >> 15) << j;
+        }
+
+        bits[i / 64] = ~sign & (64 == nr ? ~0ull : (1ull << nr) - 1);
+    }
+}
+
+/**
+ * Find the first sample in the chunk where the shift register for its sample phase is within the
+ * allowed number of errors of BS1.
+ *
+ * The shift register for the sample at t holds the samples at t - Pm, m = 0..31, where P is the
+ * number of sample phases, and BS1 wants these to be 1 for odd m and 0 for even m. A 64-bit
+ * window of the bitstream at offset -Pm
+ * checks term m for 64 samples at once. If at most e terms can be wrong, one of e + 1 groups of
+ * terms must match exactly, so the groups are checked first, and only the samples that pass
+ * (almost none, on an idle channel) get their full shift register compared.
+ *
+ * \return true if found, with the index of the sample in the chunk in *pmatch
+ */
+static
+bool _pager_flex_sync_find_bs1(struct pager_flex *flex, const uint64_t *bits, size_t nr_samples, size_t *pmatch)
+{
+    size_t nr_groups = flex->sync_max_errors + 1;
+    unsigned phases = flex->sync_phases;
+
+    for (size_t base = 0; base < nr_samples; base += 64) {
+        size_t pos = PAGER_FLEX_SYNC_HISTORY(phases) + base,
+               nr = BL_MIN2(nr_samples - base, 64);
+        uint64_t candidates = 0;
+
+        for (size_t g = 0; g < nr_groups; g++) {
+            uint64_t mismatch = 0;
+
+            for (size_t m = g * 32 / nr_groups; m < (g + 1) * 32 / nr_groups; m++) {
+                uint64_t expect = (m & 1) ? ~0ull : 0;
+
+                mismatch |= __pager_flex_sync_bits_at(bits, pos - phases * m) ^ expect;
+
+                if (~0ull == mismatch) {
+                    break;
+                }
+            }
+
+            candidates |= ~mismatch;
+        }
+
+        if (64 != nr) {
+            candidates &= (1ull << nr) - 1;
+        }
+
+        while (0 != candidates) {
+            size_t bit = __builtin_ctzll(candidates);
+
+            if (_pager_flex_sync_is_bs1(flex, __pager_flex_sync_word_at(bits, pos + bit, phases))) {
+                *pmatch = base + bit;
+                return true;
+            }
+
+            candidates &= candidates - 1;
+        }
+    }
+
+    return false;
+}
+
+/**
+ * Search a run of samples for the BS1 pattern, in any of the sample phases. Does the same job
+ * as feeding each sample to _pager_flex_sync_update in the SEARCH_BS1 state, a chunk of samples
+ * at a time. On return, the sync words and sample counter are just as if that had happened.
+ *
+ * \return The number of samples consumed. If BS1 was found, the sample it was found at is the
+ *         last one consumed, and the sync state is now BS1.
+ */
+static
+size_t _pager_flex_sync_search_bs1(struct pager_flex *flex, const int16_t *samples, size_t nr_samples)
+{
+    struct pager_flex_sync *sync = &flex->sync;
+    uint64_t bits[PAGER_FLEX_SYNC_BUF_WORDS];
+    unsigned phases = flex->sync_phases;
+    size_t history = PAGER_FLEX_SYNC_HISTORY(phases),
+           consumed = 0,
+           end = history;
+    uint8_t counter = sync->sample_counter;
+    bool found = false;
+
+#ifdef _TSL_DEBUG
+    TSL_BUG_ON(PAGER_FLEX_SYNC_STATE_SEARCH_BS1 != sync->state);
+#endif
+
+    memset(bits, 0, sizeof(bits));
+
+    /* Unpack the sync words into the bitstream of the samples leading up to this one */
+    for (size_t j = 0; j < phases * 32; j++) {
+        unsigned phase = (counter + phases * 32 - j) % phases;
+        uint64_t bit = (sync->sync_words[phase] >> (j / phases)) & 1;
+        size_t pos = history - 1 - j;
+
+        bits[pos / 64] |= bit << (pos % 64);
+    }
+
+    while (consumed < nr_samples && false == found) {
+        size_t nr = BL_MIN2(nr_samples - consumed, PAGER_FLEX_SYNC_CHUNK),
+               match = 0;
+
+        if (0 != consumed) {
+            /* Carry the tail of the last chunk over as the history for this one */
+            for (size_t w = 0; w < history / 64; w++) {
+                bits[w] = __pager_flex_sync_bits_at(bits, end - history + w * 64);
+            }
+        }
+
+        _pager_flex_sync_slice(&bits[history / 64], &samples[consumed], nr);
+
+        if (true == (found = _pager_flex_sync_find_bs1(flex, bits, nr, &match))) {
+            nr = match + 1;
+        }
+
+        end = history + nr;
+        counter = (counter + nr) % phases;
+        consumed += nr;
+    }
+
+    /* Pack the most recent samples back into the sync words */
+    for (size_t k = 0; k < phases; k++) {
+        unsigned phase = (counter + phases - k) % phases;
+        sync->sync_words[phase] = __pager_flex_sync_word_at(bits, end - 1 - k, phases);
+    }
+
+    sync->sample_counter = counter;
+
+    if (true == found) {
+        _pager_flex_sync_found_bs1(sync, sync->sync_words[counter]);
+    }
+
+    return consumed;
+}
+
 /**
  * If we're in the initial 2FSK sync phase, update the sync word tracker and check
  * if it indicates we should move on to handling the Frame Information Word.
@@ -302,7 +669,7 @@ void _pager_flex_sync_update(struct pager_flex *flex, int16_t sample)
 
     sync = &flex->sync;
 
-    sync->sample_counter = (sync->sample_counter + 1) % 10;
+    sync->sample_counter = (sync->sample_counter + 1) % flex->sync_phases;
     symbol = _pager_flex_slice_2fsk(flex, sample);
 
     switch (sync->state) {
@@ -310,10 +677,8 @@ void _pager_flex_sync_update(struct pager_flex *flex, int16_t sample)
         sync->sync_words[sync->sample_counter] <<= 1;
         sync->sync_words[sync->sample_counter] |= !!symbol;
 
-        if (sync->sync_words[sync->sample_counter] == PAGER_FLEX_SYNC_BS1) {
-            sync->bit_counter = 1;
-            sync->state = PAGER_FLEX_SYNC_STATE_BS1;
-            DIAG("SEARCH_BS1 -> BS1 (sample = %u)", sync->sample_counter);
+        if (_pager_flex_sync_is_bs1(flex, sync->sync_words[sync->sample_counter])) {
+            _pager_flex_sync_found_bs1(sync, sync->sync_words[sync->sample_counter]);
         }
 
         break;
@@ -322,6 +687,11 @@ void _pager_flex_sync_update(struct pager_flex *flex, int16_t sample)
         sync->sync_words[sync->sample_counter] <<= 1;
         sync->sync_words[sync->sample_counter] |= !!symbol;
 
+        if (0 != flex->sync_max_errors) {
+            _pager_flex_sync_track_bs1(flex);
+            break;
+        }
+
         if (sync->sync_words[sync->sample_counter] == PAGER_FLEX_SYNC_BS1) {
             sync->bit_counter++;
         } else {
@@ -1084,6 +1454,103 @@ void __pager_flex_decode_extra_biw(struct pager_flex *flex, uint32_t biw)
     }
 }
 
+void pager_flex_phase_shift_bit(struct pager_flex_phase *phase, bool bit)
+{
+#ifdef _TSL_DEBUG
+    TSL_BUG_ON(NULL == phase);
+#endif
+    phase->phase_words[phase->base_word + phase->cur_word] >>= 1;
+    phase->phase_words[phase->base_word + phase->cur_word] |= ((uint32_t)(!!bit)) << 31;
+
+    phase->cur_word = (phase->cur_word + 1) % 8;
+
+    /* Update the state of the phase tracker */
+    if (0 == phase->cur_word) {
+        phase->cur_bit++;
+    }
+
+    /* Start decoding the next block */
+    if (32 == phase->cur_bit) {
+        phase->base_word += 8;
+        phase->cur_bit = 0;
+        phase->cur_word = 0;
+    }
+}
+
+/**
+ * Transpose an 8x8 bit matrix, where byte i is row i and bit j of that byte is column j.
+ */
+static inline
+uint64_t __pager_flex_transpose_8x8(uint64_t x)
+{
+    uint64_t t = 0;
+
+    t = (x ^ (x >> 7)) & 0x00aa00aa00aa00aaull;
+    x ^= t ^ (t << 7);
+    t = (x ^ (x >> 14)) & 0x0000cccc0000ccccull;
+    x ^= t ^ (t << 14);
+    t = (x ^ (x >> 28)) & 0x00000000f0f0f0f0ull;
+    x ^= t ^ (t << 28);
+
+    return x;
+}
+
+/**
+ * De-interleave 64 received bits, which carry the next 8 bits of each word in the current block.
+ * Bit 8i + j of the raw bits is bit i of word j, so a transpose leaves word j's 8 bits in byte j.
+ */
+static
+void _pager_flex_phase_deinterleave(struct pager_flex_phase *phase)
+{
+    uint64_t cols = __pager_flex_transpose_8x8(phase->raw_bits);
+    uint32_t *words = &phase->phase_words[phase->base_word];
+
+#ifdef _TSL_DEBUG
+    TSL_BUG_ON(64 != phase->nr_raw_bits);
+    TSL_BUG_ON(0 != phase->cur_word);
+#endif
+
+    for (size_t i = 0; i < 8; i++) {
+        words[i] = (words[i] >> 8) | ((uint32_t)((cols >> (8 * i)) & 0xff) << 24);
+    }
+
+    phase->raw_bits = 0;
+    phase->nr_raw_bits = 0;
+
+    phase->cur_bit += 8;
+
+    /* Start decoding the next block */
+    if (32 == phase->cur_bit) {
+        phase->base_word += 8;
+        phase->cur_bit = 0;
+    }
+}
+
+void pager_flex_phase_flush(struct pager_flex_phase *phase)
+{
+    uint64_t raw_bits = phase->raw_bits;
+    size_t nr_raw_bits = phase->nr_raw_bits;
+
+    phase->raw_bits = 0;
+    phase->nr_raw_bits = 0;
+
+    for (size_t i = 0; i < nr_raw_bits; i++) {
+        pager_flex_phase_shift_bit(phase, !!(raw_bits & (1ull << i)));
+    }
+}
+
+void pager_flex_phase_append_bit(struct pager_flex_phase *phase, bool bit)
+{
+#ifdef _TSL_DEBUG
+    TSL_BUG_ON(NULL == phase);
+#endif
+    phase->raw_bits |= (uint64_t)bit << phase->nr_raw_bits;
+
+    if (64 == ++phase->nr_raw_bits) {
+        _pager_flex_phase_deinterleave(phase);
+    }
+}
+
 static
 void _pager_flex_phase_process(struct pager_flex *flex, unsigned phase_id)
 {
@@ -1109,6 +1576,8 @@ void _pager_flex_phase_process(struct pager_flex *flex, unsigned phase_id)
     blk = &flex->block;
     phs = &blk->phase[phase_id];
 
+    pager_flex_phase_flush(phs);
+
     TSL_BUG_ON(0 == phs->base_word);
     if (0 != phs->cur_bit) {
         DIAG("WARNING: current bit ID is %u", phs->cur_bit);
@@ -1116,6 +1585,12 @@ void _pager_flex_phase_process(struct pager_flex *flex, unsigned phase_id)
 
     DIAG("PHASE %u: %u words", phase_id, phs->cur_word);
 
+    /*
+     * Correct every word in the phase in one pass. Words that can't be corrected are left as
+     * they are, so the per-word checks below still reject them, and are otherwise cheap.
+     */
+    bch_code_decode_words(flex->bch, phs->phase_words, phs->base_word, NULL);
+
     /* Grab the BIW, and correct it */
     biw = phs->phase_words[0] & 0x7ffffffful;
     if (bch_code_decode(flex->bch, &biw)) {
@@ -1196,36 +1671,25 @@ done:
     return;
 }
 
-static
-void _pager_flex_phase_append_bit(struct pager_flex_phase *phase, bool bit)
-{
-#ifdef _TSL_DEBUG
-    TSL_BUG_ON(NULL == phase);
-#endif
-    phase->phase_words[phase->base_word + phase->cur_word] >>= 1;
-    phase->phase_words[phase->base_word + phase->cur_word] |= ((uint32_t)(!!bit)) << 31;
-
-    phase->cur_word = (phase->cur_word + 1) % 8;
-
-    /* Update the state of the phase tracker */
-    if (0 == phase->cur_word) {
-        phase->cur_bit++;
-    }
-
-    /* Start decoding the next block */
-    if (32 == phase->cur_bit) {
-        phase->base_word += 8;
-        phase->cur_bit = 0;
-        phase->cur_word = 0;
-    }
-}
+/**
+ * Number of symbols gathered and sliced at a time while receiving a block.
+ */
+#define PAGER_FLEX_BLOCK_CHUNK          256
 
+/**
+ * Deliver a run of sliced symbols to the phases of the current block. The run must not go past
+ * the end of the block. Once the block is complete, process each phase and go back to hunting
+ * for Sync 1.
+ */
 static
-void _pager_flex_block_update(struct pager_flex *flex, int16_t sample)
+void _pager_flex_block_symbols(struct pager_flex *flex, const int8_t *symbols, size_t nr_symbols)
 {
     struct pager_flex_block *blk = NULL;
     struct pager_flex_coding *coding = NULL;
-    int8_t symbol = 0;
+    struct pager_flex_phase *phase_a = NULL,
+                            *phase_b = NULL,
+                            *phase_c = NULL,
+                            *phase_d = NULL;
 #ifdef _TSL_DEBUG
     TSL_BUG_ON(NULL == flex);
 #endif
@@ -1233,57 +1697,62 @@ void _pager_flex_block_update(struct pager_flex *flex, int16_t sample)
     coding = flex->sync.coding;
 #ifdef _TSL_DEBUG
     TSL_BUG_ON(NULL == coding);
+    TSL_BUG_ON(blk->nr_symbols + nr_symbols > coding->symbols_per_block);
 #endif
 
-    symbol = coding->slice(flex, sample);
+    phase_a = &blk->phase[PAGER_FLEX_PHASE_A];
+    phase_b = &blk->phase[PAGER_FLEX_PHASE_B];
+    phase_c = &blk->phase[PAGER_FLEX_PHASE_C];
+    phase_d = &blk->phase[PAGER_FLEX_PHASE_D];
 
     /* Put the symbol bit(s) in the right phase */
     switch (coding->nr_phases) {
     case 1:
         TSL_BUG_ON(coding->sym_bits != 1);
         /* Always phase A */
-        _pager_flex_phase_append_bit(&blk->phase[PAGER_FLEX_PHASE_A], (1 == symbol));
+        for (size_t i = 0; i < nr_symbols; i++) {
+            pager_flex_phase_append_bit(phase_a, (1 == symbols[i]));
+        }
         break;
     case 2:
         /* There are two phases in the current coding, Phase A and Phase C, so fill them in */
         if (2 == coding->fsk_levels) {
-            struct pager_flex_phase *phase = NULL;
             /* Write alternating symbols to the appropriate phase */
-
-            if (false == blk->phase_ff) {
-                phase = &blk->phase[PAGER_FLEX_PHASE_A];
-            } else {
-                phase = &blk->phase[PAGER_FLEX_PHASE_C];
+            for (size_t i = 0; i < nr_symbols; i++) {
+                pager_flex_phase_append_bit(false == blk->phase_ff ? phase_a : phase_c, (1 == symbols[i]));
+                blk->phase_ff = !blk->phase_ff;
             }
-
-            _pager_flex_phase_append_bit(phase, (1 == symbol));
-            blk->phase_ff = !blk->phase_ff;
         } else {
             TSL_BUG_ON(coding->sym_bits != 2);
             /* Break apart the symbol */
-            _pager_flex_phase_append_bit(&blk->phase[PAGER_FLEX_PHASE_A], !!(symbol & 2));
-            _pager_flex_phase_append_bit(&blk->phase[PAGER_FLEX_PHASE_C], !!(symbol & 1));
+            for (size_t i = 0; i < nr_symbols; i++) {
+                pager_flex_phase_append_bit(phase_a, !!(symbols[i] & 2));
+                pager_flex_phase_append_bit(phase_c, !!(symbols[i] & 1));
+            }
         }
         break;
     case 4:
         TSL_BUG_ON(2 != coding->sym_bits);
-        if (false == blk->phase_ff) {
+        for (size_t i = 0; i < nr_symbols; i++) {
+            int8_t symbol = symbols[i];
 #ifdef _DUMP_SAMPLE_CODES
-        fprintf(stderr, "%d %d %d (sample = %d)\n", !!(symbol & 2), !!(symbol & 1), symbol, sample - flex->sample_delta);
+            fprintf(stderr, "%d %d %d\n", !!(symbol & 2), !!(symbol & 1), symbol);
 #endif
-            _pager_flex_phase_append_bit(&blk->phase[PAGER_FLEX_PHASE_A], !!(symbol & 2));
-            _pager_flex_phase_append_bit(&blk->phase[PAGER_FLEX_PHASE_B], !!(symbol & 1));
-        } else {
-            _pager_flex_phase_append_bit(&blk->phase[PAGER_FLEX_PHASE_C], !!(symbol & 2));
-            _pager_flex_phase_append_bit(&blk->phase[PAGER_FLEX_PHASE_D], !!(symbol & 1));
+            if (false == blk->phase_ff) {
+                pager_flex_phase_append_bit(phase_a, !!(symbol & 2));
+                pager_flex_phase_append_bit(phase_b, !!(symbol & 1));
+            } else {
+                pager_flex_phase_append_bit(phase_c, !!(symbol & 2));
+                pager_flex_phase_append_bit(phase_d, !!(symbol & 1));
+            }
+            blk->phase_ff = !blk->phase_ff;
         }
-        blk->phase_ff = !blk->phase_ff;
         break;
     default:
         PANIC("Unknown number of phases for FLEX coding: %u", coding->nr_phases);
     }
 
-    blk->nr_symbols++;
+    blk->nr_symbols += nr_symbols;
 
     if (blk->nr_symbols == coding->symbols_per_block) {
         /* Process the block data, one phase at a time */
@@ -1308,6 +1777,147 @@ void _pager_flex_block_update(struct pager_flex *flex, int16_t sample)
     }
 }
 
+/**
+ * The clock recovery error for a clean transition between the outer symbol levels
+ */
+#define __PAGER_FLEX_MM_FULL_ERROR          (2.0f * PAGER_FLEX_MM_LEVEL * PAGER_FLEX_MM_LEVEL)
+
+/**
+ * Scale a sample so the outer symbol levels are at PAGER_FLEX_MM_LEVEL.
+ */
+static inline
+int16_t __pager_flex_mm_scale(struct pager_flex *flex, int16_t sample)
+{
+    int32_t half_range = flex->sample_range / 2,
+            scaled = ((int32_t)sample - flex->sample_delta) * PAGER_FLEX_MM_LEVEL / (0 < half_range ? half_range : 1);
+
+    if (INT16_MAX < scaled) {
+        scaled = INT16_MAX;
+    } else if (INT16_MIN > scaled) {
+        scaled = INT16_MIN;
+    }
+
+    return scaled;
+}
+
+/**
+ * Start the symbol clock recovery at the start of Sync 2, at the symbol rate picked by the coding.
+ * The clock then runs on through the comma of Sync 2, pulling in before the block starts.
+ *
+ * The last bit of the FIW was sampled at its center, so the first symbol of Sync 2 is centered
+ * (P + S) / 2 samples on, where there are P samples per bit of Sync 1 and S samples per symbol.
+ * A half sample rounds down.
+ */
+static
+void _pager_flex_symbol_clock_start(struct pager_flex *flex)
+{
+    struct pager_flex_coding *coding = flex->sync.coding;
+    uint32_t symbol_rate = coding->baud / coding->sym_bits,
+             num = flex->sample_rate * (symbol_rate + PAGER_FLEX_SYNC_BAUD_RATE),
+             den = 2 * PAGER_FLEX_SYNC_BAUD_RATE * symbol_rate,
+             first = (2 * num + den - 1) / (2 * den);
+    float samples_per_symbol = (float)flex->sample_rate / (float)symbol_rate;
+
+    TSL_BUG_IF_FAILED(mm_init(&flex->mm, PAGER_FLEX_MM_KW * samples_per_symbol / __PAGER_FLEX_MM_FULL_ERROR,
+                PAGER_FLEX_MM_KM * samples_per_symbol / __PAGER_FLEX_MM_FULL_ERROR, samples_per_symbol,
+                (1.0f - PAGER_FLEX_MM_MAX_DRIFT) * samples_per_symbol,
+                (1.0f + PAGER_FLEX_MM_MAX_DRIFT) * samples_per_symbol));
+
+    flex->skip = (flex->sample_rate + symbol_rate / 2) / symbol_rate - 1;
+    flex->skip_count = first - 1;
+    flex->mid_count = 0;
+    flex->mid_sample = 0;
+}
+
+/**
+ * Step the symbol clock recovery on from a symbol-center sample, outside of a block.
+ */
+static
+void _pager_flex_symbol_clock_step(struct pager_flex *flex, int16_t sample)
+{
+    size_t step = mm_gardner_decision(&flex->mm, __pager_flex_mm_scale(flex, sample),
+            __pager_flex_mm_scale(flex, flex->mid_sample));
+
+    flex->skip_count = step - 1;
+    flex->mid_count = step - step/2;
+}
+
+/**
+ * Receive block data from a run of samples, the first of which is at the center of a symbol. The
+ * symbol clock recovery picks out the center of each symbol after that; these are gathered up,
+ * sliced a chunk at a time and handed to the phases, until either the samples or the block run
+ * out.
+ *
+ * \return The number of samples consumed, up to and including the last symbol-center sample.
+ *          The skip state is left as the per-sample path would leave it after that sample.
+ */
+static
+size_t _pager_flex_block_receive(struct pager_flex *flex, const int16_t *samples, size_t nr_samples)
+{
+    struct pager_flex_coding *coding = NULL;
+    int16_t centers[PAGER_FLEX_BLOCK_CHUNK];
+    int8_t symbols[PAGER_FLEX_BLOCK_CHUNK];
+    size_t next = 0,
+           last = 0,
+           step = 0;
+#ifdef _TSL_DEBUG
+    TSL_BUG_ON(NULL == flex);
+    TSL_BUG_ON(0 == nr_samples);
+#endif
+    coding = flex->sync.coding;
+#ifdef _TSL_DEBUG
+    TSL_BUG_ON(NULL == coding);
+#endif
+
+    do {
+        size_t max_symbols = BL_MIN2((size_t)(coding->symbols_per_block - flex->block.nr_symbols),
+                                     (size_t)PAGER_FLEX_BLOCK_CHUNK),
+               nr_symbols = 0;
+
+        /* Gather the symbol-center samples, with the clock recovery finding each in turn */
+        while (nr_symbols < max_symbols && next < nr_samples) {
+            centers[nr_symbols++] = samples[next];
+
+            step = mm_gardner_decision(&flex->mm, __pager_flex_mm_scale(flex, samples[next]),
+                    __pager_flex_mm_scale(flex, flex->mid_sample));
+
+            /* The sample halfway to the next symbol, if it's in this run (else it's picked up later) */
+            if (next + step/2 < nr_samples) {
+                flex->mid_sample = samples[next + step/2];
+            }
+
+            last = next;
+            next += step;
+        }
+
+        /* Then slice them all in one go */
+        coding->slice_block(flex, symbols, centers, nr_symbols);
+
+        /* This might complete the block, putting us back to searching for Sync 1 */
+        _pager_flex_block_symbols(flex, symbols, nr_symbols);
+    } while (PAGER_FLEX_STATE_BLOCK == flex->state && next < nr_samples);
+
+    if (PAGER_FLEX_STATE_BLOCK == flex->state) {
+        flex->skip_count = step - 1;
+        flex->mid_count = step - step/2;
+    }
+
+    return last + 1;
+}
+
+/**
+ * Get the number of samples until the next one that the decoder looks at.
+ */
+static
+size_t _pager_flex_skippable(struct pager_flex *flex)
+{
+    if (0 < flex->mid_count && flex->mid_count <= flex->skip_count) {
+        return flex->skip_count - flex->mid_count;
+    }
+
+    return flex->skip_count;
+}
+
 static
 bool _pager_flex_handle_fiw(struct pager_flex *flex)
 {
@@ -1326,9 +1936,8 @@ bool _pager_flex_handle_fiw(struct pager_flex *flex)
     }
 
     DIAG("FIW: Corrected %u errors", __builtin_popcount(fiw ^ (flex->sync.fiw & 0x7ffffffful)));
-    DIAG("SYNC2: %u bps, %uFSK (skip = %d)", flex->sync.coding->baud,
-            flex->sync.coding->fsk_levels,
-            flex->sync.coding->sample_skip);
+    DIAG("SYNC2: %u bps, %uFSK", flex->sync.coding->baud,
+            flex->sync.coding->fsk_levels);
 
     /* Check the FIW checksum */
     fiw_cksum = __pager_flex_calc_word_checksum(fiw);
@@ -1367,7 +1976,7 @@ aresult_t pager_flex_new(struct pager_flex **pflex, uint32_t freq_hz, pager_flex
     flex->on_num_msg = on_num_msg;
     flex->on_siv_msg = on_siv_msg;
 
-    _pager_flex_reset_sync(flex);
+    TSL_BUG_IF_FAILED(pager_flex_set_sample_rate(flex, PAGER_FLEX_DEFAULT_SAMPLE_RATE));
 
     *pflex = flex;
 
@@ -1397,6 +2006,35 @@ aresult_t pager_flex_delete(struct pager_flex **pflex)
     return ret;
 }
 
+aresult_t pager_flex_set_sync_errors(struct pager_flex *flex, unsigned nr_errors)
+{
+    aresult_t ret = A_OK;
+
+    TSL_ASSERT_ARG(NULL != flex);
+    TSL_ASSERT_ARG(PAGER_FLEX_SYNC_BS1_MAX_ERRORS >= nr_errors);
+
+    flex->sync_max_errors = nr_errors;
+
+    return ret;
+}
+
+aresult_t pager_flex_set_sample_rate(struct pager_flex *flex, uint32_t sample_rate)
+{
+    aresult_t ret = A_OK;
+
+    TSL_ASSERT_ARG(NULL != flex);
+    TSL_ASSERT_ARG(0 == sample_rate % PAGER_FLEX_SYNC_BAUD_RATE);
+    TSL_ASSERT_ARG(PAGER_FLEX_MIN_SAMPLE_RATE <= sample_rate && PAGER_FLEX_MAX_SAMPLE_RATE >= sample_rate);
+
+    flex->sample_rate = sample_rate;
+    flex->sync_phases = sample_rate / PAGER_FLEX_SYNC_BAUD_RATE;
+
+    /* Start over, searching for Sync 1 at the new rate */
+    _pager_flex_reset_sync(flex);
+
+    return ret;
+}
+
 aresult_t pager_flex_on_pcm(struct pager_flex *flex, const int16_t *pcm_samples, size_t nr_samples)
 {
     aresult_t ret = A_OK;
@@ -1410,6 +2048,12 @@ aresult_t pager_flex_on_pcm(struct pager_flex *flex, const int16_t *pcm_samples,
             flex->skip_count = flex->skip;
             switch (flex->state) {
             case PAGER_FLEX_STATE_SYNC_1:
+                if (PAGER_FLEX_SYNC_STATE_SEARCH_BS1 == flex->sync.state) {
+                    /* Nothing found yet (i.e. an idle channel), so search the rest of the block in one go */
+                    i += _pager_flex_sync_search_bs1(flex, &pcm_samples[i], nr_samples - i) - 1;
+                    break;
+                }
+
                 /* Deliver a sample to the sync state handler */
                 _pager_flex_sync_update(flex, pcm_samples[i]);
 
@@ -1418,8 +2062,7 @@ aresult_t pager_flex_on_pcm(struct pager_flex *flex, const int16_t *pcm_samples,
                         DIAG("PAGER_FLEX_STATE_SYNC_1 -> PAGER_FLEX_STATE_SYNC_2");
 
                         flex->state = PAGER_FLEX_STATE_SYNC_2;
-                        flex->skip = flex->sync.coding->sample_skip;
-                        flex->skip_count = flex->skip + flex->sync.coding->sample_fudge;
+                        _pager_flex_symbol_clock_start(flex);
                     } else {
                         /*  Reset sync state */
                         _pager_flex_reset_sync(flex);
@@ -1430,9 +2073,10 @@ aresult_t pager_flex_on_pcm(struct pager_flex *flex, const int16_t *pcm_samples,
             case PAGER_FLEX_STATE_SYNC_2:
                 /* Deliver the sample to the Sync 2 state handler (fast sync) */
                 _pager_flex_sync2_update(flex, pcm_samples[i]);
+                _pager_flex_symbol_clock_step(flex, pcm_samples[i]);
 
                 if (PAGER_FLEX_SYNC_2_STATE_SYNCED == flex->sync_2.state) {
-                    /* Move along to processing the following block */
+                    /* Move along to processing the following block, keeping the symbol clock */
                     DIAG("PAGER_FLEX_STATE_SYNC_2 -> PAGER_FLEX_STATE_BLOCK");
                     flex->state = PAGER_FLEX_STATE_BLOCK;
                 }
@@ -1440,11 +2084,16 @@ aresult_t pager_flex_on_pcm(struct pager_flex *flex, const int16_t *pcm_samples,
                 break;
 
             case PAGER_FLEX_STATE_BLOCK:
-                /* Update and accumulate block state */
-                _pager_flex_block_update(flex, pcm_samples[i]);
+                /* Slice and accumulate all the symbols in the rest of the block of samples */
+                i += _pager_flex_block_receive(flex, &pcm_samples[i], nr_samples - i) - 1;
                 break;
             }
         } else {
+            if (flex->skip_count == flex->mid_count) {
+                /* Halfway between symbols, for the symbol clock recovery */
+                flex->mid_sample = pcm_samples[i];
+            }
+
             /* Skip this sample, decrement the skip counter */
             flex->skip_count--;
         }
@@ -1453,3 +2102,40 @@ aresult_t pager_flex_on_pcm(struct pager_flex *flex, const int16_t *pcm_samples,
     return ret;
 }
 
+aresult_t pager_flex_sample_demand(struct pager_flex *flex, bool *psparse, size_t *pnr_skip)
+{
+    aresult_t ret = A_OK;
+
+    TSL_ASSERT_ARG(NULL != flex);
+    TSL_ASSERT_ARG(NULL != psparse);
+    TSL_ASSERT_ARG(NULL != pnr_skip);
+
+    /* While searching for sync, every sample is examined */
+    *psparse = 0 < flex->skip && 0 <= flex->skip_count;
+    *pnr_skip = true == *psparse ? _pager_flex_skippable(flex) : 0;
+
+    return ret;
+}
+
+aresult_t pager_flex_skip(struct pager_flex *flex, size_t nr_samples)
+{
+    aresult_t ret = A_OK;
+
+    TSL_ASSERT_ARG(NULL != flex);
+
+    if (0 == nr_samples) {
+        goto done;
+    }
+
+    if (0 >= flex->skip || 0 > flex->skip_count || nr_samples > _pager_flex_skippable(flex)) {
+        /* The decoder needs one of these samples */
+        ret = A_E_INVAL;
+        goto done;
+    }
+
+    flex->skip_count -= nr_samples;
+
+done:
+    return ret;
+}
+
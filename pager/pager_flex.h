@@ -104,6 +104,28 @@ aresult_t pager_flex_new(struct pager_flex **pflex, uint32_t freq_hz, pager_flex
  */
 aresult_t pager_flex_delete(struct pager_flex **pflex);
 
+/**
+ * Set how many bits of the 32-bit BS1 sync pattern may be in error for the decoder to still
+ * consider it found. The default is 0, an exact match.
+ *
+ * \param flex The FLEX pager decoder state
+ * \param nr_errors The number of bit errors to tolerate, at most 8
+ *
+ * \return A_OK on success, A_E_INVAL if nr_errors is out of range
+ */
+aresult_t pager_flex_set_sync_errors(struct pager_flex *flex, unsigned nr_errors);
+
+/**
+ * Set the sample rate of the input. The default is 16kHz. Lower rates are cheaper to decode, down
+ * to 4 samples per symbol at the fastest FLEX symbol rate. Starts over searching for sync.
+ *
+ * \param flex The FLEX pager decoder state
+ * \param sample_rate The sample rate, in Hertz. A multiple of 1600Hz, from 12800Hz to 16000Hz.
+ *
+ * \return A_OK on success, A_E_INVAL if the sample rate isn't supported
+ */
+aresult_t pager_flex_set_sample_rate(struct pager_flex *flex, uint32_t sample_rate);
+
 /**
  * Push a block of PCM samples through the FLEX pager decoder. This will decode and demodulate/deliver data
  * as soon as enough data is available.
@@ -114,3 +136,24 @@ aresult_t pager_flex_delete(struct pager_flex **pflex);
  */
 aresult_t pager_flex_on_pcm(struct pager_flex *flex, const int16_t *pcm_samples, size_t nr_samples);
 
+/**
+ * Find out which upcoming samples the decoder will actually look at. Once the sync word has
+ * been found, the decoder only looks at one sample per symbol, and the rest can be skipped with
+ * pager_flex_skip, so they never need to be computed.
+ *
+ * \param flex The FLEX pager decoder state
+ * \param psparse Set to true if the decoder only looks at some samples, false if it needs them all
+ * \param pnr_skip If sparse, the number of samples the decoder will ignore before the next one it
+ *                 looks at
+ */
+aresult_t pager_flex_sample_demand(struct pager_flex *flex, bool *psparse, size_t *pnr_skip);
+
+/**
+ * Advance the decoder past samples it would ignore, without providing them. nr_samples must not
+ * be more than the skip count from pager_flex_sample_demand.
+ *
+ * \param flex The FLEX pager decoder state
+ * \param nr_samples The number of samples to skip
+ */
+aresult_t pager_flex_skip(struct pager_flex *flex, size_t nr_samples);
+
@@ -1,5 +1,7 @@
 #pragma once
 
+#include <pager/mueller_muller.h>
+
 #include <stdbool.h>
 
 struct pager_flex;
@@ -74,15 +76,73 @@ enum pager_flex_sync_state {
 
 struct pager_flex_coding;
 
+/**
+ * The bit rate of Sync 1, which every FLEX transmission starts with
+ */
+#define PAGER_FLEX_SYNC_BAUD_RATE       1600
+
+/**
+ * Most samples per bit at 1600bps, during Sync 1, at the highest sample rate supported. Each
+ * sample phase is tracked separately while searching for the BS1 pattern.
+ */
+#define PAGER_FLEX_SYNC_MAX_SAMPLE_PHASES   10
+
+/**
+ * The range of sample rates supported, and the default. The sample rate must be a whole number of
+ * samples per bit at 1600bps, and at least 4 samples per symbol at 3200 symbols/s. With fewer,
+ * the symbol clock recovery can't keep the sampling point in the eye once the transmitter's clock
+ * drifts a little.
+ *@{
+ */
+#define PAGER_FLEX_MIN_SAMPLE_RATE      (8 * PAGER_FLEX_SYNC_BAUD_RATE)
+#define PAGER_FLEX_MAX_SAMPLE_RATE      (PAGER_FLEX_SYNC_MAX_SAMPLE_PHASES * PAGER_FLEX_SYNC_BAUD_RATE)
+#define PAGER_FLEX_DEFAULT_SAMPLE_RATE  PAGER_FLEX_MAX_SAMPLE_RATE
+/**
+ *@}
+ */
+
 /**
  * FLEX Sync 1 stage state tracker. Tracks the detection of various sync phases in Sync 1,
  * then stores the current state for the rest of the objects to extract.
  */
 struct pager_flex_sync {
-    uint32_t sync_words[10];
+    uint32_t sync_words[PAGER_FLEX_SYNC_MAX_SAMPLE_PHASES];
     enum pager_flex_sync_state state;
     uint8_t sample_counter;
     uint8_t bit_counter;
+
+    /**
+     * When BS1 may have bit errors: the fewest errors seen in the current run of sample phases
+     * matching BS1
+     */
+    uint8_t run_errors;
+
+    /**
+     * When BS1 may have bit errors: the width of the run with the fewest errors so far, or 0 if
+     * there hasn't been one yet
+     */
+    uint8_t best_eye;
+
+    /**
+     * The fewest errors seen in the best run
+     */
+    uint8_t best_errors;
+
+    /**
+     * The sample phase of the first sample after the best run
+     */
+    uint8_t best_phase;
+
+    /**
+     * The number of samples since the best run ended
+     */
+    uint8_t best_age;
+
+    /**
+     * The number of samples since the last run of sample phases matching BS1 ended
+     */
+    uint8_t quiet_age;
+
     uint32_t a;
     uint16_t b;
     uint32_t inv_a;
@@ -197,6 +257,17 @@ struct pager_flex_phase {
      * The base word, to determine within phase_words where cur_word is relative to.
      */
     uint8_t base_word;
+
+    /**
+     * Number of received bits waiting in raw_bits
+     */
+    uint8_t nr_raw_bits;
+
+    /**
+     * Received bits, in order from bit 0, not yet de-interleaved into phase_words. Every 64 bits
+     * holds the next 8 bits of each of the 8 words in the current block.
+     */
+    uint64_t raw_bits;
 };
 
 #define PAGER_FLEX_PHASE_A              0
@@ -205,6 +276,23 @@ struct pager_flex_phase {
 #define PAGER_FLEX_PHASE_D              3
 #define PAGER_FLEX_PHASE_MAX            4
 
+/**
+ * Shift a single received bit straight into its interleaved word in the phase. This is the
+ * per-bit reference for pager_flex_phase_append_bit.
+ */
+void pager_flex_phase_shift_bit(struct pager_flex_phase *phase, bool bit);
+
+/**
+ * Queue a received bit for the phase, de-interleaving every 64 bits into the phase words at once.
+ */
+void pager_flex_phase_append_bit(struct pager_flex_phase *phase, bool bit);
+
+/**
+ * Shift any received bits that don't yet make up a full 64 into the phase words, so the words
+ * look exactly as if each bit had been shifted in as it arrived.
+ */
+void pager_flex_phase_flush(struct pager_flex_phase *phase);
+
 /**
  * State for the block accumulation state
  */
@@ -228,7 +316,7 @@ struct pager_flex_block {
 /**
  * A FLEX pager decoder.
  *
- * The input for this must always be a 16kHz signal.
+ * The input is 16kHz, unless set otherwise with pager_flex_set_sample_rate.
  */
 struct pager_flex {
     /**
@@ -281,6 +369,21 @@ struct pager_flex {
      */
     enum pager_flex_state state;
 
+    /**
+     * The number of bits that can differ from the BS1 pattern for it to still be accepted
+     */
+    uint8_t sync_max_errors;
+
+    /**
+     * The input sample rate, in Hertz
+     */
+    uint32_t sample_rate;
+
+    /**
+     * Number of samples per bit at 1600bps, during Sync 1, at the input sample rate
+     */
+    uint8_t sync_phases;
+
     /**
      * The number of samples to skip before sampling for slicing
      */
@@ -291,6 +394,21 @@ struct pager_flex {
      */
     int16_t skip_count;
 
+    /**
+     * From Sync 2 on, the skip count at which the sample halfway between symbols is taken
+     */
+    int16_t mid_count;
+
+    /**
+     * The sample taken halfway between the last symbol and the next
+     */
+    int16_t mid_sample;
+
+    /**
+     * Symbol clock recovery, from the start of Sync 2 to the end of the block
+     */
+    struct mueller_muller mm;
+
     /**
      * The symbol sample rate. The number of samples that represents a single symbol
      */
@@ -327,6 +445,11 @@ struct pager_flex {
  */
 typedef int8_t (*pager_flex_slice_sym_func_t)(struct pager_flex *flex, int16_t sample);
 
+/**
+ * Slice function for an array of symbol-center samples, using the FLEX pager state.
+ */
+typedef void (*pager_flex_slice_block_func_t)(struct pager_flex *flex, int8_t *symbols, const int16_t *samples, size_t nr_samples);
+
 struct pager_flex_coding {
     /**
      * The identifier A-code sequence
@@ -343,11 +466,6 @@ struct pager_flex_coding {
      */
     uint8_t fsk_levels;
 
-    /**
-     * The number of samples we'll skip when we shift to Sync 2 and beyond.
-     */
-    uint8_t sample_skip;
-
     /**
      * Number of samples the Sync 2 phase has of the standard 0xa sequence
      */
@@ -358,11 +476,6 @@ struct pager_flex_coding {
      */
     uint8_t sym_bits;
 
-    /**
-     * Fudge factor applied when performing the sample rate transition.
-     */
-    uint8_t sample_fudge;
-
     /**
      * Number of symbols in the data block
      */
@@ -377,6 +490,11 @@ struct pager_flex_coding {
      * Slicer function
      */
     pager_flex_slice_sym_func_t slice;
+
+    /**
+     * Slicer function for a run of symbols, used while receiving a block
+     */
+    pager_flex_slice_block_func_t slice_block;
 };
 
 /**
@@ -415,6 +533,12 @@ struct pager_flex_coding {
  */
 #define PAGER_FLEX_SYNC_BS1                 0xaaaaaaaaul
 
+/**
+ * The most bit errors that can be tolerated in the BS1 pattern. Any more, and noise on an idle
+ * channel starts to look like a sync.
+ */
+#define PAGER_FLEX_SYNC_BS1_MAX_ERRORS      8
+
 /**
  * Value always present in 'A' binary pattern in SYNC 1
  */
@@ -445,6 +569,23 @@ struct pager_flex_coding {
  * @}
  */
 
+/**
+ * Symbol clock recovery parameters, used from the start of Sync 2 to the end of the block.
+ * Samples are scaled so the outer symbol levels are at PAGER_FLEX_MM_LEVEL, per the levels
+ * trained during sync. The gains are the fraction of a symbol the sampling point and the symbol
+ * period move for a clean transition between the outer levels that isn't centered between the
+ * samples taken. The symbol period may stray up to PAGER_FLEX_MM_MAX_DRIFT of a symbol from the
+ * nominal.
+ * @{
+ */
+#define PAGER_FLEX_MM_LEVEL                 4096
+#define PAGER_FLEX_MM_KM                    0.05f
+#define PAGER_FLEX_MM_KW                    0.0002f
+#define PAGER_FLEX_MM_MAX_DRIFT             0.005f
+/**
+ * @}
+ */
+
 /**
  * Vector Type Codes
  *
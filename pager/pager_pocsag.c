@@ -39,7 +39,7 @@
 static
 bool __pager_pocsag_check_sync_word(uint32_t word)
 {
-    return (__builtin_popcount(word ^ POCSAG_SYNC_CODEWORD) <= 4);
+    return (__builtin_popcount(word ^ POCSAG_SYNC_CODEWORD) <= POCSAG_SYNC_MAX_ERRORS);
 }
 
 static
@@ -78,65 +78,312 @@ void _pager_pocsag_sync_search_reset(struct pager_pocsag_sync_search *sync)
     sync->sync_word = 0;
 }
 
+/**
+ * Number of samples the baud rate search slices and searches at a time.
+ */
+#define POCSAG_PAGER_EYE_CHUNK          1024
+
+/**
+ * Number of 64-bit words to hold the sliced history and a chunk of samples, plus a word of
+ * padding so a 64-bit window can be read from any offset.
+ */
+#define POCSAG_PAGER_EYE_BUF_WORDS      ((POCSAG_PAGER_EYE_HISTORY + POCSAG_PAGER_EYE_CHUNK) / 64 + 1)
+
+/**
+ * Read the 64 sliced bits starting at bit offset off of the packed bit buffer.
+ */
+static inline
+uint64_t __pager_pocsag_eye_bits_at(const uint64_t *bits, size_t off)
+{
+    size_t word = off / 64,
+           shift = off % 64;
+
+    if (0 == shift) {
+        return bits[word];
+    }
+
+    return (bits[word] >> shift) | (bits[word + 1] << (64 - shift));
+}
+
+/**
+ * Slice samples into the packed bit buffer, starting at a 64-bit aligned bit offset. A negative
+ * sample slices to a 1.
+ */
 static
-aresult_t _pager_pocsag_baud_on_sample(struct pager_pocsag *pocsag, struct pager_pocsag_baud_detect *det, int16_t sample)
+void _pager_pocsag_eye_slice(uint64_t *bits, const int16_t *samples, size_t nr_samples)
 {
-    aresult_t ret = A_OK;
+    for (size_t i = 0; i < nr_samples; i += 64) {
+        size_t nr = BL_MIN2(nr_samples - i, 64);
+        uint64_t sign = 0;
 
-    int bit = 0;
+        /* Gather the sign bits, which the compiler can turn into compares and a movemask */
+        for (size_t j = 0; j < nr; j++) {
+            sign |= (uint64_t)((uint16_t)samples[i + j] >> 15) << j;
+        }
 
-    TSL_ASSERT_ARG_DEBUG(NULL != pocsag);
-    TSL_ASSERT_ARG_DEBUG(NULL != det);
+        bits[i / 64] = sign;
+    }
+}
+
+/**
+ * Check the sync codeword against the eye of each of 64 consecutive samples, starting at bit
+ * offset pos of the packed bit buffer.
+ *
+ * The eye of the sample at t holds the samples at t - offsets[m], m = 0..31, and bit m of the
+ * sync codeword is expected there. A 64-bit window of the bitstream checks term m for all
+ * 64 samples, and the mismatches are added up in a 3-bit counter per sample, held as one 64-bit
+ * word per counter bit. Overflowing the counter counts as too many errors.
+ *
+ * \return A mask of the samples whose eye is within POCSAG_SYNC_MAX_ERRORS of the sync codeword
+ */
+static
+uint64_t _pager_pocsag_eye_matches(const uint64_t *bits, size_t pos, const uint16_t *offsets)
+{
+    uint64_t count_0 = 0,
+             count_1 = 0,
+             count_2 = 0,
+             over = 0,
+             greater = 0,
+             equal = ~0ull;
+
+    for (size_t m = 0; m < 32; m++) {
+        uint64_t expect = ((POCSAG_SYNC_CODEWORD >> m) & 1) ? ~0ull : 0,
+                 carry = __pager_pocsag_eye_bits_at(bits, pos - offsets[m]) ^ expect,
+                 next = 0;
+
+        next = count_0 & carry;
+        count_0 ^= carry;
+        carry = next;
+
+        next = count_1 & carry;
+        count_1 ^= carry;
+        carry = next;
+
+        over |= count_2 & carry;
+        count_2 ^= carry;
+
+        if (~0ull == over) {
+            /* Every sample has had at least 8 errors */
+            break;
+        }
+    }
 
-    bit = sample < 0 ? 1 : 0;
+    /* Compare each counter against the limit, from the top bit down */
+#if (POCSAG_SYNC_MAX_ERRORS >> 2) & 1
+    equal &= count_2;
+#else
+    greater |= equal & count_2;
+    equal &= ~count_2;
+#endif
+
+#if (POCSAG_SYNC_MAX_ERRORS >> 1) & 1
+    equal &= count_1;
+#else
+    greater |= equal & count_1;
+    equal &= ~count_1;
+#endif
+
+#if POCSAG_SYNC_MAX_ERRORS & 1
+    equal &= count_0;
+#else
+    greater |= equal & count_0;
+    equal &= ~count_0;
+#endif
+
+    return ~(over | greater);
+}
+
+/**
+ * The clock recovery error for a clean transition between the two levels
+ */
+#define __POCSAG_PAGER_MM_FULL_ERROR    (2.0f * POCSAG_PAGER_MM_LEVEL * POCSAG_PAGER_MM_LEVEL)
 
-    det->eye_detect[det->cur_word] <<= 1;
-    det->eye_detect[det->cur_word] |= bit;
+/**
+ * Scale a sample to POCSAG_PAGER_MM_LEVEL, per the estimated signal level.
+ */
+static inline
+int16_t __pager_pocsag_scale(struct pager_pocsag *pocsag, int16_t sample)
+{
+    int32_t scaled = (int32_t)sample * POCSAG_PAGER_MM_LEVEL / (0 != pocsag->bit_level ? pocsag->bit_level : 1);
+
+    if (INT16_MAX < scaled) {
+        scaled = INT16_MAX;
+    } else if (INT16_MIN > scaled) {
+        scaled = INT16_MIN;
+    }
+
+    return scaled;
+}
+
+/**
+ * Feed the sample taken for a bit to the bit clock recovery, which works out how many samples
+ * along the next bit should be taken. Keeps the sampling point in the eye over a long burst,
+ * even if the transmitter's clock is a little off.
+ */
+static
+void _pager_pocsag_bit_clock(struct pager_pocsag *pocsag, int16_t sample)
+{
+    int32_t magnitude = sample < 0 ? -(int32_t)sample : sample;
 
-    if (__pager_pocsag_check_sync_word(det->eye_detect[det->cur_word])) {
-        det->nr_eye_matches++;
+    /* Track the signal level, so the loop gain doesn't depend on it */
+    if (0 == pocsag->bit_level) {
+        pocsag->bit_level = magnitude;
     } else {
-        /* Check if our eye is open wide enough */
-        if (det->nr_eye_matches > det->samples_per_bit/2) {
-            /* Advance the state */
-            DIAG("SEARCH -> SYNCHRONIZED: Initial Sync Found, skip = %u, matches = %u",
-                    (unsigned)det->samples_per_bit, (unsigned)det->nr_eye_matches);
-            pocsag->sample_skip = det->samples_per_bit;
-            pocsag->baud_rate = det->baud_rate;
-            _pager_pocsag_batch_reset(&pocsag->batch);
-            pocsag->batch.cur_sample_skip = det->nr_eye_matches/2;
-            pocsag->cur_state = PAGER_POCSAG_STATE_SYNCHRONIZED;
+        pocsag->bit_level += (magnitude - pocsag->bit_level) / POCSAG_PAGER_MM_LEVEL_DECAY;
+    }
+
+    pocsag->bit_skip = mm_gardner_decision(&pocsag->mm, __pager_pocsag_scale(pocsag, sample),
+            __pager_pocsag_scale(pocsag, pocsag->mid_sample));
+}
+
+/**
+ * We've found an eye that's open wide enough, so we know the baud rate. Set up to receive the
+ * first batch, sampling in the middle of the eye.
+ */
+static
+void _pager_pocsag_baud_synchronized(struct pager_pocsag *pocsag, struct pager_pocsag_baud_detect *det)
+{
+    /* The bit clock recovery works with the exact bit period, even if it's not a whole number of samples */
+    float samples_per_bit = (float)pocsag->sample_rate / (float)det->baud_rate;
+
+    DIAG("SEARCH -> SYNCHRONIZED: Initial Sync Found, skip = %u, matches = %u",
+            (unsigned)det->samples_per_bit, (unsigned)det->nr_eye_matches);
+    pocsag->sample_skip = det->samples_per_bit;
+    pocsag->bit_skip = det->samples_per_bit;
+    pocsag->bit_level = 0;
+    pocsag->mid_sample = 0;
+    TSL_BUG_IF_FAILED(mm_init(&pocsag->mm, POCSAG_PAGER_MM_KW * samples_per_bit / __POCSAG_PAGER_MM_FULL_ERROR,
+                POCSAG_PAGER_MM_KM * samples_per_bit / __POCSAG_PAGER_MM_FULL_ERROR, samples_per_bit,
+                (1.0f - POCSAG_PAGER_MM_MAX_DRIFT) * samples_per_bit,
+                (1.0f + POCSAG_PAGER_MM_MAX_DRIFT) * samples_per_bit));
+    pocsag->baud_rate = det->baud_rate;
+    _pager_pocsag_batch_reset(&pocsag->batch);
+    pocsag->batch.cur_sample_skip = det->nr_eye_matches/2;
+    pocsag->cur_state = PAGER_POCSAG_STATE_SYNCHRONIZED;
+}
+
+/**
+ * Track the width of the eye, given which of nr_samples consecutive samples matched the sync
+ * codeword. The eye is open wide enough once more than half a bit's worth of samples in a row
+ * match, and it's found at the first sample after those that doesn't match.
+ *
+ * \return true if the eye was found, with the index of that sample in *pfound
+ */
+static
+bool _pager_pocsag_baud_track_eye(struct pager_pocsag_baud_detect *det, uint64_t matches, size_t nr_samples,
+        size_t *pfound)
+{
+    for (size_t i = 0; i < nr_samples; i++) {
+        if (0 == det->nr_eye_matches && 0 == (matches >> i)) {
+            /* Nothing to track in the rest of these samples */
+            break;
+        }
+
+        if (0 != ((matches >> i) & 1)) {
+            det->nr_eye_matches++;
+        } else if (det->nr_eye_matches > det->samples_per_bit/2) {
+            *pfound = i;
+            return true;
         } else {
             /* No eye. */
             det->nr_eye_matches = 0;
         }
     }
-    det->cur_word = (det->cur_word + 1) % det->samples_per_bit;
 
-    return ret;
+    return false;
+}
+
+/**
+ * Search a run of samples for the sync codeword at each of the baud rates, in any sample phase.
+ * The samples are sliced into a packed bitstream, and each baud rate's detector checks its eye
+ * 64 samples at a time, so one pass over the samples serves all three.
+ *
+ * \return The number of samples consumed. If an eye was found, the sample it was found at is the
+ *         last one consumed, and the decoder is now synchronized.
+ */
+static
+size_t _pager_pocsag_baud_search(struct pager_pocsag *pocsag, const int16_t *samples, size_t nr_samples)
+{
+    struct pager_pocsag_baud_detect *dets[3] = { pocsag->baud_512, pocsag->baud_1200, pocsag->baud_2400 };
+    uint64_t bits[POCSAG_PAGER_EYE_BUF_WORDS];
+    size_t consumed = 0;
+
+    memset(bits, 0, sizeof(bits));
+
+    while (consumed < nr_samples && PAGER_POCSAG_STATE_SEARCH == pocsag->cur_state) {
+        size_t nr = BL_MIN2(nr_samples - consumed, POCSAG_PAGER_EYE_CHUNK),
+               end = nr;
+
+        memcpy(bits, pocsag->eye_history, sizeof(pocsag->eye_history));
+        _pager_pocsag_eye_slice(&bits[POCSAG_PAGER_EYE_HISTORY / 64], &samples[consumed], nr);
+
+        for (size_t base = 0; base < end; base += 64) {
+            size_t nr_lanes = BL_MIN2(end - base, 64);
+            struct pager_pocsag_baud_detect *found_det = NULL;
+
+            for (size_t d = 0; d < 3; d++) {
+                uint64_t matches = _pager_pocsag_eye_matches(bits, POCSAG_PAGER_EYE_HISTORY + base,
+                        dets[d]->eye_offsets);
+                size_t found = 0;
+
+                /*
+                 * The detectors see each sample in turn, so if more than one finds its eye at the
+                 * same sample, the last one wins.
+                 */
+                if (true == _pager_pocsag_baud_track_eye(dets[d], matches, nr_lanes, &found) &&
+                        base + found <= end - 1)
+                {
+                    end = base + found + 1;
+                    found_det = dets[d];
+                }
+            }
+
+            if (NULL != found_det) {
+                _pager_pocsag_baud_synchronized(pocsag, found_det);
+            }
+        }
+
+        /* Keep the samples leading up to the last one consumed, for the next chunk */
+        for (size_t w = 0; w < POCSAG_PAGER_EYE_HISTORY / 64; w++) {
+            pocsag->eye_history[w] = __pager_pocsag_eye_bits_at(bits, end + w * 64);
+        }
+
+        consumed += end;
+    }
+
+    return consumed;
 }
 
 static
 void _pager_pocsag_baud_reset(struct pager_pocsag_baud_detect *det)
 {
     TSL_BUG_ON(NULL == det);
-    memset(det->eye_detect, 0, sizeof(uint32_t) * det->samples_per_bit);
-    det->cur_word = 0;
     det->nr_eye_matches = 0;
 }
 
+/**
+ * Set up a baud rate detector for the decoder's sample rate.
+ */
+static
+void _pager_pocsag_baud_init(struct pager_pocsag_baud_detect *det, uint32_t sample_rate, uint16_t baud_rate)
+{
+    TSL_BUG_ON(NULL == det);
+
+    det->baud_rate = baud_rate;
+    det->samples_per_bit = (sample_rate + baud_rate/2) / baud_rate;
+
+    for (uint32_t m = 0; m < 32; m++) {
+        det->eye_offsets[m] = (m * sample_rate + baud_rate/2) / baud_rate;
+    }
+}
+
 static
 void _pager_pocsag_baud_search_reset(struct pager_pocsag *pocsag)
 {
+    memset(pocsag->eye_history, 0, sizeof(pocsag->eye_history));
     _pager_pocsag_baud_reset(pocsag->baud_512);
-    pocsag->baud_512->samples_per_bit = 75;
-    pocsag->baud_512->baud_rate = 512;
     _pager_pocsag_baud_reset(pocsag->baud_1200);
-    pocsag->baud_1200->samples_per_bit = 32;
-    pocsag->baud_1200->baud_rate = 1200;
     _pager_pocsag_baud_reset(pocsag->baud_2400);
-    pocsag->baud_2400->samples_per_bit = 16;
-    pocsag->baud_2400->baud_rate = 2400;
 }
 
 aresult_t pager_pocsag_new(struct pager_pocsag **ppocsag, uint32_t freq_hz,
@@ -156,19 +403,19 @@ aresult_t pager_pocsag_new(struct pager_pocsag **ppocsag, uint32_t freq_hz,
     }
 
     if (FAILED(ret = TACALLOC((void **)&pocsag->baud_512, 1,
-                    sizeof(struct pager_pocsag_baud_detect) + 75 * sizeof(uint32_t), SYS_CACHE_LINE_LENGTH)))
+                    sizeof(struct pager_pocsag_baud_detect), SYS_CACHE_LINE_LENGTH)))
     {
         goto done;
     }
 
     if (FAILED(ret = TACALLOC((void **)&pocsag->baud_1200, 1,
-                    sizeof(struct pager_pocsag_baud_detect) + 32 * sizeof(uint32_t), SYS_CACHE_LINE_LENGTH)))
+                    sizeof(struct pager_pocsag_baud_detect), SYS_CACHE_LINE_LENGTH)))
     {
         goto done;
     }
 
     if (FAILED(ret = TACALLOC((void **)&pocsag->baud_2400, 1,
-                    sizeof(struct pager_pocsag_baud_detect) + 16 * sizeof(uint32_t), SYS_CACHE_LINE_LENGTH)))
+                    sizeof(struct pager_pocsag_baud_detect), SYS_CACHE_LINE_LENGTH)))
     {
         goto done;
     }
@@ -178,7 +425,7 @@ aresult_t pager_pocsag_new(struct pager_pocsag **ppocsag, uint32_t freq_hz,
     pocsag->on_numeric = on_numeric;
     pocsag->on_alpha = on_alpha;
 
-    _pager_pocsag_baud_search_reset(pocsag);
+    TSL_BUG_IF_FAILED(pager_pocsag_set_sample_rate(pocsag, POCSAG_PAGER_BASE_BAUD_RATE));
     _pager_pocsag_message_decode_reset(&pocsag->decoder);
 
     *ppocsag = pocsag;
@@ -235,6 +482,28 @@ aresult_t pager_pocsag_delete(struct pager_pocsag **ppocsag)
     return ret;
 }
 
+aresult_t pager_pocsag_set_sample_rate(struct pager_pocsag *pocsag, uint32_t sample_rate)
+{
+    aresult_t ret = A_OK;
+
+    TSL_ASSERT_ARG(NULL != pocsag);
+    TSL_ASSERT_ARG(POCSAG_PAGER_MIN_SAMPLE_RATE <= sample_rate && POCSAG_PAGER_MAX_SAMPLE_RATE >= sample_rate);
+
+    pocsag->sample_rate = sample_rate;
+
+    _pager_pocsag_baud_init(pocsag->baud_512, sample_rate, 512);
+    _pager_pocsag_baud_init(pocsag->baud_1200, sample_rate, 1200);
+    _pager_pocsag_baud_init(pocsag->baud_2400, sample_rate, 2400);
+
+    /* Start over, searching at the new rate */
+    pocsag->cur_state = PAGER_POCSAG_STATE_SEARCH;
+    pocsag->sample_skip = 0;
+    pocsag->bit_skip = 0;
+    _pager_pocsag_baud_search_reset(pocsag);
+
+    return ret;
+}
+
 static
 aresult_t _pager_pocsag_message_decode_deliver(struct pager_pocsag *pocsag, struct pager_pocsag_message_decode *decode)
 {
@@ -319,16 +588,25 @@ aresult_t _pager_pocsag_process_batch(struct pager_pocsag *pocsag, struct pager_
     aresult_t ret = A_OK;
 
     struct pager_pocsag_message_decode *decode = NULL;
+    uint32_t words[PAGER_POCSAG_BATCH_BITS/32];
+    bool failed[PAGER_POCSAG_BATCH_BITS/32];
 
     TSL_ASSERT_ARG_DEBUG(NULL != pocsag);
     TSL_ASSERT_ARG_DEBUG(NULL != batch);
 
     decode = &pocsag->decoder;
 
+    /* Correct the whole batch up front; each word is then just a table lookup away */
+    for (size_t z = 0; z < PAGER_POCSAG_BATCH_BITS/32; z++) {
+        words[z] = batch->current_batch[z] & 0x7ffffffful;
+    }
+
+    bch_code_decode_words(pocsag->bch, words, PAGER_POCSAG_BATCH_BITS/32, failed);
+
     for (size_t z = 0; z < PAGER_POCSAG_BATCH_BITS/32; z++) {
-        uint32_t corrected = batch->current_batch[z] & 0x7ffffffful;
+        uint32_t corrected = words[z];
 
-        if (bch_code_decode(pocsag->bch, &corrected)) {
+        if (failed[z]) {
             /* We're stuck. POCSAG is too fragile to try to continue decoding, so we have to
              * discard the (rest) of the batch.
              */
@@ -447,19 +725,8 @@ aresult_t pager_pocsag_on_pcm(struct pager_pocsag *pocsag, const int16_t *pcm_sa
     while (nr_samples > next_sample) {
         switch (pocsag->cur_state) {
         case PAGER_POCSAG_STATE_SEARCH:
-            for (size_t i = 0; nr_samples > next_sample; i++) {
-                TSL_BUG_IF_FAILED(_pager_pocsag_baud_on_sample(pocsag, pocsag->baud_512,
-                            pcm_samples[next_sample]));
-                TSL_BUG_IF_FAILED(_pager_pocsag_baud_on_sample(pocsag, pocsag->baud_1200,
-                            pcm_samples[next_sample]));
-                TSL_BUG_IF_FAILED(_pager_pocsag_baud_on_sample(pocsag, pocsag->baud_2400,
-                            pcm_samples[next_sample]));
-
-                next_sample++;
-                if (pocsag->cur_state == PAGER_POCSAG_STATE_SYNCHRONIZED) {
-                    break;
-                }
-            }
+            /* Search the rest of the block at all three baud rates at once */
+            next_sample += _pager_pocsag_baud_search(pocsag, &pcm_samples[next_sample], nr_samples - next_sample);
             break;
         case PAGER_POCSAG_STATE_SYNCHRONIZED:
             pocsag->cur_state = PAGER_POCSAG_STATE_BATCH_RECEIVE;
@@ -467,9 +734,13 @@ aresult_t pager_pocsag_on_pcm(struct pager_pocsag *pocsag, const int16_t *pcm_sa
         case PAGER_POCSAG_STATE_BATCH_RECEIVE:
             DIAG("BATCH_RECEIVE: starting with %zu samples", nr_samples - next_sample);
             for (size_t i = 0; nr_samples > next_sample; i++) {
-                if (++batch->cur_sample_skip == pocsag->sample_skip) {
+                if (++batch->cur_sample_skip == pocsag->bit_skip/2) {
+                    /* Halfway between bits, for the bit clock recovery */
+                    pocsag->mid_sample = pcm_samples[next_sample];
+                } else if (batch->cur_sample_skip == pocsag->bit_skip) {
                     int sample = pcm_samples[next_sample];
                     uint32_t bit = sample < 0 ? 1 : 0;
+                    _pager_pocsag_bit_clock(pocsag, sample);
                     batch->current_batch[batch->current_batch_word] |= bit << batch->bit_count;
                     batch->current_batch_word_bit++;
                     batch->bit_count++;
@@ -504,9 +775,14 @@ aresult_t pager_pocsag_on_pcm(struct pager_pocsag *pocsag, const int16_t *pcm_sa
         case PAGER_POCSAG_STATE_SEARCH_SYNCWORD:
             DIAG("SEARCH_SYNCWORD: Skipping at rate %u", (unsigned)pocsag->sample_skip);
             for (size_t i = 0; nr_samples > next_sample; i++) {
-                if (++sync->cur_sample_skip == pocsag->sample_skip) {
+                if (++sync->cur_sample_skip == pocsag->bit_skip/2) {
+                    /* Halfway between bits, for the bit clock recovery */
+                    pocsag->mid_sample = pcm_samples[next_sample];
+                } else if (sync->cur_sample_skip == pocsag->bit_skip) {
                     int sample = pcm_samples[next_sample];
 
+                    _pager_pocsag_bit_clock(pocsag, sample);
+
                     sync->cur_sample_skip = 0;
                     sync->sync_word <<= 1;
                     sync->sync_word |= (sample < 0 ? 1 : 0);
@@ -518,6 +794,7 @@ aresult_t pager_pocsag_on_pcm(struct pager_pocsag *pocsag, const int16_t *pcm_sa
                             DIAG("SEARCH_SYNCWORD -> SEARCH (got %08x)", sync->sync_word);
                             pocsag->cur_state = PAGER_POCSAG_STATE_SEARCH;
                             pocsag->sample_skip = 0;
+                            pocsag->bit_skip = 0;
                             _pager_pocsag_baud_search_reset(pocsag);
                             TSL_BUG_IF_FAILED(_pager_pocsag_message_decode_deliver(pocsag, &pocsag->decoder));
                         } else {
@@ -538,3 +815,92 @@ aresult_t pager_pocsag_on_pcm(struct pager_pocsag *pocsag, const int16_t *pcm_sa
     return ret;
 }
 
+/**
+ * Get the skip counter that is running in the current state, or NULL if every sample is examined.
+ */
+static
+uint16_t *_pager_pocsag_skip_counter(struct pager_pocsag *pocsag)
+{
+    uint16_t *counter = NULL;
+
+    switch (pocsag->cur_state) {
+    case PAGER_POCSAG_STATE_SYNCHRONIZED:
+    case PAGER_POCSAG_STATE_BATCH_RECEIVE:
+        counter = &pocsag->batch.cur_sample_skip;
+        break;
+    case PAGER_POCSAG_STATE_SEARCH_SYNCWORD:
+        counter = &pocsag->sync.cur_sample_skip;
+        break;
+    default:
+        break;
+    }
+
+    /* The counter has to reach bit_skip exactly for a sample to be taken */
+    if (NULL != counter && *counter >= pocsag->bit_skip) {
+        counter = NULL;
+    }
+
+    return counter;
+}
+
+/**
+ * Get the number of samples until the next one that's taken, either halfway between bits or for
+ * the next bit, given the running skip counter.
+ */
+static
+size_t _pager_pocsag_skippable(struct pager_pocsag *pocsag, uint16_t counter)
+{
+    uint16_t next = counter < pocsag->bit_skip/2 ? pocsag->bit_skip/2 : pocsag->bit_skip;
+
+    return next - counter - 1;
+}
+
+aresult_t pager_pocsag_sample_demand(struct pager_pocsag *pocsag, bool *psparse, size_t *pnr_skip)
+{
+    aresult_t ret = A_OK;
+
+    uint16_t *counter = NULL;
+
+    TSL_ASSERT_ARG(NULL != pocsag);
+    TSL_ASSERT_ARG(NULL != psparse);
+    TSL_ASSERT_ARG(NULL != pnr_skip);
+
+    *psparse = false;
+    *pnr_skip = 0;
+
+    if (NULL == (counter = _pager_pocsag_skip_counter(pocsag))) {
+        goto done;
+    }
+
+    *psparse = true;
+    *pnr_skip = _pager_pocsag_skippable(pocsag, *counter);
+
+done:
+    return ret;
+}
+
+aresult_t pager_pocsag_skip(struct pager_pocsag *pocsag, size_t nr_samples)
+{
+    aresult_t ret = A_OK;
+
+    uint16_t *counter = NULL;
+
+    TSL_ASSERT_ARG(NULL != pocsag);
+
+    if (0 == nr_samples) {
+        goto done;
+    }
+
+    if (NULL == (counter = _pager_pocsag_skip_counter(pocsag)) ||
+            nr_samples > _pager_pocsag_skippable(pocsag, *counter))
+    {
+        /* The decoder needs one of these samples */
+        ret = A_E_INVAL;
+        goto done;
+    }
+
+    *counter += nr_samples;
+
+done:
+    return ret;
+}
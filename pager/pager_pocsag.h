@@ -2,6 +2,8 @@
 
 #include <tsl/result.h>
 
+#include <stdbool.h>
+
 struct pager_pocsag;
 
 typedef aresult_t (*pager_pocsag_on_numeric_msg_func_t)(
@@ -42,6 +44,18 @@ aresult_t pager_pocsag_new(struct pager_pocsag **ppocsag, uint32_t freq_hz, page
  */
 aresult_t pager_pocsag_delete(struct pager_pocsag **ppocsag);
 
+/**
+ * Set the sample rate of the PCM samples the decoder is given. The default is 38400Hz. The
+ * decoder works down to 4 samples per bit at the fastest baud rate, so as low as 9600Hz.
+ * Decoding starts over, searching for a sync codeword.
+ *
+ * \param pocsag The POCSAG decoder state.
+ * \param sample_rate The sample rate, in Hz.
+ *
+ * \return A_OK on success, A_E_INVAL if the sample rate is out of range.
+ */
+aresult_t pager_pocsag_set_sample_rate(struct pager_pocsag *pocsag, uint32_t sample_rate);
+
 /**
  * Process a block of PCM samples that have arrived, decoding any POCSAG messages contained within.
  *
@@ -53,3 +67,27 @@ aresult_t pager_pocsag_delete(struct pager_pocsag **ppocsag);
  */
 aresult_t pager_pocsag_on_pcm(struct pager_pocsag *pocsag, const int16_t *pcm_samples, size_t nr_samples);
 
+/**
+ * Find out which upcoming samples the decoder will actually look at. Once synchronized, the
+ * decoder only looks at one sample per bit, and the samples in between can be skipped with
+ * pager_pocsag_skip, so they never need to be computed.
+ *
+ * \param pocsag The POCSAG decoder state.
+ * \param psparse Set to true if the decoder only looks at some samples, false if it needs them all.
+ * \param pnr_skip If sparse, the number of samples the decoder will ignore before the next one it
+ *                 looks at.
+ *
+ * \return A_OK on success, an error code otherwise.
+ */
+aresult_t pager_pocsag_sample_demand(struct pager_pocsag *pocsag, bool *psparse, size_t *pnr_skip);
+
+/**
+ * Advance the decoder past samples it would ignore, without providing them. nr_samples must not
+ * be more than the skip count from pager_pocsag_sample_demand.
+ *
+ * \param pocsag The POCSAG decoder state.
+ * \param nr_samples The number of samples to skip.
+ *
+ * \return A_OK on success, A_E_INVAL if the decoder needs one of the samples.
+ */
+aresult_t pager_pocsag_skip(struct pager_pocsag *pocsag, size_t nr_samples);
@@ -2,6 +2,7 @@
 
 #include <pager/pager_pocsag.h>
 #include <pager/bch_code.h>
+#include <pager/mueller_muller.h>
 
 #define PAGER_POCSAG_BATCH_BITS         512
 #define PAGER_POCSAG_SYNC_BITS          32
@@ -39,6 +40,11 @@ enum pager_pocsag_state {
  */
 #define POCSAG_SYNC_CODEWORD            0x7cd215d8ul
 
+/**
+ * Number of bit errors tolerated in a received synchronization codeword
+ */
+#define POCSAG_SYNC_MAX_ERRORS          4
+
 /**
  * Idle codeword, used to detect when words in a batch are to be ignored.
  * Post-BCH correction.
@@ -50,6 +56,37 @@ enum pager_pocsag_state {
 #define POCSAG_PAGER_BAUD_1200_SAMPLES  (POCSAG_PAGER_BASE_BAUD_RATE/1200)
 #define POCSAG_PAGER_BAUD_2400_SAMPLES  (POCSAG_PAGER_BASE_BAUD_RATE/2400)
 
+/**
+ * Range of sample rates the decoder works at. The base rate is the default, and the highest; the
+ * lowest gives 4 samples per bit at 2400bps. With fewer, the bit clock recovery can't keep the
+ * sampling point in the eye once the transmitter's clock drifts a little.
+ */
+#define POCSAG_PAGER_MIN_SAMPLE_RATE    9600
+#define POCSAG_PAGER_MAX_SAMPLE_RATE    POCSAG_PAGER_BASE_BAUD_RATE
+
+/**
+ * Number of past sliced samples the baud rate search keeps: enough to hold a sync codeword at
+ * the slowest baud rate and the highest sample rate, rounded up to a whole number of 64-bit words.
+ */
+#define POCSAG_PAGER_EYE_HISTORY        ((31 * POCSAG_PAGER_BAUD_512_SAMPLES + 64) / 64 * 64)
+
+/**
+ * Bit clock recovery parameters, used once synchronized. Samples are scaled so the signal level
+ * is POCSAG_PAGER_MM_LEVEL before they're handed to the clock recovery, so the loop gains hold
+ * whatever the level of the input. The gains are the fraction of a bit the sampling point and the
+ * bit period move for a clean transition that isn't centered between the samples taken. The bit
+ * period may stray up to POCSAG_PAGER_MM_MAX_DRIFT of a bit from the nominal.
+ * @{
+ */
+#define POCSAG_PAGER_MM_LEVEL           4096
+#define POCSAG_PAGER_MM_LEVEL_DECAY     16
+#define POCSAG_PAGER_MM_KM              0.05f
+#define POCSAG_PAGER_MM_KW              0.0002f
+#define POCSAG_PAGER_MM_MAX_DRIFT       0.005f
+/**
+ * @}
+ */
+
 #define POCSAG_PAGER_MAX_ALNUM_LEN      42
 #define POCSAG_PAGER_MAX_NUM_LEN        75
 
@@ -140,29 +177,26 @@ struct pager_pocsag_message_decode {
  */
 struct pager_pocsag_baud_detect {
     /**
-     * The number of samples per bit, also the number of words in the 
+     * The number of samples per bit, rounded to the nearest sample
      */
     uint32_t samples_per_bit;
 
     /**
-     * The baud rate
+     * Offset of each bit of the sync codeword back from the latest, in samples. Bit m is
+     * m * sample_rate / baud_rate samples back, rounded, so this works when there isn't a whole
+     * number of samples per bit.
      */
-    uint16_t baud_rate;
+    uint16_t eye_offsets[32];
 
     /**
-     * The current word being processed
+     * The baud rate
      */
-    uint32_t cur_word;
+    uint16_t baud_rate;
 
     /**
      * Number of samples in the eye that match
      */
     uint32_t nr_eye_matches;
-
-    /**
-     * Sync word eye detection
-     */
-    uint32_t eye_detect[];
 };
 
 /**
@@ -220,11 +254,36 @@ struct pager_pocsag_sync_search {
  * POCSAG processing state.
  */
 struct pager_pocsag {
+    /**
+     * The sample rate of the input, in Hz
+     */
+    uint32_t sample_rate;
+
     /**
      * The rate to skip samples at
      */
     uint16_t sample_skip;
 
+    /**
+     * The number of samples from the last bit to the next, from the bit clock recovery
+     */
+    uint16_t bit_skip;
+
+    /**
+     * The sample taken halfway between the last bit and the next
+     */
+    int16_t mid_sample;
+
+    /**
+     * Estimated level of the samples taken for each bit, for scaling them for the clock recovery
+     */
+    int32_t bit_level;
+
+    /**
+     * Bit clock recovery, once synchronized
+     */
+    struct mueller_muller mm;
+
     /**
      * The current baud rate, if any
      */
@@ -250,6 +309,12 @@ struct pager_pocsag {
      */
     struct pager_pocsag_sync_search sync;
 
+    /**
+     * The most recent POCSAG_PAGER_EYE_HISTORY sliced samples seen while searching for the baud
+     * rate, oldest first, 1 for a negative sample. Shared by all the baud rate detectors.
+     */
+    uint64_t eye_history[POCSAG_PAGER_EYE_HISTORY/64];
+
     /**
      * State for decoding 512bps POCSAG
      */
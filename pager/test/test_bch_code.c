@@ -0,0 +1,137 @@
+#include <pager/bch_code.h>
+
+#include <test/assert.h>
+#include <test/framework.h>
+
+#include <tsl/assert.h>
+
+#include <stdlib.h>
+#include <stdbool.h>
+
+#define TEST_NR_RANDOM_WORDS            (1 << 20)
+#define TEST_BATCH_WORDS                88
+
+static
+struct bch_code *bch = NULL;
+
+static
+aresult_t test_bch_code_setup(void)
+{
+    static const int poly[6] = { 1, 0, 1, 0, 0, 1 };
+
+    return bch_code_new(&bch, poly, 5, 31, 21, 2);
+}
+
+static
+aresult_t test_bch_code_cleanup(void)
+{
+    bch_code_delete(&bch);
+
+    return A_OK;
+}
+
+/**
+ * Build a codeword from 21 information bits, in the bit order the pager decoders use.
+ */
+static
+uint32_t _test_bch_code_encode(uint32_t info)
+{
+    int data[21],
+        bb[10];
+    uint32_t word = info & 0x1ffffful;
+
+    for (int i = 0; i < 21; i++) {
+        data[i] = (word >> (20 - i)) & 1;
+    }
+
+    bch_code_encode(bch, data);
+    bch_code_get_redundancy(bch, bb);
+
+    for (int i = 0; i < 10; i++) {
+        word |= (uint32_t)(!!bb[i]) << (30 - i);
+    }
+
+    return word;
+}
+
+static
+uint32_t _test_bch_code_random(void)
+{
+    return ((uint32_t)random() << 16) ^ (uint32_t)random();
+}
+
+TEST_DECLARE_UNIT(test_correct_errors, bch_code)
+{
+    for (size_t n = 0; n < 64; n++) {
+        uint32_t word = _test_bch_code_encode(_test_bch_code_random()),
+                 received = word;
+
+        /* A good codeword passes through untouched, with the top bit left alone */
+        received = word | (1ul << 31);
+        TEST_ASSERT_EQUALS(bch_code_decode(bch, &received), 0);
+        TEST_ASSERT_EQUALS(received, word | (1ul << 31));
+
+        /* Every one and two bit error gets corrected */
+        for (int i = 0; i < 31; i++) {
+            for (int j = i; j < 31; j++) {
+                received = word ^ (1ul << i) ^ (1ul << j);
+                TEST_ASSERT_EQUALS(bch_code_decode(bch, &received), 0);
+                TEST_ASSERT_EQUALS(received, word);
+            }
+        }
+    }
+
+    return A_OK;
+}
+
+TEST_DECLARE_UNIT(test_matches_reference, bch_code)
+{
+    for (size_t n = 0; n < TEST_NR_RANDOM_WORDS; n++) {
+        uint32_t word = _test_bch_code_random(),
+                 fast = word,
+                 ref = word;
+        int fast_ret = bch_code_decode(bch, &fast),
+            ref_ret = bch_code_decode_reference(bch, &ref);
+
+        TEST_ASSERT_EQUALS(fast_ret, ref_ret);
+        TEST_ASSERT_EQUALS(fast, ref);
+    }
+
+    return A_OK;
+}
+
+TEST_DECLARE_UNIT(test_decode_words, bch_code)
+{
+    uint32_t words[TEST_BATCH_WORDS],
+             expect[TEST_BATCH_WORDS];
+    bool failed[TEST_BATCH_WORDS];
+    size_t nr_failed = 0;
+
+    for (size_t i = 0; i < TEST_BATCH_WORDS; i++) {
+        uint32_t word = _test_bch_code_encode(_test_bch_code_random());
+
+        /* Some clean words, some correctable, the rest with more errors than we can fix */
+        for (size_t e = 0; e < i % 5; e++) {
+            word ^= 1ul << (random() % 31);
+        }
+
+        words[i] = word;
+        expect[i] = word;
+        if (0 != bch_code_decode_reference(bch, &expect[i])) {
+            nr_failed++;
+        }
+    }
+
+    TEST_ASSERT_NOT_EQUALS(nr_failed, 0);
+    TEST_ASSERT_EQUALS(bch_code_decode_words(bch, words, TEST_BATCH_WORDS, failed), nr_failed);
+
+    for (size_t i = 0; i < TEST_BATCH_WORDS; i++) {
+        uint32_t ref = expect[i];
+        TEST_ASSERT_EQUALS(words[i], ref);
+        TEST_ASSERT_EQUALS(failed[i], 0 != bch_code_decode_reference(bch, &ref));
+    }
+
+    return A_OK;
+}
+
+TEST_DECLARE_SUITE(bch_code, test_bch_code_cleanup, test_bch_code_setup, NULL, NULL);
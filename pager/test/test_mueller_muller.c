@@ -9,6 +9,9 @@
 
 #include <stdlib.h>
 #include <stdio.h>
+#include <stdbool.h>
+#include <math.h>
+#include <time.h>
 
 static
 const int16_t *samples = NULL;
@@ -163,5 +166,184 @@ TEST_DECLARE_UNIT(test_smoke, mueller_muller)
     return A_OK;
 }
 
+#define TEST_SYNTH_NR_BITS          4096
+#define TEST_SYNTH_SAMPLES_PER_BIT  3.3f
+#define TEST_SYNTH_MAX_SAMPLES      (TEST_SYNTH_NR_BITS * 4)
+#define TEST_SYNTH_CLOCK_OFFSET     1.0002
+#define TEST_SYNTH_LEVEL            8000.0
+#define TEST_SYNTH_ROLLOFF          0.5
+#define TEST_SYNTH_SPAN             6
+#define TEST_SYNTH_LOCK_BITS        256
+#define TEST_SYNTH_MAX_SLIP         4
+
+/**
+ * Raised cosine pulse, t in bits. Zero at every other bit's decision point, so a clock that's
+ * on time sees the bit and nothing else.
+ */
+static
+double _test_mueller_muller_pulse(double t)
+{
+    double sinc = 0.0 == t ? 1.0 : sin(M_PI * t) / (M_PI * t),
+           den = 1.0 - 4.0 * TEST_SYNTH_ROLLOFF * TEST_SYNTH_ROLLOFF * t * t;
+
+    if (fabs(den) < 1e-9) {
+        return M_PI / 4.0 * sinc;
+    }
+
+    return sinc * cos(M_PI * TEST_SYNTH_ROLLOFF * t) / den;
+}
+
+/**
+ * Synthesize a pulse shaped bit stream, sampled with a transmitter clock that's a little off from
+ * the nominal rate.
+ */
+static
+size_t _test_mueller_muller_synthesize(int16_t *out, size_t nr_out, const uint8_t *bits, size_t nr_bits)
+{
+    double spb = TEST_SYNTH_SAMPLES_PER_BIT * TEST_SYNTH_CLOCK_OFFSET;
+    size_t nr = 0;
+
+    for (nr = 0; nr < nr_out; nr++) {
+        double t = (double)nr / spb,
+               v = 0.0;
+        long center = lrint(t);
+
+        if (center >= (long)nr_bits) {
+            break;
+        }
+
+        for (long k = center - TEST_SYNTH_SPAN; k <= center + TEST_SYNTH_SPAN; k++) {
+            if (0 > k || (long)nr_bits <= k) {
+                continue;
+            }
+            v += (bits[k] ? TEST_SYNTH_LEVEL : -TEST_SYNTH_LEVEL) * _test_mueller_muller_pulse(t - (double)k);
+        }
+
+        out[nr] = lrint(v);
+    }
+
+    return nr;
+}
+
+static
+void _test_mueller_muller_init_synth(struct mueller_muller *mm)
+{
+    /* Gains for an error of the order of the signal level */
+    float km = 0.15f / TEST_SYNTH_LEVEL,
+          kw = 0.25f * 0.15f * 0.15f / TEST_SYNTH_LEVEL;
+
+    TSL_BUG_IF_FAILED(mm_init(mm, kw, km, TEST_SYNTH_SAMPLES_PER_BIT,
+                TEST_SYNTH_SAMPLES_PER_BIT * 0.99f, TEST_SYNTH_SAMPLES_PER_BIT * 1.01f));
+}
+
+TEST_DECLARE_UNIT(test_interpolated_decisions, mueller_muller)
+{
+    static uint8_t bits[TEST_SYNTH_NR_BITS];
+    static int16_t synth[TEST_SYNTH_MAX_SAMPLES],
+                   decisions[TEST_SYNTH_NR_BITS + 64];
+    struct mueller_muller mm;
+    size_t nr_synth = 0,
+           nr_decisions = 0,
+           best_errors = SIZE_MAX;
+
+    srandom(4);
+
+    for (size_t i = 0; i < TEST_SYNTH_NR_BITS; i++) {
+        bits[i] = random() & 1;
+    }
+
+    nr_synth = _test_mueller_muller_synthesize(synth, sizeof(synth)/sizeof(synth[0]), bits, TEST_SYNTH_NR_BITS);
+
+    _test_mueller_muller_init_synth(&mm);
+
+    /* Odd block sizes, so decisions land across block boundaries in every possible way */
+    for (size_t off = 0, block = 1; off < nr_synth; off += block, block = block % 67 + 1) {
+        size_t nr_block = block > nr_synth - off ? nr_synth - off : block,
+               nr_out = 0;
+
+        TEST_ASSERT_OK(mm_process(&mm, synth + off, nr_block, decisions + nr_decisions,
+                    sizeof(decisions)/sizeof(decisions[0]) - nr_decisions, &nr_out));
+        nr_decisions += nr_out;
+    }
+
+    TEST_INF("Made %zu decisions for %d bits, %zu samples", nr_decisions, TEST_SYNTH_NR_BITS, nr_synth);
+
+    TEST_ASSERT_EQUALS(nr_decisions > TEST_SYNTH_NR_BITS - 2 * TEST_SYNTH_SPAN, true);
+
+    /*
+     * Once locked, every decision should be right. The loop may have started a bit or two ahead
+     * or behind, so try the alignments either side.
+     */
+    for (long slip = -TEST_SYNTH_MAX_SLIP; slip <= TEST_SYNTH_MAX_SLIP; slip++) {
+        size_t nr_errors = 0;
+
+        for (size_t i = TEST_SYNTH_LOCK_BITS; i < nr_decisions - TEST_SYNTH_MAX_SLIP - TEST_SYNTH_SPAN; i++) {
+            if ((decisions[i] > 0) != bits[(long)i + slip]) {
+                nr_errors++;
+            }
+        }
+
+        if (nr_errors < best_errors) {
+            best_errors = nr_errors;
+        }
+    }
+
+    TEST_ASSERT_EQUALS(best_errors, 0);
+
+    return A_OK;
+}
+
+#define TEST_THROUGHPUT_NR_SAMPLES  (1ul << 22)
+#define TEST_THROUGHPUT_BLOCK       4096
+
+TEST_DECLARE_UNIT(test_throughput, mueller_muller)
+{
+    static uint8_t bits[TEST_SYNTH_NR_BITS];
+    static int16_t synth[TEST_SYNTH_MAX_SAMPLES],
+                   decisions[TEST_THROUGHPUT_BLOCK];
+    struct mueller_muller mm;
+    struct timespec start,
+                    end;
+    size_t nr_synth = 0,
+           nr_blocks = 0,
+           total_decisions = 0;
+    double elapsed = 0.0;
+
+    srandom(5);
+
+    for (size_t i = 0; i < TEST_SYNTH_NR_BITS; i++) {
+        bits[i] = random() & 1;
+    }
+
+    nr_synth = _test_mueller_muller_synthesize(synth, sizeof(synth)/sizeof(synth[0]), bits, TEST_SYNTH_NR_BITS);
+    nr_blocks = nr_synth / TEST_THROUGHPUT_BLOCK;
+
+    TEST_ASSERT_NOT_EQUALS(nr_blocks, 0);
+
+    _test_mueller_muller_init_synth(&mm);
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+
+    for (size_t i = 0; i < TEST_THROUGHPUT_NR_SAMPLES / TEST_THROUGHPUT_BLOCK; i++) {
+        size_t nr_out = 0;
+
+        TEST_ASSERT_OK(mm_process(&mm, synth + (i % nr_blocks) * TEST_THROUGHPUT_BLOCK, TEST_THROUGHPUT_BLOCK,
+                    decisions, TEST_THROUGHPUT_BLOCK, &nr_out));
+        total_decisions += nr_out;
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &end);
+
+    elapsed = (double)(end.tv_sec - start.tv_sec) + (double)(end.tv_nsec - start.tv_nsec) * 1e-9;
+
+    TEST_INF("%lu samples, %zu decisions in %f sec: %.1f Msamples/sec, %.1f Mdecisions/sec",
+            TEST_THROUGHPUT_NR_SAMPLES, total_decisions, elapsed,
+            (double)TEST_THROUGHPUT_NR_SAMPLES / elapsed * 1e-6, (double)total_decisions / elapsed * 1e-6);
+
+    TEST_ASSERT_NOT_EQUALS(total_decisions, 0);
+
+    return A_OK;
+}
+
 TEST_DECLARE_SUITE(mueller_muller, test_mueller_muller_cleanup, test_mueller_muller_setup, NULL, NULL);
 
@@ -1,8 +1,49 @@
 #include <pager/pager.h>
+#include <pager/pager_flex_priv.h>
+
+#include <synth/flex_enc.h>
+#include <synth/channel.h>
 
 #include <test/assert.h>
 #include <test/framework.h>
 
+#include <tsl/safe_alloc.h>
+
+#include <stdlib.h>
+#include <string.h>
+
+/**
+ * Number of samples of random bits the BS1 search is fed, spanning several of its chunks
+ */
+#define TEST_FLEX_SEARCH_SAMPLES        5000
+
+#define TEST_FLEX_MAX_PAGES             8
+
+struct test_flex_page {
+    uint16_t baud;
+    uint8_t phase;
+    uint8_t cycle_no;
+    uint8_t frame_no;
+    uint64_t cap_code;
+    char msg[64];
+};
+
+static
+struct test_flex_page rx_pages[TEST_FLEX_MAX_PAGES];
+
+static
+size_t nr_rx_pages = 0;
+
+static
+const struct synth_flex_msg test_msgs[] = {
+    { .capcode = 1234567, .type = SYNTH_FLEX_MSG_TYPE_ALPHA, .msg = "FLEX alpha page, phase one" },
+    { .capcode = 2000, .type = SYNTH_FLEX_MSG_TYPE_NUMERIC, .msg = "5551234" },
+    { .capcode = 777777, .type = SYNTH_FLEX_MSG_TYPE_ALPHA, .msg = "Third" },
+    { .capcode = 31337, .type = SYNTH_FLEX_MSG_TYPE_ALPHA, .msg = "Fourth page" },
+};
+
+#define TEST_FLEX_NR_MSGS               (sizeof(test_msgs)/sizeof(test_msgs[0]))
+
 static
 aresult_t test_pager_flex_setup(void)
 {
@@ -15,6 +56,26 @@ aresult_t test_pager_flex_cleanup(void)
     return A_OK;
 }
 
+static
+void _test_flex_record(uint16_t baud, uint8_t phase, uint8_t cycle_no, uint8_t frame_no, uint64_t cap_code,
+        const char *message_bytes, size_t message_len)
+{
+    struct test_flex_page *page = NULL;
+
+    if (TEST_FLEX_MAX_PAGES == nr_rx_pages) {
+        return;
+    }
+
+    page = &rx_pages[nr_rx_pages++];
+    memset(page, 0, sizeof(*page));
+    page->baud = baud;
+    page->phase = phase;
+    page->cycle_no = cycle_no;
+    page->frame_no = frame_no;
+    page->cap_code = cap_code;
+    memcpy(page->msg, message_bytes, message_len < sizeof(page->msg) - 1 ? message_len : sizeof(page->msg) - 1);
+}
+
 static
 aresult_t _test_flex_on_message_simple_cb(
         struct pager_flex *flex,
@@ -29,6 +90,7 @@ aresult_t _test_flex_on_message_simple_cb(
         const char *message_bytes,
         size_t message_len)
 {
+    _test_flex_record(baud, phase, cycle_no, frame_no, cap_code, message_bytes, message_len);
     return A_OK;
 }
 
@@ -43,6 +105,7 @@ aresult_t _test_flex_on_num_message_simple_cb(
         const char *message_bytes,
         size_t message_len)
 {
+    _test_flex_record(baud, phase, cycle_no, frame_no, cap_code, message_bytes, message_len);
     return A_OK;
 }
 
@@ -56,5 +119,320 @@ TEST_DECLARE_UNIT(test_smoke, flex)
     return A_OK;
 }
 
+/**
+ * Render a FLEX frame carrying the test pages through a channel, with silence either side,
+ * optionally flipping some of the bits of BS1.
+ */
+static
+aresult_t _test_flex_render_frame(enum synth_flex_speed speed, uint32_t rate, const unsigned *bs1_flips,
+        size_t nr_flips, int16_t **ppcm, size_t *pnr_samples)
+{
+    struct synth_flex_enc *enc = NULL;
+    struct synth_channel chan;
+    int8_t *levels = NULL,
+           *padded = NULL;
+    size_t nr_levels = 0,
+           nr_out = 0;
+
+    TEST_ASSERT_OK(synth_flex_enc_new(&enc));
+    TEST_ASSERT_OK(synth_flex_enc_frame(enc, speed, 3, 42, test_msgs, TEST_FLEX_NR_MSGS, &levels, &nr_levels));
+    TEST_ASSERT_OK(synth_flex_enc_delete(&enc));
+
+    /* BS1 leads the frame, each bit sent as two levels */
+    for (size_t i = 0; i < nr_flips; i++) {
+        levels[2 * bs1_flips[i]] = -levels[2 * bs1_flips[i]];
+        levels[2 * bs1_flips[i] + 1] = -levels[2 * bs1_flips[i] + 1];
+    }
+
+    TEST_ASSERT_OK(TACALLOC((void **)&padded, nr_levels + 64, sizeof(int8_t), 0));
+    memcpy(&padded[32], levels, nr_levels);
+
+    TEST_ASSERT_OK(synth_channel_init(&chan, rate, SYNTH_FLEX_SYMBOL_RATE, SYNTH_FLEX_LEVEL_DEVIATION_HZ, 11));
+    chan.add_noise = true;
+    chan.snr_db = 25.0;
+    nr_out = synth_channel_nr_samples(&chan, nr_levels + 64);
+    TEST_ASSERT_OK(TACALLOC((void **)ppcm, nr_out, sizeof(int16_t), 0));
+    TEST_ASSERT_OK(synth_channel_render_pcm(&chan, padded, nr_levels + 64, *ppcm, nr_out, pnr_samples));
+
+    TFREE(padded);
+    TFREE(levels);
+
+    return A_OK;
+}
+
+static
+aresult_t _test_flex_decode(const int16_t *pcm, size_t nr_samples, unsigned sync_errors, size_t *pnr_pages)
+{
+    struct pager_flex *flex = NULL;
+
+    TEST_ASSERT_OK(pager_flex_new(&flex, 0, _test_flex_on_message_simple_cb, _test_flex_on_num_message_simple_cb, NULL));
+    TEST_ASSERT_OK(pager_flex_set_sync_errors(flex, sync_errors));
+
+    nr_rx_pages = 0;
+    TEST_ASSERT_OK(pager_flex_on_pcm(flex, pcm, nr_samples));
+    *pnr_pages = nr_rx_pages;
+
+    TEST_ASSERT_OK(pager_flex_delete(&flex));
+
+    return A_OK;
+}
+
+TEST_DECLARE_UNIT(test_bs1_errors, flex)
+{
+    static const unsigned flips[] = { 1, 9, 20 };
+    int16_t *pcm = NULL;
+    size_t nr_samples = 0,
+           nr_pages = 0;
+
+    TEST_ASSERT_OK(_test_flex_render_frame(SYNTH_FLEX_SPEED_1600_2FSK, 16000, NULL, 0, &pcm, &nr_samples));
+    TEST_ASSERT_OK(_test_flex_decode(pcm, nr_samples, 0, &nr_pages));
+    TEST_ASSERT_EQUALS(nr_pages, TEST_FLEX_NR_MSGS);
+    TFREE(pcm);
+
+    TEST_ASSERT_OK(_test_flex_render_frame(SYNTH_FLEX_SPEED_1600_2FSK, 16000, flips, 3, &pcm, &nr_samples));
+
+    /* An exact match is needed by default, so the frame is missed */
+    TEST_ASSERT_OK(_test_flex_decode(pcm, nr_samples, 0, &nr_pages));
+    TEST_ASSERT_EQUALS(nr_pages, 0);
+    TEST_ASSERT_OK(_test_flex_decode(pcm, nr_samples, 2, &nr_pages));
+    TEST_ASSERT_EQUALS(nr_pages, 0);
+
+    for (unsigned e = 3; e <= PAGER_FLEX_SYNC_BS1_MAX_ERRORS; e++) {
+        TEST_ASSERT_OK(_test_flex_decode(pcm, nr_samples, e, &nr_pages));
+        TEST_ASSERT_EQUALS(nr_pages, TEST_FLEX_NR_MSGS);
+    }
+
+    TFREE(pcm);
+
+    return A_OK;
+}
+
+/**
+ * The per-sample BS1 search, as _pager_flex_sync_update does it: shift each sliced sample into the
+ * register for its sample phase, and check that register against BS1.
+ *
+ * \return The index of the first sample where BS1 matches, or nr_samples if it never does
+ */
+static
+size_t _test_flex_search_bs1_ref(const int16_t *samples, size_t nr_samples, unsigned phases, unsigned max_errors,
+        uint32_t *sync_words, uint8_t *pcounter)
+{
+    uint8_t counter = 0;
+
+    memset(sync_words, 0, sizeof(uint32_t) * PAGER_FLEX_SYNC_MAX_SAMPLE_PHASES);
+
+    for (size_t i = 0; i < nr_samples; i++) {
+        counter = (counter + 1) % phases;
+        sync_words[counter] = (sync_words[counter] << 1) | (samples[i] >= 0);
+
+        if (__builtin_popcount(sync_words[counter] ^ PAGER_FLEX_SYNC_BS1) <= max_errors) {
+            *pcounter = counter;
+            return i;
+        }
+    }
+
+    *pcounter = counter;
+    return nr_samples;
+}
+
+TEST_DECLARE_UNIT(test_bs1_search_offset, flex)
+{
+    static const uint32_t rates[] = { 16000, 12800 };
+    static const unsigned sync_errors[] = { 0, 2, 5 };
+    static const size_t chunks[] = { 1, 37, 1024, 1500, TEST_FLEX_SEARCH_SAMPLES };
+    static int16_t samples[TEST_FLEX_SEARCH_SAMPLES];
+
+    srandom(6);
+
+    for (size_t n = 0; n < 24; n++) {
+        uint32_t rate = rates[n % 2],
+                 ref_words[PAGER_FLEX_SYNC_MAX_SAMPLE_PHASES];
+        unsigned phases = rate / PAGER_FLEX_SYNC_BAUD_RATE,
+                 max_errors = sync_errors[n % 3];
+        size_t start = 100 + random() % (TEST_FLEX_SEARCH_SAMPLES - 32 * phases - 200),
+               match = 0;
+        uint32_t bs1 = PAGER_FLEX_SYNC_BS1;
+        uint8_t ref_counter = 0;
+
+        /* Random bits, held for a bit period, then BS1 with as many errors as are allowed */
+        for (size_t i = 0; i < TEST_FLEX_SEARCH_SAMPLES; i += phases) {
+            bool bit = random() & 1;
+
+            if (i >= start && i < start + 32 * phases) {
+                bit = (bs1 >> (31 - (i - start) / phases)) & 1;
+            }
+
+            for (size_t j = i; j < i + phases && j < TEST_FLEX_SEARCH_SAMPLES; j++) {
+                /* Noise around the threshold, including samples right on it */
+                samples[j] = bit ? random() % 2000 : -1 - (int16_t)(random() % 2000);
+            }
+        }
+
+        for (unsigned e = 0; e < max_errors; e++) {
+            size_t bit = random() % 32;
+
+            for (size_t j = start + bit * phases; j < start + (bit + 1) * phases; j++) {
+                samples[j] = -1 - samples[j];
+            }
+        }
+
+        match = _test_flex_search_bs1_ref(samples, TEST_FLEX_SEARCH_SAMPLES, phases, max_errors, ref_words,
+                &ref_counter);
+        TEST_ASSERT_NOT_EQUALS(match, TEST_FLEX_SEARCH_SAMPLES);
+
+        /* The reference's state just before the match */
+        TEST_ASSERT_EQUALS(_test_flex_search_bs1_ref(samples, match, phases, max_errors, ref_words, &ref_counter),
+                match);
+
+        for (size_t c = 0; c < sizeof(chunks)/sizeof(chunks[0]); c++) {
+            struct pager_flex *flex = NULL;
+
+            TEST_ASSERT_OK(pager_flex_new(&flex, 0, _test_flex_on_message_simple_cb,
+                        _test_flex_on_num_message_simple_cb, NULL));
+            TEST_ASSERT_OK(pager_flex_set_sample_rate(flex, rate));
+            TEST_ASSERT_OK(pager_flex_set_sync_errors(flex, max_errors));
+
+            /* Everything up to the match, in chunks, leaves the search where the reference is */
+            for (size_t i = 0; i < match; i += chunks[c]) {
+                size_t nr = match - i < chunks[c] ? match - i : chunks[c];
+                TEST_ASSERT_OK(pager_flex_on_pcm(flex, &samples[i], nr));
+                TEST_ASSERT_EQUALS(flex->sync.state, PAGER_FLEX_SYNC_STATE_SEARCH_BS1);
+            }
+
+            TEST_ASSERT_EQUALS(flex->sync.sample_counter, ref_counter);
+            TEST_ASSERT_EQUALS(0, memcmp(flex->sync.sync_words, ref_words, sizeof(uint32_t) * phases));
+
+            /* And the sample the reference matched on finds BS1 */
+            TEST_ASSERT_OK(pager_flex_on_pcm(flex, &samples[match], 1));
+            TEST_ASSERT_NOT_EQUALS(flex->sync.state, PAGER_FLEX_SYNC_STATE_SEARCH_BS1);
+
+            TEST_ASSERT_OK(pager_flex_delete(&flex));
+        }
+    }
+
+    return A_OK;
+}
+
+TEST_DECLARE_UNIT(test_phase_deinterleave, flex)
+{
+    static const size_t nr_blocks = PAGER_FLEX_PHASE_WORDS / 8;
+    uint32_t codewords[PAGER_FLEX_PHASE_WORDS];
+
+    srandom(7);
+
+    for (size_t n = 0; n < 64; n++) {
+        struct pager_flex_phase block,
+                                ref;
+        /* Whole blocks, whole 64-bit groups of a block, and everything in between */
+        size_t nr_bits = 0 == n ? nr_blocks * 256 : random() % (nr_blocks * 256 + 1);
+
+        for (size_t i = 0; i < PAGER_FLEX_PHASE_WORDS; i++) {
+            codewords[i] = ((uint32_t)random() << 16) ^ (uint32_t)random();
+        }
+
+        memset(&block, 0, sizeof(block));
+        memset(&ref, 0, sizeof(ref));
+
+        /* Each block sends bit 0 of its 8 words, then bit 1, and so on */
+        for (size_t i = 0; i < nr_bits; i++) {
+            size_t word = (i / 256) * 8 + i % 8,
+                   bit = (i % 256) / 8;
+            bool value = !!(codewords[word] & (1ul << bit));
+
+            pager_flex_phase_append_bit(&block, value);
+            pager_flex_phase_shift_bit(&ref, value);
+        }
+
+        pager_flex_phase_flush(&block);
+
+        TEST_ASSERT_EQUALS(0, memcmp(block.phase_words, ref.phase_words, sizeof(ref.phase_words)));
+        TEST_ASSERT_EQUALS(block.cur_bit, ref.cur_bit);
+        TEST_ASSERT_EQUALS(block.cur_word, ref.cur_word);
+        TEST_ASSERT_EQUALS(block.base_word, ref.base_word);
+        TEST_ASSERT_EQUALS(block.nr_raw_bits, 0);
+
+        /* Every word of a block that was received in full comes out as it was sent */
+        for (size_t i = 0; i < nr_bits / 256 * 8; i++) {
+            TEST_ASSERT_EQUALS(block.phase_words[i], codewords[i]);
+        }
+    }
+
+    return A_OK;
+}
+
+/**
+ * Decode a frame, handing it to the decoder in chunks whose sizes cycle through the given list.
+ */
+static
+aresult_t _test_flex_decode_chunked(const int16_t *pcm, size_t nr_samples, uint32_t rate, const size_t *chunks,
+        size_t nr_chunks)
+{
+    struct pager_flex *flex = NULL;
+
+    TEST_ASSERT_OK(pager_flex_new(&flex, 0, _test_flex_on_message_simple_cb, _test_flex_on_num_message_simple_cb, NULL));
+    TEST_ASSERT_OK(pager_flex_set_sample_rate(flex, rate));
+
+    nr_rx_pages = 0;
+    for (size_t i = 0, c = 0; i < nr_samples; i += chunks[c], c = (c + 1) % nr_chunks) {
+        TEST_ASSERT_OK(pager_flex_on_pcm(flex, &pcm[i], nr_samples - i < chunks[c] ? nr_samples - i : chunks[c]));
+    }
+
+    TEST_ASSERT_OK(pager_flex_delete(&flex));
+
+    return A_OK;
+}
+
+TEST_DECLARE_UNIT(test_chunked_pcm, flex)
+{
+    static const uint32_t rates[] = { 16000, 12800 };
+    static const size_t one[] = { 1 },
+                        odd[] = { 3, 1, 97, 13, 255, 7, 1023, 5, 257 };
+    struct test_flex_page expect[TEST_FLEX_MAX_PAGES];
+
+    for (int n = 0; n < 2 * (SYNTH_FLEX_SPEED_6400_4FSK + 1); n++) {
+        int speed = n % (SYNTH_FLEX_SPEED_6400_4FSK + 1);
+        uint32_t rate = rates[n / (SYNTH_FLEX_SPEED_6400_4FSK + 1)];
+        int16_t *pcm = NULL;
+        size_t nr_samples = 0,
+               nr_expect = 0;
+
+        TEST_ASSERT_OK(_test_flex_render_frame(speed, rate, NULL, 0, &pcm, &nr_samples));
+
+        /* The whole frame in one go */
+        TEST_ASSERT_OK(_test_flex_decode_chunked(pcm, nr_samples, rate, &nr_samples, 1));
+        TEST_ASSERT_EQUALS(nr_rx_pages, TEST_FLEX_NR_MSGS);
+        memcpy(expect, rx_pages, sizeof(expect));
+        nr_expect = nr_rx_pages;
+
+        for (size_t i = 0; i < TEST_FLEX_NR_MSGS; i++) {
+            bool found = false;
+
+            for (size_t j = 0; j < nr_expect; j++) {
+                if (expect[j].cap_code == test_msgs[i].capcode &&
+                        0 == strncmp(expect[j].msg, test_msgs[i].msg, strlen(test_msgs[i].msg)))
+                {
+                    found = true;
+                }
+            }
+
+            TEST_ASSERT_EQUALS(found, true);
+        }
+
+        /* A sample at a time */
+        TEST_ASSERT_OK(_test_flex_decode_chunked(pcm, nr_samples, rate, one, 1));
+        TEST_ASSERT_EQUALS(nr_rx_pages, nr_expect);
+        TEST_ASSERT_EQUALS(0, memcmp(rx_pages, expect, sizeof(expect[0]) * nr_expect));
+
+        /* Odd sizes, so chunks end all over the symbols, blocks and sync words */
+        TEST_ASSERT_OK(_test_flex_decode_chunked(pcm, nr_samples, rate, odd, sizeof(odd)/sizeof(odd[0])));
+        TEST_ASSERT_EQUALS(nr_rx_pages, nr_expect);
+        TEST_ASSERT_EQUALS(0, memcmp(rx_pages, expect, sizeof(expect[0]) * nr_expect));
+
+        TFREE(pcm);
+    }
+
+    return A_OK;
+}
+
 TEST_DECLARE_SUITE(flex, test_pager_flex_cleanup, test_pager_flex_setup, NULL, NULL);
 
@@ -0,0 +1,137 @@
+#include <pager/pager_pocsag.h>
+#include <pager/pager_pocsag_priv.h>
+
+#include <test/assert.h>
+#include <test/framework.h>
+
+#include <stdlib.h>
+#include <string.h>
+
+/**
+ * Number of preamble bits sent ahead of the sync codeword
+ */
+#define TEST_POCSAG_PREAMBLE_BITS       64
+
+/**
+ * Longest signal generated: an offset of up to a bit and 64 samples, the preamble, the sync
+ * codeword and an idle codeword, at 512 baud and the base sample rate
+ */
+#define TEST_POCSAG_MAX_SAMPLES         ((TEST_POCSAG_PREAMBLE_BITS + 65) * POCSAG_PAGER_BAUD_512_SAMPLES + 64)
+
+#define TEST_POCSAG_LEVEL               8000
+
+static
+aresult_t test_pager_pocsag_sync_setup(void)
+{
+    return A_OK;
+}
+
+static
+aresult_t test_pager_pocsag_sync_cleanup(void)
+{
+    return A_OK;
+}
+
+static
+aresult_t _test_pocsag_on_msg(struct pager_pocsag *pocsag, uint16_t baud_rate, uint32_t capcode,
+        const char *data, size_t data_len, uint8_t function)
+{
+    return A_OK;
+}
+
+/**
+ * Generate the preamble, the sync codeword with the given bits flipped, then an idle codeword,
+ * after offset samples of silence. A 1 is sent as a negative sample.
+ *
+ * \return The number of samples generated
+ */
+static
+size_t _test_pocsag_make_sync(int16_t *samples, uint32_t sample_rate, uint16_t baud, size_t offset,
+        uint32_t flips)
+{
+    uint32_t sync = POCSAG_SYNC_CODEWORD ^ flips;
+    size_t nr_bits = TEST_POCSAG_PREAMBLE_BITS + 64,
+           nr_samples = offset + nr_bits * sample_rate / baud;
+
+    memset(samples, 0, sizeof(int16_t) * offset);
+
+    for (size_t i = 0; i < nr_bits; i++) {
+        size_t start = offset + i * sample_rate / baud,
+               end = offset + (i + 1) * sample_rate / baud;
+        bool bit = false;
+
+        if (i < TEST_POCSAG_PREAMBLE_BITS) {
+            bit = !(i & 1);
+        } else if (i < TEST_POCSAG_PREAMBLE_BITS + 32) {
+            bit = (sync >> (31 - (i - TEST_POCSAG_PREAMBLE_BITS))) & 1;
+        } else {
+            bit = (POCSAG_IDLE_CODEWORD >> (31 - (i - TEST_POCSAG_PREAMBLE_BITS - 32))) & 1;
+        }
+
+        for (size_t j = start; j < end; j++) {
+            /* A little noise, that never crosses the threshold */
+            samples[j] = (bit ? -TEST_POCSAG_LEVEL : TEST_POCSAG_LEVEL) + (int16_t)(random() % 2001) - 1000;
+        }
+    }
+
+    return nr_samples;
+}
+
+/**
+ * Pick nr_errors distinct bits of the codeword to flip.
+ */
+static
+uint32_t _test_pocsag_random_flips(unsigned nr_errors)
+{
+    uint32_t flips = 0;
+
+    while ((unsigned)__builtin_popcount(flips) < nr_errors) {
+        flips |= 1ul << (random() % 32);
+    }
+
+    return flips;
+}
+
+TEST_DECLARE_UNIT(test_sync_search, pocsag_sync)
+{
+    static const uint16_t bauds[] = { 512, 1200, 2400 };
+    /* The base rate, and the lowest */
+    static const uint32_t rates[] = { POCSAG_PAGER_BASE_BAUD_RATE, POCSAG_PAGER_MIN_SAMPLE_RATE };
+    static int16_t samples[TEST_POCSAG_MAX_SAMPLES];
+
+    srandom(8);
+
+    for (size_t r = 0; r < sizeof(rates)/sizeof(rates[0]); r++) {
+        for (size_t b = 0; b < sizeof(bauds)/sizeof(bauds[0]); b++) {
+            size_t samples_per_bit = rates[r] / bauds[b];
+
+            /* Start the signal at several points within a bit, so each lane of the search sees the eye */
+            for (size_t n = 0; n < 8; n++) {
+                size_t offset = n * samples_per_bit / 8 + random() % 64;
+
+                for (unsigned nr_errors = 0; nr_errors <= POCSAG_SYNC_MAX_ERRORS + 1; nr_errors++) {
+                    struct pager_pocsag *pocsag = NULL;
+                    size_t nr_samples = _test_pocsag_make_sync(samples, rates[r], bauds[b], offset,
+                            _test_pocsag_random_flips(nr_errors));
+
+                    TEST_ASSERT_OK(pager_pocsag_new(&pocsag, 0, _test_pocsag_on_msg, _test_pocsag_on_msg));
+                    TEST_ASSERT_OK(pager_pocsag_set_sample_rate(pocsag, rates[r]));
+                    TEST_ASSERT_OK(pager_pocsag_on_pcm(pocsag, samples, nr_samples));
+
+                    if (nr_errors <= POCSAG_SYNC_MAX_ERRORS) {
+                        TEST_ASSERT_NOT_EQUALS(pocsag->cur_state, PAGER_POCSAG_STATE_SEARCH);
+                        TEST_ASSERT_EQUALS(pocsag->baud_rate, bauds[b]);
+                    } else {
+                        TEST_ASSERT_EQUALS(pocsag->cur_state, PAGER_POCSAG_STATE_SEARCH);
+                    }
+
+                    TEST_ASSERT_OK(pager_pocsag_delete(&pocsag));
+                }
+            }
+        }
+    }
+
+    return A_OK;
+}
+
+TEST_DECLARE_SUITE(pocsag_sync, test_pager_pocsag_sync_cleanup, test_pager_pocsag_sync_setup, NULL, NULL);
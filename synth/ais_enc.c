@@ -0,0 +1,217 @@
+/*
+ *  ais_enc.c - AIS packet encoder for signal synthesis
+ *
+ *  Copyright (c)2017 Phil Vachon <phil@security-embedded.com>
+ *
+ *  This file is a part of The Standard Library (TSL)
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ */
+
+#include <synth/ais_enc.h>
+
+#include <ais/ais_decode.h>
+
+#include <tsl/safe_alloc.h>
+#include <tsl/errors.h>
+#include <tsl/assert.h>
+
+#include <math.h>
+#include <string.h>
+
+#define SYNTH_AIS_RAMP_BITS             8
+#define SYNTH_AIS_TRAINING_BITS         24
+#define SYNTH_AIS_FLAG                  0x7e
+#define SYNTH_AIS_FLAG_BITS             8
+#define SYNTH_AIS_BUFFER_BITS           8
+
+static
+uint16_t _synth_ais_crc16(const uint8_t *data, size_t len)
+{
+    uint16_t crc = 0xffffu;
+    const uint16_t poly = 0x8408u;
+
+    for (size_t i = 0; i < len; i++) {
+        crc ^= (uint16_t)data[i];
+        for (size_t j = 0; j < 8; j++) {
+            if (crc & 1) {
+                crc = (crc >> 1) ^ poly;
+            } else {
+                crc >>= 1;
+            }
+        }
+    }
+
+    return ~crc;
+}
+
+aresult_t synth_ais_set_bitfield(uint8_t *packet, size_t packet_len, size_t offset, size_t len, uint32_t value)
+{
+    TSL_ASSERT_ARG(NULL != packet);
+    TSL_ASSERT_ARG(0 < len && len <= 32);
+    TSL_ASSERT_ARG(offset + len <= packet_len * 8);
+
+    for (size_t i = 0; i < len; i++) {
+        size_t bit = offset + i;
+        uint8_t mask = 0x80 >> (bit % 8);
+
+        if ((value >> (len - 1 - i)) & 1) {
+            packet[bit / 8] |= mask;
+        } else {
+            packet[bit / 8] &= ~mask;
+        }
+    }
+
+    return A_OK;
+}
+
+aresult_t synth_ais_position_report_pack(unsigned msg_id, const struct ais_position_report *rpt,
+        uint8_t *packet, size_t packet_len)
+{
+    aresult_t ret = A_OK;
+
+    TSL_ASSERT_ARG(1 <= msg_id && msg_id <= 3);
+    TSL_ASSERT_ARG(NULL != rpt);
+    TSL_ASSERT_ARG(NULL != packet);
+    TSL_ASSERT_ARG(SYNTH_AIS_POSITION_REPORT_BYTES <= packet_len);
+
+    memset(packet, 0, SYNTH_AIS_POSITION_REPORT_BYTES);
+
+    synth_ais_set_bitfield(packet, packet_len, 0, 6, msg_id);
+    synth_ais_set_bitfield(packet, packet_len, 6, 2, 0);
+    synth_ais_set_bitfield(packet, packet_len, 8, 30, rpt->mmsi);
+    synth_ais_set_bitfield(packet, packet_len, 38, 4, rpt->nav_stat);
+    synth_ais_set_bitfield(packet, packet_len, 42, 8, (uint32_t)rpt->rate_of_turn);
+    synth_ais_set_bitfield(packet, packet_len, 50, 10, (uint32_t)lrintf(rpt->speed_over_ground * 10.0f));
+    synth_ais_set_bitfield(packet, packet_len, 60, 1, rpt->position_acc);
+    synth_ais_set_bitfield(packet, packet_len, 61, 28, (uint32_t)lrint((double)rpt->longitude * 600000.0));
+    synth_ais_set_bitfield(packet, packet_len, 89, 27, (uint32_t)lrint((double)rpt->latitude * 600000.0));
+    synth_ais_set_bitfield(packet, packet_len, 116, 12, rpt->course);
+    synth_ais_set_bitfield(packet, packet_len, 128, 9, rpt->heading);
+    synth_ais_set_bitfield(packet, packet_len, 137, 6, rpt->timestamp);
+
+    return ret;
+}
+
+/**
+ * Append a bit, before NRZI encoding, to the output.
+ */
+static inline
+void _synth_ais_emit_bit(int8_t *levels, size_t *pnr_levels, int8_t *plevel, unsigned bit)
+{
+    /* NRZI: a 0 is sent as a transition, a 1 as no transition */
+    if (0 == bit) {
+        *plevel = -*plevel;
+    }
+
+    levels[(*pnr_levels)++] = *plevel;
+}
+
+aresult_t synth_ais_enc_frame(const uint8_t *packet, size_t packet_len, int8_t **plevels, size_t *pnr_levels)
+{
+    aresult_t ret = A_OK;
+
+    uint8_t *body = NULL;
+    int8_t *levels = NULL,
+           level = 1;
+    size_t body_len = 0,
+           max_levels = 0,
+           nr_levels = 0;
+    unsigned nr_ones = 0;
+    uint16_t crc = 0;
+
+    TSL_ASSERT_ARG(NULL != packet);
+    TSL_ASSERT_ARG(0 != packet_len);
+    TSL_ASSERT_ARG(NULL != plevels);
+    TSL_ASSERT_ARG(NULL != pnr_levels);
+
+    *plevels = NULL;
+    *pnr_levels = 0;
+
+    body_len = packet_len + 2;
+
+    if (FAILED(ret = TACALLOC((void **)&body, body_len, sizeof(uint8_t), SYS_CACHE_LINE_LENGTH))) {
+        goto done;
+    }
+
+    /* The FCS is appended least significant byte first */
+    memcpy(body, packet, packet_len);
+    crc = _synth_ais_crc16(packet, packet_len);
+    body[packet_len] = crc & 0xff;
+    body[packet_len + 1] = crc >> 8;
+
+    /* Worst case, every fifth bit of the body needs a stuffed bit following it */
+    max_levels = SYNTH_AIS_RAMP_BITS + SYNTH_AIS_TRAINING_BITS + 2 * SYNTH_AIS_FLAG_BITS +
+        SYNTH_AIS_BUFFER_BITS + body_len * 8 + (body_len * 8) / 5;
+
+    if (FAILED(ret = TACALLOC((void **)&levels, max_levels, sizeof(int8_t), SYS_CACHE_LINE_LENGTH))) {
+        goto done;
+    }
+
+    /* Ramp up: an unmodulated carrier */
+    for (size_t i = 0; i < SYNTH_AIS_RAMP_BITS; i++) {
+        _synth_ais_emit_bit(levels, &nr_levels, &level, 1);
+    }
+
+    /* Training sequence, alternating, starting with 0 */
+    for (size_t i = 0; i < SYNTH_AIS_TRAINING_BITS; i++) {
+        _synth_ais_emit_bit(levels, &nr_levels, &level, i & 1);
+    }
+
+    for (size_t i = 0; i < SYNTH_AIS_FLAG_BITS; i++) {
+        _synth_ais_emit_bit(levels, &nr_levels, &level, (SYNTH_AIS_FLAG >> (7 - i)) & 1);
+    }
+
+    /* Each byte is sent least significant bit first, with a 0 stuffed after five 1s */
+    for (size_t i = 0; i < body_len * 8; i++) {
+        unsigned bit = (body[i / 8] >> (i % 8)) & 1;
+
+        _synth_ais_emit_bit(levels, &nr_levels, &level, bit);
+
+        if (0 == bit) {
+            nr_ones = 0;
+        } else if (5 == ++nr_ones) {
+            _synth_ais_emit_bit(levels, &nr_levels, &level, 0);
+            nr_ones = 0;
+        }
+    }
+
+    for (size_t i = 0; i < SYNTH_AIS_FLAG_BITS; i++) {
+        _synth_ais_emit_bit(levels, &nr_levels, &level, (SYNTH_AIS_FLAG >> (7 - i)) & 1);
+    }
+
+    /* Buffer bits, to let the receiver clock out the end flag */
+    for (size_t i = 0; i < SYNTH_AIS_BUFFER_BITS; i++) {
+        _synth_ais_emit_bit(levels, &nr_levels, &level, 1);
+    }
+
+    TSL_BUG_ON(nr_levels > max_levels);
+
+    *plevels = levels;
+    *pnr_levels = nr_levels;
+    levels = NULL;
+
+done:
+    if (NULL != body) {
+        TFREE(body);
+    }
+
+    if (NULL != levels) {
+        TFREE(levels);
+    }
+
+    return ret;
+}
+
@@ -0,0 +1,64 @@
+#pragma once
+
+#include <tsl/result.h>
+
+#include <stdint.h>
+#include <stddef.h>
+
+struct ais_position_report;
+
+/**
+ * The bit rate of the levels generated by the AIS encoder
+ */
+#define SYNTH_AIS_BIT_RATE              9600
+
+/**
+ * The deviation, in Hz, corresponding to a symbol level of 1
+ */
+#define SYNTH_AIS_LEVEL_DEVIATION_HZ    2400
+
+/**
+ * The length, in bytes, of a position report (message types 1, 2 and 3)
+ */
+#define SYNTH_AIS_POSITION_REPORT_BYTES 21
+
+/**
+ * Write a bitfield into an AIS packet. Fields are packed most significant bit first, the
+ * same way ais_decode extracts them.
+ *
+ * \param packet The packet buffer
+ * \param packet_len The length of the packet buffer, in bytes
+ * \param offset The bit offset of the field
+ * \param len The length of the field, in bits. At most 32.
+ * \param value The value to write. Only the low len bits are used.
+ *
+ * \return A_OK on success, an error code otherwise.
+ */
+aresult_t synth_ais_set_bitfield(uint8_t *packet, size_t packet_len, size_t offset, size_t len, uint32_t value);
+
+/**
+ * Pack a position report into an AIS message.
+ *
+ * \param msg_id The message type, one of 1, 2 or 3
+ * \param rpt The position report to pack
+ * \param packet The packet buffer, at least SYNTH_AIS_POSITION_REPORT_BYTES long
+ * \param packet_len The length of the packet buffer, in bytes
+ *
+ * \return A_OK on success, an error code otherwise.
+ */
+aresult_t synth_ais_position_report_pack(unsigned msg_id, const struct ais_position_report *rpt,
+        uint8_t *packet, size_t packet_len);
+
+/**
+ * Frame an AIS packet for transmission: training sequence, HDLC flags, bit stuffing, the
+ * FCS and NRZI encoding. The result is one level (-1 or +1) per bit at SYNTH_AIS_BIT_RATE.
+ *
+ * \param packet The packet to transmit, as ais_demod delivers it
+ * \param packet_len The length of the packet, in bytes
+ * \param plevels The symbol levels. Allocated by this function, free with TFREE.
+ * \param pnr_levels The number of symbol levels. Returned by reference.
+ *
+ * \return A_OK on success, an error code otherwise.
+ */
+aresult_t synth_ais_enc_frame(const uint8_t *packet, size_t packet_len, int8_t **plevels, size_t *pnr_levels);
+
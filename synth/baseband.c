@@ -0,0 +1,74 @@
+/*
+ *  baseband.c - Baseband signal generators for signal synthesis
+ *
+ *  Copyright (c)2017 Phil Vachon <phil@security-embedded.com>
+ *
+ *  This file is a part of The Standard Library (TSL)
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ */
+
+#include <synth/baseband.h>
+
+#include <tsl/errors.h>
+#include <tsl/assert.h>
+
+#include <math.h>
+
+aresult_t synth_tone_generate(float *out, size_t nr_samples, uint32_t sample_rate, uint32_t tone_hz)
+{
+    double incr = 0.0;
+
+    TSL_ASSERT_ARG(NULL != out);
+    TSL_ASSERT_ARG(0 != sample_rate);
+
+    incr = 2.0 * M_PI * (double)tone_hz / (double)sample_rate;
+
+    for (size_t i = 0; i < nr_samples; i++) {
+        out[i] = (float)sin(incr * (double)i);
+    }
+
+    return A_OK;
+}
+
+aresult_t synth_fsk_generate(float *out, size_t nr_out, double samples_per_symbol,
+        const int8_t *levels, size_t nr_levels, float scale, size_t *pnr_generated)
+{
+    size_t nr_generated = 0;
+    double next_edge = 0.0;
+
+    TSL_ASSERT_ARG(NULL != out);
+    TSL_ASSERT_ARG(0.0 < samples_per_symbol);
+    TSL_ASSERT_ARG(NULL != levels);
+    TSL_ASSERT_ARG(NULL != pnr_generated);
+
+    next_edge = samples_per_symbol;
+
+    for (size_t i = 0; i < nr_levels && nr_generated < nr_out; i++) {
+        float value = scale * (float)levels[i];
+
+        /* Fill up to the next symbol boundary, carrying the fractional part forward */
+        while (nr_generated < nr_out && (double)nr_generated < next_edge) {
+            out[nr_generated++] = value;
+        }
+
+        next_edge += samples_per_symbol;
+    }
+
+    *pnr_generated = nr_generated;
+
+    return A_OK;
+}
+
@@ -0,0 +1,37 @@
+#pragma once
+
+#include <tsl/result.h>
+
+#include <stdint.h>
+#include <stddef.h>
+
+/**
+ * Generate a sine tone, normalized to [-1.0, 1.0].
+ *
+ * \param out The output buffer
+ * \param nr_samples The number of samples to generate
+ * \param sample_rate The sample rate, in Hz
+ * \param tone_hz The frequency of the tone, in Hz
+ *
+ * \return A_OK on success, an error code otherwise.
+ */
+aresult_t synth_tone_generate(float *out, size_t nr_samples, uint32_t sample_rate, uint32_t tone_hz);
+
+/**
+ * Generate a non-return-to-zero FSK baseband signal from a sequence of symbol levels. Each
+ * symbol is held for samples_per_symbol samples; the symbol timing is tracked as a fraction
+ * so arbitrary (and slightly wrong, for modelling clock drift) rates can be generated.
+ *
+ * \param out The output buffer
+ * \param nr_out The maximum number of samples that can be written to out
+ * \param samples_per_symbol The number of output samples per symbol
+ * \param levels The symbol levels (i.e. -1/+1 for 2FSK, -3/-1/+1/+3 for 4FSK)
+ * \param nr_levels The number of symbols in levels
+ * \param scale The scale applied to each level to get the output sample value
+ * \param pnr_generated The number of samples written to out. Returned by reference.
+ *
+ * \return A_OK on success, an error code otherwise.
+ */
+aresult_t synth_fsk_generate(float *out, size_t nr_out, double samples_per_symbol,
+        const int8_t *levels, size_t nr_levels, float scale, size_t *pnr_generated);
+
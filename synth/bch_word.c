@@ -0,0 +1,57 @@
+/*
+ *  bch_word.c - BCH(31,21) word encoding for pager signal synthesis
+ *
+ *  Copyright (c)2017 Phil Vachon <phil@security-embedded.com>
+ *
+ *  This file is a part of The Standard Library (TSL)
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ */
+
+#include <synth/bch_word.h>
+
+#include <pager/bch_code.h>
+
+#include <tsl/assert.h>
+
+uint32_t synth_bch_word_encode(struct bch_code *bch, uint32_t info)
+{
+    int data[21],
+        bb[10];
+    uint32_t word = info & 0x1ffffful;
+
+    TSL_BUG_ON(NULL == bch);
+
+    /*
+     * The decoder treats bit (30 - j) of the word as the coefficient of X**j. The information
+     * polynomial is shifted up by X**10, so information coefficient i lands in bit (20 - i).
+     */
+    for (int i = 0; i < 21; i++) {
+        data[i] = (word >> (20 - i)) & 1;
+    }
+
+    bch_code_encode(bch, data);
+    bch_code_get_redundancy(bch, bb);
+
+    for (int i = 0; i < 10; i++) {
+        word |= (uint32_t)(!!bb[i]) << (30 - i);
+    }
+
+    /* Even parity across the entire word */
+    word |= (uint32_t)(__builtin_popcount(word) & 1) << 31;
+
+    return word;
+}
+
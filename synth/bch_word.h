@@ -0,0 +1,21 @@
+#pragma once
+
+#include <stdint.h>
+
+struct bch_code;
+
+/**
+ * Encode 21 information bits as a BCH(31,21) codeword with an even parity bit, for use in
+ * POCSAG and FLEX transmissions.
+ *
+ * The codeword uses the same bit order the pager decoders use: bit 0 is the first bit
+ * transmitted. The information bits occupy bits 0 through 20, the BCH check bits occupy
+ * bits 21 through 30 and the even parity bit is bit 31.
+ *
+ * \param bch The BCH(31,21) code state
+ * \param info The information bits, in bits 0 through 20
+ *
+ * \return The encoded 32-bit word
+ */
+uint32_t synth_bch_word_encode(struct bch_code *bch, uint32_t info);
+
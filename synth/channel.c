@@ -0,0 +1,202 @@
+/*
+ *  channel.c - Channel model for rendering synthetic transmissions
+ *
+ *  Copyright (c)2017 Phil Vachon <phil@security-embedded.com>
+ *
+ *  This file is a part of The Standard Library (TSL)
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ */
+
+#include <synth/channel.h>
+#include <synth/baseband.h>
+#include <synth/fm_mod.h>
+
+#include <tsl/safe_alloc.h>
+#include <tsl/errors.h>
+#include <tsl/assert.h>
+
+#include <math.h>
+#include <stdlib.h>
+
+aresult_t synth_channel_init(struct synth_channel *chan, uint32_t sample_rate, double symbol_rate,
+        uint32_t deviation_hz, uint64_t seed)
+{
+    TSL_ASSERT_ARG(NULL != chan);
+    TSL_ASSERT_ARG(0 != sample_rate);
+    TSL_ASSERT_ARG(0.0 < symbol_rate);
+
+    chan->sample_rate = sample_rate;
+    chan->symbol_rate = symbol_rate;
+    chan->deviation_hz = deviation_hz;
+    chan->full_scale_hz = SYNTH_CHANNEL_DEFAULT_FULL_SCALE_HZ;
+    chan->freq_offset_hz = 0;
+    chan->drift_ppm = 0.0;
+    chan->snr_db = 0.0;
+    chan->add_noise = false;
+
+    return synth_noise_init(&chan->noise, seed);
+}
+
+static
+double _synth_channel_samples_per_symbol(const struct synth_channel *chan)
+{
+    return (double)chan->sample_rate / (chan->symbol_rate * (1.0 + chan->drift_ppm * 1e-6));
+}
+
+size_t synth_channel_nr_samples(const struct synth_channel *chan, size_t nr_levels)
+{
+    TSL_BUG_ON(NULL == chan);
+
+    return (size_t)ceil((double)nr_levels * _synth_channel_samples_per_symbol(chan));
+}
+
+static
+int16_t _synth_channel_clamp(float sample)
+{
+    if (sample > 32767.0f) {
+        return 32767;
+    } else if (sample < -32768.0f) {
+        return -32768;
+    }
+
+    return (int16_t)lrintf(sample);
+}
+
+aresult_t synth_channel_render_pcm(struct synth_channel *chan, const int8_t *levels, size_t nr_levels,
+        int16_t *out, size_t nr_out, size_t *pnr_samples)
+{
+    aresult_t ret = A_OK;
+
+    float *baseband = NULL;
+    size_t nr_samples = 0;
+    float scale = 0.0f,
+          offset = 0.0f,
+          peak = 0.0f;
+    int max_level = 1;
+
+    TSL_ASSERT_ARG(NULL != chan);
+    TSL_ASSERT_ARG(0 != chan->full_scale_hz);
+    TSL_ASSERT_ARG(NULL != levels);
+    TSL_ASSERT_ARG(NULL != out);
+    TSL_ASSERT_ARG(NULL != pnr_samples);
+
+    *pnr_samples = 0;
+
+    if (FAILED(ret = TACALLOC((void **)&baseband, nr_out, sizeof(float), SYS_CACHE_LINE_LENGTH))) {
+        goto done;
+    }
+
+    scale = 32767.0f * (float)chan->deviation_hz / (float)chan->full_scale_hz;
+    offset = 32767.0f * (float)chan->freq_offset_hz / (float)chan->full_scale_hz;
+
+    if (FAILED(ret = synth_fsk_generate(baseband, nr_out, _synth_channel_samples_per_symbol(chan), levels,
+                    nr_levels, scale, &nr_samples)))
+    {
+        goto done;
+    }
+
+    if (chan->add_noise) {
+        for (size_t i = 0; i < nr_levels; i++) {
+            if (abs(levels[i]) > max_level) {
+                max_level = abs(levels[i]);
+            }
+        }
+
+        peak = scale * (float)max_level;
+
+        if (FAILED(ret = synth_noise_add_awgn(&chan->noise, baseband, nr_samples,
+                        peak * powf(10.0f, -(float)chan->snr_db / 20.0f))))
+        {
+            goto done;
+        }
+    }
+
+    for (size_t i = 0; i < nr_samples; i++) {
+        out[i] = _synth_channel_clamp(baseband[i] + offset);
+    }
+
+    *pnr_samples = nr_samples;
+
+done:
+    if (NULL != baseband) {
+        TFREE(baseband);
+    }
+
+    return ret;
+}
+
+aresult_t synth_channel_render_iq(struct synth_channel *chan, const int8_t *levels, size_t nr_levels,
+        int16_t *out, size_t nr_out, size_t *pnr_samples)
+{
+    aresult_t ret = A_OK;
+
+    float *baseband = NULL,
+          *iq = NULL;
+    size_t nr_samples = 0;
+    struct synth_fm_mod mod;
+    const float amplitude = 16383.0f;
+
+    TSL_ASSERT_ARG(NULL != chan);
+    TSL_ASSERT_ARG(NULL != levels);
+    TSL_ASSERT_ARG(NULL != out);
+    TSL_ASSERT_ARG(NULL != pnr_samples);
+
+    *pnr_samples = 0;
+
+    if (FAILED(ret = TACALLOC((void **)&baseband, nr_out, sizeof(float), SYS_CACHE_LINE_LENGTH))) {
+        goto done;
+    }
+
+    if (FAILED(ret = TACALLOC((void **)&iq, 2 * nr_out, sizeof(float), SYS_CACHE_LINE_LENGTH))) {
+        goto done;
+    }
+
+    if (FAILED(ret = synth_fsk_generate(baseband, nr_out, _synth_channel_samples_per_symbol(chan), levels,
+                    nr_levels, 1.0f, &nr_samples)))
+    {
+        goto done;
+    }
+
+    TSL_BUG_IF_FAILED(synth_fm_mod_init(&mod, chan->sample_rate, chan->freq_offset_hz, chan->deviation_hz));
+    TSL_BUG_IF_FAILED(synth_fm_mod_process(&mod, baseband, nr_samples, amplitude, iq));
+
+    if (chan->add_noise) {
+        /* Split the noise power evenly between I and Q */
+        if (FAILED(ret = synth_noise_add_awgn(&chan->noise, iq, 2 * nr_samples,
+                        amplitude / sqrtf(2.0f) * powf(10.0f, -(float)chan->snr_db / 20.0f))))
+        {
+            goto done;
+        }
+    }
+
+    for (size_t i = 0; i < 2 * nr_samples; i++) {
+        out[i] = _synth_channel_clamp(iq[i]);
+    }
+
+    *pnr_samples = nr_samples;
+
+done:
+    if (NULL != iq) {
+        TFREE(iq);
+    }
+
+    if (NULL != baseband) {
+        TFREE(baseband);
+    }
+
+    return ret;
+}
+
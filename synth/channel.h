@@ -0,0 +1,121 @@
+#pragma once
+
+#include <synth/noise.h>
+
+#include <tsl/result.h>
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stddef.h>
+
+/**
+ * Default PCM full scale deviation, matching a discriminator running on a 25kHz channel
+ */
+#define SYNTH_CHANNEL_DEFAULT_FULL_SCALE_HZ     12500
+
+/**
+ * A model of the path from a transmitter's symbol stream to a receiver: the symbol clock
+ * (with optional drift), FM deviation, carrier frequency offset and additive noise.
+ */
+struct synth_channel {
+    /**
+     * The output sample rate, in Hz
+     */
+    uint32_t sample_rate;
+
+    /**
+     * The nominal symbol rate, in symbols per second
+     */
+    double symbol_rate;
+
+    /**
+     * The frequency deviation for a symbol level of 1, in Hz
+     */
+    uint32_t deviation_hz;
+
+    /**
+     * The deviation, in Hz, that corresponds to a full scale PCM sample
+     */
+    uint32_t full_scale_hz;
+
+    /**
+     * Carrier frequency offset, in Hz
+     */
+    int32_t freq_offset_hz;
+
+    /**
+     * Transmitter symbol clock error, in parts per million. Positive values mean the
+     * transmitter's clock runs fast.
+     */
+    double drift_ppm;
+
+    /**
+     * Signal to noise ratio, in dB. Only used if add_noise is set.
+     */
+    double snr_db;
+
+    /**
+     * Whether or not to add white Gaussian noise
+     */
+    bool add_noise;
+
+    /**
+     * The noise source
+     */
+    struct synth_noise noise;
+};
+
+/**
+ * Initialize a channel model. The model starts out ideal: no frequency offset, drift or noise.
+ * PCM full scale defaults to SYNTH_CHANNEL_DEFAULT_FULL_SCALE_HZ.
+ *
+ * \param chan The channel model
+ * \param sample_rate The output sample rate, in Hz
+ * \param symbol_rate The nominal symbol rate, in symbols per second
+ * \param deviation_hz The deviation for a symbol level of 1, in Hz
+ * \param seed The noise seed
+ *
+ * \return A_OK on success, an error code otherwise.
+ */
+aresult_t synth_channel_init(struct synth_channel *chan, uint32_t sample_rate, double symbol_rate,
+        uint32_t deviation_hz, uint64_t seed);
+
+/**
+ * Get the number of output samples needed to render the given number of symbols.
+ */
+size_t synth_channel_nr_samples(const struct synth_channel *chan, size_t nr_levels);
+
+/**
+ * Render symbol levels as real PCM samples, as an ideal FM discriminator would output them.
+ * Full scale corresponds to a deviation of full_scale_hz. The noise power is relative to the
+ * peak deviation of the signal.
+ *
+ * \param chan The channel model
+ * \param levels The symbol levels
+ * \param nr_levels The number of symbol levels
+ * \param out The output buffer
+ * \param nr_out The size of the output buffer, in samples
+ * \param pnr_samples The number of samples written. Returned by reference.
+ *
+ * \return A_OK on success, an error code otherwise.
+ */
+aresult_t synth_channel_render_pcm(struct synth_channel *chan, const int8_t *levels, size_t nr_levels,
+        int16_t *out, size_t nr_out, size_t *pnr_samples);
+
+/**
+ * Render symbol levels as an FM modulated carrier, as interleaved 16-bit complex samples. The
+ * carrier is at half of full scale. The noise power is relative to the carrier power, across
+ * the entire sample bandwidth.
+ *
+ * \param chan The channel model
+ * \param levels The symbol levels
+ * \param nr_levels The number of symbol levels
+ * \param out The output buffer, interleaved I/Q
+ * \param nr_out The size of the output buffer, in complex samples
+ * \param pnr_samples The number of complex samples written. Returned by reference.
+ *
+ * \return A_OK on success, an error code otherwise.
+ */
+aresult_t synth_channel_render_iq(struct synth_channel *chan, const int8_t *levels, size_t nr_levels,
+        int16_t *out, size_t nr_out, size_t *pnr_samples);
+
@@ -0,0 +1,510 @@
+/*
+ *  flex_enc.c - FLEX frame encoder for signal synthesis
+ *
+ *  Copyright (c)2017 Phil Vachon <phil@security-embedded.com>
+ *
+ *  This file is a part of The Standard Library (TSL)
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ */
+
+#include <synth/flex_enc.h>
+#include <synth/bch_word.h>
+#include <synth/synth_priv.h>
+
+#include <pager/bch_code.h>
+
+#include <tsl/safe_alloc.h>
+#include <tsl/errors.h>
+#include <tsl/assert.h>
+
+#include <stdbool.h>
+#include <string.h>
+
+#define SYNTH_FLEX_SYNC_BS1             0xaaaaaaaaul
+#define SYNTH_FLEX_SYNC_MAGIC_A         0x5939ul
+#define SYNTH_FLEX_SYNC_MAGIC_B         0x5555ul
+#define SYNTH_FLEX_SYNC_2_MAGIC_C       0xed84ul
+
+#define SYNTH_FLEX_MESSAGE_STANDARD_NUMERIC     0x3
+#define SYNTH_FLEX_MESSAGE_ALPHANUMERIC         0x5
+
+#define SYNTH_FLEX_MAX_PHASES           4
+#define SYNTH_FLEX_BLOCKS_PER_FRAME     11
+#define SYNTH_FLEX_WORDS_PER_BLOCK      8
+#define SYNTH_FLEX_WORDS_PER_PHASE      (SYNTH_FLEX_BLOCKS_PER_FRAME * SYNTH_FLEX_WORDS_PER_BLOCK)
+#define SYNTH_FLEX_BITS_PER_PHASE       (SYNTH_FLEX_WORDS_PER_PHASE * 32)
+
+/**
+ * Sync 1 is 144 bits long (BS1, A, B, inverted A and the FIW), always sent at 1600 baud.
+ */
+#define SYNTH_FLEX_SYNC_1_BITS          (32 + 32 + 16 + 32 + 32)
+
+/**
+ * Description of each of the FLEX speeds, mirroring what the decoder expects.
+ */
+struct synth_flex_coding {
+    uint16_t seq_a;
+    uint16_t symbol_rate;
+    uint8_t fsk_levels;
+    uint8_t nr_phases;
+
+    /**
+     * Number of symbols in each of the Sync 2 comma sequences
+     */
+    uint8_t comma_symbols;
+};
+
+static const
+struct synth_flex_coding _synth_flex_codings[] = {
+    [SYNTH_FLEX_SPEED_1600_2FSK] = { .seq_a = 0x78f3, .symbol_rate = 1600, .fsk_levels = 2, .nr_phases = 1, .comma_symbols = 4 },
+    [SYNTH_FLEX_SPEED_3200_2FSK] = { .seq_a = 0x84e7, .symbol_rate = 3200, .fsk_levels = 2, .nr_phases = 2, .comma_symbols = 24 },
+    [SYNTH_FLEX_SPEED_3200_4FSK] = { .seq_a = 0x4f97, .symbol_rate = 1600, .fsk_levels = 4, .nr_phases = 2, .comma_symbols = 12 },
+    [SYNTH_FLEX_SPEED_6400_4FSK] = { .seq_a = 0x215f, .symbol_rate = 3200, .fsk_levels = 4, .nr_phases = 4, .comma_symbols = 32 },
+};
+
+struct synth_flex_enc {
+    /**
+     * BCH(31,21) code, shared with the decoder implementation
+     */
+    struct bch_code *bch;
+
+    /**
+     * The words for each phase of the frame currently being encoded
+     */
+    uint32_t phase_words[SYNTH_FLEX_MAX_PHASES][SYNTH_FLEX_WORDS_PER_PHASE];
+};
+
+aresult_t synth_flex_enc_new(struct synth_flex_enc **penc)
+{
+    aresult_t ret = A_OK;
+
+    static const int poly[6] = { 1, 0, 1, 0, 0, 1 };
+    struct synth_flex_enc *enc = NULL;
+
+    TSL_ASSERT_ARG(NULL != penc);
+
+    *penc = NULL;
+
+    if (FAILED(ret = TZAALLOC(enc, SYS_CACHE_LINE_LENGTH))) {
+        goto done;
+    }
+
+    if (FAILED(ret = bch_code_new(&enc->bch, poly, 5, 31, 21, 2))) {
+        goto done;
+    }
+
+    *penc = enc;
+
+done:
+    if (FAILED(ret)) {
+        if (NULL != enc) {
+            TFREE(enc);
+        }
+    }
+    return ret;
+}
+
+aresult_t synth_flex_enc_delete(struct synth_flex_enc **penc)
+{
+    aresult_t ret = A_OK;
+
+    struct synth_flex_enc *enc = NULL;
+
+    TSL_ASSERT_ARG(NULL != penc);
+    TSL_ASSERT_ARG(NULL != *penc);
+
+    enc = *penc;
+
+    if (NULL != enc->bch) {
+        bch_code_delete(&enc->bch);
+    }
+
+    TFREE(enc);
+
+    *penc = NULL;
+
+    return ret;
+}
+
+aresult_t synth_flex_speed_parse(const char *name, enum synth_flex_speed *pspeed)
+{
+    aresult_t ret = A_OK;
+
+    TSL_ASSERT_ARG(NULL != name);
+    TSL_ASSERT_ARG(NULL != pspeed);
+
+    if (!strcmp(name, "1600/2")) {
+        *pspeed = SYNTH_FLEX_SPEED_1600_2FSK;
+    } else if (!strcmp(name, "3200/2")) {
+        *pspeed = SYNTH_FLEX_SPEED_3200_2FSK;
+    } else if (!strcmp(name, "3200/4")) {
+        *pspeed = SYNTH_FLEX_SPEED_3200_4FSK;
+    } else if (!strcmp(name, "6400/4")) {
+        *pspeed = SYNTH_FLEX_SPEED_6400_4FSK;
+    } else {
+        ret = A_E_INVAL;
+    }
+
+    return ret;
+}
+
+/**
+ * Fill in the 4-bit checksum field of a word so the nibbles of the 21 information bits
+ * sum to 0xf.
+ */
+static
+uint32_t _synth_flex_word_checksum(uint32_t word)
+{
+    uint8_t cksum = 0;
+    uint32_t tmp = 0;
+
+    word &= 0x1ffff0ul;
+    tmp = word;
+
+    for (size_t nibble = 0; nibble < 6; nibble++) {
+        cksum += tmp & 0xf;
+        tmp >>= 4;
+    }
+
+    return word | ((0xf - cksum) & 0xf);
+}
+
+/**
+ * Map a character to the BCD digit the decoder maps back to it. Anything not in the
+ * numeric character set becomes a space.
+ */
+static
+uint32_t _synth_flex_numeric_digit(char c)
+{
+    static const char charmap[] = "0123456789XU -][";
+    const char *p = NULL;
+
+    if ('\0' == c || NULL == (p = strchr(charmap, c))) {
+        return 0xc;
+    }
+
+    return (uint32_t)(p - charmap);
+}
+
+/**
+ * Count the number of message words needed to carry the given page, including the status
+ * word for alphanumeric pages. Returns 0 if the page is too long to be carried.
+ */
+static
+size_t _synth_flex_msg_words(const struct synth_flex_msg *msg)
+{
+    size_t len = NULL == msg->msg ? 0 : strlen(msg->msg),
+           nr_words = 0;
+
+    switch (msg->type) {
+    case SYNTH_FLEX_MSG_TYPE_ALPHA:
+        /* Status word, then 3 characters per word following the signature */
+        nr_words = 1 + (len + 1 + 2) / 3;
+        return nr_words > 0x7f ? 0 : nr_words;
+    case SYNTH_FLEX_MSG_TYPE_NUMERIC:
+        /* 2 leading bits are skipped, then the digits are packed into a continuous stream */
+        nr_words = (2 + 4 * len + 20) / 21;
+        if (0 == nr_words) {
+            nr_words = 1;
+        }
+        return nr_words > 8 ? 0 : nr_words;
+    default:
+        return 0;
+    }
+}
+
+/**
+ * Encode the vector and message words of a page.
+ */
+static
+void _synth_flex_msg_encode(struct synth_flex_enc *enc, const struct synth_flex_msg *msg, uint32_t *vec,
+        uint32_t *words, size_t word_start, size_t nr_words)
+{
+    const char *body = msg->msg;
+    size_t len = NULL == body ? 0 : strlen(body);
+
+    if (SYNTH_FLEX_MSG_TYPE_ALPHA == msg->type) {
+        size_t next_char = 0;
+
+        *vec = synth_bch_word_encode(enc->bch, _synth_flex_word_checksum(
+                    (SYNTH_FLEX_MESSAGE_ALPHANUMERIC << 4) | (word_start << 7) | (nr_words << 14)));
+
+        /* Status word: first and only fragment, no continuation */
+        words[0] = synth_bch_word_encode(enc->bch, 0x3ul << 11);
+
+        for (size_t i = 1; i < nr_words; i++) {
+            uint32_t word = 0;
+
+            for (size_t j = 0; j < 3; j++) {
+                uint32_t c = 0x3;
+
+                if (1 == i && 0 == j) {
+                    /* The signature is not checked by our decoder, so it's left as zero. */
+                    c = 0;
+                } else if (next_char < len) {
+                    c = body[next_char++] & 0x7f;
+                }
+
+                word |= c << (7 * j);
+            }
+
+            words[i] = synth_bch_word_encode(enc->bch, word);
+        }
+    } else {
+        uint64_t acc = 0;
+        unsigned acc_bits = 2;
+        size_t next_char = 0;
+
+        *vec = synth_bch_word_encode(enc->bch, _synth_flex_word_checksum(
+                    (SYNTH_FLEX_MESSAGE_STANDARD_NUMERIC << 4) | (word_start << 7) | ((nr_words - 1) << 14)));
+
+        for (size_t i = 0; i < nr_words; i++) {
+            while (acc_bits < 21) {
+                acc |= (uint64_t)_synth_flex_numeric_digit(next_char < len ? body[next_char] : '\0') << acc_bits;
+                acc_bits += 4;
+                next_char++;
+            }
+
+            words[i] = synth_bch_word_encode(enc->bch, acc & 0x1ffffful);
+            acc >>= 21;
+            acc_bits -= 21;
+        }
+    }
+}
+
+/**
+ * Lay out the block information word, addresses, vectors and messages for one phase.
+ */
+static
+aresult_t _synth_flex_phase_encode(struct synth_flex_enc *enc, unsigned phase, unsigned nr_phases,
+        const struct synth_flex_msg *msgs, size_t nr_msgs)
+{
+    aresult_t ret = A_OK;
+
+    uint32_t *words = enc->phase_words[phase];
+    size_t nr_addrs = 0,
+           next_addr = 0,
+           next_word = 0;
+
+    for (size_t i = phase; i < nr_msgs; i += nr_phases) {
+        nr_addrs++;
+    }
+
+    if (nr_addrs > 0x3e) {
+        SYN_MSG(SEV_WARNING, "TOO-MANY-PAGES", "Phase %c can't carry %zu pages", 'A' + phase, nr_addrs);
+        ret = A_E_INVAL;
+        goto done;
+    }
+
+    /* Idle fill alternates all zeros and all ones, so the slicer always sees transitions */
+    for (size_t i = 0; i < SYNTH_FLEX_WORDS_PER_PHASE; i++) {
+        words[i] = synth_bch_word_encode(enc->bch, (i & 1) ? 0x1ffffful : 0);
+    }
+
+    /* BIW: no additional BIWs, vectors start immediately after the addresses */
+    words[0] = synth_bch_word_encode(enc->bch, _synth_flex_word_checksum((1 + nr_addrs) << 10));
+
+    next_word = 1 + 2 * nr_addrs;
+
+    for (size_t i = phase; i < nr_msgs; i += nr_phases) {
+        const struct synth_flex_msg *msg = &msgs[i];
+        size_t nr_words = _synth_flex_msg_words(msg);
+
+        if (0 == msg->capcode || msg->capcode > 0x1e0000ul - 0x8000ul) {
+            SYN_MSG(SEV_WARNING, "BAD-CAPCODE", "Capcode %u can't be encoded as a short address", msg->capcode);
+            ret = A_E_INVAL;
+            goto done;
+        }
+
+        if (0 == nr_words || next_word + nr_words > SYNTH_FLEX_WORDS_PER_PHASE) {
+            SYN_MSG(SEV_WARNING, "TOO-LONG", "Page to capcode %u does not fit in phase %c", msg->capcode,
+                    'A' + phase);
+            ret = A_E_INVAL;
+            goto done;
+        }
+
+        words[1 + next_addr] = synth_bch_word_encode(enc->bch, msg->capcode + 0x8000ul);
+        _synth_flex_msg_encode(enc, msg, &words[1 + nr_addrs + next_addr], &words[next_word], next_word, nr_words);
+
+        next_addr++;
+        next_word += nr_words;
+    }
+
+done:
+    return ret;
+}
+
+/**
+ * Get bit k of a phase, as it is transmitted. Each block of 8 words is interleaved so the
+ * first 8 bits transmitted are bit 0 of each of the 8 words.
+ */
+static inline
+unsigned _synth_flex_phase_bit(const uint32_t *words, size_t k)
+{
+    size_t block = k / 256,
+           offs = k % 256;
+
+    return (words[block * SYNTH_FLEX_WORDS_PER_BLOCK + (offs % 8)] >> (offs / 8)) & 1;
+}
+
+/**
+ * Map a 4FSK symbol value (as sliced by the decoder) to a level.
+ */
+static inline
+int8_t _synth_flex_4fsk_level(unsigned msb, unsigned lsb)
+{
+    static const int8_t levels[4] = { -3, -1, 3, 1 };
+    return levels[(msb << 1) | lsb];
+}
+
+static
+int8_t *_synth_flex_emit(int8_t *out, int8_t level, unsigned repeat)
+{
+    for (unsigned i = 0; i < repeat; i++) {
+        *out++ = level;
+    }
+    return out;
+}
+
+/**
+ * Emit the given bits, MSB first, as 2FSK symbols.
+ */
+static
+int8_t *_synth_flex_emit_bits(int8_t *out, uint32_t bits, unsigned nr_bits, unsigned repeat)
+{
+    for (unsigned i = 0; i < nr_bits; i++) {
+        out = _synth_flex_emit(out, ((bits >> (nr_bits - 1 - i)) & 1) ? 3 : -3, repeat);
+    }
+    return out;
+}
+
+aresult_t synth_flex_enc_frame(struct synth_flex_enc *enc, enum synth_flex_speed speed, uint8_t cycle_no,
+        uint8_t frame_no, const struct synth_flex_msg *msgs, size_t nr_msgs, int8_t **plevels,
+        size_t *pnr_levels)
+{
+    aresult_t ret = A_OK;
+
+    const struct synth_flex_coding *coding = NULL;
+    int8_t *levels = NULL,
+           *out = NULL;
+    size_t nr_levels = 0,
+           nr_symbols = 0;
+    unsigned repeat = 0;
+    uint32_t a = 0,
+             fiw = 0;
+
+    TSL_ASSERT_ARG(NULL != enc);
+    TSL_ASSERT_ARG(speed <= SYNTH_FLEX_SPEED_6400_4FSK);
+    TSL_ASSERT_ARG(cycle_no < 15);
+    TSL_ASSERT_ARG(frame_no < 128);
+    TSL_ASSERT_ARG(NULL != msgs || 0 == nr_msgs);
+    TSL_ASSERT_ARG(NULL != plevels);
+    TSL_ASSERT_ARG(NULL != pnr_levels);
+
+    *plevels = NULL;
+    *pnr_levels = 0;
+
+    coding = &_synth_flex_codings[speed];
+    repeat = SYNTH_FLEX_SYMBOL_RATE / coding->symbol_rate;
+
+    for (unsigned i = 0; i < coding->nr_phases; i++) {
+        if (FAILED(ret = _synth_flex_phase_encode(enc, i, coding->nr_phases, msgs, nr_msgs))) {
+            goto done;
+        }
+    }
+
+    /* Sync 2 and the frame body are sent at the coding's symbol rate */
+    nr_symbols = 2 * coding->comma_symbols + 2 * (16 / (coding->fsk_levels / 2)) +
+        SYNTH_FLEX_BITS_PER_PHASE * coding->nr_phases / (coding->fsk_levels / 2);
+    nr_levels = SYNTH_FLEX_SYNC_1_BITS * 2 + nr_symbols * repeat;
+
+    if (FAILED(ret = TACALLOC((void **)&levels, nr_levels, sizeof(int8_t), SYS_CACHE_LINE_LENGTH))) {
+        goto done;
+    }
+
+    out = levels;
+
+    /* Sync 1 */
+    a = ((uint32_t)coding->seq_a << 16) | SYNTH_FLEX_SYNC_MAGIC_A;
+    out = _synth_flex_emit_bits(out, SYNTH_FLEX_SYNC_BS1, 32, 2);
+    out = _synth_flex_emit_bits(out, a, 32, 2);
+    out = _synth_flex_emit_bits(out, SYNTH_FLEX_SYNC_MAGIC_B, 16, 2);
+    out = _synth_flex_emit_bits(out, ~a, 32, 2);
+
+    /* The FIW is sent least significant bit first */
+    fiw = synth_bch_word_encode(enc->bch, _synth_flex_word_checksum(((uint32_t)cycle_no << 4) |
+                ((uint32_t)frame_no << 8)));
+    for (unsigned i = 0; i < 32; i++) {
+        out = _synth_flex_emit(out, ((fiw >> i) & 1) ? 3 : -3, 2);
+    }
+
+    /* Sync 2: comma, C, inverted comma, inverted C */
+    for (int inv = 0; inv < 2; inv++) {
+        uint32_t c = inv ? ~SYNTH_FLEX_SYNC_2_MAGIC_C & 0xffff : SYNTH_FLEX_SYNC_2_MAGIC_C;
+
+        for (unsigned i = 0; i < coding->comma_symbols; i++) {
+            out = _synth_flex_emit(out, ((i & 1) ^ inv) ? 3 : -3, repeat);
+        }
+
+        if (2 == coding->fsk_levels) {
+            out = _synth_flex_emit_bits(out, c, 16, repeat);
+        } else {
+            for (unsigned i = 0; i < 8; i++) {
+                unsigned sym = (c >> (14 - 2 * i)) & 0x3;
+                out = _synth_flex_emit(out, _synth_flex_4fsk_level(sym >> 1, sym & 1), repeat);
+            }
+        }
+    }
+
+    /* The frame body, with the phases multiplexed the way the decoder splits them back out */
+    for (size_t k = 0; k < SYNTH_FLEX_BITS_PER_PHASE; k++) {
+        uint32_t (*pw)[SYNTH_FLEX_WORDS_PER_PHASE] = enc->phase_words;
+
+        switch (speed) {
+        case SYNTH_FLEX_SPEED_1600_2FSK:
+            out = _synth_flex_emit(out, _synth_flex_phase_bit(pw[0], k) ? 3 : -3, repeat);
+            break;
+        case SYNTH_FLEX_SPEED_3200_2FSK:
+            out = _synth_flex_emit(out, _synth_flex_phase_bit(pw[0], k) ? 3 : -3, repeat);
+            out = _synth_flex_emit(out, _synth_flex_phase_bit(pw[1], k) ? 3 : -3, repeat);
+            break;
+        case SYNTH_FLEX_SPEED_3200_4FSK:
+            out = _synth_flex_emit(out, _synth_flex_4fsk_level(_synth_flex_phase_bit(pw[0], k),
+                        _synth_flex_phase_bit(pw[1], k)), repeat);
+            break;
+        case SYNTH_FLEX_SPEED_6400_4FSK:
+            out = _synth_flex_emit(out, _synth_flex_4fsk_level(_synth_flex_phase_bit(pw[0], k),
+                        _synth_flex_phase_bit(pw[1], k)), repeat);
+            out = _synth_flex_emit(out, _synth_flex_4fsk_level(_synth_flex_phase_bit(pw[2], k),
+                        _synth_flex_phase_bit(pw[3], k)), repeat);
+            break;
+        }
+    }
+
+    TSL_BUG_ON((size_t)(out - levels) != nr_levels);
+
+    *plevels = levels;
+    *pnr_levels = nr_levels;
+    levels = NULL;
+
+done:
+    if (NULL != levels) {
+        TFREE(levels);
+    }
+
+    return ret;
+}
+
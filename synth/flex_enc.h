@@ -0,0 +1,110 @@
+#pragma once
+
+#include <tsl/result.h>
+
+#include <stdint.h>
+#include <stddef.h>
+
+struct synth_flex_enc;
+
+/**
+ * The symbol rate of the levels generated by the FLEX encoder. Symbols sent at 1600 baud
+ * are repeated.
+ */
+#define SYNTH_FLEX_SYMBOL_RATE          3200
+
+/**
+ * The deviation, in Hz, corresponding to a symbol level of 1. The outer 4FSK symbols (and all
+ * 2FSK symbols) are +/- 3, or +/- 4800 Hz.
+ */
+#define SYNTH_FLEX_LEVEL_DEVIATION_HZ   1600
+
+enum synth_flex_speed {
+    SYNTH_FLEX_SPEED_1600_2FSK,
+    SYNTH_FLEX_SPEED_3200_2FSK,
+    SYNTH_FLEX_SPEED_3200_4FSK,
+    SYNTH_FLEX_SPEED_6400_4FSK,
+};
+
+enum synth_flex_msg_type {
+    /**
+     * 7-bit ASCII alphanumeric message
+     */
+    SYNTH_FLEX_MSG_TYPE_ALPHA,
+
+    /**
+     * Standard numeric message
+     */
+    SYNTH_FLEX_MSG_TYPE_NUMERIC,
+};
+
+/**
+ * A FLEX page to be encoded. Only short addresses are supported.
+ */
+struct synth_flex_msg {
+    /**
+     * The CAPcode to deliver the page to
+     */
+    uint32_t capcode;
+
+    /**
+     * How the message body is to be encoded
+     */
+    enum synth_flex_msg_type type;
+
+    /**
+     * The message body, NUL-terminated
+     */
+    const char *msg;
+};
+
+/**
+ * Create a new FLEX encoder.
+ *
+ * \param penc The new encoder. Returned by reference.
+ *
+ * \return A_OK on success, an error code otherwise.
+ */
+aresult_t synth_flex_enc_new(struct synth_flex_enc **penc);
+
+/**
+ * Destroy a FLEX encoder.
+ *
+ * \param penc The encoder, passed by reference. Set to NULL on success.
+ *
+ * \return A_OK on success, an error code otherwise.
+ */
+aresult_t synth_flex_enc_delete(struct synth_flex_enc **penc);
+
+/**
+ * Parse a FLEX speed name (i.e. "1600/2", "3200/2", "3200/4" or "6400/4").
+ *
+ * \param name The name of the speed
+ * \param pspeed The speed. Returned by reference.
+ *
+ * \return A_OK on success, A_E_INVAL if the name is not recognized.
+ */
+aresult_t synth_flex_speed_parse(const char *name, enum synth_flex_speed *pspeed);
+
+/**
+ * Encode a single FLEX frame carrying the given pages. Pages are assigned to the phases
+ * available at the given speed round robin.
+ *
+ * The frame is returned as symbol levels (-3, -1, +1, +3) at SYNTH_FLEX_SYMBOL_RATE.
+ *
+ * \param enc The encoder
+ * \param speed The speed and modulation for the frame body
+ * \param cycle_no The cycle number, [0, 14]
+ * \param frame_no The frame number, [0, 127]
+ * \param msgs The pages to encode
+ * \param nr_msgs The number of pages
+ * \param plevels The symbol levels. Allocated by this function, free with TFREE.
+ * \param pnr_levels The number of symbol levels. Returned by reference.
+ *
+ * \return A_OK on success, A_E_INVAL if the pages do not fit in a single frame, an error
+ *         code otherwise.
+ */
+aresult_t synth_flex_enc_frame(struct synth_flex_enc *enc, enum synth_flex_speed speed, uint8_t cycle_no,
+        uint8_t frame_no, const struct synth_flex_msg *msgs, size_t nr_msgs, int8_t **plevels,
+        size_t *pnr_levels);
+
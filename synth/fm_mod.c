@@ -0,0 +1,74 @@
+/*
+ *  fm_mod.c - Complex FM modulator for signal synthesis
+ *
+ *  Copyright (c)2017 Phil Vachon <phil@security-embedded.com>
+ *
+ *  This file is a part of The Standard Library (TSL)
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ */
+
+#include <synth/fm_mod.h>
+
+#include <tsl/errors.h>
+#include <tsl/assert.h>
+
+#include <math.h>
+
+aresult_t synth_fm_mod_init(struct synth_fm_mod *mod, uint32_t sample_rate, int32_t offset_hz,
+        uint32_t deviation_hz)
+{
+    TSL_ASSERT_ARG(NULL != mod);
+    TSL_ASSERT_ARG(0 != sample_rate);
+
+    mod->phase = 0.0;
+    mod->carrier_incr = 2.0 * M_PI * (double)offset_hz / (double)sample_rate;
+    mod->deviation_incr = 2.0 * M_PI * (double)deviation_hz / (double)sample_rate;
+
+    return A_OK;
+}
+
+aresult_t synth_fm_mod_process(struct synth_fm_mod *mod, const float *baseband, size_t nr_samples,
+        float amplitude, float *iq_out)
+{
+    double phase = 0.0;
+
+    TSL_ASSERT_ARG(NULL != mod);
+    TSL_ASSERT_ARG(NULL != iq_out);
+
+    phase = mod->phase;
+
+    for (size_t i = 0; i < nr_samples; i++) {
+        iq_out[2 * i    ] += amplitude * (float)cos(phase);
+        iq_out[2 * i + 1] += amplitude * (float)sin(phase);
+
+        phase += mod->carrier_incr;
+        if (NULL != baseband) {
+            phase += mod->deviation_incr * baseband[i];
+        }
+
+        /* Keep the accumulator small, so we don't lose precision over long runs */
+        if (phase >= M_PI) {
+            phase -= 2.0 * M_PI;
+        } else if (phase < -M_PI) {
+            phase += 2.0 * M_PI;
+        }
+    }
+
+    mod->phase = phase;
+
+    return A_OK;
+}
+
@@ -0,0 +1,58 @@
+#pragma once
+
+#include <tsl/result.h>
+
+#include <stdint.h>
+#include <stddef.h>
+
+/**
+ * State for a complex FM modulator, placing a carrier at an offset from the center of
+ * a complex baseband stream.
+ */
+struct synth_fm_mod {
+    /**
+     * The current phase of the carrier, in radians
+     */
+    double phase;
+
+    /**
+     * The phase increment per sample for the unmodulated carrier
+     */
+    double carrier_incr;
+
+    /**
+     * The phase increment per sample for a full-scale (1.0) modulating signal
+     */
+    double deviation_incr;
+};
+
+/**
+ * Initialize an FM modulator.
+ *
+ * \param mod The modulator state
+ * \param sample_rate The sample rate of the complex output, in Hz
+ * \param offset_hz The offset of the carrier from the center of the output, in Hz
+ * \param deviation_hz The deviation for a full-scale modulating signal, in Hz
+ *
+ * \return A_OK on success, an error code otherwise.
+ */
+aresult_t synth_fm_mod_init(struct synth_fm_mod *mod, uint32_t sample_rate, int32_t offset_hz,
+        uint32_t deviation_hz);
+
+/**
+ * Frequency modulate a real baseband signal, adding the modulated carrier to an existing
+ * buffer of interleaved complex samples. This lets several carriers be summed into the
+ * same wideband buffer.
+ *
+ * \param mod The modulator state
+ * \param baseband The modulating signal, normalized to [-1.0, 1.0]. If NULL, an
+ *                 unmodulated carrier is generated.
+ * \param nr_samples The number of samples to generate
+ * \param amplitude The amplitude of the carrier
+ * \param iq_out The interleaved complex output buffer. Must be 2 * nr_samples floats.
+ *
+ * \return A_OK on success, an error code otherwise.
+ */
+aresult_t synth_fm_mod_process(struct synth_fm_mod *mod, const float *baseband, size_t nr_samples,
+        float amplitude, float *iq_out);
+
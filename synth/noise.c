@@ -0,0 +1,94 @@
+/*
+ *  noise.c - Deterministic noise sources for signal synthesis
+ *
+ *  Copyright (c)2017 Phil Vachon <phil@security-embedded.com>
+ *
+ *  This file is a part of The Standard Library (TSL)
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ */
+
+#include <synth/noise.h>
+
+#include <tsl/errors.h>
+#include <tsl/assert.h>
+
+#include <math.h>
+
+#define SYNTH_NOISE_DEFAULT_SEED        0x9e3779b97f4a7c15ull
+
+aresult_t synth_noise_init(struct synth_noise *noise, uint64_t seed)
+{
+    TSL_ASSERT_ARG(NULL != noise);
+
+    noise->state = 0 == seed ? SYNTH_NOISE_DEFAULT_SEED : seed;
+    noise->spare = 0.0f;
+    noise->have_spare = false;
+
+    return A_OK;
+}
+
+uint32_t synth_noise_uniform(struct synth_noise *noise)
+{
+    uint64_t x = noise->state;
+
+    x ^= x >> 12;
+    x ^= x << 25;
+    x ^= x >> 27;
+    noise->state = x;
+
+    return (uint32_t)((x * 0x2545f4914f6cdd1dull) >> 32);
+}
+
+float synth_noise_gaussian(struct synth_noise *noise)
+{
+    float u1 = 0.0f,
+          u2 = 0.0f,
+          mag = 0.0f;
+
+    if (noise->have_spare) {
+        noise->have_spare = false;
+        return noise->spare;
+    }
+
+    /* Map to (0, 1] so the log never sees a zero */
+    u1 = ((float)synth_noise_uniform(noise) + 1.0f) / 4294967296.0f;
+    u2 = (float)synth_noise_uniform(noise) / 4294967296.0f;
+
+    mag = sqrtf(-2.0f * logf(u1));
+
+    noise->spare = mag * sinf(2.0f * (float)M_PI * u2);
+    noise->have_spare = true;
+
+    return mag * cosf(2.0f * (float)M_PI * u2);
+}
+
+aresult_t synth_noise_add_awgn(struct synth_noise *noise, float *samples, size_t nr_samples, float sigma)
+{
+    TSL_ASSERT_ARG(NULL != noise);
+    TSL_ASSERT_ARG(NULL != samples);
+
+    if (0.0f == sigma) {
+        goto done;
+    }
+
+    for (size_t i = 0; i < nr_samples; i++) {
+        samples[i] += sigma * synth_noise_gaussian(noise);
+    }
+
+done:
+    return A_OK;
+}
+
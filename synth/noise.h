@@ -0,0 +1,62 @@
+#pragma once
+
+#include <tsl/result.h>
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stddef.h>
+
+/**
+ * State for a deterministic noise source. The same seed always produces the same
+ * sequence of samples, so synthetic captures are reproducible run to run.
+ */
+struct synth_noise {
+    /**
+     * xorshift64* generator state. Never zero.
+     */
+    uint64_t state;
+
+    /**
+     * Box-Muller produces samples in pairs; this holds the second of the pair.
+     */
+    float spare;
+
+    /**
+     * Whether or not spare holds a valid sample
+     */
+    bool have_spare;
+};
+
+/**
+ * Initialize a noise source.
+ *
+ * \param noise The noise source state
+ * \param seed The seed for the generator. 0 is mapped to a fixed non-zero seed.
+ *
+ * \return A_OK on success, an error code otherwise.
+ */
+aresult_t synth_noise_init(struct synth_noise *noise, uint64_t seed);
+
+/**
+ * Get the next uniformly distributed 32-bit integer from the noise source.
+ */
+uint32_t synth_noise_uniform(struct synth_noise *noise);
+
+/**
+ * Get the next sample of zero-mean, unit-variance Gaussian noise.
+ */
+float synth_noise_gaussian(struct synth_noise *noise);
+
+/**
+ * Add white Gaussian noise with the given standard deviation to a buffer of samples. For
+ * complex samples, pass the interleaved buffer and twice the number of samples.
+ *
+ * \param noise The noise source state
+ * \param samples The samples to add noise to, in place
+ * \param nr_samples The number of floats in samples
+ * \param sigma The standard deviation of the noise to be added
+ *
+ * \return A_OK on success, an error code otherwise.
+ */
+aresult_t synth_noise_add_awgn(struct synth_noise *noise, float *samples, size_t nr_samples, float sigma);
+
@@ -0,0 +1,294 @@
+/*
+ *  pocsag_enc.c - POCSAG transmission encoder for signal synthesis
+ *
+ *  Copyright (c)2017 Phil Vachon <phil@security-embedded.com>
+ *
+ *  This file is a part of The Standard Library (TSL)
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ */
+
+#include <synth/pocsag_enc.h>
+#include <synth/bch_word.h>
+#include <synth/synth_priv.h>
+
+#include <pager/bch_code.h>
+
+#include <tsl/safe_alloc.h>
+#include <tsl/errors.h>
+#include <tsl/assert.h>
+
+#include <string.h>
+
+#define SYNTH_POCSAG_PREAMBLE_BITS      576
+#define SYNTH_POCSAG_SYNC_CODEWORD      0x7cd215d8ul
+#define SYNTH_POCSAG_IDLE_INFO          (0x6983915eul & 0x1ffffful)
+#define SYNTH_POCSAG_WORDS_PER_BATCH    16
+#define SYNTH_POCSAG_BITS_PER_BATCH     (32 + SYNTH_POCSAG_WORDS_PER_BATCH * 32)
+
+struct synth_pocsag_enc {
+    /**
+     * BCH(31,21) code, shared with the decoder implementation
+     */
+    struct bch_code *bch;
+
+    /**
+     * The encoded idle codeword
+     */
+    uint32_t idle_word;
+};
+
+aresult_t synth_pocsag_enc_new(struct synth_pocsag_enc **penc)
+{
+    aresult_t ret = A_OK;
+
+    static const int poly[6] = { 1, 0, 1, 0, 0, 1 };
+    struct synth_pocsag_enc *enc = NULL;
+
+    TSL_ASSERT_ARG(NULL != penc);
+
+    *penc = NULL;
+
+    if (FAILED(ret = TZAALLOC(enc, SYS_CACHE_LINE_LENGTH))) {
+        goto done;
+    }
+
+    if (FAILED(ret = bch_code_new(&enc->bch, poly, 5, 31, 21, 2))) {
+        goto done;
+    }
+
+    enc->idle_word = synth_bch_word_encode(enc->bch, SYNTH_POCSAG_IDLE_INFO);
+
+    *penc = enc;
+
+done:
+    if (FAILED(ret)) {
+        if (NULL != enc) {
+            TFREE(enc);
+        }
+    }
+    return ret;
+}
+
+aresult_t synth_pocsag_enc_delete(struct synth_pocsag_enc **penc)
+{
+    aresult_t ret = A_OK;
+
+    struct synth_pocsag_enc *enc = NULL;
+
+    TSL_ASSERT_ARG(NULL != penc);
+    TSL_ASSERT_ARG(NULL != *penc);
+
+    enc = *penc;
+
+    if (NULL != enc->bch) {
+        bch_code_delete(&enc->bch);
+    }
+
+    TFREE(enc);
+
+    *penc = NULL;
+
+    return ret;
+}
+
+/**
+ * Map a character to the BCD digit the decoder maps back to it. Anything not in the
+ * numeric character set becomes a space.
+ */
+static
+uint32_t _synth_pocsag_numeric_digit(char c)
+{
+    static const char charmap[] = "0123456789XU -[]";
+    const char *p = NULL;
+
+    if ('\0' == c || NULL == (p = strchr(charmap, c))) {
+        return 0xc;
+    }
+
+    return (uint32_t)(p - charmap);
+}
+
+/**
+ * Count the number of message codewords needed to carry the given page.
+ */
+static
+size_t _synth_pocsag_msg_words(const struct synth_pocsag_msg *msg)
+{
+    size_t len = NULL == msg->msg ? 0 : strlen(msg->msg);
+
+    switch (msg->type) {
+    case SYNTH_POCSAG_MSG_TYPE_ALPHA:
+        return (len * 7 + 19) / 20;
+    case SYNTH_POCSAG_MSG_TYPE_NUMERIC:
+        return (len * 4 + 19) / 20;
+    default:
+        return 0;
+    }
+}
+
+/**
+ * Pack the message body into the 20-bit payload of each codeword. Characters are packed
+ * first-bit-first, least significant bit first, exactly as the decoder unpacks them.
+ */
+static
+void _synth_pocsag_msg_encode(struct synth_pocsag_enc *enc, const struct synth_pocsag_msg *msg,
+        uint32_t *words, size_t nr_words)
+{
+    const char *body = msg->msg;
+    size_t len = NULL == body ? 0 : strlen(body),
+           next_char = 0;
+    unsigned char_bits = SYNTH_POCSAG_MSG_TYPE_ALPHA == msg->type ? 7 : 4;
+    uint64_t acc = 0;
+    unsigned acc_bits = 0;
+
+    for (size_t i = 0; i < nr_words; i++) {
+        while (acc_bits < 20) {
+            uint32_t c = 0;
+
+            if (SYNTH_POCSAG_MSG_TYPE_ALPHA == msg->type) {
+                /* Pad out with NUL, which the decoder treats as a possible terminator */
+                c = next_char < len ? (uint32_t)(body[next_char] & 0x7f) : 0;
+            } else {
+                c = _synth_pocsag_numeric_digit(next_char < len ? body[next_char] : '\0');
+            }
+
+            acc |= (uint64_t)c << acc_bits;
+            acc_bits += char_bits;
+            next_char++;
+        }
+
+        words[i] = synth_bch_word_encode(enc->bch, ((uint32_t)(acc & 0xfffff) << 1) | 1);
+        acc >>= 20;
+        acc_bits -= 20;
+    }
+}
+
+/**
+ * Render one codeword into the output levels. The sync codeword is sent most significant
+ * bit first; all other words are sent bit 0 first.
+ */
+static
+int8_t *_synth_pocsag_emit_word(int8_t *out, uint32_t word, bool msb_first)
+{
+    for (int i = 0; i < 32; i++) {
+        unsigned bit = msb_first ? (word >> (31 - i)) & 1 : (word >> i) & 1;
+        *out++ = bit ? -1 : 1;
+    }
+
+    return out;
+}
+
+aresult_t synth_pocsag_enc_transmission(struct synth_pocsag_enc *enc, const struct synth_pocsag_msg *msgs,
+        size_t nr_msgs, int8_t **plevels, size_t *pnr_levels)
+{
+    aresult_t ret = A_OK;
+
+    uint32_t *words = NULL;
+    int8_t *levels = NULL,
+           *out = NULL;
+    size_t max_words = 0,
+           nr_words = 0,
+           nr_batches = 0,
+           nr_levels = 0;
+
+    TSL_ASSERT_ARG(NULL != enc);
+    TSL_ASSERT_ARG(NULL != msgs || 0 == nr_msgs);
+    TSL_ASSERT_ARG(NULL != plevels);
+    TSL_ASSERT_ARG(NULL != pnr_levels);
+
+    *plevels = NULL;
+    *pnr_levels = 0;
+
+    /* Worst case: each page has to wait out a full batch to reach its frame */
+    for (size_t i = 0; i < nr_msgs; i++) {
+        max_words += SYNTH_POCSAG_WORDS_PER_BATCH + 1 + _synth_pocsag_msg_words(&msgs[i]);
+    }
+    max_words += 2 * SYNTH_POCSAG_WORDS_PER_BATCH;
+
+    if (FAILED(ret = TACALLOC((void **)&words, max_words, sizeof(uint32_t), SYS_CACHE_LINE_LENGTH))) {
+        goto done;
+    }
+
+    for (size_t i = 0; i < nr_msgs; i++) {
+        const struct synth_pocsag_msg *msg = &msgs[i];
+        size_t frame = msg->capcode & 0x7,
+               nr_msg_words = _synth_pocsag_msg_words(msg);
+        uint32_t addr = 0;
+
+        if (msg->capcode >= (1ul << 21) || msg->function > 3) {
+            SYN_MSG(SEV_WARNING, "BAD-PAGE", "Capcode %u, function %u can't be encoded, skipping.",
+                    msg->capcode, (unsigned)msg->function);
+            continue;
+        }
+
+        /* Idle until we reach the page's frame, in this batch or the next */
+        while ((nr_words % SYNTH_POCSAG_WORDS_PER_BATCH) / 2 != frame) {
+            words[nr_words++] = enc->idle_word;
+        }
+
+        /* The address field and function bits go where the decoder looks for them */
+        addr = ((msg->capcode >> 3) << 1) | ((uint32_t)msg->function << 19);
+        words[nr_words++] = synth_bch_word_encode(enc->bch, addr);
+
+        _synth_pocsag_msg_encode(enc, msg, &words[nr_words], nr_msg_words);
+        nr_words += nr_msg_words;
+    }
+
+    /* At least one idle word terminates the last page, then pad out the batch */
+    do {
+        words[nr_words++] = enc->idle_word;
+    } while (0 != nr_words % SYNTH_POCSAG_WORDS_PER_BATCH);
+
+    TSL_BUG_ON(nr_words > max_words);
+
+    nr_batches = nr_words / SYNTH_POCSAG_WORDS_PER_BATCH;
+    nr_levels = SYNTH_POCSAG_PREAMBLE_BITS + nr_batches * SYNTH_POCSAG_BITS_PER_BATCH;
+
+    if (FAILED(ret = TACALLOC((void **)&levels, nr_levels, sizeof(int8_t), SYS_CACHE_LINE_LENGTH))) {
+        goto done;
+    }
+
+    out = levels;
+
+    for (size_t i = 0; i < SYNTH_POCSAG_PREAMBLE_BITS; i++) {
+        *out++ = (i & 1) ? 1 : -1;
+    }
+
+    for (size_t i = 0; i < nr_batches; i++) {
+        out = _synth_pocsag_emit_word(out, SYNTH_POCSAG_SYNC_CODEWORD, true);
+        for (size_t j = 0; j < SYNTH_POCSAG_WORDS_PER_BATCH; j++) {
+            out = _synth_pocsag_emit_word(out, words[i * SYNTH_POCSAG_WORDS_PER_BATCH + j], false);
+        }
+    }
+
+    TSL_BUG_ON((size_t)(out - levels) != nr_levels);
+
+    *plevels = levels;
+    *pnr_levels = nr_levels;
+    levels = NULL;
+
+done:
+    if (NULL != words) {
+        TFREE(words);
+    }
+
+    if (NULL != levels) {
+        TFREE(levels);
+    }
+
+    return ret;
+}
+
@@ -0,0 +1,85 @@
+#pragma once
+
+#include <tsl/result.h>
+
+#include <stdint.h>
+#include <stddef.h>
+
+struct synth_pocsag_enc;
+
+enum synth_pocsag_msg_type {
+    /**
+     * Address only, no message words
+     */
+    SYNTH_POCSAG_MSG_TYPE_TONE,
+
+    /**
+     * 4-bit BCD numeric message
+     */
+    SYNTH_POCSAG_MSG_TYPE_NUMERIC,
+
+    /**
+     * 7-bit ASCII alphanumeric message
+     */
+    SYNTH_POCSAG_MSG_TYPE_ALPHA,
+};
+
+/**
+ * A POCSAG page to be encoded
+ */
+struct synth_pocsag_msg {
+    /**
+     * The CAPcode to deliver the page to. The low 3 bits select the frame in the batch.
+     */
+    uint32_t capcode;
+
+    /**
+     * The function code, [0, 3]
+     */
+    uint8_t function;
+
+    /**
+     * How the message body is to be encoded
+     */
+    enum synth_pocsag_msg_type type;
+
+    /**
+     * The message body, NUL-terminated. Ignored for tone-only pages.
+     */
+    const char *msg;
+};
+
+/**
+ * Create a new POCSAG encoder.
+ *
+ * \param penc The new encoder. Returned by reference.
+ *
+ * \return A_OK on success, an error code otherwise.
+ */
+aresult_t synth_pocsag_enc_new(struct synth_pocsag_enc **penc);
+
+/**
+ * Destroy a POCSAG encoder.
+ *
+ * \param penc The encoder, passed by reference. Set to NULL on success.
+ *
+ * \return A_OK on success, an error code otherwise.
+ */
+aresult_t synth_pocsag_enc_delete(struct synth_pocsag_enc **penc);
+
+/**
+ * Encode a complete POCSAG transmission: the preamble, followed by as many batches as are
+ * needed to carry the given pages. The result is one symbol level per bit, -1 for a 1 and +1
+ * for a 0, to be rendered at the desired baud rate.
+ *
+ * \param enc The encoder
+ * \param msgs The pages to encode
+ * \param nr_msgs The number of pages
+ * \param plevels The symbol levels. Allocated by this function, free with TFREE.
+ * \param pnr_levels The number of symbol levels. Returned by reference.
+ *
+ * \return A_OK on success, an error code otherwise.
+ */
+aresult_t synth_pocsag_enc_transmission(struct synth_pocsag_enc *enc, const struct synth_pocsag_msg *msgs,
+        size_t nr_msgs, int8_t **plevels, size_t *pnr_levels);
+
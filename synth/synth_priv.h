@@ -0,0 +1,6 @@
+#pragma once
+
+#include <tsl/diag.h>
+
+#define SYN_MSG(sev, sys, msg, ...) MESSAGE("SYNTH", sev, sys, msg, ##__VA_ARGS__)
+
@@ -0,0 +1,92 @@
+#include <synth/noise.h>
+#include <synth/fm_mod.h>
+#include <synth/baseband.h>
+
+#include <test/assert.h>
+#include <test/framework.h>
+
+#include <math.h>
+#include <string.h>
+
+static
+aresult_t test_synth_setup(void)
+{
+    return A_OK;
+}
+
+static
+aresult_t test_synth_cleanup(void)
+{
+    return A_OK;
+}
+
+TEST_DECLARE_UNIT(test_noise_repeatable, synth)
+{
+    struct synth_noise a,
+                       b;
+    double sum = 0.0,
+           sum_sq = 0.0;
+
+    TEST_ASSERT_OK(synth_noise_init(&a, 42));
+    TEST_ASSERT_OK(synth_noise_init(&b, 42));
+
+    for (size_t i = 0; i < 16384; i++) {
+        float x = synth_noise_gaussian(&a);
+        TEST_ASSERT_EQUALS(x, synth_noise_gaussian(&b));
+        sum += x;
+        sum_sq += x * x;
+    }
+
+    /* Check the noise is roughly zero mean, unit variance */
+    TEST_ASSERT_EQUALS(true, fabs(sum/16384.0) < 0.05);
+    TEST_ASSERT_EQUALS(true, fabs(sum_sq/16384.0 - 1.0) < 0.05);
+
+    return A_OK;
+}
+
+TEST_DECLARE_UNIT(test_fm_mod_offset, synth)
+{
+    struct synth_fm_mod mod;
+    float iq[2 * 64];
+
+    memset(iq, 0, sizeof(iq));
+
+    /* An unmodulated carrier at fs/8 advances by pi/4 each sample */
+    TEST_ASSERT_OK(synth_fm_mod_init(&mod, 8000, 1000, 0));
+    TEST_ASSERT_OK(synth_fm_mod_process(&mod, NULL, 64, 1.0f, iq));
+
+    for (size_t i = 0; i < 64; i++) {
+        TEST_ASSERT_EQUALS(true, fabsf(iq[2 * i] - (float)cos(M_PI/4.0 * i)) < 1e-4f);
+        TEST_ASSERT_EQUALS(true, fabsf(iq[2 * i + 1] - (float)sin(M_PI/4.0 * i)) < 1e-4f);
+    }
+
+    return A_OK;
+}
+
+TEST_DECLARE_UNIT(test_fsk_fractional, synth)
+{
+    static const int8_t levels[] = { 1, -1, 1, -1 };
+    float out[16];
+    size_t nr_generated = 0,
+           nr_high = 0;
+
+    /* 2.5 samples per symbol should give a 3/2/3/2 pattern */
+    TEST_ASSERT_OK(synth_fsk_generate(out, 16, 2.5, levels, 4, 1.0f, &nr_generated));
+    TEST_ASSERT_EQUALS(nr_generated, 10);
+
+    for (size_t i = 0; i < nr_generated; i++) {
+        if (out[i] > 0.0f) {
+            nr_high++;
+        }
+    }
+
+    TEST_ASSERT_EQUALS(nr_high, 6);
+    TEST_ASSERT_EQUALS(out[2], 1.0f);
+    TEST_ASSERT_EQUALS(out[3], -1.0f);
+    TEST_ASSERT_EQUALS(out[5], 1.0f);
+
+    return A_OK;
+}
+
+TEST_DECLARE_SUITE(synth, test_synth_cleanup, test_synth_setup, NULL, NULL);
+
@@ -0,0 +1,293 @@
+#include <synth/pocsag_enc.h>
+#include <synth/flex_enc.h>
+#include <synth/ais_enc.h>
+#include <synth/channel.h>
+
+#include <pager/pager_pocsag.h>
+#include <pager/pager_flex.h>
+#include <ais/ais_demod.h>
+#include <ais/ais_decode.h>
+
+#include <test/assert.h>
+#include <test/framework.h>
+
+#include <tsl/safe_alloc.h>
+
+#include <math.h>
+#include <string.h>
+
+#define TEST_MAX_MSGS           8
+
+struct test_rx_msg {
+    uint64_t capcode;
+    char msg[256];
+};
+
+static
+struct test_rx_msg rx_msgs[TEST_MAX_MSGS];
+
+static
+size_t nr_rx_msgs = 0;
+
+static
+uint8_t rx_packet[64];
+
+static
+size_t rx_packet_len = 0;
+
+static
+void _test_rx_record(uint64_t capcode, const char *data, size_t data_len)
+{
+    struct test_rx_msg *msg = NULL;
+
+    if (nr_rx_msgs == TEST_MAX_MSGS) {
+        return;
+    }
+
+    msg = &rx_msgs[nr_rx_msgs++];
+    msg->capcode = capcode;
+    memset(msg->msg, 0, sizeof(msg->msg));
+    memcpy(msg->msg, data, data_len < sizeof(msg->msg) - 1 ? data_len : sizeof(msg->msg) - 1);
+}
+
+static
+aresult_t _test_pocsag_on_msg(struct pager_pocsag *pocsag, uint16_t baud_rate, uint32_t capcode,
+        const char *data, size_t data_len, uint8_t function)
+{
+    _test_rx_record(capcode, data, data_len);
+    return A_OK;
+}
+
+static
+aresult_t _test_flex_on_alnum(struct pager_flex *flex, uint16_t baud, uint8_t phase, uint8_t cycle_no,
+        uint8_t frame_no, uint64_t cap_code, bool fragmented, bool maildrop, uint8_t seq_num,
+        const char *message_bytes, size_t message_len)
+{
+    _test_rx_record(cap_code, message_bytes, message_len);
+    return A_OK;
+}
+
+static
+aresult_t _test_flex_on_num(struct pager_flex *flex, uint16_t baud, uint8_t phase, uint8_t cycle_no,
+        uint8_t frame_no, uint64_t cap_code, const char *message_bytes, size_t message_len)
+{
+    _test_rx_record(cap_code, message_bytes, message_len);
+    return A_OK;
+}
+
+static
+aresult_t _test_flex_on_siv(struct pager_flex *flex, uint16_t baud, uint8_t phase, uint8_t cycle_no,
+        uint8_t frame_no, uint64_t cap_code, uint8_t siv_msg_type, uint32_t data)
+{
+    return A_OK;
+}
+
+static
+aresult_t _test_ais_on_msg(struct ais_demod *demod, void *state, const uint8_t *packet, size_t packet_len,
+        bool fcs_valid)
+{
+    if (fcs_valid && packet_len <= sizeof(rx_packet)) {
+        memcpy(rx_packet, packet, packet_len);
+        rx_packet_len = packet_len;
+    }
+    return A_OK;
+}
+
+/**
+ * Render the levels through the channel, with a symbol of silence either side.
+ */
+static
+aresult_t _test_render(struct synth_channel *chan, const int8_t *levels, size_t nr_levels, int16_t **ppcm,
+        size_t *pnr_samples)
+{
+    aresult_t ret = A_OK;
+
+    int8_t *padded = NULL;
+    size_t nr_padded = nr_levels + 64,
+           nr_out = 0;
+
+    TEST_ASSERT_OK(TACALLOC((void **)&padded, nr_padded, sizeof(int8_t), 0));
+    memcpy(&padded[32], levels, nr_levels);
+
+    nr_out = synth_channel_nr_samples(chan, nr_padded);
+    TEST_ASSERT_OK(TACALLOC((void **)ppcm, nr_out, sizeof(int16_t), 0));
+    TEST_ASSERT_OK(synth_channel_render_pcm(chan, padded, nr_padded, *ppcm, nr_out, pnr_samples));
+
+    TFREE(padded);
+
+    return ret;
+}
+
+static
+aresult_t test_synth_round_trip_setup(void)
+{
+    return A_OK;
+}
+
+static
+aresult_t test_synth_round_trip_cleanup(void)
+{
+    return A_OK;
+}
+
+TEST_DECLARE_UNIT(test_pocsag_round_trip, synth_round_trip)
+{
+    static const uint16_t bauds[] = { 512, 1200, 2400 };
+    /* The default rate, and the lowest, with 4 samples per bit at 2400bps */
+    static const uint32_t rates[] = { 38400, 9600 };
+    static const struct synth_pocsag_msg msgs[] = {
+        { .capcode = 1234567, .function = 3, .type = SYNTH_POCSAG_MSG_TYPE_ALPHA, .msg = "TEST PAGE 1: ROOM 12 CALL 5555" },
+        { .capcode = 42, .function = 3, .type = SYNTH_POCSAG_MSG_TYPE_ALPHA, .msg = "Hello, world" },
+    };
+    struct synth_pocsag_enc *enc = NULL;
+    int8_t *levels = NULL;
+    size_t nr_levels = 0;
+
+    TEST_ASSERT_OK(synth_pocsag_enc_new(&enc));
+    TEST_ASSERT_OK(synth_pocsag_enc_transmission(enc, msgs, 2, &levels, &nr_levels));
+
+    for (size_t i = 0; i < sizeof(bauds)/sizeof(bauds[0]) * sizeof(rates)/sizeof(rates[0]); i++) {
+        struct pager_pocsag *pocsag = NULL;
+        struct synth_channel chan;
+        uint16_t baud = bauds[i % (sizeof(bauds)/sizeof(bauds[0]))];
+        uint32_t rate = rates[i / (sizeof(bauds)/sizeof(bauds[0]))];
+        int16_t *pcm = NULL;
+        size_t nr_samples = 0;
+
+        TEST_ASSERT_OK(synth_channel_init(&chan, rate, baud, 4500, 1 + i));
+        chan.drift_ppm = 50.0;
+        chan.add_noise = true;
+        chan.snr_db = 12.0;
+
+        TEST_ASSERT_OK(_test_render(&chan, levels, nr_levels, &pcm, &nr_samples));
+
+        nr_rx_msgs = 0;
+        TEST_ASSERT_OK(pager_pocsag_new(&pocsag, 0, _test_pocsag_on_msg, _test_pocsag_on_msg));
+        TEST_ASSERT_EQUALS(true, FAILED(pager_pocsag_set_sample_rate(pocsag, 4800)));
+        TEST_ASSERT_OK(pager_pocsag_set_sample_rate(pocsag, rate));
+        TEST_ASSERT_OK(pager_pocsag_on_pcm(pocsag, pcm, nr_samples));
+        TEST_ASSERT_OK(pager_pocsag_delete(&pocsag));
+
+        TEST_ASSERT_EQUALS(nr_rx_msgs, 2);
+        for (size_t j = 0; j < 2; j++) {
+            TEST_ASSERT_EQUALS(rx_msgs[j].capcode, msgs[j].capcode);
+            TEST_ASSERT_EQUALS(0, strncmp(rx_msgs[j].msg, msgs[j].msg, strlen(msgs[j].msg)));
+        }
+
+        TFREE(pcm);
+    }
+
+    TFREE(levels);
+    TEST_ASSERT_OK(synth_pocsag_enc_delete(&enc));
+
+    return A_OK;
+}
+
+TEST_DECLARE_UNIT(test_flex_round_trip, synth_round_trip)
+{
+    static const struct synth_flex_msg msgs[] = {
+        { .capcode = 1234567, .type = SYNTH_FLEX_MSG_TYPE_ALPHA, .msg = "FLEX alpha page, phase one" },
+        { .capcode = 2000, .type = SYNTH_FLEX_MSG_TYPE_NUMERIC, .msg = "5551234" },
+        { .capcode = 777777, .type = SYNTH_FLEX_MSG_TYPE_ALPHA, .msg = "Third" },
+        { .capcode = 31337, .type = SYNTH_FLEX_MSG_TYPE_ALPHA, .msg = "Fourth page" },
+    };
+    /* The default rate, and the lowest, with 4 samples per symbol at 3200 symbols/s */
+    static const uint32_t rates[] = { 16000, 12800 };
+    struct synth_flex_enc *enc = NULL;
+
+    TEST_ASSERT_OK(synth_flex_enc_new(&enc));
+
+    for (int n = 0; n < 2 * (SYNTH_FLEX_SPEED_6400_4FSK + 1); n++) {
+        struct pager_flex *flex = NULL;
+        struct synth_channel chan;
+        int speed = n % (SYNTH_FLEX_SPEED_6400_4FSK + 1);
+        uint32_t rate = rates[n / (SYNTH_FLEX_SPEED_6400_4FSK + 1)];
+        int8_t *levels = NULL;
+        int16_t *pcm = NULL;
+        size_t nr_levels = 0,
+               nr_samples = 0;
+
+        TEST_ASSERT_OK(synth_flex_enc_frame(enc, speed, 3, 42, msgs, 4, &levels, &nr_levels));
+
+        TEST_ASSERT_OK(synth_channel_init(&chan, rate, SYNTH_FLEX_SYMBOL_RATE, SYNTH_FLEX_LEVEL_DEVIATION_HZ, 7));
+        chan.add_noise = true;
+        chan.snr_db = 25.0;
+
+        TEST_ASSERT_OK(_test_render(&chan, levels, nr_levels, &pcm, &nr_samples));
+
+        nr_rx_msgs = 0;
+        TEST_ASSERT_OK(pager_flex_new(&flex, 0, _test_flex_on_alnum, _test_flex_on_num, _test_flex_on_siv));
+        TEST_ASSERT_EQUALS(true, FAILED(pager_flex_set_sample_rate(flex, 12000)));
+        TEST_ASSERT_OK(pager_flex_set_sample_rate(flex, rate));
+        TEST_ASSERT_OK(pager_flex_on_pcm(flex, pcm, nr_samples));
+        TEST_ASSERT_OK(pager_flex_delete(&flex));
+
+        TEST_ASSERT_EQUALS(nr_rx_msgs, 4);
+        for (size_t i = 0; i < 4; i++) {
+            bool found = false;
+            for (size_t j = 0; j < nr_rx_msgs; j++) {
+                if (rx_msgs[j].capcode == msgs[i].capcode) {
+                    TEST_ASSERT_EQUALS(0, strncmp(rx_msgs[j].msg, msgs[i].msg, strlen(msgs[i].msg)));
+                    found = true;
+                }
+            }
+            TEST_ASSERT_EQUALS(true, found);
+        }
+
+        TFREE(pcm);
+        TFREE(levels);
+    }
+
+    TEST_ASSERT_OK(synth_flex_enc_delete(&enc));
+
+    return A_OK;
+}
+
+TEST_DECLARE_UNIT(test_ais_round_trip, synth_round_trip)
+{
+    struct ais_position_report rpt;
+    struct ais_demod *demod = NULL;
+    struct synth_channel chan;
+    uint8_t packet[SYNTH_AIS_POSITION_REPORT_BYTES];
+    int8_t *levels = NULL;
+    int16_t *pcm = NULL;
+    size_t nr_levels = 0,
+           nr_samples = 0;
+
+    memset(&rpt, 0, sizeof(rpt));
+    rpt.mmsi = 316001234;
+    rpt.nav_stat = 5;
+    rpt.speed_over_ground = 12.3f;
+    rpt.longitude = -123.1234f;
+    rpt.latitude = 49.2827f;
+    rpt.course = 1234;
+    rpt.heading = 123;
+    rpt.timestamp = 42;
+
+    TEST_ASSERT_OK(synth_ais_position_report_pack(1, &rpt, packet, sizeof(packet)));
+    TEST_ASSERT_EQUALS(packet[0] >> 2, 1);
+
+    TEST_ASSERT_OK(synth_ais_enc_frame(packet, sizeof(packet), &levels, &nr_levels));
+
+    TEST_ASSERT_OK(synth_channel_init(&chan, 48000, SYNTH_AIS_BIT_RATE, SYNTH_AIS_LEVEL_DEVIATION_HZ, 3));
+    chan.add_noise = true;
+    chan.snr_db = 15.0;
+
+    TEST_ASSERT_OK(_test_render(&chan, levels, nr_levels, &pcm, &nr_samples));
+
+    rx_packet_len = 0;
+    TEST_ASSERT_OK(ais_demod_new(&demod, NULL, _test_ais_on_msg, 0));
+    TEST_ASSERT_OK(ais_demod_on_pcm(demod, pcm, nr_samples));
+    TEST_ASSERT_OK(ais_demod_delete(&demod));
+
+    TEST_ASSERT_EQUALS(rx_packet_len, sizeof(packet));
+    TEST_ASSERT_EQUALS(0, memcmp(rx_packet, packet, sizeof(packet)));
+
+    TFREE(pcm);
+    TFREE(levels);
+
+    return A_OK;
+}
+
+TEST_DECLARE_SUITE(synth_round_trip, test_synth_round_trip_cleanup, test_synth_round_trip_setup, NULL, NULL);
+
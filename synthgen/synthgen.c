@@ -0,0 +1,542 @@
+/*
+ *  synthgen.c - Generate synthetic FLEX, POCSAG and AIS signal corpora
+ *
+ *  Copyright (c)2017 Phil Vachon <phil@security-embedded.com>
+ *
+ *  This file is a part of The Standard Library (TSL)
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ */
+#include <synth/pocsag_enc.h>
+#include <synth/flex_enc.h>
+#include <synth/ais_enc.h>
+#include <synth/channel.h>
+
+#include <ais/ais_decode.h>
+
+#include <app/app.h>
+
+#include <tsl/diag.h>
+#include <tsl/errors.h>
+#include <tsl/assert.h>
+#include <tsl/safe_alloc.h>
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <string.h>
+
+#define SGEN_MSG(sev, sys, msg, ...) MESSAGE("SYNTHGEN", sev, sys, msg, ##__VA_ARGS__)
+
+/**
+ * Maximum number of messages that can be loaded from a message file
+ */
+#define SYNTHGEN_MAX_MSGS           1024
+
+/**
+ * Maximum length of a single message, in characters
+ */
+#define SYNTHGEN_MAX_MSG_LEN        255
+
+enum synthgen_proto_type {
+    SYNTHGEN_PROTO_FLEX = 0,
+    SYNTHGEN_PROTO_POCSAG = 1,
+    SYNTHGEN_PROTO_AIS = 2,
+};
+
+/**
+ * A message loaded from the message file, or generated. Each protocol uses the fields it needs.
+ */
+struct synthgen_msg {
+    uint32_t address;
+    char type;
+    char text[SYNTHGEN_MAX_MSG_LEN + 1];
+    struct ais_position_report rpt;
+};
+
+static
+enum synthgen_proto_type _proto = SYNTHGEN_PROTO_FLEX;
+
+static
+const char *_baud = NULL;
+
+static
+unsigned sample_rate = 0;
+
+static
+bool _iq_output = false;
+
+static
+bool _add_noise = false;
+
+static
+double snr_db = 0.0;
+
+static
+int32_t freq_offset_hz = 0;
+
+static
+double drift_ppm = 0.0;
+
+static
+uint64_t seed = 1;
+
+static
+unsigned repeat = 1;
+
+static
+unsigned gap_ms = 100;
+
+static
+unsigned nr_gen_msgs = 4;
+
+static
+int out_fd = -1;
+
+static
+struct synthgen_msg *msgs = NULL;
+
+static
+size_t nr_msgs = 0;
+
+static
+void _usage(const char *appname)
+{
+    SGEN_MSG(SEV_INFO, "USAGE", "%s -m [proto] [-b baud] [-S sample rate] [-M message file] [-R repeat] [-n SNR dB] [-O offset Hz] [-P drift ppm] [-q] [out_file]",
+            appname);
+    SGEN_MSG(SEV_INFO, "USAGE", "        -m [type] Specify protocol to generate               ");
+    SGEN_MSG(SEV_INFO, "USAGE", "           POCSAG - the POCSAG pager protocol                ");
+    SGEN_MSG(SEV_INFO, "USAGE", "           FLEX   - Motorola FLEX pager protocol             ");
+    SGEN_MSG(SEV_INFO, "USAGE", "           AIS    - Automatic Identification System          ");
+    SGEN_MSG(SEV_INFO, "USAGE", "        -b [baud] POCSAG: 512, 1200, 2400                    ");
+    SGEN_MSG(SEV_INFO, "USAGE", "                  FLEX: 1600/2, 3200/2, 3200/4, 6400/4       ");
+    SGEN_MSG(SEV_INFO, "USAGE", "        -M [file] Messages, one per line:                    ");
+    SGEN_MSG(SEV_INFO, "USAGE", "                  pagers: [capcode] [A|N|T] [message]        ");
+    SGEN_MSG(SEV_INFO, "USAGE", "                  AIS: [mmsi] [lat] [lon] [SoG] [CoG]        ");
+    SGEN_MSG(SEV_INFO, "USAGE", "        -c [nr]   Number of messages to make up, if no -M    ");
+    SGEN_MSG(SEV_INFO, "USAGE", "        -R [nr]   Number of times to repeat the transmission ");
+    SGEN_MSG(SEV_INFO, "USAGE", "        -g [ms]   Gap between transmissions                  ");
+    SGEN_MSG(SEV_INFO, "USAGE", "        -n [dB]   Add white noise at the given SNR           ");
+    SGEN_MSG(SEV_INFO, "USAGE", "        -O [Hz]   Carrier frequency offset                   ");
+    SGEN_MSG(SEV_INFO, "USAGE", "        -P [ppm]  Transmitter symbol clock error             ");
+    SGEN_MSG(SEV_INFO, "USAGE", "        -r [seed] Random seed for noise                      ");
+    SGEN_MSG(SEV_INFO, "USAGE", "        -q        Write FM modulated complex int16 (I/Q)     ");
+    exit(EXIT_SUCCESS);
+}
+
+static
+void _load_messages(const char *file_name)
+{
+    FILE *fp = NULL;
+    char line[SYNTHGEN_MAX_MSG_LEN + 64];
+    size_t line_no = 0;
+
+    if (NULL == (fp = fopen(file_name, "r"))) {
+        int errnum = errno;
+        SGEN_MSG(SEV_FATAL, "BAD-MSG-FILE", "Failed to open message file '%s': %s (%d)", file_name,
+                strerror(errnum), errnum);
+        exit(EXIT_FAILURE);
+    }
+
+    while (NULL != fgets(line, sizeof(line), fp) && nr_msgs < SYNTHGEN_MAX_MSGS) {
+        struct synthgen_msg *msg = &msgs[nr_msgs];
+        char *cur = line,
+             *end = NULL;
+
+        line_no++;
+
+        /* Strip the trailing newline, skip blank lines and comments */
+        line[strcspn(line, "\r\n")] = '\0';
+        if ('\0' == line[0] || '#' == line[0]) {
+            continue;
+        }
+
+        msg->address = strtoul(cur, &end, 0);
+        if (end == cur) {
+            SGEN_MSG(SEV_WARNING, "BAD-MSG-LINE", "%s:%zu: missing address, skipping", file_name, line_no);
+            continue;
+        }
+        cur = end;
+
+        if (SYNTHGEN_PROTO_AIS == _proto) {
+            msg->rpt.mmsi = msg->address;
+            msg->rpt.latitude = strtof(cur, &cur);
+            msg->rpt.longitude = strtof(cur, &cur);
+            msg->rpt.speed_over_ground = strtof(cur, &cur);
+            msg->rpt.course = (uint32_t)(strtod(cur, &cur) * 10.0);
+            msg->rpt.heading = msg->rpt.course / 10;
+            msg->rpt.rate_of_turn = -128;
+        } else {
+            while (' ' == *cur || '\t' == *cur) {
+                cur++;
+            }
+
+            msg->type = *cur;
+            if ('A' != msg->type && 'N' != msg->type && 'T' != msg->type) {
+                SGEN_MSG(SEV_WARNING, "BAD-MSG-LINE", "%s:%zu: unknown message type '%c', skipping",
+                        file_name, line_no, msg->type);
+                continue;
+            }
+
+            if ('\0' != *cur) {
+                cur++;
+            }
+            if (' ' == *cur) {
+                cur++;
+            }
+
+            strncpy(msg->text, cur, SYNTHGEN_MAX_MSG_LEN);
+            msg->text[SYNTHGEN_MAX_MSG_LEN] = '\0';
+        }
+
+        nr_msgs++;
+    }
+
+    fclose(fp);
+
+    if (0 == nr_msgs) {
+        SGEN_MSG(SEV_FATAL, "NO-MESSAGES", "No messages found in '%s', aborting.", file_name);
+        exit(EXIT_FAILURE);
+    }
+}
+
+static
+void _generate_messages(void)
+{
+    for (size_t i = 0; i < nr_gen_msgs && i < SYNTHGEN_MAX_MSGS; i++) {
+        struct synthgen_msg *msg = &msgs[nr_msgs++];
+
+        msg->address = 1000 + 1117 * i;
+        msg->type = 'A';
+        snprintf(msg->text, sizeof(msg->text), "SYNTHETIC TEST PAGE %zu TO %u", i, msg->address);
+
+        msg->rpt.mmsi = 316000000 + i;
+        msg->rpt.nav_stat = 0;
+        msg->rpt.rate_of_turn = -128;
+        msg->rpt.speed_over_ground = 0.5f * (float)(i % 40);
+        msg->rpt.latitude = 49.0f + 0.01f * (float)i;
+        msg->rpt.longitude = -123.0f - 0.01f * (float)i;
+        msg->rpt.course = (i * 150) % 3600;
+        msg->rpt.heading = msg->rpt.course / 10;
+        msg->rpt.timestamp = i % 60;
+    }
+}
+
+static
+void _set_options(int argc, char * const argv[])
+{
+    int arg = -1;
+    const char *msg_file = NULL;
+
+    while ((arg = getopt(argc, argv, "m:b:S:M:c:R:g:n:O:P:r:qh")) != -1) {
+        switch (arg) {
+        case 'm':
+            if (!strncasecmp(optarg, "pocsag", 6)) {
+                _proto = SYNTHGEN_PROTO_POCSAG;
+            } else if (!strncasecmp(optarg, "flex", 4)) {
+                _proto = SYNTHGEN_PROTO_FLEX;
+            } else if (!strncasecmp(optarg, "ais", 3)) {
+                _proto = SYNTHGEN_PROTO_AIS;
+            } else {
+                SGEN_MSG(SEV_ERROR, "UNKNOWN-PROTOCOL-TYPE", "Unknown protocol type specified: %s", optarg);
+                exit(EXIT_FAILURE);
+            }
+            break;
+        case 'b':
+            _baud = optarg;
+            break;
+        case 'S':
+            sample_rate = strtoul(optarg, NULL, 0);
+            break;
+        case 'M':
+            msg_file = optarg;
+            break;
+        case 'c':
+            nr_gen_msgs = strtoul(optarg, NULL, 0);
+            break;
+        case 'R':
+            repeat = strtoul(optarg, NULL, 0);
+            break;
+        case 'g':
+            gap_ms = strtoul(optarg, NULL, 0);
+            break;
+        case 'n':
+            _add_noise = true;
+            snr_db = strtod(optarg, NULL);
+            break;
+        case 'O':
+            freq_offset_hz = strtol(optarg, NULL, 0);
+            break;
+        case 'P':
+            drift_ppm = strtod(optarg, NULL);
+            break;
+        case 'r':
+            seed = strtoull(optarg, NULL, 0);
+            break;
+        case 'q':
+            _iq_output = true;
+            break;
+        case 'h':
+            _usage(argv[0]);
+            break;
+        }
+    }
+
+    if (0 == sample_rate) {
+        switch (_proto) {
+        case SYNTHGEN_PROTO_FLEX:
+            sample_rate = 16000;
+            break;
+        case SYNTHGEN_PROTO_POCSAG:
+            sample_rate = 38400;
+            break;
+        case SYNTHGEN_PROTO_AIS:
+            sample_rate = 48000;
+            break;
+        }
+    }
+
+    TSL_BUG_IF_FAILED(TCALLOC((void **)&msgs, sizeof(struct synthgen_msg), SYNTHGEN_MAX_MSGS));
+
+    if (NULL != msg_file) {
+        _load_messages(msg_file);
+    } else {
+        _generate_messages();
+    }
+
+    if (optind < argc) {
+        if (0 > (out_fd = open(argv[optind], O_WRONLY | O_CREAT | O_TRUNC, 0666))) {
+            int errnum = errno;
+            SGEN_MSG(SEV_FATAL, "BAD-OUTPUT-FILE", "Failed to open output file '%s': %s (%d)", argv[optind],
+                    strerror(errnum), errnum);
+            exit(EXIT_FAILURE);
+        }
+    } else {
+        SGEN_MSG(SEV_INFO, "WRITE-TO-STDOUT", "Writing samples to stdout.");
+        out_fd = STDOUT_FILENO;
+    }
+}
+
+/**
+ * Encode a single transmission, returning its symbol levels and the channel parameters
+ * needed to render it.
+ */
+static
+aresult_t _encode_transmission(unsigned iter, int8_t **plevels, size_t *pnr_levels, double *psymbol_rate,
+        uint32_t *pdeviation_hz)
+{
+    aresult_t ret = A_OK;
+
+    switch (_proto) {
+    case SYNTHGEN_PROTO_POCSAG: {
+            static struct synth_pocsag_enc *enc = NULL;
+            static struct synth_pocsag_msg pmsgs[SYNTHGEN_MAX_MSGS];
+
+            if (NULL == enc) {
+                TSL_BUG_IF_FAILED(synth_pocsag_enc_new(&enc));
+            }
+
+            for (size_t i = 0; i < nr_msgs; i++) {
+                pmsgs[i].capcode = msgs[i].address;
+                pmsgs[i].function = 3;
+                pmsgs[i].msg = msgs[i].text;
+                switch (msgs[i].type) {
+                case 'N':
+                    pmsgs[i].type = SYNTH_POCSAG_MSG_TYPE_NUMERIC;
+                    break;
+                case 'T':
+                    pmsgs[i].type = SYNTH_POCSAG_MSG_TYPE_TONE;
+                    break;
+                default:
+                    pmsgs[i].type = SYNTH_POCSAG_MSG_TYPE_ALPHA;
+                }
+            }
+
+            *psymbol_rate = NULL == _baud ? 1200 : strtoul(_baud, NULL, 0);
+            *pdeviation_hz = 4500;
+            ret = synth_pocsag_enc_transmission(enc, pmsgs, nr_msgs, plevels, pnr_levels);
+        }
+        break;
+
+    case SYNTHGEN_PROTO_FLEX: {
+            static struct synth_flex_enc *enc = NULL;
+            static struct synth_flex_msg fmsgs[SYNTHGEN_MAX_MSGS];
+            enum synth_flex_speed speed = SYNTH_FLEX_SPEED_1600_2FSK;
+
+            if (NULL == enc) {
+                TSL_BUG_IF_FAILED(synth_flex_enc_new(&enc));
+            }
+
+            if (NULL != _baud && FAILED(synth_flex_speed_parse(_baud, &speed))) {
+                SGEN_MSG(SEV_FATAL, "BAD-SPEED", "Unknown FLEX speed '%s'", _baud);
+                exit(EXIT_FAILURE);
+            }
+
+            for (size_t i = 0; i < nr_msgs; i++) {
+                fmsgs[i].capcode = msgs[i].address;
+                fmsgs[i].type = 'N' == msgs[i].type ? SYNTH_FLEX_MSG_TYPE_NUMERIC : SYNTH_FLEX_MSG_TYPE_ALPHA;
+                fmsgs[i].msg = msgs[i].text;
+            }
+
+            *psymbol_rate = SYNTH_FLEX_SYMBOL_RATE;
+            *pdeviation_hz = SYNTH_FLEX_LEVEL_DEVIATION_HZ;
+            ret = synth_flex_enc_frame(enc, speed, (iter / 128) % 15, iter % 128, fmsgs, nr_msgs, plevels,
+                    pnr_levels);
+        }
+        break;
+
+    case SYNTHGEN_PROTO_AIS: {
+            uint8_t packet[SYNTH_AIS_POSITION_REPORT_BYTES];
+            struct synthgen_msg *msg = &msgs[iter % nr_msgs];
+
+            TSL_BUG_IF_FAILED(synth_ais_position_report_pack(1, &msg->rpt, packet, sizeof(packet)));
+
+            *psymbol_rate = SYNTH_AIS_BIT_RATE;
+            *pdeviation_hz = SYNTH_AIS_LEVEL_DEVIATION_HZ;
+            ret = synth_ais_enc_frame(packet, sizeof(packet), plevels, pnr_levels);
+        }
+        break;
+    }
+
+    return ret;
+}
+
+static
+aresult_t _write_samples(const int16_t *samples, size_t nr_bytes)
+{
+    aresult_t ret = A_OK;
+
+    const uint8_t *buf = (const uint8_t *)samples;
+    size_t written = 0;
+
+    while (written < nr_bytes) {
+        ssize_t op_ret = write(out_fd, buf + written, nr_bytes - written);
+
+        if (0 > op_ret) {
+            int errnum = errno;
+            SGEN_MSG(SEV_FATAL, "WRITE-FAIL", "Failed to write samples: %s (%d)", strerror(errnum), errnum);
+            ret = A_E_INVAL;
+            goto done;
+        }
+
+        written += op_ret;
+    }
+
+done:
+    return ret;
+}
+
+static
+aresult_t generate_corpus(void)
+{
+    aresult_t ret = A_OK;
+
+    struct synth_channel chan;
+    bool chan_ready = false;
+    uint64_t nr_total_samples = 0;
+
+    for (unsigned i = 0; i < repeat && app_running(); i++) {
+        int8_t *levels = NULL,
+               *padded = NULL;
+        int16_t *samples = NULL;
+        size_t nr_levels = 0,
+               nr_gap = 0,
+               nr_padded = 0,
+               nr_out = 0,
+               nr_samples = 0;
+        double symbol_rate = 0.0;
+        uint32_t deviation_hz = 0;
+
+        if (FAILED(ret = _encode_transmission(i, &levels, &nr_levels, &symbol_rate, &deviation_hz))) {
+            SGEN_MSG(SEV_FATAL, "ENCODE-FAIL", "Failed to encode transmission %u, aborting.", i);
+            goto done;
+        }
+
+        if (false == chan_ready) {
+            TSL_BUG_IF_FAILED(synth_channel_init(&chan, sample_rate, symbol_rate, deviation_hz, seed));
+            chan.freq_offset_hz = freq_offset_hz;
+            chan.drift_ppm = drift_ppm;
+            chan.add_noise = _add_noise;
+            chan.snr_db = snr_db;
+            chan_ready = true;
+        }
+
+        /* Follow each transmission with a gap of unmodulated carrier */
+        nr_gap = (size_t)(symbol_rate * gap_ms / 1000.0);
+        nr_padded = nr_levels + nr_gap;
+
+        TSL_BUG_IF_FAILED(TCALLOC((void **)&padded, sizeof(int8_t), nr_padded));
+        memcpy(padded, levels, nr_levels);
+
+        nr_out = synth_channel_nr_samples(&chan, nr_padded);
+        TSL_BUG_IF_FAILED(TCALLOC((void **)&samples, (_iq_output ? 2 : 1) * sizeof(int16_t), nr_out));
+
+        if (_iq_output) {
+            TSL_BUG_IF_FAILED(synth_channel_render_iq(&chan, padded, nr_padded, samples, nr_out, &nr_samples));
+        } else {
+            TSL_BUG_IF_FAILED(synth_channel_render_pcm(&chan, padded, nr_padded, samples, nr_out, &nr_samples));
+        }
+
+        ret = _write_samples(samples, nr_samples * (_iq_output ? 2 : 1) * sizeof(int16_t));
+
+        nr_total_samples += nr_samples;
+
+        TFREE(samples);
+        TFREE(padded);
+        TFREE(levels);
+
+        if (FAILED(ret)) {
+            goto done;
+        }
+    }
+
+    SGEN_MSG(SEV_INFO, "DONE", "Wrote %llu samples (%.2f seconds at %u Hz)", (unsigned long long)nr_total_samples,
+            (double)nr_total_samples / (double)sample_rate, sample_rate);
+
+done:
+    return ret;
+}
+
+int main(int argc, char * const argv[])
+{
+    int ret = EXIT_FAILURE;
+
+    TSL_BUG_IF_FAILED(app_init("synthgen", NULL));
+    TSL_BUG_IF_FAILED(app_sigint_catch(NULL));
+
+    _set_options(argc, argv);
+
+    SGEN_MSG(SEV_INFO, "STARTING", "Generating %u transmissions of %zu messages at %u Hz%s", repeat, nr_msgs,
+            sample_rate, _iq_output ? " (I/Q)" : "");
+
+    if (FAILED(generate_corpus())) {
+        goto done;
+    }
+
+    ret = EXIT_SUCCESS;
+
+done:
+    if (-1 != out_fd && STDOUT_FILENO != out_fd) {
+        close(out_fd);
+    }
+
+    if (NULL != msgs) {
+        TFREE(msgs);
+    }
+
+    return ret;
+}